@@ -32,6 +32,8 @@
 #define LCUI_FONT_H
 
 #include <LCUI/font/fontlibrary.h>
+#include <LCUI/font/fontcatalog.h>
+#include <LCUI/font/glyphcache.h>
 #include <LCUI/font/textstyle.h>
 #include <LCUI/font/textlayer.h>
 #include <LCUI/font/fontconfig.h>
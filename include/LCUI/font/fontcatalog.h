@@ -0,0 +1,92 @@
+/*
+ * fontcatalog.h -- The on-disk cache of the font information in font files
+ *
+ * Copyright (c) 2019, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_FONT_CATALOG_H
+#define LCUI_FONT_CATALOG_H
+
+#include <LCUI/util/dict.h>
+
+LCUI_BEGIN_HEADER
+
+/** 字体文件中的字体信息 */
+typedef struct LCUI_FontCatalogFaceRec_ {
+	int index;		/**< 字体在字体文件中的序号 */
+	char *family_name;	/**< 字族名称 */
+	char *style_name;	/**< 样式名称 */
+} LCUI_FontCatalogFaceRec, *LCUI_FontCatalogFace;
+
+/** 字体文件的记录 */
+typedef struct LCUI_FontCatalogFileRec_ {
+	char *path;			/**< 字体文件路径 */
+	int64_t mtime;			/**< 字体文件的修改时间 */
+	int64_t size;			/**< 字体文件的大小 */
+	int faces_length;		/**< 字体数量 */
+	LCUI_FontCatalogFaceRec *faces;	/**< 字体信息列表 */
+} LCUI_FontCatalogFileRec, *LCUI_FontCatalogFile;
+
+/**
+ * 字体目录
+ * 记录各个字体文件中有哪些字体，在字体文件未被修改时，载入字体只需读取记录，
+ * 不必打开字体文件，字体文件等到需要渲染字形时再打开。
+ */
+typedef struct LCUI_FontCatalogRec_ {
+	Dict *files;
+	DictType files_type;
+	LCUI_BOOL changed;	/**< 是否有未保存的改动 */
+} LCUI_FontCatalogRec, *LCUI_FontCatalog;
+
+LCUI_API void FontCatalog_Init(LCUI_FontCatalog catalog);
+
+LCUI_API void FontCatalog_Destroy(LCUI_FontCatalog catalog);
+
+/**
+ * 查找字体文件的记录
+ * @returns 字体文件的路径、修改时间或大小与记录的不一致时返回 NULL
+ */
+LCUI_API LCUI_FontCatalogFile FontCatalog_Find(LCUI_FontCatalog catalog,
+					       const char *path);
+
+/**
+ * 记录字体文件中的字体
+ * @param[in] fonts 字体列表，第 i 个字体是字体文件中的第 i 个字体，载入失败
+ *  的字体为 NULL
+ */
+LCUI_API int FontCatalog_Add(LCUI_FontCatalog catalog, const char *path,
+			     LCUI_Font *fonts, int n_fonts);
+
+/** 从缓存文件中读取字体目录 */
+LCUI_API int FontCatalog_Load(LCUI_FontCatalog catalog, const char *filepath);
+
+/** 将字体目录保存至缓存文件 */
+LCUI_API int FontCatalog_Save(LCUI_FontCatalog catalog, const char *filepath);
+
+LCUI_END_HEADER
+
+#endif
@@ -40,6 +40,14 @@ typedef enum LCUI_FontStyle {
 	FONT_STYLE_TOTAL_NUM
 } LCUI_FontStyle;
 
+/** 字体位图混合函数所用的指令集 */
+typedef enum LCUI_FontBitmapMixerType {
+	FONT_BITMAP_MIXER_AUTO,		/**< 根据 CPU 支持的指令集自动选择 */
+	FONT_BITMAP_MIXER_SCALAR,	/**< 不使用 SIMD 指令 */
+	FONT_BITMAP_MIXER_SSE2,
+	FONT_BITMAP_MIXER_AVX2
+} LCUI_FontBitmapMixerType;
+
 typedef enum LCUI_FontWeight {
 	FONT_WEIGHT_NONE = 0,
 	FONT_WEIGHT_THIN = 100,
@@ -77,13 +85,33 @@ typedef struct LCUI_FontRec_ {
 	LCUI_FontStyle style;		/**< 风格 */
 	LCUI_FontWeight weight;		/**< 粗细程度 */
 	LCUI_FontEngine *engine;	/**< 所属的字体引擎 */
+	uint64_t cache_key;		/**< 在字形缓存中的键值，为 0 时不缓存 */
 } LCUI_FontRec, *LCUI_Font;
 
+/** 字体位图缓存的统计信息 */
+typedef struct LCUI_FontBitmapCacheStatsRec_ {
+	size_t hits;		/**< 命中次数 */
+	size_t misses;		/**< 未命中次数，包括重新载入被回收的字体位图 */
+	size_t evictions;	/**< 被回收的字体位图数量 */
+	size_t glyphs;		/**< 已缓存的字体位图数量 */
+	size_t pages;		/**< 图集页数量 */
+	size_t bytes;		/**< 图集页占用的内存总量 */
+	size_t retired;		/**< 等待读取结束后释放的图集页和字形表数量 */
+	size_t limit;		/**< 内存用量限制 */
+} LCUI_FontBitmapCacheStatsRec, *LCUI_FontBitmapCacheStats;
+
 struct LCUI_FontEngine {
 	char name[64];
 	int(*open)(const char*, LCUI_Font**);
 	int(*render)(LCUI_FontBitmap*, wchar_t, int, LCUI_Font);
 	void(*close)(void*);
+	/**
+	 * 为字体文件中指定序号的字体创建字体数据，可以为 NULL
+	 * 字体信息已经从字体目录缓存中得知，不必立即打开字体文件
+	 */
+	void*(*open_face)(const char*, int);
+	/** 检查字体中是否有字符的字形，可以为 NULL */
+	LCUI_BOOL(*has_char)(LCUI_Font, wchar_t);
 };
 
 /**
@@ -138,6 +166,13 @@ LCUI_API int FontBitmap_Print(LCUI_FontBitmap *fontbmp);
 LCUI_API int FontBitmap_Mix(LCUI_Graph *graph, LCUI_Pos pos,
 			    const LCUI_FontBitmap *bmp, LCUI_Color color);
 
+/**
+ * 指定字体位图的混合函数
+ * 主要用于测试各个指令集版本的混合函数，默认会根据 CPU 支持的指令集自动选择
+ * @returns 未编译该版本或 CPU 不支持该指令集时返回 -ENOTSUP
+ */
+LCUI_API int FontBitmap_SetMixer(LCUI_FontBitmapMixerType type);
+
 /** 载入字体位图 */
 LCUI_API int LCUIFont_RenderBitmap(LCUI_FontBitmap *buff, wchar_t ch,
 				   int font_id, int pixel_size);
@@ -188,6 +223,17 @@ LCUI_API size_t LCUIFont_GetIdByNames(int **font_ids,
 				      LCUI_FontWeight weight,
 				      const char *names);
 
+/**
+ * 为字符选择字体
+ * 依次在字体列表、默认字体和其它已载入的字体中查找有该字符的字形的字体，其它
+ * 字体中与字体列表的首个字体风格和字重相同的字体优先。查找结果会被缓存，在载
+ * 入新的字体后失效。
+ * @param[in] font_ids 字体 ID 列表，以 0 结尾，可以为 NULL
+ * @return 选中的字体的 ID，所有字体都没有该字符时返回字体列表中的首个字体或默
+ *  认字体的 ID
+ */
+LCUI_API int LCUIFont_GetIdByChar(const int *font_ids, wchar_t ch);
+
 /** 获取指定字体ID的字体信息 */
 LCUI_API LCUI_Font LCUIFont_GetById(int id);
 
@@ -199,12 +245,15 @@ LCUI_API void LCUIFont_SetDefault(int id);
 
 /**
  * 向字体缓存中添加字体位图
+ * 已有相同字符的字体位图时会替换它，在 LCUIFont_BeginRead() 与
+ * LCUIFont_EndRead() 之间获取的旧位图在 LCUIFont_EndRead() 之前仍可读取。
  * @param[in] ch 字符码
  * @param[in] font_id 使用的字体ID
  * @param[in] size 字体大小（单位为像素）
- * @param[out] bmp 要添加的字体位图
- * @warning 此函数仅仅是将 bmp 复制进缓存中，并未重新分配新的空间储存位图数
- * 据，因此，请勿在调用此函数后手动释放 bmp。
+ * @param[in] bmp 要添加的字体位图
+ * @returns 缓存中的字体位图的引用
+ * @warning 位图数据 bmp->buffer 的所有权会转交给缓存，缓存复制完位图数据后会
+ * 释放它，因此，请勿在调用此函数后使用或释放 bmp->buffer。
  */
 LCUI_API LCUI_FontBitmap* LCUIFont_AddBitmap(wchar_t ch, int font_id,
 					     int size, const LCUI_FontBitmap *bmp);
@@ -216,14 +265,78 @@ LCUI_API LCUI_FontBitmap* LCUIFont_AddBitmap(wchar_t ch, int font_id,
  * @param[in] size 字体大小（单位为像素）
  * @param[out] bmp 输出的字体位图的引用
  * @warning 请勿释放 bmp，bmp 仅仅是引用缓存中的字体位图，并未建分配新
- * 空间存储字体位图的拷贝。
+ * 空间存储字体位图的拷贝。在其它线程可能替换或回收缓存时，需要在
+ * LCUIFont_BeginRead() 与 LCUIFont_EndRead() 之间获取和使用 bmp。
  */
 LCUI_API int LCUIFont_GetBitmap(wchar_t ch, int font_id, int size,
 				const LCUI_FontBitmap **bmp);
 
+/**
+ * 锁定缓存中的字体位图，使其在当前帧中不会因超出内存用量限制而被回收
+ * 在当前帧中获取过的字体位图已被锁定，锁定在调用 LCUIFont_EndFrame() 后解除。
+ * 被回收的字体位图的引用会失效，之后需要重新调用 LCUIFont_GetBitmap() 获取。
+ * @param[in] bmp 在当前的读取期间由 LCUIFont_GetBitmap() 获取的字体位图
+ * @returns 成功返回 0，bmp 不是缓存中的字体位图时返回 -1
+ */
+LCUI_API int LCUIFont_PinBitmap(const LCUI_FontBitmap *bmp);
+
+/**
+ * 结束当前帧
+ * 解除在当前帧中对字体位图的锁定，并按内存用量限制回收字体位图缓存。
+ * 被回收的数据会在所有已开始的读取结束后才释放，因此可以在其它线程仍在
+ * 绘制时调用。
+ */
+LCUI_API void LCUIFont_EndFrame(void);
+
+/**
+ * 开始读取字体位图缓存
+ * 在调用 LCUIFont_EndRead() 之前，获取到的字体位图都不会被释放，
+ * 读取期间不应长时间阻塞，否则被替换和回收的数据会一直无法释放。
+ * @returns 读取时所处的回收周期，需要传给 LCUIFont_EndRead()
+ */
+LCUI_API size_t LCUIFont_BeginRead(void);
+
+/** 结束读取字体位图缓存 */
+LCUI_API void LCUIFont_EndRead(size_t epoch);
+
+/**
+ * 设置字体位图缓存的内存用量限制
+ * @param[in] max_bytes 最大内存用量（单位为字节），为 0 时不限制
+ */
+LCUI_API void LCUIFont_SetBitmapCacheLimit(size_t max_bytes);
+
+/**
+ * 回收字体位图缓存，适用于内存不足时
+ * 被锁定的字体位图不会被回收，因此实际内存用量可能仍会大于 max_bytes。
+ * @param[in] max_bytes 回收后的最大内存用量（单位为字节）
+ * @returns 被回收的内存量
+ */
+LCUI_API size_t LCUIFont_TrimBitmapCache(size_t max_bytes);
+
+/** 获取字体位图缓存的统计信息 */
+LCUI_API void LCUIFont_GetBitmapCacheStats(LCUI_FontBitmapCacheStats stats);
+
 /** 载入字体至数据库中 */
 LCUI_API int LCUIFont_LoadFile(const char *filepath);
 
+/**
+ * 设置字体目录缓存文件的路径，需要在初始化字体处理模块之前设置
+ * 缓存文件记录了已载入的字体文件中的字体信息，在字体文件未被修改时，再次载
+ * 入它不用打开字体文件，以减少启动耗时。
+ * @param[in] path 缓存文件的路径，为 NULL 时使用环境变量 LCUI_FONT_CACHE
+ *  的值，未设置该环境变量或者路径为空字符串时不使用缓存
+ */
+LCUI_API void LCUIFont_SetCatalogCachePath(const char *path);
+
+/**
+ * 设置字形缓存文件的路径，需要在初始化字体处理模块之前设置
+ * 缓存文件保存了渲染过的字体位图，再次启动时直接从中读取，以减少首屏渲染文字
+ * 的耗时。新渲染的字体位图会在停用字体处理模块时写入缓存文件。
+ * @param[in] path 缓存文件的路径，为 NULL 时使用环境变量 LCUI_GLYPH_CACHE
+ *  的值，未设置该环境变量或者路径为空字符串时不使用缓存
+ */
+LCUI_API void LCUIFont_SetGlyphCachePath(const char *path);
+
 /** 初始化字体处理模块 */
 LCUI_API void LCUI_InitFontLibrary(void);
 
@@ -0,0 +1,112 @@
+/*
+ * glyphcache.h -- The on-disk cache of the rendered glyph bitmaps
+ *
+ * Copyright (c) 2019, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_FONT_GLYPH_CACHE_H
+#define LCUI_FONT_GLYPH_CACHE_H
+
+#include <LCUI/util/linkedlist.h>
+#include <LCUI/thread.h>
+
+LCUI_BEGIN_HEADER
+
+/** 字形缓存文件中的字形记录 */
+typedef struct LCUI_GlyphCacheEntryRec_ {
+	uint64_t font_key;	/**< 字体的键值 */
+	uint32_t code;		/**< 字符码 */
+	int32_t size;		/**< 像素大小 */
+	int32_t top;
+	int32_t left;
+	int32_t width;
+	int32_t rows;
+	int32_t pitch;
+	int32_t num_grays;
+	int32_t pixel_mode;
+	int32_t advance_x;
+	int32_t advance_y;
+	uint32_t offset;	/**< 位图数据在缓存文件中的偏移量 */
+} LCUI_GlyphCacheEntryRec, *LCUI_GlyphCacheEntry;
+
+/**
+ * 字形缓存
+ * 将渲染好的字体位图保存至缓存文件中，下次启动时直接从缓存文件中读取，不必再
+ * 用字体引擎渲染。缓存文件会被映射至内存中，其中的字形记录按字体的键值、字符
+ * 码和像素大小排序，可直接用二分查找定位。
+ * 新增的字形在保存前都留在内存中，它们占用的内存超出限制后，之后新增的字形会
+ * 被丢弃，等到下次启动时再重新渲染。
+ */
+typedef struct LCUI_GlyphCacheRec_ {
+	uchar_t *data;		/**< 缓存文件的内容 */
+	size_t size;		/**< 缓存文件的大小 */
+	LCUI_BOOL mapped;	/**< 缓存文件的内容是否是映射至内存中的 */
+	size_t length;		/**< 缓存文件中的字形数量 */
+	const LCUI_GlyphCacheEntryRec *entries;
+	LinkedList glyphs;	/**< 新增的、尚未保存的字形 */
+	size_t glyphs_size;	/**< 新增的字形占用的内存大小 */
+	LCUI_Mutex mutex;	/**< 用于保护新增的字形列表 */
+} LCUI_GlyphCacheRec, *LCUI_GlyphCache;
+
+LCUI_API void GlyphCache_Init(LCUI_GlyphCache cache);
+
+LCUI_API void GlyphCache_Destroy(LCUI_GlyphCache cache);
+
+/**
+ * 获取字体文件中的字体的键值
+ * 键值由字体文件的路径、修改时间、大小和字体的序号计算而来，字体文件被修改后
+ * 键值也随之改变，缓存文件中原有的字形不会再被用到。
+ * @returns 字体文件不存在时返回 0
+ */
+LCUI_API uint64_t GlyphCache_GetFontKey(const char *path, int index);
+
+/**
+ * 从缓存中读取字体位图
+ * @param[out] bmp 字体位图，其位图数据是新分配的，需用 FontBitmap_Free() 释放
+ * @returns 找到时返回 0，否则返回负数
+ */
+LCUI_API int GlyphCache_Read(LCUI_GlyphCache cache, uint64_t font_key,
+			     unsigned code, int size, LCUI_FontBitmap *bmp);
+
+/**
+ * 将字体位图存入缓存，它会在保存缓存文件时被写入
+ * 可在多个线程中同时调用，新增的字形占用的内存超出限制时，不再存入。
+ * @returns 存入时返回 0，超出限制时返回 -ENOSPC，其它错误时返回负数
+ */
+LCUI_API int GlyphCache_Add(LCUI_GlyphCache cache, uint64_t font_key,
+			    unsigned code, int size,
+			    const LCUI_FontBitmap *bmp);
+
+/** 载入缓存文件，格式不对的缓存文件会被忽略 */
+LCUI_API int GlyphCache_Load(LCUI_GlyphCache cache, const char *filepath);
+
+/** 将缓存文件中原有的字形和新增的字形一起保存至缓存文件 */
+LCUI_API int GlyphCache_Save(LCUI_GlyphCache cache, const char *filepath);
+
+LCUI_END_HEADER
+
+#endif
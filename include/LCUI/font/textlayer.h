@@ -33,12 +33,38 @@
 
 LCUI_BEGIN_HEADER
 
+/**
+ * 文本字符
+ * 字符数据直接存放在文本行的字符数组中，样式以序号的形式引用文本图层的样式表，
+ * 以减少大量文本占用的内存
+ * 注意：style 成员原先是 LCUI_TextStyle 指针，现在是样式表中的序号，从 1 开始，
+ * 这是一个不兼容的改动，直接访问该成员的代码需要改用 text_styles[style - 1]
+ */
 typedef struct LCUI_TextCharRec_ {
 	wchar_t code;                  /**< 字符码 */
-	LCUI_TextStyle style;          /**< 该字符使用的样式数据 */
-	const LCUI_FontBitmap *bitmap; /**< 字体位图数据(只读) */
+	unsigned style;                /**< 样式序号，为 0 时表示使用全局样式 */
+	const LCUI_FontBitmap *bitmap; /**< 字体位图的度量信息(只读)，不含位图数据 */
 } LCUI_TextCharRec, *LCUI_TextChar;
 
+/**
+ * 文本图层中的字形
+ * 字体位图缓存中的字体位图可能会被回收，因此文本图层保存了一份度量信息供排版
+ * 使用，位图数据在绘制时再从字体位图缓存中获取。
+ */
+typedef struct LCUI_TextGlyphRec_ {
+	LCUI_FontBitmap bitmap; /**< 字体位图的度量信息，位图数据为 NULL */
+	wchar_t code;           /**< 字符码 */
+	int font_id;            /**< 字体ID */
+	int size;               /**< 字体大小（单位为像素），为 0 时表示没有字形 */
+} LCUI_TextGlyphRec, *LCUI_TextGlyph;
+
+/** 字形表，以字符码、字体ID和字体大小索引字形 */
+typedef struct LCUI_TextGlyphTableRec_ {
+	size_t size;           /**< 槽位数量，为 2 的幂 */
+	size_t length;         /**< 字形数量 */
+	LCUI_TextGlyph *slots; /**< 槽位 */
+} LCUI_TextGlyphTableRec, *LCUI_TextGlyphTable;
+
 /** End Of Line character */
 typedef enum LCUI_EOLChar {
 	LCUI_EOL_NONE, /**< 无换行 */
@@ -47,19 +73,38 @@ typedef enum LCUI_EOLChar {
 	LCUI_EOL_CR_LF /**< Windows 格式换行： \r\n */
 } LCUI_EOLChar;
 
+/**
+ * 文本行中的词语
+ * 词语以可断行的字符结尾，记录词语的宽度后，重新断行时只需逐个词语累加宽度
+ */
+typedef struct LCUI_TextWordRec_ {
+	int end;    /**< 词语的结束位置，即下一个词语的开始位置 */
+	int width;  /**< 词语的宽度 */
+	int height; /**< 词语中最大字体的高度 */
+} LCUI_TextWordRec, *LCUI_TextWord;
+
 /* 文本行 */
 typedef struct TextRowRec_ {
+	int y;                 /**< 相对于首行顶部的Y轴坐标，按需计算 */
+	size_t offset;         /**< 行首在文本中的位置，按需计算 */
 	int width;             /**< 宽度 */
 	int height;            /**< 高度 */
 	int text_height;       /**< 当前行中最大字体的高度 */
 	int length;            /**< 该行文本长度 */
-	LCUI_TextChar *string; /**< 该行文本的数据 */
+	int capacity;          /**< 字符数组的容量 */
+	int *chars_x;          /**< 各个字符的X轴坐标，按需计算 */
+	int words_length;      /**< 词语数量 */
+	LCUI_TextWord words;   /**< 各个词语的尺寸，按需计算 */
+	LCUI_TextChar string;  /**< 该行文本的字符数组 */
 	LCUI_EOLChar eol;      /**< 行尾结束类型 */
+	LCUI_BOOL need_typeset; /**< 是否需要重新排版 */
 } LCUI_TextRowRec, *LCUI_TextRow;
 
 /* 文本行列表 */
 typedef struct LCUI_TextRowListRec_ {
 	int length;         /**< 当前总行数 */
+	int valid_y_length; /**< Y轴坐标有效的行数 */
+	int valid_offset_length; /**< 行首位置有效的行数 */
 	LCUI_TextRow *rows; /**< 每一行文本的数据 */
 } LCUI_TextRowListRec, *LCUI_TextRowList;
 
@@ -103,9 +148,12 @@ typedef struct LCUI_TextLayerRec_ {
 	LCUI_BOOL enable_autowrap;     /**< 是否启用自动换行模式 */
 	LCUI_BOOL enable_style_tag;    /**< 是否使用文本样式标签 */
 	LinkedList dirty_rects;               /**< 脏矩形记录 */
-	LinkedList text_styles;               /**< 样式缓存 */
+	LCUI_TextStyle *text_styles;          /**< 样式表，已释放的样式为 NULL */
+	size_t *text_style_refs;              /**< 各个样式被字符引用的次数 */
+	unsigned text_styles_length;          /**< 样式表中的样式数量 */
 	LCUI_TextStyleRec text_default_style; /**< 文本全局样式 */
 	LCUI_TextRowListRec text_rows;        /**< 文本行列表 */
+	LCUI_TextGlyphTableRec glyphs;        /**< 文本中用到的字形 */
 	struct {
 		LCUI_BOOL update_bitmap;  /**< 更新文本的字体位图 */
 		LCUI_BOOL update_typeset; /**< 重新对文本进行排版 */
@@ -191,6 +239,13 @@ LCUI_API int TextLayer_SetTextA(LCUI_TextLayer layer, const char *ascii_text);
 /** 设置文本内容（UTF-8版） */
 LCUI_API int TextLayer_SetText(LCUI_TextLayer layer, const char *utf8_text);
 
+/**
+ * 获取指定行列在文本中的位置
+ * 行尾符按它的字符数计算，即 CR LF 算作两个字符。各行的行首位置会被缓存，修改
+ * 文本后只需重新计算被修改的行后面的行，在同一行中连续编辑时不必遍历各行。
+ */
+LCUI_API size_t TextLayer_GetTextOffset(LCUI_TextLayer layer, int row, int col);
+
 /** 获取文本图层中的文本（宽字符版） */
 LCUI_API size_t TextLayer_GetTextW(LCUI_TextLayer layer, size_t start_pos,
 				   size_t max_len, wchar_t *wstr_buff);
@@ -39,6 +39,8 @@ LCUI_BEGIN_HEADER
 
 #define MAX_SELECTOR_LEN	1024
 #define MAX_SELECTOR_DEPTH	32
+#define SELECTOR_BLOOM_FILTER_SIZE	8
+#define LCUI_COMPILED_CSS_MAGIC	"LCUICSSB"
 
  /** 样式属性名 */
 enum LCUI_StyleKeyName {
@@ -154,9 +156,19 @@ enum LCUI_StyleKeyName {
 #define key_box_shadow_start	key_box_shadow_x
 #define key_box_shadow_end	key_box_shadow_color
 
+/**
+ * 样式表
+ * 只存放设置过的样式，用位图标记有哪些属性，样式按属性键从小到大紧凑排列，
+ * 需要通过 StyleSheet_GetStyle() 和 StyleSheet_AddStyle() 访问其中的样式
+ * 注意：原先的 sheet 成员是以属性键为下标的样式数组，现已移除，这是一个不兼容
+ * 的改动
+ */
 typedef struct LCUI_StyleSheetRec_ {
-	LCUI_Style sheet;
-	int length;
+	unsigned *bits;			/**< 属性键位图 */
+	int bits_length;		/**< 位图的长度 */
+	LCUI_Style styles;		/**< 样式列表 */
+	int length;			/**< 样式数量 */
+	int capacity;			/**< 样式列表的容量 */
 } LCUI_StyleSheetRec, *LCUI_StyleSheet;
 
 typedef const LCUI_StyleSheetRec *LCUI_CachedStyleSheet;
@@ -170,6 +182,14 @@ typedef struct LCUI_StyleListNodeRec_ {
 	LinkedListNode node;
 } LCUI_StyleListNodeRec, *LCUI_StyleListNode;
 
+/**
+ * 选择器名称的布隆过滤器
+ * 记录了类型名、ID、类名和状态名的原子，用于快速判断名称是否不存在
+ */
+typedef struct LCUI_SelectorBloomFilterRec_ {
+	unsigned bits[SELECTOR_BLOOM_FILTER_SIZE];
+} LCUI_SelectorBloomFilterRec, *LCUI_SelectorBloomFilter;
+
 /** 选择器结点结构 */
 typedef struct LCUI_SelectorNodeRec_ {
 	char *id;			/**< ID */
@@ -178,6 +198,10 @@ typedef struct LCUI_SelectorNodeRec_ {
 	char **status;			/**< 状态列表 */
 	char *fullname;			/**< 全名，由 id、type、classes、status 组合而成 */
 	int rank;			/**< 权值 */
+	unsigned hash;			/**< 全名的哈希值 */
+	unsigned *atoms;		/**< 各个名称的原子，已按从小到大排序 */
+	unsigned atoms_length;		/**< 原子的数量 */
+	LCUI_SelectorBloomFilterRec bloom;	/**< 名称的布隆过滤器 */
 } LCUI_SelectorNodeRec, *LCUI_SelectorNode;
 
 /** 选择器结构 */
@@ -191,22 +215,23 @@ typedef struct LCUI_SelectorRec_ {
 
 /* clang-format on */
 
-#define CheckStyleType(S, K, T) \
-	(S->sheet[K].is_valid && S->sheet[K].type == LCUI_STYPE_##T)
+#define CheckStyleType(S, K, T) StyleSheet_CheckStyleType(S, K, LCUI_STYPE_##T)
 
-#define SetStyle(S, NAME, VAL, TYPE)             \
-	S->sheet[NAME].is_valid = TRUE,          \
-	S->sheet[NAME].type = LCUI_STYPE_##TYPE, \
-	S->sheet[NAME].val_##TYPE = VAL
+#define SetStyle(S, NAME, VAL, TYPE)                     \
+	do {                                             \
+		LCUI_Style _s;                           \
+		_s = StyleSheet_AddStyle(S, NAME);       \
+		if (_s) {                                \
+			_s->is_valid = TRUE;             \
+			_s->type = LCUI_STYPE_##TYPE;    \
+			_s->val_##TYPE = VAL;            \
+		}                                        \
+	} while (0)
 
-#define UnsetStyle(S, NAME)              \
-	S->sheet[NAME].is_valid = FALSE, \
-	S->sheet[NAME].type = LCUI_STYPE_NONE, S->sheet[NAME].val_int = 0
+#define UnsetStyle(S, NAME) StyleSheet_RemoveStyle(S, NAME)
 
 #define LCUI_FindStyleSheet(S, L) LCUI_FindStyleSheetFromGroup(0, NULL, S, L)
 
-#define StyleSheet_GetStyle(S, K) &((S)->sheet[K])
-
 LCUI_API void DestroyStyle(LCUI_Style s);
 
 LCUI_API void MergeStyle(LCUI_Style dst, LCUI_Style src);
@@ -227,6 +252,26 @@ LCUI_API void StyleSheet_Clear(LCUI_StyleSheet ss);
 
 LCUI_API void StyleSheet_Delete(LCUI_StyleSheet ss);
 
+/**
+ * 获取样式表中的样式，只用于读取样式值
+ * 如果样式表中没有该样式，则返回一个共享的无效样式，它会在多个线程中被同时
+ * 读取，因此返回值是只读的，需要修改样式时应使用 StyleSheet_AddStyle()
+ */
+LCUI_API const LCUI_StyleRec *StyleSheet_GetStyle(const LCUI_StyleSheetRec *ss,
+						  int key);
+
+/**
+ * 获取样式表中的样式，如果没有则添加一个无效的样式，用于写入样式值
+ * @returns 内存不足或 key 无效时返回 NULL
+ */
+LCUI_API LCUI_Style StyleSheet_AddStyle(LCUI_StyleSheet ss, int key);
+
+/** 移除样式表中的样式 */
+LCUI_API void StyleSheet_RemoveStyle(LCUI_StyleSheet ss, int key);
+
+LCUI_API LCUI_BOOL StyleSheet_CheckStyleType(const LCUI_StyleSheetRec *ss,
+					     int key, LCUI_StyleType type);
+
 LCUI_API int StyleSheet_Merge(LCUI_StyleSheet dest,
 			      const LCUI_StyleSheetRec *src);
 
@@ -262,6 +307,46 @@ LCUI_API LCUI_BOOL SelectorNode_Match(LCUI_SelectorNode sn1,
 LCUI_API int LCUI_PutStyleSheet(LCUI_Selector selector, LCUI_StyleSheet in_ss,
 				const char *space);
 
+/**
+ * 开始批量添加样式表
+ * 在调用 LCUI_EndPutStyleSheets() 之前，受影响的样式表缓存不会被清除
+ */
+LCUI_API void LCUI_BeginPutStyleSheets(void);
+
+/** 结束批量添加样式表，一次性清除受到这批样式表影响的缓存 */
+LCUI_API void LCUI_EndPutStyleSheets(void);
+
+/**
+ * 锁定样式库
+ * 在调用 LCUI_UnlockCSSLibrary() 之前，其它线程不能读取或修改样式库，
+ * 可用于让一批样式表在其它线程看来是一次性添加的
+ */
+LCUI_API void LCUI_LockCSSLibrary(void);
+
+/** 解除样式库的锁定 */
+LCUI_API void LCUI_UnlockCSSLibrary(void);
+
+/**
+ * 获取样式表缓存的版本号
+ * 每当有缓存被清除时，版本号都会改变，在版本号不变的情况下，之前通过
+ * LCUI_GetCachedStyleSheet() 获取的样式表仍然有效
+ */
+LCUI_API unsigned LCUI_GetStyleSheetCacheVersion(void);
+
+/**
+ * 获取以指定名称索引的样式表缓存数量
+ * @param[in] name 选择器末尾结点中的名称，例如：#id、.class、:status
+ */
+LCUI_API size_t LCUI_GetStyleSheetCacheIndexSize(const char *name);
+
+/**
+ * 判断类或状态名称是否出现在某个选择器的祖先结点中
+ * 如果没有出现，那么在部件上切换这个类或状态不会影响子级部件的样式
+ * @param[in] prefix 名称前缀，'.' 表示类，':' 表示状态
+ * @param[in] name 类或状态的名称
+ */
+LCUI_API LCUI_BOOL LCUI_IsAncestorSelectorName(char prefix, const char *name);
+
 /**
  * 从指定组中查找样式表
  * @param[in] group 组号
@@ -292,6 +377,29 @@ LCUI_API const char *LCUI_GetStyleName(int key);
 
 LCUI_API int LCUI_GetStyleTotal(void);
 
+/**
+ * 将样式库中的样式规则保存为预编译样式表
+ * 预编译样式表中存放的是已经解析好的选择器和样式，载入时不需要再解析 CSS 代码，
+ * 可以在构建时生成，然后在程序启动时用 LCUI_LoadCompiledCSSFile() 载入。
+ * 它只能被同一版本、同一平台的 LCUI 载入，@font-face 规则不会被保存。
+ * @param[in] filepath 预编译样式表的文件路径
+ * @param[in] space 只保存属于该空间的样式规则，例如 LCUI_LoadCSSFile() 载入的
+ *  CSS 文件的路径，为 NULL 时保存全部样式规则
+ * @returns 成功时返回无法保存而被跳过的样式数量，例如图像样式，失败时返回
+ *  负数
+ */
+LCUI_API int LCUI_SaveCompiledCSS(const char *filepath, const char *space);
+
+/**
+ * 从内存中载入预编译样式表
+ * @param[in] data 预编译样式表的内容，需要按 4 字节对齐
+ * @returns 成功返回 0，格式不对时返回 -2
+ */
+LCUI_API int LCUI_LoadCompiledCSS(const void *data, size_t size);
+
+/** 载入预编译样式表文件，文件会被映射至内存中读取 */
+LCUI_API int LCUI_LoadCompiledCSSFile(const char *filepath);
+
 LCUI_API void LCUI_PrintStyleSheet(LCUI_StyleSheet ss);
 
 LCUI_API void LCUI_PrintSelector(LCUI_Selector selector);
@@ -41,9 +41,11 @@ LCUI_BEGIN_HEADER
 	case '\r':       \
 	case '\t'
 
-#define CSSParser_GetChar(CTX)                               \
-	do {                                                 \
-		(CTX)->buffer[(ctx)->pos++] = *((CTX)->cur); \
+#define CSSParser_GetChar(CTX)                                         \
+	do {                                                           \
+		if ((size_t)(CTX)->pos + 1 < (CTX)->buffer_size) {    \
+			(CTX)->buffer[(CTX)->pos++] = *((CTX)->cur);  \
+		}                                                      \
 	} while (0);
 
 typedef enum LCUI_CSSParserTarget {
@@ -132,6 +134,14 @@ struct LCUI_CSSParserRuleContextRec_ {
 	LCUI_CSSRuleParsers parsers; /**< 规则解析器列表 */
 };
 
+/** 解析后暂存的样式规则，稍后再添加至样式库 */
+typedef struct LCUI_CSSParsedRuleRec_ {
+	LCUI_CSSRule type;     /**< 规则类型，普通的样式规则为 CSS_RULE_NONE */
+	LinkedList selectors;  /**< 选择器文本列表 */
+	LCUI_StyleSheet sheet; /**< 样式表 */
+	char *font_src;        /**< @font-face 规则中的字体文件路径 */
+} LCUI_CSSParsedRuleRec, *LCUI_CSSParsedRule;
+
 /** CSS 代码解析器的环境参数（上下文数据） */
 struct LCUI_CSSParserContextRec_ {
 	int pos;            /**< 缓存中的字符串的下标位置 */
@@ -146,6 +156,13 @@ struct LCUI_CSSParserContextRec_ {
 	LCUI_CSSParserRuleContextRec rule;
 	LCUI_CSSParserStyleContextRec style;
 	LCUI_CSSParserCommentContextRec comment;
+
+	/**
+	 * 暂存解析结果的规则列表
+	 * 为 NULL 时解析出的样式表会直接添加至样式库，否则只记录在该列表中，
+	 * 此时解析过程不会访问样式库，可以在其它线程中进行
+	 */
+	LinkedList *rules;
 };
 
 LCUI_API int LCUI_GetStyleValue(const char *str);
@@ -162,9 +179,20 @@ LCUI_API void CSSStyleParser_SetCSSProperty(LCUI_CSSParserStyleContext ctx,
 
 LCUI_API LCUI_CSSPropertyParser LCUI_GetCSSPropertyParser(const char *name);
 
-/** 从文件中载入CSS样式数据，并导入至样式库中 */
+/**
+ * 从文件中载入CSS样式数据，并导入至样式库中
+ * 如果文件是用 LCUI_SaveCompiledCSS() 生成的预编译样式表，则直接载入它
+ */
 LCUI_API int LCUI_LoadCSSFile(const char *filepath);
 
+/**
+ * 从多个文件中载入CSS样式数据
+ * 文件会在多个线程中同时解析，然后按照它们在数组中的顺序一次性导入至样式
+ * 库中，样式的优先级与依次调用 LCUI_LoadCSSFile() 载入这些文件时相同
+ * @returns 成功载入的文件数量
+ */
+LCUI_API size_t LCUI_LoadCSSFiles(const char **filepaths, size_t n_files);
+
 /** 从字符串中载入CSS样式数据，并导入至样式库中 */
 LCUI_API size_t LCUI_LoadCSSString(const char *str, const char *space);
 
@@ -258,6 +258,13 @@ typedef struct LCUI_WidgetRec_ {
 	char *type;
 	strlist_t classes;
 	strlist_t status;
+
+	/**
+	 * Selector node cached for style lookups
+	 * It is rebuilt after the id, classes or status has changed
+	 */
+	LCUI_SelectorNode selector_node;
+
 	wchar_t *title;
 	Dict *attributes;
 	LCUI_BOOL disabled;
@@ -67,7 +67,8 @@ LCUI_API LCUI_Style Widget_GetStyle(LCUI_Widget w, int key);
 
 LCUI_API int Widget_UnsetStyle(LCUI_Widget w, int key);
 
-LCUI_API LCUI_Style Widget_GetInheritedStyle(LCUI_Widget w, int key);
+LCUI_API const LCUI_StyleRec *Widget_GetInheritedStyle(LCUI_Widget w,
+						       int key);
 
 LCUI_API LCUI_BOOL Widget_CheckStyleBooleanValue(LCUI_Widget w, int key,
 						 LCUI_BOOL value);
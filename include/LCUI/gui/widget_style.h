@@ -90,9 +90,25 @@ LCUI_API void Widget_ExecUpdateStyle(LCUI_Widget w, LCUI_BOOL is_update_all);
 
 LCUI_API void Widget_DestroyStyleSheets(LCUI_Widget w);
 
-/** 获取选择器结点 */
+/** 获取选择器结点，用完后需调用 SelectorNode_Delete() 释放 */
 LCUI_SelectorNode Widget_GetSelectorNode(LCUI_Widget w);
 
+/** 获取部件缓存的选择器结点，该结点由部件持有，不需要释放 */
+LCUI_API LCUI_SelectorNode Widget_GetCachedSelectorNode(LCUI_Widget w);
+
+/** 清除部件缓存的选择器结点，在 id、类或状态变化后调用 */
+void Widget_InvalidateSelectorNode(LCUI_Widget w);
+
+/**
+ * 初始化部件的选择器
+ * 选择器直接引用部件及其祖先缓存的选择器结点，用完后不需要释放
+ * @param[out] s 选择器
+ * @param[in] nodes 结点列表，容量为 MAX_SELECTOR_DEPTH
+ * @returns 成功返回 0，部件层级过深则返回 -1
+ */
+LCUI_API int Widget_InitSelector(LCUI_Widget w, LCUI_Selector s,
+				 LCUI_SelectorNode *nodes);
+
 /** 获取选择器 */
 LCUI_API LCUI_Selector Widget_GetSelector(LCUI_Widget w);
 
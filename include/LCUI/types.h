@@ -447,6 +447,8 @@ typedef struct LCUI_WidgetTasksRec_ {
 	size_t user_task_count;
 	size_t destroy_count;
 	size_t destroy_time;
+	size_t style_share_count;
+	size_t style_lookup_count;
 } LCUI_WidgetTasksProfileRec, *LCUI_WidgetTasksProfile;
 
 typedef struct LCUI_FrameProfileRec_ {
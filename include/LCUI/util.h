@@ -41,6 +41,8 @@
 #include <LCUI/util/steptimer.h>
 #include <LCUI/util/string.h>
 #include <LCUI/util/strpool.h>
+#include <LCUI/util/atom.h>
+#include <LCUI/util/rope.h>
 #include <LCUI/util/strlist.h>
 #include <LCUI/util/parse.h>
 #include <LCUI/util/event.h>
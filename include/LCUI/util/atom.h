@@ -0,0 +1,65 @@
+﻿/*
+ * atom.h -- the table of interned names
+ *
+ * Copyright (c) 2019, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_UTIL_ATOM_H
+#define LCUI_UTIL_ATOM_H
+
+/**
+ * 原子
+ * 每个不同的名称对应一个从 1 开始编号的原子，比较原子即可判断名称是否相同，
+ * 原子在原子表被销毁前一直有效
+ */
+typedef unsigned atom_t;
+
+#define ATOM_NONE 0
+
+/**
+ * 初始化原子表
+ * 首次获取原子时会自动初始化，但初始化和销毁都没有加锁，需要在其它线程使用
+ * 原子表之前完成。CSS 库会在初始化时调用它。
+ */
+LCUI_API void atom_table_init(void);
+
+/** 销毁原子表，之前获取的原子和名称都将失效 */
+LCUI_API void atom_table_destroy(void);
+
+/** 获取名称对应的原子，名称还没有原子时会为它新建一个 */
+LCUI_API atom_t atom_from_str(const char *str);
+
+/** 查找名称对应的原子，名称还没有原子时返回 ATOM_NONE */
+LCUI_API atom_t atom_find(const char *str);
+
+/** 获取原子对应的名称 */
+LCUI_API const char *atom_to_str(atom_t atom);
+
+/** 获取原子的数量 */
+LCUI_API size_t atom_count(void);
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * rope.h -- rope, a text buffer for efficient editing of long text
+ *
+ * Copyright (c) 2019, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCUI_UTIL_ROPE_H
+#define LCUI_UTIL_ROPE_H
+
+LCUI_BEGIN_HEADER
+
+typedef struct RopeNodeRec_ RopeNode;
+typedef struct RopeRec_ Rope;
+
+/**
+ * 绳索（Rope）
+ * 将文本分成多个定长的块，存放在以字符位置为序的平衡树中，插入和删除文本
+ * 只需要修改少数几个块，耗时与文本长度的对数成正比
+ */
+struct RopeRec_ {
+	RopeNode *root;
+	unsigned seed;
+};
+
+LCUI_API void Rope_Init(Rope *rope);
+
+/** 清空绳索中的文本 */
+LCUI_API void Rope_Clear(Rope *rope);
+
+/** 获取文本长度 */
+LCUI_API size_t Rope_GetLength(const Rope *rope);
+
+/** 获取指定位置的字符，位置超出范围时返回 0 */
+LCUI_API wchar_t Rope_GetChar(const Rope *rope, size_t pos);
+
+/**
+ * 在指定位置插入文本
+ * @returns 成功时返回 0，内存不足时返回 -ENOMEM
+ */
+LCUI_API int Rope_Insert(Rope *rope, size_t pos, const wchar_t *wcs,
+			 size_t len);
+
+/** 删除从指定位置开始的文本 */
+LCUI_API void Rope_Delete(Rope *rope, size_t pos, size_t len);
+
+/**
+ * 获取从指定位置开始的文本
+ * @param[out] buf 文本缓存，至少需要能容纳 max_len + 1 个字符
+ * @returns 获取到的字符数
+ */
+LCUI_API size_t Rope_GetText(const Rope *rope, size_t pos, size_t max_len,
+			     wchar_t *buf);
+
+LCUI_END_HEADER
+
+#endif
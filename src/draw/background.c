@@ -49,6 +49,10 @@ void Background_Paint(const LCUI_Background *bg,
 	Graph_Init(&buffer);
 	Graph_Quote(&graph, &paint->canvas, &rect);
 	Graph_FillRect(&graph, bg->color, NULL, TRUE);
+	/* 图像可能还未解码完成，只有尺寸信息 */
+	if (!Graph_IsValid(bg->image)) {
+		return;
+	}
 	/* 将坐标转换为相对于背景内容框 */
 	rect.x += paint->rect.x - box->x;
 	rect.y += paint->rect.y - box->y;
@@ -0,0 +1,347 @@
+/*
+ * fontcatalog.c -- The on-disk cache of the font information in font files
+ *
+ * Copyright (c) 2019, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/util.h>
+#include <LCUI/font.h>
+
+#define FONT_CATALOG_HEADER "LCUI font catalog 1"
+#define FONT_CATALOG_LINE_SIZE 1024
+
+static void FontCatalogFile_Destroy(LCUI_FontCatalogFile file)
+{
+	int i;
+
+	for (i = 0; i < file->faces_length; ++i) {
+		free(file->faces[i].family_name);
+		free(file->faces[i].style_name);
+	}
+	free(file->faces);
+	free(file->path);
+	free(file);
+}
+
+static void OnDestroyFontCatalogFile(void *privdata, void *data)
+{
+	FontCatalogFile_Destroy(data);
+}
+
+static LCUI_FontCatalogFile FontCatalogFile_Create(const char *path,
+						   int64_t mtime, int64_t size,
+						   int n_faces)
+{
+	LCUI_FontCatalogFile file;
+
+	file = malloc(sizeof(LCUI_FontCatalogFileRec));
+	if (!file) {
+		return NULL;
+	}
+	file->path = strdup2(path);
+	file->mtime = mtime;
+	file->size = size;
+	file->faces_length = 0;
+	file->faces = calloc(max(n_faces, 1), sizeof(LCUI_FontCatalogFaceRec));
+	if (!file->path || !file->faces) {
+		FontCatalogFile_Destroy(file);
+		return NULL;
+	}
+	return file;
+}
+
+/** 名称中不能有换行符和制表符，否则无法写入缓存文件 */
+static LCUI_BOOL FontCatalog_IsValidName(const char *name)
+{
+	return name && !strpbrk(name, "\t\r\n");
+}
+
+static int FontCatalogFile_AddFace(LCUI_FontCatalogFile file, int index,
+				   const char *family_name,
+				   const char *style_name)
+{
+	LCUI_FontCatalogFace face = &file->faces[file->faces_length];
+
+	if (!FontCatalog_IsValidName(family_name) ||
+	    !FontCatalog_IsValidName(style_name)) {
+		return -1;
+	}
+	face->index = index;
+	face->family_name = strdup2(family_name);
+	face->style_name = strdup2(style_name);
+	file->faces_length += 1;
+	if (!face->family_name || !face->style_name) {
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static int FontCatalog_Put(LCUI_FontCatalog catalog,
+			   LCUI_FontCatalogFile file)
+{
+	Dict_Delete(catalog->files, file->path);
+	if (Dict_Add(catalog->files, file->path, file) != 0) {
+		FontCatalogFile_Destroy(file);
+		return -1;
+	}
+	return 0;
+}
+
+/** 获取文件的修改时间和大小 */
+static int GetFileStat(const char *path, int64_t *mtime, int64_t *size)
+{
+	struct stat buf;
+
+	if (stat(path, &buf) != 0) {
+		return -1;
+	}
+	*mtime = (int64_t)buf.st_mtime;
+	*size = (int64_t)buf.st_size;
+	return 0;
+}
+
+void FontCatalog_Init(LCUI_FontCatalog catalog)
+{
+	Dict_InitStringKeyType(&catalog->files_type);
+	catalog->files_type.valDestructor = OnDestroyFontCatalogFile;
+	catalog->files = Dict_Create(&catalog->files_type, NULL);
+	catalog->changed = FALSE;
+}
+
+void FontCatalog_Destroy(LCUI_FontCatalog catalog)
+{
+	Dict_Release(catalog->files);
+	catalog->files = NULL;
+	catalog->changed = FALSE;
+}
+
+LCUI_FontCatalogFile FontCatalog_Find(LCUI_FontCatalog catalog,
+				      const char *path)
+{
+	int64_t mtime, size;
+	LCUI_FontCatalogFile file;
+
+	file = Dict_FetchValue(catalog->files, path);
+	if (!file || GetFileStat(path, &mtime, &size) != 0) {
+		return NULL;
+	}
+	if (file->mtime != mtime || file->size != size) {
+		return NULL;
+	}
+	return file;
+}
+
+int FontCatalog_Add(LCUI_FontCatalog catalog, const char *path,
+		    LCUI_Font *fonts, int n_fonts)
+{
+	int i;
+	int64_t mtime, size;
+	LCUI_FontCatalogFile file;
+
+	if (GetFileStat(path, &mtime, &size) != 0) {
+		return -1;
+	}
+	file = FontCatalogFile_Create(path, mtime, size, n_fonts);
+	if (!file) {
+		return -ENOMEM;
+	}
+	for (i = 0; i < n_fonts; ++i) {
+		if (!fonts[i]) {
+			continue;
+		}
+		if (FontCatalogFile_AddFace(file, i, fonts[i]->family_name,
+					    fonts[i]->style_name) != 0) {
+			FontCatalogFile_Destroy(file);
+			return -1;
+		}
+	}
+	if (file->faces_length < 1) {
+		FontCatalogFile_Destroy(file);
+		return -1;
+	}
+	catalog->changed = TRUE;
+	return FontCatalog_Put(catalog, file);
+}
+
+/** 读取一行文本，并去掉行尾的换行符 */
+static char *ReadLine(FILE *fp, char *buf)
+{
+	size_t len;
+
+	if (!fgets(buf, FONT_CATALOG_LINE_SIZE, fp)) {
+		return NULL;
+	}
+	len = strlen(buf);
+	/* 行内容不完整，说明缓存文件已损坏 */
+	if (len < 1 || buf[len - 1] != '\n') {
+		return NULL;
+	}
+	buf[len - 1] = 0;
+	return buf;
+}
+
+/**
+ * 读取字体文件的记录
+ * 格式为一行 "<修改时间> <大小> <字体数量> <路径>"，后面跟着每个字体各一行的
+ * "<序号>\t<字族名称>\t<样式名称>"
+ */
+static LCUI_FontCatalogFile FontCatalog_ReadFile(FILE *fp, char *buf)
+{
+	int i, n, index, offset;
+	long long mtime, size;
+	char *family_name, *style_name;
+	LCUI_FontCatalogFile file;
+
+	if (!ReadLine(fp, buf)) {
+		return NULL;
+	}
+	if (sscanf(buf, "%lld %lld %d %n", &mtime, &size, &n, &offset) != 3 ||
+	    n < 1 || n > 0xffff) {
+		return NULL;
+	}
+	file = FontCatalogFile_Create(buf + offset, mtime, size, n);
+	if (!file) {
+		return NULL;
+	}
+	for (i = 0; i < n; ++i) {
+		if (!ReadLine(fp, buf)) {
+			break;
+		}
+		family_name = strchr(buf, '\t');
+		style_name = family_name ? strchr(family_name + 1, '\t') : NULL;
+		if (!style_name || sscanf(buf, "%d", &index) != 1) {
+			break;
+		}
+		*family_name++ = 0;
+		*style_name++ = 0;
+		if (FontCatalogFile_AddFace(file, index, family_name,
+					    style_name) != 0) {
+			break;
+		}
+	}
+	if (i < n) {
+		FontCatalogFile_Destroy(file);
+		return NULL;
+	}
+	return file;
+}
+
+int FontCatalog_Load(LCUI_FontCatalog catalog, const char *filepath)
+{
+	FILE *fp;
+	char *buf;
+	LCUI_FontCatalogFile file;
+
+	fp = fopen(filepath, "r");
+	if (!fp) {
+		return -1;
+	}
+	buf = malloc(FONT_CATALOG_LINE_SIZE);
+	if (!buf) {
+		fclose(fp);
+		return -ENOMEM;
+	}
+	/* 格式不对的缓存文件直接忽略，等保存时再覆盖它 */
+	if (!ReadLine(fp, buf) || strcmp(buf, FONT_CATALOG_HEADER) != 0) {
+		free(buf);
+		fclose(fp);
+		return -2;
+	}
+	while ((file = FontCatalog_ReadFile(fp, buf))) {
+		FontCatalog_Put(catalog, file);
+	}
+	free(buf);
+	fclose(fp);
+	return 0;
+}
+
+int FontCatalog_Save(LCUI_FontCatalog catalog, const char *filepath)
+{
+	int i, ret = 0;
+	FILE *fp;
+	char *tmp_path;
+	DictEntry *entry;
+	DictIterator *iter;
+	LCUI_FontCatalogFile file;
+
+	tmp_path = malloc(strlen(filepath) + 5);
+	if (!tmp_path) {
+		return -ENOMEM;
+	}
+	/* 先写入临时文件再替换，避免其它进程读到不完整的缓存文件 */
+	sprintf(tmp_path, "%s.tmp", filepath);
+	fp = fopen(tmp_path, "w");
+	if (!fp) {
+		free(tmp_path);
+		return -1;
+	}
+	fputs(FONT_CATALOG_HEADER "\n", fp);
+	iter = Dict_GetIterator(catalog->files);
+	while ((entry = Dict_Next(iter))) {
+		file = DictEntry_GetVal(entry);
+		if (file->faces_length < 1 ||
+		    !FontCatalog_IsValidName(file->path)) {
+			continue;
+		}
+		fprintf(fp, "%lld %lld %d %s\n", (long long)file->mtime,
+			(long long)file->size, file->faces_length, file->path);
+		for (i = 0; i < file->faces_length; ++i) {
+			fprintf(fp, "%d\t%s\t%s\n", file->faces[i].index,
+				file->faces[i].family_name,
+				file->faces[i].style_name);
+		}
+	}
+	Dict_ReleaseIterator(iter);
+	if (ferror(fp)) {
+		ret = -1;
+	}
+	if (fclose(fp) != 0 || ret != 0) {
+		remove(tmp_path);
+		free(tmp_path);
+		return -1;
+	}
+	/* Windows 中的 rename() 不能覆盖已有的文件 */
+	if (rename(tmp_path, filepath) != 0) {
+		remove(filepath);
+		ret = rename(tmp_path, filepath);
+	}
+	if (ret == 0) {
+		catalog->changed = FALSE;
+	} else {
+		remove(tmp_path);
+	}
+	free(tmp_path);
+	return ret;
+}
@@ -1,994 +1,2728 @@
-﻿/*
- * fontlibrary.c -- The font info and font bitmap cache module.
- *
- * Copyright (c) 2018, Liu chao <lc-soft@live.cn> All rights reserved.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions are met:
- *
- *   * Redistributions of source code must retain the above copyright notice,
- *     this list of conditions and the following disclaimer.
- *   * Redistributions in binary form must reproduce the above copyright
- *     notice, this list of conditions and the following disclaimer in the
- *     documentation and/or other materials provided with the distribution.
- *   * Neither the name of LCUI nor the names of its contributors may be used
- *     to endorse or promote products derived from this software without
- *     specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
- * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
- * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
- * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
- * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
- * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
- * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
- * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
- * POSSIBILITY OF SUCH DAMAGE.
- */
-
-#include "config.h"
-#include <errno.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <LCUI_Build.h>
-#include <LCUI/types.h>
-#include <LCUI/util.h>
-#include <LCUI/graph.h>
-#include <LCUI/font.h>
-
-/* clang-format off */
-
-#define FONT_CACHE_SIZE		32
-#define FONT_CACHE_MAX_SIZE	1024
-
-/**
- * 库中缓存的字体位图是分组存放的，共有三级分组，分别为：
- * 字符->字体信息->字体大小
- * 获取字体位图时的搜索顺序为：先找到字符的记录，然后在记录中的字体数据库里找
- * 到指定字体样式标识号的字体位图库，之后在字体位图库中找到指定像素大小的字体
- * 位图。
- */
-
-typedef struct LCUI_FontStyleNodeRec_ {
-	/* 字体列表，按粗细程度存放 */
-	LCUI_Font weights[FONT_WEIGHT_TOTAL_NUM];
-} LCUI_FontStyleNodeRec, *LCUI_FontStyleNode;
-
-typedef LCUI_FontStyleNodeRec LCUI_FontStyleList[FONT_STYLE_TOTAL_NUM];
-
-typedef struct LCUI_FontCacheRec {
-	LCUI_Font fonts[FONT_CACHE_SIZE];
-} LCUI_FontCacheRec, *LCUI_FontCache;
-
-/** 字体字族索引结点 */
-typedef struct LCUI_FontFamilyNodeRec_ {
-	char *family_name;		/**< 字体的字族名称  */
-	LCUI_FontStyleList styles;	/**< 字体列表，按风格存放 */
-} LCUI_FontFamilyNodeRec, *LCUI_FontFamilyNode;
-
-static struct LCUI_FontLibraryModule {
-	int count;			/**< 计数器，主要用于为字体信息生成标识号 */
-	int font_cache_num;		/**< 字体信息缓存区的数量 */
-	LCUI_BOOL active;		/**< 标记，指示数据库是否初始化 */
-	Dict *font_families;		/**< 字族信息库，以字族名称索引字体信息 */
-	DictType font_families_type;	/**< 字族信息库的字典类型数据 */
-	RBTree bitmap_cache;		/**< 字体位图缓存区 */
-	LCUI_FontCache *font_cache;	/**< 字体信息缓存区 */
-	LCUI_Font default_font;		/**< 默认字体的信息 */
-	LCUI_Font incore_font;		/**< 内置字体的信息 */
-	LCUI_FontEngine engines[2];	/**< 当前可用字体引擎列表 */
-	LCUI_FontEngine *engine;	/**< 当前选择的字体引擎 */
-} fontlib;
-
-/* clang-format on */
-
-#define FontBitmap_IsValid(fbmp) \
-	((fbmp) && (fbmp)->width > 0 && (fbmp)->rows > 0)
-#define SelectChar(ch) (RBTree *)RBTree_GetData(&fontlib.bitmap_cache, ch)
-#define SelectFont(ch, font_id) (RBTree *)RBTree_GetData(ch, font_id)
-#define SelectBitmap(font, size) (LCUI_FontBitmap *)RBTree_GetData(font, size)
-#define SelectFontFamliy(family_name) \
-	(LCUI_FontFamilyNode)         \
-	    Dict_FetchValue(fontlib.font_families, family_name);
-#define SelectFontStyle(FNODE, S) (&(FNODE)->styles[S])
-#define SelectFontWeight(SNODE, W) ((SNODE)->weights[W / 100 - 1])
-#define ClearFontWeight(SNODE, W)                     \
-	do {                                          \
-		(SNODE)->weights[W / 100 - 1] = NULL; \
-	} while (0);
-#define SetFontWeight(SNODE, FONT)                                 \
-	do {                                                       \
-		(SNODE)->weights[(FONT)->weight / 100 - 1] = FONT; \
-	} while (0);
-
-static LCUI_FontCache FontCache(void)
-{
-	LCUI_FontCache cache;
-	if (!(cache = malloc(sizeof(LCUI_FontCacheRec)))) {
-		return NULL;
-	}
-	memset(cache->fonts, 0, sizeof(cache->fonts));
-	return cache;
-}
-
-static void DeleteFontCache(LCUI_FontCache cache)
-{
-	int i;
-	for (i = 0; i < FONT_CACHE_SIZE; ++i) {
-		if (cache->fonts[i]) {
-			DeleteFont(cache->fonts[i]);
-		}
-		cache->fonts[i] = NULL;
-	}
-	free(cache);
-}
-
-static LCUI_Font GetFontCache(int id)
-{
-	if (id > fontlib.font_cache_num * FONT_CACHE_SIZE) {
-		return NULL;
-	}
-	return fontlib.font_cache[id / FONT_CACHE_SIZE]
-	    ->fonts[id % FONT_CACHE_SIZE];
-}
-
-static int SetFontCache(LCUI_Font font)
-{
-	size_t size;
-	LCUI_FontCache *caches, cache;
-
-	if (font->id > FONT_CACHE_MAX_SIZE) {
-		Logger_Error("[font] font cache size is the max size\n");
-		return -1;
-	}
-	while (font->id >= fontlib.font_cache_num * FONT_CACHE_SIZE) {
-		fontlib.font_cache_num += 1;
-		size = fontlib.font_cache_num * sizeof(LCUI_FontCache);
-		caches = realloc(fontlib.font_cache, size);
-		if (!caches) {
-			fontlib.font_cache_num -= 1;
-			return -ENOMEM;
-		}
-		cache = FontCache();
-		if (!cache) {
-			return -ENOMEM;
-		}
-		caches[fontlib.font_cache_num - 1] = cache;
-		fontlib.font_cache = caches;
-	}
-	fontlib.font_cache[font->id / FONT_CACHE_SIZE]
-	    ->fonts[font->id % FONT_CACHE_SIZE] = font;
-	return 0;
-}
-
-LCUI_FontWeight LCUIFont_DetectWeight(const char *str)
-{
-	char *buf;
-	LCUI_FontWeight weight = FONT_WEIGHT_NORMAL;
-	if (!(buf = malloc(strsize(str)))) {
-		return weight;
-	}
-	strtolower(buf, str);
-	if (strstr(buf, "thin")) {
-		weight = FONT_WEIGHT_THIN;
-	} else if (strstr(buf, "light")) {
-		weight = FONT_WEIGHT_EXTRA_LIGHT;
-	} else if (strstr(buf, "semilight")) {
-		weight = FONT_WEIGHT_LIGHT;
-	} else if (strstr(buf, "medium")) {
-		weight = FONT_WEIGHT_MEDIUM;
-	} else if (strstr(buf, "semibold")) {
-		weight = FONT_WEIGHT_SEMI_BOLD;
-	} else if (strstr(buf, "bold")) {
-		weight = FONT_WEIGHT_BOLD;
-	} else if (strstr(buf, "black")) {
-		weight = FONT_WEIGHT_BLACK;
-	}
-	free(buf);
-	return weight;
-}
-
-LCUI_FontStyle LCUIFont_DetectStyle(const char *str)
-{
-	char *buf;
-	LCUI_FontStyle style = FONT_STYLE_NORMAL;
-
-	if (!(buf = malloc(strsize(str)))) {
-		return style;
-	}
-	strtolower(buf, str);
-	if (strstr(buf, "oblique")) {
-		style = FONT_STYLE_OBLIQUE;
-	} else if (strstr(buf, "italic")) {
-		style = FONT_STYLE_ITALIC;
-	}
-	free(buf);
-	return style;
-}
-
-LCUI_Font Font(const char *family_name, const char *style_name)
-{
-	ASSIGN(font, LCUI_Font);
-	font->id = 0;
-	font->data = NULL;
-	font->engine = NULL;
-	font->family_name = strdup2(family_name);
-	font->style_name = strdup2(style_name);
-	font->weight = LCUIFont_DetectWeight(style_name);
-	font->style = LCUIFont_DetectStyle(style_name);
-	return font;
-}
-
-void DeleteFont(LCUI_Font font)
-{
-	free(font->family_name);
-	free(font->style_name);
-	font->engine->close(font->data);
-	font->data = NULL;
-	font->engine = NULL;
-	free(font);
-}
-
-static void DestroyFontFamilyNode(void *privdata, void *data)
-{
-	LCUI_FontFamilyNode node = data;
-	if (node->family_name) {
-		free(node->family_name);
-	}
-	node->family_name = NULL;
-	memset(node->styles, 0, sizeof(node->styles));
-	free(node);
-}
-
-static void DestroyFontBitmap(void *arg)
-{
-	FontBitmap_Free(arg);
-	free(arg);
-}
-
-static void DestroyTreeNode(void *arg)
-{
-	RBTree_Destroy(arg);
-	free(arg);
-}
-
-int LCUIFont_Add(LCUI_Font font)
-{
-	LCUI_Font exists_font;
-	LCUI_FontFamilyNode node;
-	LCUI_FontStyleNode snode;
-	node = SelectFontFamliy(font->family_name);
-	if (!node) {
-		node = NEW(LCUI_FontFamilyNodeRec, 1);
-		node->family_name = strdup2(font->family_name);
-		memset(node->styles, 0, sizeof(node->styles));
-		Dict_Add(fontlib.font_families, node->family_name, node);
-	}
-	snode = SelectFontStyle(node, font->style);
-	exists_font = SelectFontWeight(snode, font->weight);
-	if (exists_font) {
-		font->id = exists_font->id;
-		if (fontlib.default_font &&
-		    font->id == fontlib.default_font->id) {
-			fontlib.default_font = font;
-		}
-		ClearFontWeight(snode, font->weight);
-		DeleteFont(exists_font);
-	} else {
-		font->id = ++fontlib.count;
-	}
-	SetFontWeight(snode, font);
-	SetFontCache(font);
-	return font->id;
-}
-
-LCUI_Font LCUIFont_GetById(int id)
-{
-	if (!fontlib.active) {
-		return NULL;
-	}
-	if (id < 0 || id >= fontlib.font_cache_num * FONT_CACHE_SIZE) {
-		return NULL;
-	}
-	return GetFontCache(id);
-}
-
-size_t LCUIFont_UpdateWeight(const int *font_ids, LCUI_FontWeight weight,
-			     int **new_font_ids)
-{
-	int id, *ids;
-	LCUI_Font font;
-	size_t i, count, len;
-
-	if (!font_ids) {
-		return 0;
-	}
-	for (len = 0; font_ids[len]; ++len)
-		;
-	if (len < 1) {
-		return 0;
-	}
-	ids = malloc((len + 1) * sizeof(int));
-	if (!ids) {
-		return 0;
-	}
-	for (i = 0, count = 0; i < len; ++i) {
-		font = LCUIFont_GetById(font_ids[i]);
-		id = LCUIFont_GetId(font->family_name, font->style, weight);
-		if (id > 0) {
-			ids[count++] = id;
-		}
-	}
-	ids[count] = 0;
-	if (new_font_ids && count > 0) {
-		*new_font_ids = ids;
-	} else {
-		*new_font_ids = NULL;
-		free(ids);
-	}
-	return count;
-}
-
-size_t LCUIFont_UpdateStyle(const int *font_ids, LCUI_FontStyle style,
-			    int **new_font_ids)
-{
-	int id, *ids;
-	LCUI_Font font;
-	size_t i, count, len;
-
-	if (!font_ids) {
-		return 0;
-	}
-	for (len = 0; font_ids[len]; ++len)
-		;
-	if (len < 1) {
-		return 0;
-	}
-	ids = malloc((len + 1) * sizeof(int));
-	if (!ids) {
-		return 0;
-	}
-	for (i = 0, count = 0; i < len; ++i) {
-		font = LCUIFont_GetById(font_ids[i]);
-		id = LCUIFont_GetId(font->family_name, style, font->weight);
-		if (id > 0) {
-			ids[count++] = id;
-		}
-	}
-	ids[count] = 0;
-	if (new_font_ids && count > 0) {
-		*new_font_ids = ids;
-	} else {
-		*new_font_ids = NULL;
-		free(ids);
-	}
-	return count;
-}
-
-size_t LCUIFont_GetIdByNames(int **font_ids, LCUI_FontStyle style,
-			     LCUI_FontWeight weight, const char *names)
-{
-	int *ids;
-	char name[256];
-	const char *p;
-	size_t count, i;
-
-	*font_ids = NULL;
-	if (!names) {
-		return 0;
-	}
-	for (p = names, count = 1; *p; ++p) {
-		if (*p == ',') {
-			++count;
-		}
-	}
-	if (p - names == 0) {
-		return 0;
-	}
-	ids = NEW(int, count + 1);
-	if (!ids) {
-		return 0;
-	}
-	for (p = names, count = 0, i = 0;; ++p) {
-		if (*p != ',' && *p) {
-			name[i++] = *p;
-			continue;
-		}
-		name[i] = 0;
-		strtrim(name, name, "'\"\n\r\t ");
-		ids[count] = LCUIFont_GetId(name, style, weight);
-		if (ids[count] > 0) {
-			++count;
-		}
-		i = 0;
-		if (!*p) {
-			break;
-		}
-	}
-	ids[count] = 0;
-	if (count < 1) {
-		free(ids);
-		ids = NULL;
-	}
-	*font_ids = ids;
-	return count;
-}
-
-static LCUI_FontWeight FindBolderWeight(LCUI_FontStyleNode snode,
-					LCUI_FontWeight weight)
-{
-	for (weight += 100; weight <= FONT_WEIGHT_BLACK; weight += 100) {
-		if (SelectFontWeight(snode, weight)) {
-			return weight;
-		}
-	}
-	return FONT_WEIGHT_NONE;
-}
-
-static LCUI_FontWeight FindLighterWeight(LCUI_FontStyleNode snode,
-					 LCUI_FontWeight weight)
-{
-	for (weight -= 100; weight >= FONT_WEIGHT_THIN; weight -= 100) {
-		if (SelectFontWeight(snode, weight)) {
-			return weight;
-		}
-	}
-	return FONT_WEIGHT_NONE;
-}
-
-/**
- * 在未找到指定字重的字体时进行回退，找到合适的字体
- * 回退规则的参考文档：https://developer.mozilla.org/en-US/docs/Web/CSS/font-weight#Fallback_weights
- */
-static LCUI_FontWeight FontWeightFallback(LCUI_FontStyleNode snode,
-					  LCUI_FontWeight weight)
-{
-	if (weight > FONT_WEIGHT_MEDIUM) {
-		return FindBolderWeight(snode, weight);
-	}
-	if (weight < FONT_WEIGHT_NORMAL) {
-		return FindLighterWeight(snode, weight);
-	}
-	if (weight == FONT_WEIGHT_NORMAL) {
-		if (SelectFontWeight(snode, FONT_WEIGHT_MEDIUM)) {
-			return FONT_WEIGHT_MEDIUM;
-		}
-	} else if (weight == FONT_WEIGHT_MEDIUM) {
-		if (SelectFontWeight(snode, FONT_WEIGHT_NORMAL)) {
-			return FONT_WEIGHT_NORMAL;
-		}
-	}
-	weight = FindLighterWeight(snode, weight);
-	if (weight != FONT_WEIGHT_NONE) {
-		return weight;
-	}
-	return FONT_WEIGHT_NONE;
-}
-
-int LCUIFont_GetId(const char *family_name, LCUI_FontStyle style,
-		   LCUI_FontWeight weight)
-{
-	int style_num;
-	LCUI_FontWeight w;
-	LCUI_FontStyleNode snode;
-	LCUI_FontFamilyNode fnode;
-
-	if (!fontlib.active) {
-		return -1;
-	}
-	fnode = SelectFontFamliy(family_name);
-	if (!fnode) {
-		return -2;
-	}
-	if (weight == 0) {
-		weight = FONT_WEIGHT_NORMAL;
-	}
-	for (style_num = style; style_num >= 0; --style_num) {
-		snode = &fnode->styles[style_num];
-		if (SelectFontWeight(snode, weight)) {
-			return SelectFontWeight(snode, weight)->id;
-		}
-		w = FontWeightFallback(snode, weight);
-		if (w) {
-			return SelectFontWeight(snode, w)->id;
-		}
-	}
-	return -3;
-}
-
-int LCUIFont_GetDefault(void)
-{
-	if (!fontlib.default_font) {
-		return -1;
-	}
-	return fontlib.default_font->id;
-}
-
-void LCUIFont_SetDefault(int id)
-{
-	LCUI_Font font = LCUIFont_GetById(id);
-	if (font) {
-		fontlib.default_font = font;
-		Logger_Debug("[font] select: %s\n", font->family_name);
-	}
-}
-
-LCUI_FontBitmap *LCUIFont_AddBitmap(wchar_t ch, int font_id, int size,
-				    const LCUI_FontBitmap *bmp)
-{
-	LCUI_FontBitmap *bmp_cache;
-	RBTree *tree_font, *tree_bmp;
-
-	if (!fontlib.active) {
-		return NULL;
-	}
-	/* 获取字符的字体信息集 */
-	tree_font = SelectChar(ch);
-	if (!tree_font) {
-		tree_font = NEW(RBTree, 1);
-		if (!tree_font) {
-			return NULL;
-		}
-		RBTree_Init(tree_font);
-		RBTree_OnDestroy(tree_font, DestroyTreeNode);
-		RBTree_Insert(&fontlib.bitmap_cache, ch, tree_font);
-	}
-	/* 当字体ID不大于0时，使用内置字体 */
-	if (font_id <= 0) {
-		font_id = fontlib.incore_font->id;
-	}
-	/* 获取相应字体样式标识号的字体位图库 */
-	tree_bmp = SelectFont(tree_font, font_id);
-	if (!tree_bmp) {
-		tree_bmp = NEW(RBTree, 1);
-		if (!tree_bmp) {
-			return NULL;
-		}
-		RBTree_Init(tree_bmp);
-		RBTree_OnDestroy(tree_bmp, DestroyFontBitmap);
-		RBTree_Insert(tree_font, font_id, tree_bmp);
-	}
-	/* 在字体位图库中获取指定像素大小的字体位图 */
-	bmp_cache = SelectBitmap(tree_bmp, size);
-	if (!bmp_cache) {
-		bmp_cache = NEW(LCUI_FontBitmap, 1);
-		if (!bmp_cache) {
-			return NULL;
-		}
-		RBTree_Insert(tree_bmp, size, bmp_cache);
-	}
-	/* 拷贝数据至该空间内 */
-	memcpy(bmp_cache, bmp, sizeof(LCUI_FontBitmap));
-	return bmp_cache;
-}
-
-int LCUIFont_GetBitmap(wchar_t ch, int font_id, int size,
-		       const LCUI_FontBitmap **bmp)
-{
-	int ret;
-	RBTree *ctx;
-	LCUI_FontBitmap bmp_cache;
-
-	*bmp = NULL;
-	if (!fontlib.active) {
-		return -2;
-	}
-	if (font_id <= 0) {
-		if (fontlib.default_font) {
-			font_id = fontlib.default_font->id;
-		} else {
-			font_id = fontlib.incore_font->id;
-		}
-	}
-	do {
-		if (!(ctx = SelectChar(ch))) {
-			break;
-		}
-		ctx = SelectFont(ctx, font_id);
-		if (!ctx) {
-			break;
-		}
-		*bmp = SelectBitmap(ctx, size);
-		if (*bmp) {
-			return 0;
-		}
-		break;
-	} while (0);
-	if (ch == 0) {
-		return -1;
-	}
-	FontBitmap_Init(&bmp_cache);
-	ret = LCUIFont_RenderBitmap(&bmp_cache, ch, font_id, size);
-	if (ret == 0) {
-		*bmp = LCUIFont_AddBitmap(ch, font_id, size, &bmp_cache);
-		return 0;
-	}
-	ret = LCUIFont_GetBitmap(0, font_id, size, bmp);
-	if (ret != 0) {
-		*bmp = LCUIFont_AddBitmap(0, font_id, size, &bmp_cache);
-	}
-	return -1;
-}
-
-static int LCUIFont_LoadFileEx(LCUI_FontEngine *engine, const char *file)
-{
-	LCUI_Font *fonts;
-	int i, num_fonts, id;
-
-	Logger_Debug("[font] load file: %s\n", file);
-	if (!engine) {
-		return -1;
-	}
-	num_fonts = engine->open(file, &fonts);
-	if (num_fonts < 1) {
-		Logger_Debug("[font] failed to load file: %s\n", file);
-		return -2;
-	}
-	for (i = 0; i < num_fonts; ++i) {
-		fonts[i]->engine = engine;
-		id = LCUIFont_Add(fonts[i]);
-		Logger_Debug("[font] add family: %s, style name: %s, id: %d\n",
-			    fonts[i]->family_name, fonts[i]->style_name, id);
-	}
-	free(fonts);
-	return 0;
-}
-
-int LCUIFont_LoadFile(const char *filepath)
-{
-	return LCUIFont_LoadFileEx(fontlib.engine, filepath);
-}
-
-/** 打印字体位图的信息 */
-void FontBitmap_PrintInfo(LCUI_FontBitmap *bitmap)
-{
-	printf("address:%p\n", bitmap);
-	if (!bitmap) {
-		return;
-	}
-	printf("top: %d, left: %d, width:%d, rows:%d\n", bitmap->top, bitmap->left,
-	    bitmap->width, bitmap->rows);
-}
-
-/** 初始化字体位图 */
-void FontBitmap_Init(LCUI_FontBitmap *bitmap)
-{
-	bitmap->rows = 0;
-	bitmap->width = 0;
-	bitmap->top = 0;
-	bitmap->left = 0;
-	bitmap->buffer = NULL;
-}
-
-/** 释放字体位图占用的资源 */
-void FontBitmap_Free(LCUI_FontBitmap *bitmap)
-{
-	if (bitmap->buffer) {
-		free(bitmap->buffer);
-	}
-	FontBitmap_Init(bitmap);
-}
-
-/** 创建字体位图 */
-int FontBitmap_Create(LCUI_FontBitmap *bitmap, int width, int rows)
-{
-	size_t size;
-	if (width < 0 || rows < 0) {
-		FontBitmap_Free(bitmap);
-		return -1;
-	}
-	if (FontBitmap_IsValid(bitmap)) {
-		FontBitmap_Free(bitmap);
-	}
-	bitmap->width = width;
-	bitmap->rows = rows;
-	size = width * rows * sizeof(uchar_t);
-	bitmap->buffer = (uchar_t *)malloc(size);
-	if (bitmap->buffer == NULL) {
-		return -2;
-	}
-	return 0;
-}
-
-/** 在屏幕打印以0和1表示字体位图 */
-int FontBitmap_Print(LCUI_FontBitmap *fontbmp)
-{
-	int x, y, m;
-	for (y = 0; y < fontbmp->rows; ++y) {
-		m = y * fontbmp->width;
-		for (x = 0; x < fontbmp->width; ++x, ++m) {
-			if (fontbmp->buffer[m] > 128) {
-				printf("#");
-			} else if (fontbmp->buffer[m] > 64) {
-				printf("-");
-			} else {
-				printf(" ");
-			}
-		}
-		printf("\n");
-	}
-	printf("\n");
-	return 0;
-}
-
-static void FontBitmap_MixARGB(LCUI_Graph *graph, LCUI_Rect *write_rect,
-			       const LCUI_FontBitmap *bmp, LCUI_Color color,
-			       LCUI_Rect *read_rect)
-{
-	int x, y;
-	LCUI_Color c;
-	LCUI_ARGB *px, *px_row_des;
-	uchar_t *byte_ptr, *byte_row_ptr;
-
-	byte_row_ptr = bmp->buffer + read_rect->y * bmp->width;
-	px_row_des = graph->argb + write_rect->y * graph->width;
-	byte_row_ptr += read_rect->x;
-	px_row_des += write_rect->x;
-	for (y = 0; y < read_rect->height; ++y) {
-		px = px_row_des;
-		byte_ptr = byte_row_ptr;
-		for (x = 0; x < read_rect->width; ++x, ++byte_ptr, ++px) {
-			c = color;
-			c.alpha = (uchar_t)(*byte_ptr * color.alpha / 255.0);
-			LCUI_OverPixel(px, &c);
-		}
-		px_row_des += graph->width;
-		byte_row_ptr += bmp->width;
-	}
-}
-
-static void FontBitmap_MixRGB(LCUI_Graph *graph, LCUI_Rect *write_rect,
-			      const LCUI_FontBitmap *bmp, LCUI_Color color,
-			      LCUI_Rect *read_rect)
-{
-	int x, y;
-	uchar_t *byte_src, *byte_row_src, *byte_row_des, *byte_des, alpha;
-	byte_row_src = bmp->buffer + read_rect->y * bmp->width + read_rect->x;
-	byte_row_des = graph->bytes + write_rect->y * graph->bytes_per_row;
-	byte_row_des += write_rect->x * graph->bytes_per_pixel;
-	for (y = 0; y < read_rect->height; ++y) {
-		byte_src = byte_row_src;
-		byte_des = byte_row_des;
-		for (x = 0; x < read_rect->width; ++x) {
-			alpha = (uchar_t)(*byte_src * color.alpha / 255);
-			ALPHA_BLEND(*byte_des, color.b, alpha);
-			++byte_des;
-			ALPHA_BLEND(*byte_des, color.g, alpha);
-			++byte_des;
-			ALPHA_BLEND(*byte_des, color.r, alpha);
-			++byte_des;
-			++byte_src;
-		}
-		byte_row_des += graph->bytes_per_row;
-		byte_row_src += bmp->width;
-	}
-}
-
-int FontBitmap_Mix(LCUI_Graph *graph, LCUI_Pos pos, const LCUI_FontBitmap *bmp,
-		   LCUI_Color color)
-{
-	LCUI_Graph write_slot;
-	LCUI_Rect r_rect, w_rect;
-	if (pos.x > (int)graph->width || pos.y > (int)graph->height) {
-		return -2;
-	}
-	/* 获取写入区域 */
-	w_rect.x = pos.x;
-	w_rect.y = pos.y;
-	w_rect.width = bmp->width;
-	w_rect.height = bmp->rows;
-	/* 获取需要裁剪的区域 */
-	LCUIRect_GetCutArea(graph->width, graph->height, w_rect, &r_rect);
-	w_rect.x += r_rect.x;
-	w_rect.y += r_rect.y;
-	w_rect.width = r_rect.width;
-	w_rect.height = r_rect.height;
-	Graph_Quote(&write_slot, graph, &w_rect);
-	Graph_GetValidRect(&write_slot, &w_rect);
-	/* 获取背景图引用的源图形 */
-	graph = Graph_GetQuote(graph);
-	if (graph->color_type == LCUI_COLOR_TYPE_ARGB) {
-		FontBitmap_MixARGB(graph, &w_rect, bmp, color, &r_rect);
-	} else {
-		FontBitmap_MixRGB(graph, &w_rect, bmp, color, &r_rect);
-	}
-	return 0;
-}
-
-int LCUIFont_RenderBitmap(LCUI_FontBitmap *buff, wchar_t ch, int font_id,
-			  int pixel_size)
-{
-	LCUI_Font font = fontlib.default_font;
-	do {
-		if (font_id < 0 || !fontlib.engine) {
-			break;
-		}
-		font = LCUIFont_GetById(font_id);
-		if (font) {
-			break;
-		}
-		if (fontlib.default_font) {
-			font = fontlib.default_font;
-		} else {
-			font = fontlib.incore_font;
-		}
-		break;
-	} while (0);
-	if (!font) {
-		return -1;
-	}
-	return font->engine->render(buff, ch, pixel_size, font);
-}
-
-static void LCUIFont_InitBase(void)
-{
-	fontlib.count = 0;
-	fontlib.font_cache_num = 1;
-	fontlib.font_cache = NEW(LCUI_FontCache, 1);
-	fontlib.font_cache[0] = FontCache();
-	RBTree_Init(&fontlib.bitmap_cache);
-	Dict_InitStringKeyType(&fontlib.font_families_type);
-	fontlib.font_families_type.valDestructor = DestroyFontFamilyNode;
-	fontlib.font_families = Dict_Create(&fontlib.font_families_type, NULL);
-	RBTree_OnDestroy(&fontlib.bitmap_cache, DestroyTreeNode);
-	fontlib.active = TRUE;
-}
-
-static void LCUIFont_InitEngine(void)
-{
-	int fid;
-	/* 先初始化内置的字体引擎 */
-	fontlib.engine = &fontlib.engines[0];
-	LCUIFont_InitInCoreFont(fontlib.engine);
-	LCUIFont_LoadFile("in-core.inconsolata");
-	fid = LCUIFont_GetId("inconsolata", 0, 0);
-	fontlib.incore_font = LCUIFont_GetById(fid);
-	fontlib.default_font = fontlib.incore_font;
-	/* 然后看情况启用其它字体引擎 */
-#ifdef LCUI_FONT_ENGINE_FREETYPE
-	if (LCUIFont_InitFreeType(&fontlib.engines[1]) == 0) {
-		fontlib.engine = &fontlib.engines[1];
-	}
-#endif
-	if (fontlib.engine && fontlib.engine != &fontlib.engines[0]) {
-		Logger_Debug("[font] current font engine is: %s\n",
-		    fontlib.engine->name);
-	} else {
-		Logger_Warning("[font] warning: not font engine support!\n");
-	}
-}
-
-static void LCUIFont_FreeBase(void)
-{
-	if (!fontlib.active) {
-		return;
-	}
-	fontlib.active = FALSE;
-	while (fontlib.font_cache_num > 0) {
-		--fontlib.font_cache_num;
-		DeleteFontCache(fontlib.font_cache[fontlib.font_cache_num]);
-	}
-	Dict_Release(fontlib.font_families);
-	RBTree_Destroy(&fontlib.bitmap_cache);
-	free(fontlib.font_cache);
-	fontlib.font_cache = NULL;
-}
-
-static void LCUIFont_FreeEngine(void)
-{
-	LCUIFont_ExitInCoreFont();
-#ifdef LCUI_FONT_ENGINE_FREETYPE
-	LCUIFont_ExitFreeType();
-#endif
-}
-
-#ifdef LCUI_BUILD_IN_WIN32
-static void LCUIFont_LoadFontsForWindows(void)
-{
-	size_t i;
-	int *ids = NULL;
-	const char *names = "Consola, Simsun, Microsoft YaHei";
-	const char *fonts[] = { "C:/Windows/Fonts/consola.ttf",
-				"C:/Windows/Fonts/simsun.ttc",
-				"C:/Windows/Fonts/msyh.ttf",
-				"C:/Windows/Fonts/msyh.ttc" };
-
-	for (i = 0; i < sizeof(fonts) / sizeof(char *); ++i) {
-		LCUIFont_LoadFile(fonts[i]);
-	}
-	i = LCUIFont_GetIdByNames(&ids, FONT_STYLE_NORMAL, FONT_WEIGHT_NORMAL,
-				  names);
-	if (i > 0) {
-		LCUIFont_SetDefault(ids[i - 1]);
-	}
-	free(ids);
-}
-
-#else
-
-#ifdef USE_FONTCONFIG
-
-static void LCUIFont_LoadFontsByFontConfig(void)
-{
-	size_t i;
-	char *path;
-	int *ids = NULL;
-	const char *names = "Noto Sans CJK, Ubuntu, WenQuanYi Micro Hei";
-	const char *fonts[] = { "Ubuntu", "Noto Sans CJK SC",
-				"WenQuanYi Micro Hei" };
-
-	for (i = 0; i < sizeof(fonts) / sizeof(char *); ++i) {
-		path = Fontconfig_GetPath(fonts[i]);
-		LCUIFont_LoadFile(path);
-		free(path);
-	}
-	i = LCUIFont_GetIdByNames(&ids, FONT_STYLE_NORMAL, FONT_WEIGHT_NORMAL,
-				  names);
-	if (i > 0) {
-		LCUIFont_SetDefault(ids[i - 1]);
-	}
-	free(ids);
-}
-
-#else
-
-static void LCUIFont_LoadFontsForLinux(void)
-{
-	size_t i;
-	int *ids = NULL;
-	const char *names = "Noto Sans CJK SC, Ubuntu, WenQuanYi Micro Hei";
-	const char *fonts[] = {
-		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-R.ttf",
-		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-RI.ttf",
-		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-B.ttf",
-		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-BI.ttf",
-		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-M.ttf",
-		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-MI.ttf",
-		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-L.ttf",
-		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-LI.ttf",
-		"/usr/share/fonts/opentype/noto/NotoSansCJK-Regular.ttc",
-		"/usr/share/fonts/opentype/noto/NotoSansCJK.ttc",
-		"/usr/share/fonts/truetype/wqy/wqy-microhei.ttc"
-	};
-
-	for (i = 0; i < sizeof(fonts) / sizeof(char *); ++i) {
-		LCUIFont_LoadFile(fonts[i]);
-	}
-	i = LCUIFont_GetIdByNames(&ids, FONT_STYLE_NORMAL, FONT_WEIGHT_NORMAL,
-				  names);
-	if (i > 0) {
-		LCUIFont_SetDefault(ids[i - 1]);
-	}
-	free(ids);
-}
-#endif
-
-#endif
-
-static void LCUIFont_LoadDefaultFonts(void)
-{
-#ifdef LCUI_BUILD_IN_WIN32
-	LCUIFont_LoadFontsForWindows();
-#elif defined(USE_FONTCONFIG)
-	Logger_Debug("[font] fontconfig enabled\n");
-	LCUIFont_LoadFontsByFontConfig();
-#else
-	LCUIFont_LoadFontsForLinux();
-#endif
-}
-
-void LCUI_InitFontLibrary(void)
-{
-	LCUIFont_InitBase();
-	LCUIFont_InitEngine();
-	LCUIFont_LoadDefaultFonts();
-}
-
-void LCUI_FreeFontLibrary(void)
-{
-	LCUIFont_FreeBase();
-	LCUIFont_FreeEngine();
-}
+﻿/*
+ * fontlibrary.c -- The font info and font bitmap cache module.
+ *
+ * Copyright (c) 2018, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/util.h>
+#include <LCUI/thread.h>
+#include <LCUI/graph.h>
+#include <LCUI/font.h>
+
+#ifndef LCUI_BUILD_IN_WIN32
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+/* clang-format off */
+
+#define FONT_CACHE_SIZE		32
+#define FONT_CACHE_MAX_SIZE	1024
+
+#define GLYPH_TABLE_INIT_SIZE	1024
+#define GLYPH_PAGE_SIZE		(64 * 1024)
+
+#define FALLBACK_TABLE_INIT_SIZE	256
+#define FALLBACK_TABLE_MAX_LENGTH	(64 * 1024)
+
+/**
+ * 库中缓存的字体位图存放在一个开放寻址的哈希表中，键值由字符码、字体 ID 和
+ * 像素大小打包而成，只需一次查找即可找到字体位图。
+ * 字体位图的记录和位图数据紧凑地存放在较大的图集页中，每条记录之后紧跟它的
+ * 位图数据，以减少内存分配次数并提升访问局部性。
+ *
+ * 图集页的总量超出缓存容量限制时，会按最近最少使用的顺序回收图集页，页中的
+ * 记录会一并从哈希表中移除，因此记录和哈希表占用的内存也受容量限制约束。在当
+ * 前帧中用到的图集页会被锁定，直到 LCUIFont_EndFrame() 被调用后才能被回收。
+ * 替换字体位图时会发布一条新的记录，旧记录所在的图集页在空间全部被替换后回收。
+ *
+ * 绘制时可能有多个线程同时读取缓存，因此查找操作不加锁，只有写入操作需要持
+ * 有互斥锁。字体位图的记录在写入完成后才会被发布到哈希表中，哈希表扩容时会
+ * 创建新表并整体替换旧表。被替换的哈希表和被回收的图集页按纪元延迟释放：读
+ * 取缓存的线程在开始读取时登记到当前纪元，写入方只有在上一个纪元的读取全部
+ * 结束后才能进入下一个纪元，在纪元 E 中被回收的数据等到进入纪元 E + 2 后，
+ * 就不会再有线程读取它们，此时才会被释放。
+ */
+
+typedef struct LCUI_FontAtlasPageRec_ LCUI_FontAtlasPageRec;
+typedef LCUI_FontAtlasPageRec *LCUI_FontAtlasPage;
+
+typedef struct LCUI_FontGlyphRec_ LCUI_FontGlyphRec;
+typedef LCUI_FontGlyphRec *LCUI_FontGlyph;
+
+struct LCUI_FontGlyphRec_ {
+	uint64_t key;
+	/** 字体中没有该字形时使用的替代字形的键值，为 0 时表示没有替代字形 */
+	uint64_t fallback_key;
+	LCUI_FontBitmap bitmap;
+	size_t size;			/**< 记录和位图数据占用的空间 */
+	LCUI_FontAtlasPage page;	/**< 记录所在的图集页 */
+	LCUI_FontGlyph next;		/**< 同一图集页中的上一条记录 */
+};
+
+/** 字体位图图集页，用于存放多个字体位图的记录和数据 */
+struct LCUI_FontAtlasPageRec_ {
+	size_t size;
+	size_t used;
+	size_t freed;			/**< 已被替换的字体位图占用的空间 */
+	size_t frame;			/**< 最近一次被使用时的帧序号 */
+	size_t epoch;			/**< 被回收时的纪元 */
+	uchar_t *data;
+	LCUI_FontGlyph glyphs;		/**< 最后分配的记录 */
+	LinkedListNode node;
+};
+
+/**
+ * 纪元，用于延迟释放仍可能被其它线程读取的数据
+ * 读取方在开始读取时登记到当前纪元，写入方只有在上一个纪元的读取全部结束后
+ * 才能进入下一个纪元，在纪元 E 中被替换的数据等到进入纪元 E + 2 后才能释放。
+ */
+typedef struct LCUI_FontEpochRec_ {
+	size_t current;			/**< 当前纪元 */
+	size_t readers[2];		/**< 按纪元的奇偶记录正在读取的线程数量 */
+} LCUI_FontEpochRec, *LCUI_FontEpoch;
+
+/** 字体位图哈希表 */
+typedef struct LCUI_FontGlyphTableRec_ {
+	size_t size;			/**< 槽位数量，为 2 的幂 */
+	size_t removed;			/**< 已删除的槽位数量 */
+	LCUI_FontGlyph *slots;		/**< 槽位，紧跟在表头之后分配 */
+	size_t epoch;			/**< 被替换时的纪元 */
+	LinkedListNode node;
+} LCUI_FontGlyphTableRec, *LCUI_FontGlyphTable;
+
+typedef struct LCUI_FontBitmapCacheRec_ {
+	LCUI_FontGlyphTable table;	/**< 当前的哈希表 */
+	LinkedList retired_tables;	/**< 已被替换、等待释放的哈希表 */
+	LinkedList retired_pages;	/**< 已被回收、等待释放的图集页 */
+	LCUI_Mutex mutex;		/**< 写入锁 */
+	LCUI_FontEpochRec epoch;	/**< 读取缓存的线程所在的纪元 */
+	size_t length;			/**< 已缓存的字体位图数量 */
+	LinkedList pages;		/**< 字体位图图集页列表 */
+	size_t frame;			/**< 当前帧序号 */
+	size_t bytes;			/**< 图集页占用的内存总量 */
+	size_t limit;			/**< 图集页的内存用量限制，为 0 时不限制 */
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+} LCUI_FontBitmapCacheRec, *LCUI_FontBitmapCache;
+
+/**
+ * 字体回退缓存
+ * 字体列表中的首个字体没有某个字符的字形时，需要到其它字体中查找，查找结果按
+ * 字体列表和字符码存放在开放寻址的哈希表中，再次遇到该字符时不必重新查找。
+ * 不同的字体列表可能有相同的键值，因此记录中还引用了字体列表的副本，命中时需
+ * 比较列表内容。字族名称列表的解析结果也一并缓存，两者都在载入新的字体后失效。
+ *
+ * 排版时每个字符都要查找一次，因此查找操作与字体位图缓存一样不加锁：记录在
+ * 写入完成后才通过字体列表指针发布，发布后不再修改；扩容和清空时创建新表并整
+ * 体替换旧表，旧表和它引用的字体列表按纪元延迟释放。
+ */
+typedef struct LCUI_FontFallbackRec_ {
+	uint64_t key;			/**< 字体列表的键值 */
+	const int *font_ids;		/**< 字体列表，为 NULL 时表示空槽位 */
+	uint32_t code;			/**< 字符码 */
+	int font_id;			/**< 选中的字体 */
+} LCUI_FontFallbackRec, *LCUI_FontFallback;
+
+/** 字体回退哈希表 */
+typedef struct LCUI_FontFallbackTableRec_ {
+	size_t size;			/**< 槽位数量，为 2 的幂 */
+	size_t length;
+	LCUI_FontFallback slots;	/**< 槽位，紧跟在表头之后分配 */
+	LinkedList lists;		/**< 各条记录引用的字体列表的副本 */
+	size_t epoch;			/**< 被替换时的纪元 */
+	LinkedListNode node;
+} LCUI_FontFallbackTableRec, *LCUI_FontFallbackTable;
+
+typedef struct LCUI_FontFallbackCacheRec_ {
+	LCUI_FontFallbackTable table;	/**< 当前的哈希表，为 NULL 时表示缓存为空 */
+	LinkedList retired_tables;	/**< 已被替换、等待释放的哈希表 */
+	LCUI_FontEpochRec epoch;	/**< 读取缓存的线程所在的纪元 */
+	size_t generation;		/**< 缓存被清空的次数 */
+	Dict *names;			/**< 字族名称列表的解析结果 */
+	DictType names_type;
+	LCUI_Mutex mutex;		/**< 写入锁 */
+} LCUI_FontFallbackCacheRec, *LCUI_FontFallbackCache;
+
+typedef struct LCUI_FontStyleNodeRec_ {
+	/* 字体列表，按粗细程度存放 */
+	LCUI_Font weights[FONT_WEIGHT_TOTAL_NUM];
+} LCUI_FontStyleNodeRec, *LCUI_FontStyleNode;
+
+typedef LCUI_FontStyleNodeRec LCUI_FontStyleList[FONT_STYLE_TOTAL_NUM];
+
+typedef struct LCUI_FontCacheRec {
+	LCUI_Font fonts[FONT_CACHE_SIZE];
+} LCUI_FontCacheRec, *LCUI_FontCache;
+
+/** 字体字族索引结点 */
+typedef struct LCUI_FontFamilyNodeRec_ {
+	char *family_name;		/**< 字体的字族名称  */
+	LCUI_FontStyleList styles;	/**< 字体列表，按风格存放 */
+} LCUI_FontFamilyNodeRec, *LCUI_FontFamilyNode;
+
+static struct LCUI_FontLibraryModule {
+	int count;			/**< 计数器，主要用于为字体信息生成标识号 */
+	int font_cache_num;		/**< 字体信息缓存区的数量 */
+	LCUI_BOOL active;		/**< 标记，指示数据库是否初始化 */
+	Dict *font_families;		/**< 字族信息库，以字族名称索引字体信息 */
+	DictType font_families_type;	/**< 字族信息库的字典类型数据 */
+	LCUI_FontBitmapCacheRec bitmap_cache;	/**< 字体位图缓存区 */
+	LCUI_FontFallbackCacheRec fallback_cache;	/**< 字体回退缓存 */
+	LCUI_FontCache *font_cache;	/**< 字体信息缓存区 */
+	LCUI_Font default_font;		/**< 默认字体的信息 */
+	LCUI_Font incore_font;		/**< 内置字体的信息 */
+	LCUI_FontEngine engines[2];	/**< 当前可用字体引擎列表 */
+	LCUI_FontEngine *engine;	/**< 当前选择的字体引擎 */
+	LCUI_FontCatalogRec catalog;	/**< 字体目录 */
+	char *catalog_path;		/**< 字体目录缓存文件的路径 */
+	LCUI_BOOL catalog_path_set;	/**< 是否已设置缓存文件的路径 */
+	LCUI_GlyphCacheRec glyph_cache;	/**< 字形缓存 */
+	char *glyph_cache_path;		/**< 字形缓存文件的路径 */
+	LCUI_BOOL glyph_cache_path_set;	/**< 是否已设置字形缓存文件的路径 */
+	LCUI_BOOL glyph_cache_enabled;	/**< 是否启用字形缓存 */
+} fontlib;
+
+/** 哈希表中已删除的槽位指向的记录 */
+static LCUI_FontGlyphRec glyph_tombstone;
+
+/* clang-format on */
+
+#define FontBitmap_IsValid(fbmp) \
+	((fbmp) && (fbmp)->width > 0 && (fbmp)->rows > 0)
+/* 图集页中的记录和位图数据按 8 字节对齐 */
+#define GlyphAlign(size) (((size) + 7) & ~(size_t)7)
+#define GLYPH_RECORD_SIZE GlyphAlign(sizeof(LCUI_FontGlyphRec))
+#define GlyphKey(ch, font_id, size)                     \
+	(((uint64_t)(uint32_t)(ch) << 32) |             \
+	 ((uint64_t)((font_id)&0xffff) << 16) |         \
+	 (uint64_t)((size)&0xffff))
+/* 原子操作，用于在多个线程间无锁地读取字体位图缓存 */
+#ifdef _MSC_VER
+#define AtomicLoadPtr(P) \
+	InterlockedCompareExchangePointer((PVOID volatile *)(P), NULL, NULL)
+#define AtomicStorePtr(P, V) \
+	InterlockedExchangePointer((PVOID volatile *)(P), (PVOID)(V))
+#define AtomicGetSize(P) (*(volatile size_t *)(P))
+#define AtomicSetSize(P, V) (*(volatile size_t *)(P) = (V))
+#ifdef _WIN64
+#define AtomicIncSize(P) InterlockedIncrement64((LONG64 volatile *)(P))
+#else
+#define AtomicIncSize(P) InterlockedIncrement((LONG volatile *)(P))
+#endif
+#else
+#define AtomicLoadPtr(P) __atomic_load_n(P, __ATOMIC_ACQUIRE)
+#define AtomicStorePtr(P, V) __atomic_store_n(P, V, __ATOMIC_RELEASE)
+#define AtomicGetSize(P) __atomic_load_n(P, __ATOMIC_RELAXED)
+#define AtomicSetSize(P, V) __atomic_store_n(P, V, __ATOMIC_RELAXED)
+#define AtomicIncSize(P) __atomic_fetch_add(P, 1, __ATOMIC_RELAXED)
+#endif
+/* 带有完整内存屏障的原子操作，用于登记读取缓存的线程 */
+#ifdef _MSC_VER
+#ifdef _WIN64
+#define AtomicSyncGetSize(P) \
+	((size_t)InterlockedCompareExchange64((LONG64 volatile *)(P), 0, 0))
+#define AtomicSyncAddSize(P, V) \
+	InterlockedExchangeAdd64((LONG64 volatile *)(P), (LONG64)(V))
+#else
+#define AtomicSyncGetSize(P) \
+	((size_t)InterlockedCompareExchange((LONG volatile *)(P), 0, 0))
+#define AtomicSyncAddSize(P, V) \
+	InterlockedExchangeAdd((LONG volatile *)(P), (LONG)(V))
+#endif
+#else
+#define AtomicSyncGetSize(P) __atomic_load_n(P, __ATOMIC_SEQ_CST)
+#define AtomicSyncAddSize(P, V) __atomic_fetch_add(P, V, __ATOMIC_SEQ_CST)
+#endif
+#define SelectFontFamliy(family_name) \
+	(LCUI_FontFamilyNode)         \
+	    Dict_FetchValue(fontlib.font_families, family_name);
+#define SelectFontStyle(FNODE, S) (&(FNODE)->styles[S])
+#define SelectFontWeight(SNODE, W) ((SNODE)->weights[W / 100 - 1])
+#define ClearFontWeight(SNODE, W)                     \
+	do {                                          \
+		(SNODE)->weights[W / 100 - 1] = NULL; \
+	} while (0);
+#define SetFontWeight(SNODE, FONT)                                 \
+	do {                                                       \
+		(SNODE)->weights[(FONT)->weight / 100 - 1] = FONT; \
+	} while (0);
+
+static LCUI_FontCache FontCache(void)
+{
+	LCUI_FontCache cache;
+	if (!(cache = malloc(sizeof(LCUI_FontCacheRec)))) {
+		return NULL;
+	}
+	memset(cache->fonts, 0, sizeof(cache->fonts));
+	return cache;
+}
+
+static void DeleteFontCache(LCUI_FontCache cache)
+{
+	int i;
+	for (i = 0; i < FONT_CACHE_SIZE; ++i) {
+		if (cache->fonts[i]) {
+			DeleteFont(cache->fonts[i]);
+		}
+		cache->fonts[i] = NULL;
+	}
+	free(cache);
+}
+
+static LCUI_Font GetFontCache(int id)
+{
+	if (id > fontlib.font_cache_num * FONT_CACHE_SIZE) {
+		return NULL;
+	}
+	return fontlib.font_cache[id / FONT_CACHE_SIZE]
+	    ->fonts[id % FONT_CACHE_SIZE];
+}
+
+static int SetFontCache(LCUI_Font font)
+{
+	size_t size;
+	LCUI_FontCache *caches, cache;
+
+	if (font->id > FONT_CACHE_MAX_SIZE) {
+		Logger_Error("[font] font cache size is the max size\n");
+		return -1;
+	}
+	while (font->id >= fontlib.font_cache_num * FONT_CACHE_SIZE) {
+		fontlib.font_cache_num += 1;
+		size = fontlib.font_cache_num * sizeof(LCUI_FontCache);
+		caches = realloc(fontlib.font_cache, size);
+		if (!caches) {
+			fontlib.font_cache_num -= 1;
+			return -ENOMEM;
+		}
+		cache = FontCache();
+		if (!cache) {
+			return -ENOMEM;
+		}
+		caches[fontlib.font_cache_num - 1] = cache;
+		fontlib.font_cache = caches;
+	}
+	fontlib.font_cache[font->id / FONT_CACHE_SIZE]
+	    ->fonts[font->id % FONT_CACHE_SIZE] = font;
+	return 0;
+}
+
+LCUI_FontWeight LCUIFont_DetectWeight(const char *str)
+{
+	char *buf;
+	LCUI_FontWeight weight = FONT_WEIGHT_NORMAL;
+	if (!(buf = malloc(strsize(str)))) {
+		return weight;
+	}
+	strtolower(buf, str);
+	if (strstr(buf, "thin")) {
+		weight = FONT_WEIGHT_THIN;
+	} else if (strstr(buf, "light")) {
+		weight = FONT_WEIGHT_EXTRA_LIGHT;
+	} else if (strstr(buf, "semilight")) {
+		weight = FONT_WEIGHT_LIGHT;
+	} else if (strstr(buf, "medium")) {
+		weight = FONT_WEIGHT_MEDIUM;
+	} else if (strstr(buf, "semibold")) {
+		weight = FONT_WEIGHT_SEMI_BOLD;
+	} else if (strstr(buf, "bold")) {
+		weight = FONT_WEIGHT_BOLD;
+	} else if (strstr(buf, "black")) {
+		weight = FONT_WEIGHT_BLACK;
+	}
+	free(buf);
+	return weight;
+}
+
+LCUI_FontStyle LCUIFont_DetectStyle(const char *str)
+{
+	char *buf;
+	LCUI_FontStyle style = FONT_STYLE_NORMAL;
+
+	if (!(buf = malloc(strsize(str)))) {
+		return style;
+	}
+	strtolower(buf, str);
+	if (strstr(buf, "oblique")) {
+		style = FONT_STYLE_OBLIQUE;
+	} else if (strstr(buf, "italic")) {
+		style = FONT_STYLE_ITALIC;
+	}
+	free(buf);
+	return style;
+}
+
+LCUI_Font Font(const char *family_name, const char *style_name)
+{
+	ASSIGN(font, LCUI_Font);
+	font->id = 0;
+	font->data = NULL;
+	font->engine = NULL;
+	font->cache_key = 0;
+	font->family_name = strdup2(family_name);
+	font->style_name = strdup2(style_name);
+	font->weight = LCUIFont_DetectWeight(style_name);
+	font->style = LCUIFont_DetectStyle(style_name);
+	return font;
+}
+
+void DeleteFont(LCUI_Font font)
+{
+	free(font->family_name);
+	free(font->style_name);
+	font->engine->close(font->data);
+	font->data = NULL;
+	font->engine = NULL;
+	free(font);
+}
+
+static void DestroyFontFamilyNode(void *privdata, void *data)
+{
+	LCUI_FontFamilyNode node = data;
+	if (node->family_name) {
+		free(node->family_name);
+	}
+	node->family_name = NULL;
+	memset(node->styles, 0, sizeof(node->styles));
+	free(node);
+}
+
+static void DestroyAtlasPage(void *arg)
+{
+	LCUI_FontAtlasPage page = arg;
+	free(page->data);
+	free(page);
+}
+
+static size_t GlyphHash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return (size_t)key;
+}
+
+static LCUI_FontGlyphTable FontGlyphTable(size_t size)
+{
+	LCUI_FontGlyphTable table;
+
+	table = calloc(1, sizeof(LCUI_FontGlyphTableRec) +
+			      sizeof(LCUI_FontGlyph) * size);
+	if (!table) {
+		return NULL;
+	}
+	table->size = size;
+	table->slots = (LCUI_FontGlyph *)(table + 1);
+	table->node.data = table;
+	return table;
+}
+
+static void FontGlyphTable_Put(LCUI_FontGlyphTable table, LCUI_FontGlyph glyph)
+{
+	size_t mask = table->size - 1;
+	size_t i = GlyphHash(glyph->key) & mask;
+
+	while (table->slots[i]) {
+		i = (i + 1) & mask;
+	}
+	/* 字体位图的记录已写入完毕，发布后即可被其它线程读取 */
+	AtomicStorePtr(&table->slots[i], glyph);
+}
+
+/** 在哈希表中用新的记录替换旧的记录，旧的记录必须在表中 */
+static void FontGlyphTable_Replace(LCUI_FontGlyphTable table,
+				   LCUI_FontGlyph old_glyph,
+				   LCUI_FontGlyph glyph)
+{
+	size_t mask = table->size - 1;
+	size_t i = GlyphHash(glyph->key) & mask;
+
+	while (table->slots[i] != old_glyph) {
+		i = (i + 1) & mask;
+	}
+	AtomicStorePtr(&table->slots[i], glyph);
+}
+
+/**
+ * 从哈希表中移除记录，记录不在表中时不做任何操作
+ * 槽位会被标记为已删除而不是清空，以免中断其它记录的探测序列。
+ * @returns 记录在表中时返回 TRUE
+ */
+static LCUI_BOOL FontGlyphTable_Remove(LCUI_FontGlyphTable table,
+				       LCUI_FontGlyph glyph)
+{
+	size_t mask = table->size - 1;
+	size_t i = GlyphHash(glyph->key) & mask;
+
+	while (table->slots[i]) {
+		if (table->slots[i] == glyph) {
+			AtomicStorePtr(&table->slots[i], &glyph_tombstone);
+			table->removed += 1;
+			return TRUE;
+		}
+		i = (i + 1) & mask;
+	}
+	return FALSE;
+}
+
+static void FontEpoch_Init(LCUI_FontEpoch epoch)
+{
+	epoch->current = 0;
+	epoch->readers[0] = 0;
+	epoch->readers[1] = 0;
+}
+
+/**
+ * 开始读取，返回登记时的纪元
+ * 登记后再次确认纪元未变，避免登记到写入方已经检查过的纪元中。
+ */
+static size_t FontEpoch_BeginRead(LCUI_FontEpoch epoch)
+{
+	size_t current;
+
+	while (1) {
+		current = AtomicSyncGetSize(&epoch->current);
+		AtomicSyncAddSize(&epoch->readers[current & 1], 1);
+		if (AtomicSyncGetSize(&epoch->current) == current) {
+			return current;
+		}
+		AtomicSyncAddSize(&epoch->readers[current & 1], (size_t)-1);
+	}
+}
+
+static void FontEpoch_EndRead(LCUI_FontEpoch epoch, size_t current)
+{
+	AtomicSyncAddSize(&epoch->readers[current & 1], (size_t)-1);
+}
+
+/**
+ * 尝试进入下一个纪元，需持有写入锁
+ * 上一个纪元与下一个纪元的奇偶相同，只有在上一个纪元中登记的读取全部结束后，
+ * 才能进入下一个纪元。
+ */
+static LCUI_BOOL FontEpoch_Advance(LCUI_FontEpoch epoch)
+{
+	if (AtomicSyncGetSize(&epoch->readers[(epoch->current + 1) & 1]) > 0) {
+		return FALSE;
+	}
+	AtomicSyncAddSize(&epoch->current, 1);
+	return TRUE;
+}
+
+static void FontBitmapCache_Init(LCUI_FontBitmapCache cache)
+{
+	cache->length = 0;
+	cache->frame = 0;
+	cache->bytes = 0;
+	FontEpoch_Init(&cache->epoch);
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+	cache->table = FontGlyphTable(GLYPH_TABLE_INIT_SIZE);
+	LCUIMutex_Init(&cache->mutex);
+	LinkedList_Init(&cache->retired_tables);
+	LinkedList_Init(&cache->retired_pages);
+	LinkedList_Init(&cache->pages);
+}
+
+/** 释放缓存占用的全部资源，此时不能再有线程读取缓存 */
+static void FontBitmapCache_Destroy(LCUI_FontBitmapCache cache)
+{
+	LinkedList_ClearData(&cache->pages, DestroyAtlasPage);
+	LinkedList_ClearData(&cache->retired_pages, DestroyAtlasPage);
+	LinkedList_ClearData(&cache->retired_tables, free);
+	LCUIMutex_Destroy(&cache->mutex);
+	free(cache->table);
+	cache->table = NULL;
+	cache->length = 0;
+	cache->bytes = 0;
+}
+
+/** 获取最晚被回收的数据所在的纪元 */
+static LCUI_BOOL FontBitmapCache_GetNewestRetired(LCUI_FontBitmapCache cache,
+						  size_t *epoch)
+{
+	LCUI_FontGlyphTable table;
+	LCUI_FontAtlasPage page;
+	LinkedListNode *node;
+	LCUI_BOOL found = FALSE;
+
+	node = LinkedList_GetNodeAtTail(&cache->retired_tables, 0);
+	if (node) {
+		table = node->data;
+		*epoch = table->epoch;
+		found = TRUE;
+	}
+	node = LinkedList_GetNodeAtTail(&cache->retired_pages, 0);
+	if (node) {
+		page = node->data;
+		if (!found || page->epoch > *epoch) {
+			*epoch = page->epoch;
+		}
+		found = TRUE;
+	}
+	return found;
+}
+
+/**
+ * 释放不会再被读取的哈希表和图集页，需持有写入锁
+ * 被回收的数据按纪元的先后顺序排列，只需从表头开始释放。
+ */
+static void FontBitmapCache_Reclaim(LCUI_FontBitmapCache cache)
+{
+	size_t epoch;
+	LinkedListNode *node;
+	LCUI_FontGlyphTable table;
+	LCUI_FontAtlasPage page;
+
+	if (!FontBitmapCache_GetNewestRetired(cache, &epoch)) {
+		return;
+	}
+	while (cache->epoch.current < epoch + 2 &&
+	       FontEpoch_Advance(&cache->epoch));
+	while ((node = LinkedList_GetNode(&cache->retired_tables, 0))) {
+		table = node->data;
+		if (table->epoch + 2 > cache->epoch.current) {
+			break;
+		}
+		LinkedList_Unlink(&cache->retired_tables, node);
+		free(table);
+	}
+	while ((node = LinkedList_GetNode(&cache->retired_pages, 0))) {
+		page = node->data;
+		if (page->epoch + 2 > cache->epoch.current) {
+			break;
+		}
+		LinkedList_Unlink(&cache->retired_pages, node);
+		DestroyAtlasPage(page);
+	}
+}
+
+/** 回收图集页，需持有写入锁，图集页等到不再被读取时才释放 */
+static void FontBitmapCache_RetirePage(LCUI_FontBitmapCache cache,
+				       LCUI_FontAtlasPage page)
+{
+	cache->bytes -= page->size;
+	page->epoch = cache->epoch.current;
+	LinkedList_Unlink(&cache->pages, &page->node);
+	LinkedList_AppendNode(&cache->retired_pages, &page->node);
+}
+
+/** 查找字体位图，无需加锁，但需在登记读取后调用 */
+static LCUI_FontGlyph FontBitmapCache_Find(LCUI_FontBitmapCache cache,
+					   uint64_t key)
+{
+	size_t i, mask;
+	LCUI_FontGlyph glyph;
+	LCUI_FontGlyphTable table;
+
+	table = AtomicLoadPtr(&cache->table);
+	mask = table->size - 1;
+	i = GlyphHash(key) & mask;
+	while ((glyph = AtomicLoadPtr(&table->slots[i]))) {
+		if (glyph != &glyph_tombstone && glyph->key == key) {
+			return glyph;
+		}
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+/**
+ * 重建哈希表，需持有写入锁
+ * 新表的大小按现有记录的数量确定，已删除的槽位不会被复制到新表中。
+ */
+static int FontBitmapCache_Rebuild(LCUI_FontBitmapCache cache)
+{
+	size_t i, size = GLYPH_TABLE_INIT_SIZE;
+	LCUI_FontGlyph glyph;
+	LCUI_FontGlyphTable table;
+
+	while (size < (cache->length + 1) * 4) {
+		size *= 2;
+	}
+	table = FontGlyphTable(size);
+	if (!table) {
+		return -ENOMEM;
+	}
+	for (i = 0; i < cache->table->size; ++i) {
+		glyph = cache->table->slots[i];
+		if (glyph && glyph != &glyph_tombstone) {
+			FontGlyphTable_Put(table, glyph);
+		}
+	}
+	/* 其它线程可能仍在查找旧表，等到它们结束读取后再释放 */
+	cache->table->epoch = cache->epoch.current;
+	LinkedList_AppendNode(&cache->retired_tables, &cache->table->node);
+	AtomicStorePtr(&cache->table, table);
+	return 0;
+}
+
+/** 确保哈希表中还能再放入一条记录，需持有写入锁 */
+static int FontBitmapCache_Reserve(LCUI_FontBitmapCache cache)
+{
+	LCUI_FontGlyphTable table = cache->table;
+
+	if ((cache->length + table->removed + 1) * 2 > table->size) {
+		return FontBitmapCache_Rebuild(cache);
+	}
+	return 0;
+}
+
+/**
+ * 在图集页中分配一条记录，记录之后紧跟 size 字节的位图数据，需持有写入锁
+ * 其它线程可能正在使用已有图集页中的数据，所以这里不回收图集页，超出内存
+ * 用量限制的部分会在 LCUIFont_EndFrame() 中回收。
+ */
+static LCUI_FontGlyph FontBitmapCache_Alloc(LCUI_FontBitmapCache cache,
+					    size_t size)
+{
+	LCUI_FontGlyph glyph;
+	LCUI_FontAtlasPage page = NULL;
+	LinkedListNode *node = LinkedList_GetNodeAtTail(&cache->pages, 0);
+
+	size = GLYPH_RECORD_SIZE + GlyphAlign(size);
+	if (node) {
+		page = node->data;
+	}
+	if (!page || page->used + size > page->size) {
+		page = malloc(sizeof(LCUI_FontAtlasPageRec));
+		if (!page) {
+			return NULL;
+		}
+		page->used = 0;
+		page->freed = 0;
+		page->glyphs = NULL;
+		page->size = max(size, GLYPH_PAGE_SIZE);
+		page->data = malloc(page->size);
+		if (!page->data) {
+			free(page);
+			return NULL;
+		}
+		page->node.data = page;
+		cache->bytes += page->size;
+		/* 尺寸过大的位图独占一页，不影响当前页的后续分配 */
+		if (size > GLYPH_PAGE_SIZE) {
+			LinkedList_InsertNode(&cache->pages, 0, &page->node);
+		} else {
+			LinkedList_AppendNode(&cache->pages, &page->node);
+		}
+	}
+	AtomicSetSize(&page->frame, cache->frame);
+	glyph = (LCUI_FontGlyph)(page->data + page->used);
+	page->used += size;
+	glyph->size = size;
+	glyph->page = page;
+	glyph->next = page->glyphs;
+	page->glyphs = glyph;
+	return glyph;
+}
+
+static LCUI_FontAtlasPage FontBitmapCache_FindLRUPage(
+    LCUI_FontBitmapCache cache)
+{
+	LinkedListNode *node;
+	LCUI_FontAtlasPage page, lru_page = NULL;
+
+	for (LinkedList_Each(node, &cache->pages)) {
+		page = node->data;
+		/* 跳过当前帧中用到的图集页 */
+		if (page->frame == cache->frame) {
+			continue;
+		}
+		if (!lru_page || page->frame < lru_page->frame) {
+			lru_page = page;
+		}
+	}
+	return lru_page;
+}
+
+/** 从哈希表中移除图集页中的记录，然后回收该图集页，需持有写入锁 */
+static void FontBitmapCache_EvictPage(LCUI_FontBitmapCache cache,
+				      LCUI_FontAtlasPage page)
+{
+	LCUI_FontGlyph glyph;
+
+	/* 已被替换的旧记录不在表中，只移除仍在表中的记录 */
+	for (glyph = page->glyphs; glyph; glyph = glyph->next) {
+		if (FontGlyphTable_Remove(cache->table, glyph)) {
+			cache->length -= 1;
+			cache->evictions += 1;
+		}
+	}
+	FontBitmapCache_RetirePage(cache, page);
+}
+
+/**
+ * 回收图集页，直到图集页占用的内存总量不超过 max_bytes，需持有写入锁
+ * 图集页中的记录会一并从哈希表中移除，其它线程可能仍在读取它们，图集页会
+ * 等到它们结束读取后再释放。
+ * @returns 被回收的内存量
+ */
+static size_t FontBitmapCache_Trim(LCUI_FontBitmapCache cache,
+				   size_t max_bytes)
+{
+	size_t bytes = cache->bytes;
+	LCUI_FontAtlasPage page;
+
+	while (cache->bytes > max_bytes) {
+		page = FontBitmapCache_FindLRUPage(cache);
+		if (!page) {
+			break;
+		}
+		FontBitmapCache_EvictPage(cache, page);
+	}
+	return bytes - cache->bytes;
+}
+
+/** 标记字体位图在当前帧中被使用，需在登记读取后调用 */
+static void FontBitmapCache_Touch(LCUI_FontBitmapCache cache,
+				  LCUI_FontGlyph glyph)
+{
+	LCUI_FontAtlasPage page = glyph->page;
+
+	if (AtomicGetSize(&page->frame) != cache->frame) {
+		AtomicSetSize(&page->frame, cache->frame);
+	}
+}
+
+/** 在图集页列表中查找字体位图所属的记录 */
+static LCUI_FontGlyph FontGlyphList_FindByBitmap(LinkedList *pages,
+						 const LCUI_FontBitmap *bmp)
+{
+	uintptr_t addr = (uintptr_t)bmp;
+	LinkedListNode *node;
+	LCUI_FontAtlasPage page;
+	LCUI_FontGlyph glyph;
+
+	for (LinkedList_Each(node, pages)) {
+		page = node->data;
+		if (addr < (uintptr_t)page->data ||
+		    addr >= (uintptr_t)page->data + page->used) {
+			continue;
+		}
+		for (glyph = page->glyphs; glyph; glyph = glyph->next) {
+			if (&glyph->bitmap == bmp) {
+				return glyph;
+			}
+		}
+		return NULL;
+	}
+	return NULL;
+}
+
+/**
+ * 查找字体位图所属的记录，需持有写入锁
+ * 只有缓存中的字体位图才有记录，其它字体位图的地址不在任何图集页中。已被回收
+ * 但仍可能被读取的图集页也会被查找。
+ */
+static LCUI_FontGlyph FontBitmapCache_FindByBitmap(LCUI_FontBitmapCache cache,
+						   const LCUI_FontBitmap *bmp)
+{
+	LCUI_FontGlyph glyph;
+
+	glyph = FontGlyphList_FindByBitmap(&cache->pages, bmp);
+	if (!glyph) {
+		glyph = FontGlyphList_FindByBitmap(&cache->retired_pages, bmp);
+	}
+	return glyph;
+}
+
+/**
+ * 记录被替换的字体位图占用的空间，需持有写入锁
+ * 图集页中的空间全部被替换后，回收该图集页。最后一页仍在用于分配新的空间，
+ * 因此保留它。
+ */
+static void FontBitmapCache_Retire(LCUI_FontBitmapCache cache,
+				   LCUI_FontGlyph glyph)
+{
+	LinkedListNode *node;
+	LCUI_FontAtlasPage page = glyph->page;
+
+	page->freed += glyph->size;
+	node = LinkedList_GetNodeAtTail(&cache->pages, 0);
+	if (page->freed >= page->used && node != &page->node) {
+		FontBitmapCache_RetirePage(cache, page);
+	}
+}
+
+/**
+ * 将字体位图存入缓存，需持有写入锁
+ * 位图数据会被复制到记录之后，bmp->buffer 由本函数释放。
+ * 替换已有的字体位图时会新建一条记录再发布，其它线程读到的记录总是完整的。
+ * @param[in] replace 在字体位图已存在时是否替换它
+ */
+static LCUI_FontGlyph FontBitmapCache_Add(LCUI_FontBitmapCache cache,
+					  uint64_t key,
+					  const LCUI_FontBitmap *bmp,
+					  LCUI_BOOL replace)
+{
+	size_t size = 0;
+	LCUI_FontGlyph glyph, old_glyph;
+
+	old_glyph = FontBitmapCache_Find(cache, key);
+	if (old_glyph && !replace) {
+		free(bmp->buffer);
+		return old_glyph;
+	}
+	if (!old_glyph && FontBitmapCache_Reserve(cache) != 0) {
+		free(bmp->buffer);
+		return NULL;
+	}
+	if (bmp->buffer && bmp->width > 0 && bmp->rows > 0) {
+		size = (size_t)bmp->width * bmp->rows * sizeof(uchar_t);
+	}
+	glyph = FontBitmapCache_Alloc(cache, size);
+	if (!glyph) {
+		free(bmp->buffer);
+		return NULL;
+	}
+	glyph->key = key;
+	glyph->fallback_key = 0;
+	glyph->bitmap = *bmp;
+	glyph->bitmap.buffer = NULL;
+	if (size > 0) {
+		glyph->bitmap.buffer = (uchar_t *)glyph + GLYPH_RECORD_SIZE;
+		memcpy(glyph->bitmap.buffer, bmp->buffer, size);
+	}
+	free(bmp->buffer);
+	if (old_glyph) {
+		FontGlyphTable_Replace(cache->table, old_glyph, glyph);
+		FontBitmapCache_Retire(cache, old_glyph);
+		return glyph;
+	}
+	FontGlyphTable_Put(cache->table, glyph);
+	cache->length += 1;
+	return glyph;
+}
+
+/**
+ * 记录字体中没有该字形，需持有写入锁
+ * 之后查找该字形时直接得到替代字形，不必再用字体引擎渲染。替代字形以键值
+ * 引用，它被替换或回收后不影响这条记录。
+ */
+static void FontBitmapCache_AddFallback(LCUI_FontBitmapCache cache,
+					uint64_t key, uint64_t fallback_key)
+{
+	LCUI_FontGlyph glyph;
+
+	if (FontBitmapCache_Find(cache, key) ||
+	    FontBitmapCache_Reserve(cache) != 0) {
+		return;
+	}
+	glyph = FontBitmapCache_Alloc(cache, 0);
+	if (!glyph) {
+		return;
+	}
+	glyph->key = key;
+	glyph->fallback_key = fallback_key;
+	FontBitmap_Init(&glyph->bitmap);
+	FontGlyphTable_Put(cache->table, glyph);
+	cache->length += 1;
+}
+
+static void OnDestroyFontIds(void *privdata, void *data)
+{
+	free(data);
+}
+
+static LCUI_FontFallbackTable FontFallbackTable(size_t size)
+{
+	LCUI_FontFallbackTable table;
+
+	table = calloc(1, sizeof(LCUI_FontFallbackTableRec) +
+			      sizeof(LCUI_FontFallbackRec) * size);
+	if (!table) {
+		return NULL;
+	}
+	table->size = size;
+	table->slots = (LCUI_FontFallback)(table + 1);
+	table->node.data = table;
+	LinkedList_Init(&table->lists);
+	return table;
+}
+
+static void DestroyFontFallbackTable(void *arg)
+{
+	LCUI_FontFallbackTable table = arg;
+
+	LinkedList_Clear(&table->lists, free);
+	free(table);
+}
+
+static void FontFallbackCache_Init(LCUI_FontFallbackCache cache)
+{
+	cache->table = NULL;
+	cache->generation = 0;
+	FontEpoch_Init(&cache->epoch);
+	LinkedList_Init(&cache->retired_tables);
+	Dict_InitStringCopyKeyType(&cache->names_type);
+	cache->names_type.valDestructor = OnDestroyFontIds;
+	cache->names = Dict_Create(&cache->names_type, NULL);
+	LCUIMutex_Init(&cache->mutex);
+}
+
+/** 释放缓存占用的全部资源，此时不能再有线程读取缓存 */
+static void FontFallbackCache_Destroy(LCUI_FontFallbackCache cache)
+{
+	Dict_Release(cache->names);
+	LCUIMutex_Destroy(&cache->mutex);
+	LinkedList_ClearData(&cache->retired_tables, DestroyFontFallbackTable);
+	if (cache->table) {
+		DestroyFontFallbackTable(cache->table);
+	}
+	cache->table = NULL;
+	cache->names = NULL;
+}
+
+/** 替换哈希表，需持有写入锁，旧表等到不再被读取时才释放 */
+static void FontFallbackCache_SetTable(LCUI_FontFallbackCache cache,
+				       LCUI_FontFallbackTable table)
+{
+	LCUI_FontFallbackTable old_table = cache->table;
+
+	AtomicStorePtr(&cache->table, table);
+	if (old_table) {
+		old_table->epoch = cache->epoch.current;
+		LinkedList_AppendNode(&cache->retired_tables, &old_table->node);
+	}
+}
+
+/** 释放不会再被读取的哈希表，需持有写入锁 */
+static void FontFallbackCache_Reclaim(LCUI_FontFallbackCache cache)
+{
+	LinkedListNode *node;
+	LCUI_FontFallbackTable table;
+
+	node = LinkedList_GetNodeAtTail(&cache->retired_tables, 0);
+	if (!node) {
+		return;
+	}
+	table = node->data;
+	while (cache->epoch.current < table->epoch + 2 &&
+	       FontEpoch_Advance(&cache->epoch));
+	while ((node = LinkedList_GetNode(&cache->retired_tables, 0))) {
+		table = node->data;
+		if (table->epoch + 2 > cache->epoch.current) {
+			break;
+		}
+		LinkedList_Unlink(&cache->retired_tables, node);
+		DestroyFontFallbackTable(table);
+	}
+}
+
+/** 清空缓存，需持有写入锁 */
+static void FontFallbackCache_Clear(LCUI_FontFallbackCache cache)
+{
+	FontFallbackCache_SetTable(cache, NULL);
+	AtomicSyncAddSize(&cache->generation, 1);
+	Dict_Empty(cache->names);
+	FontFallbackCache_Reclaim(cache);
+}
+
+/** 计算字体列表的键值 */
+static uint64_t FontIds_Hash(const int *font_ids)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (; font_ids && *font_ids > 0; ++font_ids) {
+		hash = (hash ^ (uint32_t)*font_ids) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+static LCUI_BOOL FontIds_Equal(const int *a, const int *b)
+{
+	for (; *a > 0 && *a == *b; ++a, ++b);
+	return *a == *b || (*a <= 0 && *b <= 0);
+}
+
+/** 复制字体 ID 列表，列表为空时也会分配一个只有结束符的列表 */
+static int *FontIds_Duplicate(const int *font_ids, size_t count)
+{
+	int *ids;
+
+	ids = malloc(sizeof(int) * (count + 1));
+	if (!ids) {
+		return NULL;
+	}
+	if (count > 0) {
+		memcpy(ids, font_ids, sizeof(int) * count);
+	}
+	ids[count] = 0;
+	return ids;
+}
+
+/** 获取与字体列表内容相同的副本，没有时新建一个，需持有写入锁 */
+static const int *FontFallbackTable_GetIds(LCUI_FontFallbackTable table,
+					   const int *font_ids)
+{
+	int *ids;
+	size_t count;
+	LinkedListNode *node;
+
+	for (LinkedList_Each(node, &table->lists)) {
+		if (FontIds_Equal(node->data, font_ids)) {
+			return node->data;
+		}
+	}
+	for (count = 0; font_ids[count] > 0; ++count);
+	ids = FontIds_Duplicate(font_ids, count);
+	if (ids) {
+		LinkedList_Append(&table->lists, ids);
+	}
+	return ids;
+}
+
+/** 查找字体回退记录所在的槽位，没有时返回空槽位，无需加锁 */
+static LCUI_FontFallback FontFallbackTable_Find(LCUI_FontFallbackTable table,
+						uint64_t key,
+						const int *font_ids,
+						uint32_t code)
+{
+	const int *ids;
+	size_t i, mask = table->size - 1;
+	LCUI_FontFallback slot;
+
+	i = GlyphHash(key ^ ((uint64_t)code * 0x9e3779b97f4a7c15ULL)) & mask;
+	for (;; i = (i + 1) & mask) {
+		slot = &table->slots[i];
+		ids = AtomicLoadPtr(&slot->font_ids);
+		if (!ids || (slot->key == key && slot->code == code &&
+			     FontIds_Equal(ids, font_ids))) {
+			return slot;
+		}
+	}
+}
+
+/** 获取字体回退记录中的字体，无需加锁，但需在登记读取后调用 */
+static int FontFallbackCache_Get(LCUI_FontFallbackCache cache, uint64_t key,
+				 const int *font_ids, uint32_t code)
+{
+	LCUI_FontFallback slot;
+	LCUI_FontFallbackTable table;
+
+	table = AtomicLoadPtr(&cache->table);
+	if (!table) {
+		return 0;
+	}
+	slot = FontFallbackTable_Find(table, key, font_ids, code);
+	if (!AtomicLoadPtr(&slot->font_ids)) {
+		return 0;
+	}
+	return slot->font_id;
+}
+
+/**
+ * 扩大哈希表，需持有写入锁
+ * 记录过多时不再扩大，而是换用一个空表，旧的记录和字体列表随旧表一起释放。
+ */
+static int FontFallbackCache_Grow(LCUI_FontFallbackCache cache)
+{
+	size_t i, size = FALLBACK_TABLE_INIT_SIZE;
+	LCUI_FontFallback slot;
+	LCUI_FontFallbackTable table, old_table = cache->table;
+
+	if (old_table && old_table->length < FALLBACK_TABLE_MAX_LENGTH) {
+		size = old_table->size * 2;
+	} else {
+		old_table = NULL;
+	}
+	table = FontFallbackTable(size);
+	if (!table) {
+		return -ENOMEM;
+	}
+	if (old_table) {
+		for (i = 0; i < old_table->size; ++i) {
+			if (!old_table->slots[i].font_ids) {
+				continue;
+			}
+			slot = FontFallbackTable_Find(
+			    table, old_table->slots[i].key,
+			    old_table->slots[i].font_ids,
+			    old_table->slots[i].code);
+			*slot = old_table->slots[i];
+			table->length += 1;
+		}
+		/* 字体列表仍被复制过来的记录引用，改由新表持有 */
+		LinkedList_Concat(&table->lists, &old_table->lists);
+	}
+	FontFallbackCache_SetTable(cache, table);
+	return 0;
+}
+
+/** 添加字体回退记录，需持有写入锁，记录已存在时不做任何操作 */
+static void FontFallbackCache_Put(LCUI_FontFallbackCache cache, uint64_t key,
+				  const int *font_ids, uint32_t code,
+				  int font_id)
+{
+	LCUI_FontFallback slot;
+	LCUI_FontFallbackTable table = cache->table;
+
+	FontFallbackCache_Reclaim(cache);
+	if ((!table || (table->length + 1) * 2 > table->size) &&
+	    FontFallbackCache_Grow(cache) != 0) {
+		return;
+	}
+	table = cache->table;
+	slot = FontFallbackTable_Find(table, key, font_ids, code);
+	/* 已发布的记录可能正在被其它线程读取，不能修改 */
+	if (slot->font_ids) {
+		return;
+	}
+	font_ids = FontFallbackTable_GetIds(table, font_ids);
+	if (!font_ids) {
+		return;
+	}
+	slot->key = key;
+	slot->code = code;
+	slot->font_id = font_id;
+	/* 记录已写入完毕，发布后即可被其它线程读取 */
+	AtomicStorePtr(&slot->font_ids, font_ids);
+	table->length += 1;
+}
+
+int LCUIFont_Add(LCUI_Font font)
+{
+	LCUI_Font exists_font;
+	LCUI_FontFamilyNode node;
+	LCUI_FontStyleNode snode;
+	node = SelectFontFamliy(font->family_name);
+	if (!node) {
+		node = NEW(LCUI_FontFamilyNodeRec, 1);
+		node->family_name = strdup2(font->family_name);
+		memset(node->styles, 0, sizeof(node->styles));
+		Dict_Add(fontlib.font_families, node->family_name, node);
+	}
+	snode = SelectFontStyle(node, font->style);
+	exists_font = SelectFontWeight(snode, font->weight);
+	if (exists_font) {
+		font->id = exists_font->id;
+		if (fontlib.default_font &&
+		    font->id == fontlib.default_font->id) {
+			fontlib.default_font = font;
+		}
+		ClearFontWeight(snode, font->weight);
+		DeleteFont(exists_font);
+	} else {
+		font->id = ++fontlib.count;
+	}
+	SetFontWeight(snode, font);
+	SetFontCache(font);
+	/* 新的字体可能有之前找不到的字形，已有的回退结果需要重新查找 */
+	LCUIMutex_Lock(&fontlib.fallback_cache.mutex);
+	FontFallbackCache_Clear(&fontlib.fallback_cache);
+	LCUIMutex_Unlock(&fontlib.fallback_cache.mutex);
+	return font->id;
+}
+
+LCUI_Font LCUIFont_GetById(int id)
+{
+	if (!fontlib.active) {
+		return NULL;
+	}
+	if (id < 0 || id >= fontlib.font_cache_num * FONT_CACHE_SIZE) {
+		return NULL;
+	}
+	return GetFontCache(id);
+}
+
+size_t LCUIFont_UpdateWeight(const int *font_ids, LCUI_FontWeight weight,
+			     int **new_font_ids)
+{
+	int id, *ids;
+	LCUI_Font font;
+	size_t i, count, len;
+
+	if (!font_ids) {
+		return 0;
+	}
+	for (len = 0; font_ids[len]; ++len)
+		;
+	if (len < 1) {
+		return 0;
+	}
+	ids = malloc((len + 1) * sizeof(int));
+	if (!ids) {
+		return 0;
+	}
+	for (i = 0, count = 0; i < len; ++i) {
+		font = LCUIFont_GetById(font_ids[i]);
+		id = LCUIFont_GetId(font->family_name, font->style, weight);
+		if (id > 0) {
+			ids[count++] = id;
+		}
+	}
+	ids[count] = 0;
+	if (new_font_ids && count > 0) {
+		*new_font_ids = ids;
+	} else {
+		*new_font_ids = NULL;
+		free(ids);
+	}
+	return count;
+}
+
+size_t LCUIFont_UpdateStyle(const int *font_ids, LCUI_FontStyle style,
+			    int **new_font_ids)
+{
+	int id, *ids;
+	LCUI_Font font;
+	size_t i, count, len;
+
+	if (!font_ids) {
+		return 0;
+	}
+	for (len = 0; font_ids[len]; ++len)
+		;
+	if (len < 1) {
+		return 0;
+	}
+	ids = malloc((len + 1) * sizeof(int));
+	if (!ids) {
+		return 0;
+	}
+	for (i = 0, count = 0; i < len; ++i) {
+		font = LCUIFont_GetById(font_ids[i]);
+		id = LCUIFont_GetId(font->family_name, style, font->weight);
+		if (id > 0) {
+			ids[count++] = id;
+		}
+	}
+	ids[count] = 0;
+	if (new_font_ids && count > 0) {
+		*new_font_ids = ids;
+	} else {
+		*new_font_ids = NULL;
+		free(ids);
+	}
+	return count;
+}
+
+static size_t LCUIFont_ParseIdByNames(int **font_ids, LCUI_FontStyle style,
+				      LCUI_FontWeight weight,
+				      const char *names)
+{
+	int *ids;
+	char name[256];
+	const char *p;
+	size_t count, i;
+
+	*font_ids = NULL;
+	if (!names) {
+		return 0;
+	}
+	for (p = names, count = 1; *p; ++p) {
+		if (*p == ',') {
+			++count;
+		}
+	}
+	if (p - names == 0) {
+		return 0;
+	}
+	ids = NEW(int, count + 1);
+	if (!ids) {
+		return 0;
+	}
+	for (p = names, count = 0, i = 0;; ++p) {
+		if (*p != ',' && *p) {
+			name[i++] = *p;
+			continue;
+		}
+		name[i] = 0;
+		strtrim(name, name, "'\"\n\r\t ");
+		ids[count] = LCUIFont_GetId(name, style, weight);
+		if (ids[count] > 0) {
+			++count;
+		}
+		i = 0;
+		if (!*p) {
+			break;
+		}
+	}
+	ids[count] = 0;
+	if (count < 1) {
+		free(ids);
+		ids = NULL;
+	}
+	*font_ids = ids;
+	return count;
+}
+
+size_t LCUIFont_GetIdByNames(int **font_ids, LCUI_FontStyle style,
+			     LCUI_FontWeight weight, const char *names)
+{
+	int *ids;
+	char *key;
+	size_t count = 0, generation;
+	LCUI_FontFallbackCache cache = &fontlib.fallback_cache;
+
+	*font_ids = NULL;
+	if (!names || !fontlib.active) {
+		return 0;
+	}
+	key = malloc(strlen(names) + 32);
+	if (!key) {
+		return 0;
+	}
+	sprintf(key, "%d %d %s", style, weight, names);
+	LCUIMutex_Lock(&cache->mutex);
+	generation = cache->generation;
+	ids = Dict_FetchValue(cache->names, key);
+	if (ids) {
+		for (count = 0; ids[count]; ++count);
+		ids = count > 0 ? FontIds_Duplicate(ids, count) : NULL;
+		LCUIMutex_Unlock(&cache->mutex);
+		free(key);
+		*font_ids = ids;
+		return ids ? count : 0;
+	}
+	LCUIMutex_Unlock(&cache->mutex);
+	count = LCUIFont_ParseIdByNames(font_ids, style, weight, names);
+	ids = FontIds_Duplicate(*font_ids, count);
+	LCUIMutex_Lock(&cache->mutex);
+	/* 解析期间载入了新的字体时，解析结果可能已经过时，不缓存它 */
+	if (ids && generation == cache->generation &&
+	    Dict_Add(cache->names, key, ids) == 0) {
+		ids = NULL;
+	}
+	LCUIMutex_Unlock(&cache->mutex);
+	free(ids);
+	free(key);
+	return count;
+}
+
+static LCUI_BOOL LCUIFont_HasChar(LCUI_Font font, wchar_t ch)
+{
+	if (!font->engine || !font->engine->has_char) {
+		return TRUE;
+	}
+	return font->engine->has_char(font, ch);
+}
+
+/** 在已载入的字体中查找有该字符的字形的字体，与 base 风格和字重相同的优先 */
+static int LCUIFont_FindIdByChar(LCUI_Font base, wchar_t ch)
+{
+	int id, pass;
+	LCUI_Font font;
+	LCUI_BOOL similar;
+
+	for (pass = 0; pass < 2; ++pass) {
+		for (id = 1; id <= fontlib.count; ++id) {
+			font = GetFontCache(id);
+			if (!font) {
+				continue;
+			}
+			similar = !base || (font->style == base->style &&
+					    font->weight == base->weight);
+			if (similar != (pass == 0)) {
+				continue;
+			}
+			if (LCUIFont_HasChar(font, ch)) {
+				return id;
+			}
+		}
+	}
+	return 0;
+}
+
+int LCUIFont_GetIdByChar(const int *font_ids, wchar_t ch)
+{
+	int i, id;
+	uint64_t key;
+	static const int empty_ids[1] = { 0 };
+	size_t generation, epoch;
+	LCUI_Font font, base = NULL;
+	LCUI_FontFallbackCache cache = &fontlib.fallback_cache;
+
+	if (!fontlib.active) {
+		return -1;
+	}
+	if (!font_ids) {
+		font_ids = empty_ids;
+	}
+	key = FontIds_Hash(font_ids);
+	generation = AtomicSyncGetSize(&cache->generation);
+	epoch = FontEpoch_BeginRead(&cache->epoch);
+	id = FontFallbackCache_Get(cache, key, font_ids, ch);
+	FontEpoch_EndRead(&cache->epoch, epoch);
+	if (id > 0) {
+		return id;
+	}
+	for (i = 0; font_ids[i] > 0; ++i) {
+		font = LCUIFont_GetById(font_ids[i]);
+		if (!font) {
+			continue;
+		}
+		if (!base) {
+			base = font;
+		}
+		if (LCUIFont_HasChar(font, ch)) {
+			id = font->id;
+			break;
+		}
+	}
+	font = fontlib.default_font;
+	if (id < 1 && font && LCUIFont_HasChar(font, ch)) {
+		id = font->id;
+	}
+	if (id < 1) {
+		id = LCUIFont_FindIdByChar(base ? base : font, ch);
+	}
+	/* 所有字体都没有该字符的字形，由首个字体显示它的替代字形 */
+	if (id < 1) {
+		id = base ? base->id : LCUIFont_GetDefault();
+	}
+	LCUIMutex_Lock(&cache->mutex);
+	if (id > 0 && generation == cache->generation) {
+		FontFallbackCache_Put(cache, key, font_ids, ch, id);
+	}
+	LCUIMutex_Unlock(&cache->mutex);
+	return id;
+}
+
+static LCUI_FontWeight FindBolderWeight(LCUI_FontStyleNode snode,
+					LCUI_FontWeight weight)
+{
+	for (weight += 100; weight <= FONT_WEIGHT_BLACK; weight += 100) {
+		if (SelectFontWeight(snode, weight)) {
+			return weight;
+		}
+	}
+	return FONT_WEIGHT_NONE;
+}
+
+static LCUI_FontWeight FindLighterWeight(LCUI_FontStyleNode snode,
+					 LCUI_FontWeight weight)
+{
+	for (weight -= 100; weight >= FONT_WEIGHT_THIN; weight -= 100) {
+		if (SelectFontWeight(snode, weight)) {
+			return weight;
+		}
+	}
+	return FONT_WEIGHT_NONE;
+}
+
+/**
+ * 在未找到指定字重的字体时进行回退，找到合适的字体
+ * 回退规则的参考文档：https://developer.mozilla.org/en-US/docs/Web/CSS/font-weight#Fallback_weights
+ */
+static LCUI_FontWeight FontWeightFallback(LCUI_FontStyleNode snode,
+					  LCUI_FontWeight weight)
+{
+	if (weight > FONT_WEIGHT_MEDIUM) {
+		return FindBolderWeight(snode, weight);
+	}
+	if (weight < FONT_WEIGHT_NORMAL) {
+		return FindLighterWeight(snode, weight);
+	}
+	if (weight == FONT_WEIGHT_NORMAL) {
+		if (SelectFontWeight(snode, FONT_WEIGHT_MEDIUM)) {
+			return FONT_WEIGHT_MEDIUM;
+		}
+	} else if (weight == FONT_WEIGHT_MEDIUM) {
+		if (SelectFontWeight(snode, FONT_WEIGHT_NORMAL)) {
+			return FONT_WEIGHT_NORMAL;
+		}
+	}
+	weight = FindLighterWeight(snode, weight);
+	if (weight != FONT_WEIGHT_NONE) {
+		return weight;
+	}
+	return FONT_WEIGHT_NONE;
+}
+
+int LCUIFont_GetId(const char *family_name, LCUI_FontStyle style,
+		   LCUI_FontWeight weight)
+{
+	int style_num;
+	LCUI_FontWeight w;
+	LCUI_FontStyleNode snode;
+	LCUI_FontFamilyNode fnode;
+
+	if (!fontlib.active) {
+		return -1;
+	}
+	fnode = SelectFontFamliy(family_name);
+	if (!fnode) {
+		return -2;
+	}
+	if (weight == 0) {
+		weight = FONT_WEIGHT_NORMAL;
+	}
+	for (style_num = style; style_num >= 0; --style_num) {
+		snode = &fnode->styles[style_num];
+		if (SelectFontWeight(snode, weight)) {
+			return SelectFontWeight(snode, weight)->id;
+		}
+		w = FontWeightFallback(snode, weight);
+		if (w) {
+			return SelectFontWeight(snode, w)->id;
+		}
+	}
+	return -3;
+}
+
+int LCUIFont_GetDefault(void)
+{
+	if (!fontlib.default_font) {
+		return -1;
+	}
+	return fontlib.default_font->id;
+}
+
+void LCUIFont_SetDefault(int id)
+{
+	LCUI_Font font = LCUIFont_GetById(id);
+	if (font) {
+		fontlib.default_font = font;
+		Logger_Debug("[font] select: %s\n", font->family_name);
+	}
+}
+
+/** 获取字体在字形缓存中的键值，未启用字形缓存时返回 0 */
+static uint64_t LCUIFont_GetCacheKey(int font_id)
+{
+	LCUI_Font font;
+
+	if (!fontlib.glyph_cache_enabled) {
+		return 0;
+	}
+	font = LCUIFont_GetById(font_id);
+	return font ? font->cache_key : 0;
+}
+
+/**
+ * 载入字体位图，优先从字形缓存中读取，读取不到时再用字体引擎渲染
+ * @param[out] cache_key 新渲染的字体位图需要存入字形缓存时，为字体的键值，
+ *  否则为 0
+ */
+static int LCUIFont_LoadBitmap(LCUI_FontBitmap *bmp, wchar_t ch, int font_id,
+			       int size, uint64_t *cache_key)
+{
+	int ret;
+	uint64_t key = LCUIFont_GetCacheKey(font_id);
+
+	*cache_key = 0;
+	if (key && GlyphCache_Read(&fontlib.glyph_cache, key, ch, size,
+				   bmp) == 0) {
+		return 0;
+	}
+	ret = LCUIFont_RenderBitmap(bmp, ch, font_id, size);
+	if (ret == 0) {
+		*cache_key = key;
+	}
+	return ret;
+}
+
+LCUI_FontBitmap *LCUIFont_AddBitmap(wchar_t ch, int font_id, int size,
+				    const LCUI_FontBitmap *bmp)
+{
+	LCUI_FontGlyph glyph;
+	LCUI_FontBitmapCache cache = &fontlib.bitmap_cache;
+
+	if (!fontlib.active) {
+		return NULL;
+	}
+	/* 当字体ID不大于0时，使用内置字体 */
+	if (font_id <= 0) {
+		font_id = fontlib.incore_font->id;
+	}
+	LCUIMutex_Lock(&cache->mutex);
+	glyph = FontBitmapCache_Add(cache, GlyphKey(ch, font_id, size), bmp,
+				    TRUE);
+	FontBitmapCache_Reclaim(cache);
+	LCUIMutex_Unlock(&cache->mutex);
+	return glyph ? &glyph->bitmap : NULL;
+}
+
+int LCUIFont_GetBitmap(wchar_t ch, int font_id, int size,
+		       const LCUI_FontBitmap **bmp)
+{
+	int ret;
+	size_t epoch;
+	uint64_t key, cache_key, fallback_key = 0, missing_key = 0;
+	LCUI_FontGlyph glyph;
+	LCUI_FontBitmap bmp_cache;
+	LCUI_FontBitmapCache cache = &fontlib.bitmap_cache;
+
+	*bmp = NULL;
+	if (!fontlib.active) {
+		return -2;
+	}
+	if (font_id <= 0) {
+		if (fontlib.default_font) {
+			font_id = fontlib.default_font->id;
+		} else {
+			font_id = fontlib.incore_font->id;
+		}
+	}
+	key = GlyphKey(ch, font_id, size);
+	epoch = FontEpoch_BeginRead(&cache->epoch);
+	glyph = FontBitmapCache_Find(cache, key);
+	/* 字体中没有该字形，直接使用已记录的替代字形 */
+	if (glyph && glyph->fallback_key) {
+		fallback_key = glyph->fallback_key;
+		glyph = FontBitmapCache_Find(cache, fallback_key);
+	}
+	if (glyph) {
+		AtomicIncSize(&cache->hits);
+		FontBitmapCache_Touch(cache, glyph);
+	}
+	FontEpoch_EndRead(&cache->epoch, epoch);
+	if (glyph) {
+		*bmp = &glyph->bitmap;
+		return fallback_key ? -1 : 0;
+	}
+	/* 替代字形已被替换或回收，重新获取它 */
+	if (fallback_key) {
+		LCUIFont_GetBitmap(0, font_id, size, bmp);
+		return -1;
+	}
+	if (ch == 0) {
+		return -1;
+	}
+	AtomicIncSize(&cache->misses);
+	/* 在锁外渲染字体位图，让多个线程能够同时渲染不同的字符 */
+	FontBitmap_Init(&bmp_cache);
+	ret = LCUIFont_LoadBitmap(&bmp_cache, ch, font_id, size, &cache_key);
+	if (ret != 0) {
+		ret = LCUIFont_GetBitmap(0, font_id, size, bmp);
+		if (ret == 0) {
+			FontBitmap_Free(&bmp_cache);
+			LCUIMutex_Lock(&cache->mutex);
+			FontBitmapCache_AddFallback(cache, key,
+						    GlyphKey(0, font_id, size));
+			FontBitmapCache_Reclaim(cache);
+			LCUIMutex_Unlock(&cache->mutex);
+			return -1;
+		}
+		missing_key = key;
+		key = GlyphKey(0, font_id, size);
+		ret = -1;
+	}
+	/* 字形缓存有自己的锁，在写入锁外存入新渲染的字体位图 */
+	if (cache_key) {
+		GlyphCache_Add(&fontlib.glyph_cache, cache_key, ch, size,
+			       &bmp_cache);
+	}
+	/* 其它线程可能已经缓存了相同的字体位图，此时直接使用它 */
+	LCUIMutex_Lock(&cache->mutex);
+	glyph = FontBitmapCache_Add(cache, key, &bmp_cache, FALSE);
+	if (glyph && missing_key) {
+		FontBitmapCache_AddFallback(cache, missing_key, key);
+	}
+	FontBitmapCache_Reclaim(cache);
+	LCUIMutex_Unlock(&cache->mutex);
+	if (glyph) {
+		*bmp = &glyph->bitmap;
+	}
+	return ret;
+}
+
+int LCUIFont_PinBitmap(const LCUI_FontBitmap *bmp)
+{
+	LCUI_FontGlyph glyph;
+	LCUI_FontBitmapCache cache = &fontlib.bitmap_cache;
+
+	if (!fontlib.active) {
+		return -2;
+	}
+	LCUIMutex_Lock(&cache->mutex);
+	glyph = FontBitmapCache_FindByBitmap(cache, bmp);
+	if (glyph) {
+		FontBitmapCache_Touch(cache, glyph);
+	}
+	LCUIMutex_Unlock(&cache->mutex);
+	return glyph ? 0 : -1;
+}
+
+void LCUIFont_EndFrame(void)
+{
+	LCUI_FontBitmapCache cache = &fontlib.bitmap_cache;
+
+	if (!fontlib.active) {
+		return;
+	}
+	LCUIMutex_Lock(&cache->mutex);
+	/* 刚结束的帧中用到的图集页很可能在下一帧中继续使用，先回收再进入下一帧 */
+	if (cache->limit > 0) {
+		FontBitmapCache_Trim(cache, cache->limit);
+	}
+	FontBitmapCache_Reclaim(cache);
+	cache->frame += 1;
+	LCUIMutex_Unlock(&cache->mutex);
+}
+
+void LCUIFont_SetBitmapCacheLimit(size_t max_bytes)
+{
+	LCUI_FontBitmapCache cache = &fontlib.bitmap_cache;
+
+	if (!fontlib.active) {
+		cache->limit = max_bytes;
+		return;
+	}
+	LCUIMutex_Lock(&cache->mutex);
+	cache->limit = max_bytes;
+	if (max_bytes > 0) {
+		FontBitmapCache_Trim(cache, max_bytes);
+	}
+	FontBitmapCache_Reclaim(cache);
+	LCUIMutex_Unlock(&cache->mutex);
+}
+
+size_t LCUIFont_TrimBitmapCache(size_t max_bytes)
+{
+	size_t bytes;
+	LCUI_FontBitmapCache cache = &fontlib.bitmap_cache;
+
+	if (!fontlib.active) {
+		return 0;
+	}
+	LCUIMutex_Lock(&cache->mutex);
+	bytes = FontBitmapCache_Trim(cache, max_bytes);
+	FontBitmapCache_Reclaim(cache);
+	LCUIMutex_Unlock(&cache->mutex);
+	return bytes;
+}
+
+size_t LCUIFont_BeginRead(void)
+{
+	return FontEpoch_BeginRead(&fontlib.bitmap_cache.epoch);
+}
+
+void LCUIFont_EndRead(size_t epoch)
+{
+	FontEpoch_EndRead(&fontlib.bitmap_cache.epoch, epoch);
+}
+
+void LCUIFont_GetBitmapCacheStats(LCUI_FontBitmapCacheStats stats)
+{
+	LCUI_FontBitmapCache cache = &fontlib.bitmap_cache;
+
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+	stats->evictions = cache->evictions;
+	stats->glyphs = cache->length;
+	stats->pages = cache->pages.length;
+	stats->bytes = cache->bytes;
+	stats->retired = cache->retired_pages.length +
+			 cache->retired_tables.length;
+	stats->limit = cache->limit;
+}
+
+/** 根据字体目录中的记录载入字体，字体文件等到渲染字形时再打开 */
+static int LCUIFont_LoadCatalogFile(LCUI_FontEngine *engine,
+				    LCUI_FontCatalogFile file)
+{
+	int i, id;
+	void *data;
+	LCUI_Font font;
+	LCUI_FontCatalogFace face;
+
+	for (i = 0; i < file->faces_length; ++i) {
+		face = &file->faces[i];
+		data = engine->open_face(file->path, face->index);
+		if (!data) {
+			continue;
+		}
+		font = Font(face->family_name, face->style_name);
+		font->engine = engine;
+		font->data = data;
+		if (fontlib.glyph_cache_enabled) {
+			font->cache_key =
+			    GlyphCache_GetFontKey(file->path, face->index);
+		}
+		id = LCUIFont_Add(font);
+		Logger_Debug("[font] add family: %s, style name: %s, id: %d\n",
+			     font->family_name, font->style_name, id);
+	}
+	return 0;
+}
+
+static int LCUIFont_LoadFileEx(LCUI_FontEngine *engine, const char *file)
+{
+	LCUI_Font *fonts;
+	LCUI_FontCatalogFile catalog_file = NULL;
+	int i, num_fonts, id;
+
+	Logger_Debug("[font] load file: %s\n", file);
+	if (!engine) {
+		return -1;
+	}
+	if (file && engine->open_face && fontlib.catalog.files) {
+		catalog_file = FontCatalog_Find(&fontlib.catalog, file);
+	}
+	if (catalog_file) {
+		return LCUIFont_LoadCatalogFile(engine, catalog_file);
+	}
+	num_fonts = engine->open(file, &fonts);
+	if (num_fonts < 1) {
+		Logger_Debug("[font] failed to load file: %s\n", file);
+		return -2;
+	}
+	if (engine->open_face && fontlib.catalog.files) {
+		FontCatalog_Add(&fontlib.catalog, file, fonts, num_fonts);
+	}
+	for (i = 0; i < num_fonts; ++i) {
+		if (!fonts[i]) {
+			continue;
+		}
+		fonts[i]->engine = engine;
+		if (file && fontlib.glyph_cache_enabled) {
+			fonts[i]->cache_key = GlyphCache_GetFontKey(file, i);
+		}
+		id = LCUIFont_Add(fonts[i]);
+		Logger_Debug("[font] add family: %s, style name: %s, id: %d\n",
+			    fonts[i]->family_name, fonts[i]->style_name, id);
+	}
+	free(fonts);
+	return 0;
+}
+
+int LCUIFont_LoadFile(const char *filepath)
+{
+	return LCUIFont_LoadFileEx(fontlib.engine, filepath);
+}
+
+void LCUIFont_SetCatalogCachePath(const char *path)
+{
+	if (fontlib.catalog_path) {
+		free(fontlib.catalog_path);
+	}
+	fontlib.catalog_path = path ? strdup2(path) : NULL;
+	fontlib.catalog_path_set = path != NULL;
+}
+
+static void LCUIFont_InitCatalog(void)
+{
+	const char *path;
+
+	if (!fontlib.catalog_path_set) {
+		free(fontlib.catalog_path);
+		path = getenv("LCUI_FONT_CACHE");
+		fontlib.catalog_path = path ? strdup2(path) : NULL;
+	}
+	fontlib.catalog.files = NULL;
+	if (!fontlib.catalog_path || !fontlib.catalog_path[0]) {
+		return;
+	}
+	FontCatalog_Init(&fontlib.catalog);
+	FontCatalog_Load(&fontlib.catalog, fontlib.catalog_path);
+}
+
+/** 创建文件所在的目录，缓存文件所在的目录可能还不存在 */
+static int LCUIFont_MakeParentDir(const char *filepath)
+{
+#ifndef LCUI_BUILD_IN_WIN32
+	int ret = 0;
+	char *p, *dir;
+
+	dir = strdup2(filepath);
+	if (!dir) {
+		return -ENOMEM;
+	}
+	for (p = strchr(dir + 1, '/'); p; p = strchr(p + 1, '/')) {
+		*p = 0;
+		if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+			ret = -errno;
+			break;
+		}
+		*p = '/';
+	}
+	free(dir);
+	return ret;
+#else
+	return 0;
+#endif
+}
+
+/** 保存字体目录中新增的记录 */
+static void LCUIFont_SaveCatalog(void)
+{
+	if (!fontlib.catalog.files || !fontlib.catalog.changed) {
+		return;
+	}
+	LCUIFont_MakeParentDir(fontlib.catalog_path);
+	if (FontCatalog_Save(&fontlib.catalog, fontlib.catalog_path) != 0) {
+		Logger_Debug("[font] failed to save catalog cache: %s\n",
+			     fontlib.catalog_path);
+	}
+}
+
+static void LCUIFont_FreeCatalog(void)
+{
+	LCUIFont_SaveCatalog();
+	if (fontlib.catalog.files) {
+		FontCatalog_Destroy(&fontlib.catalog);
+	}
+}
+
+void LCUIFont_SetGlyphCachePath(const char *path)
+{
+	if (fontlib.glyph_cache_path) {
+		free(fontlib.glyph_cache_path);
+	}
+	fontlib.glyph_cache_path = path ? strdup2(path) : NULL;
+	fontlib.glyph_cache_path_set = path != NULL;
+}
+
+static void LCUIFont_InitGlyphCache(void)
+{
+	const char *path;
+
+	if (!fontlib.glyph_cache_path_set) {
+		free(fontlib.glyph_cache_path);
+		path = getenv("LCUI_GLYPH_CACHE");
+		fontlib.glyph_cache_path = path ? strdup2(path) : NULL;
+	}
+	GlyphCache_Init(&fontlib.glyph_cache);
+	fontlib.glyph_cache_enabled =
+	    fontlib.glyph_cache_path && fontlib.glyph_cache_path[0];
+	if (fontlib.glyph_cache_enabled) {
+		GlyphCache_Load(&fontlib.glyph_cache, fontlib.glyph_cache_path);
+	}
+}
+
+/** 保存新渲染的字体位图，然后释放字形缓存 */
+static void LCUIFont_FreeGlyphCache(void)
+{
+	if (fontlib.glyph_cache_enabled &&
+	    GlyphCache_Save(&fontlib.glyph_cache,
+			    fontlib.glyph_cache_path) != 0) {
+		Logger_Debug("[font] failed to save glyph cache: %s\n",
+			     fontlib.glyph_cache_path);
+	}
+	GlyphCache_Destroy(&fontlib.glyph_cache);
+	fontlib.glyph_cache_enabled = FALSE;
+}
+
+/** 打印字体位图的信息 */
+void FontBitmap_PrintInfo(LCUI_FontBitmap *bitmap)
+{
+	printf("address:%p\n", bitmap);
+	if (!bitmap) {
+		return;
+	}
+	printf("top: %d, left: %d, width:%d, rows:%d\n", bitmap->top, bitmap->left,
+	    bitmap->width, bitmap->rows);
+}
+
+/** 初始化字体位图 */
+void FontBitmap_Init(LCUI_FontBitmap *bitmap)
+{
+	bitmap->rows = 0;
+	bitmap->width = 0;
+	bitmap->top = 0;
+	bitmap->left = 0;
+	bitmap->pitch = 0;
+	bitmap->num_grays = 0;
+	bitmap->pixel_mode = 0;
+	bitmap->advance.x = 0;
+	bitmap->advance.y = 0;
+	bitmap->buffer = NULL;
+}
+
+/** 释放字体位图占用的资源 */
+void FontBitmap_Free(LCUI_FontBitmap *bitmap)
+{
+	if (bitmap->buffer) {
+		free(bitmap->buffer);
+	}
+	FontBitmap_Init(bitmap);
+}
+
+/** 创建字体位图 */
+int FontBitmap_Create(LCUI_FontBitmap *bitmap, int width, int rows)
+{
+	size_t size;
+	if (width < 0 || rows < 0) {
+		FontBitmap_Free(bitmap);
+		return -1;
+	}
+	if (FontBitmap_IsValid(bitmap)) {
+		FontBitmap_Free(bitmap);
+	}
+	bitmap->width = width;
+	bitmap->rows = rows;
+	size = width * rows * sizeof(uchar_t);
+	bitmap->buffer = (uchar_t *)malloc(size);
+	if (bitmap->buffer == NULL) {
+		return -2;
+	}
+	return 0;
+}
+
+/** 在屏幕打印以0和1表示字体位图 */
+int FontBitmap_Print(LCUI_FontBitmap *fontbmp)
+{
+	int x, y, m;
+	for (y = 0; y < fontbmp->rows; ++y) {
+		m = y * fontbmp->width;
+		for (x = 0; x < fontbmp->width; ++x, ++m) {
+			if (fontbmp->buffer[m] > 128) {
+				printf("#");
+			} else if (fontbmp->buffer[m] > 64) {
+				printf("-");
+			} else {
+				printf(" ");
+			}
+		}
+		printf("\n");
+	}
+	printf("\n");
+	return 0;
+}
+
+static void FontBitmap_MixARGB(LCUI_Graph *graph, LCUI_Rect *write_rect,
+			       const LCUI_FontBitmap *bmp, LCUI_Color color,
+			       LCUI_Rect *read_rect)
+{
+	int x, y;
+	LCUI_Color c;
+	LCUI_ARGB *px, *px_row_des;
+	uchar_t *byte_ptr, *byte_row_ptr;
+
+	byte_row_ptr = bmp->buffer + read_rect->y * bmp->width;
+	px_row_des = graph->argb + write_rect->y * graph->width;
+	byte_row_ptr += read_rect->x;
+	px_row_des += write_rect->x;
+	for (y = 0; y < read_rect->height; ++y) {
+		px = px_row_des;
+		byte_ptr = byte_row_ptr;
+		for (x = 0; x < read_rect->width; ++x, ++byte_ptr, ++px) {
+			c = color;
+			c.alpha = (uchar_t)(*byte_ptr * color.alpha / 255.0);
+			LCUI_OverPixel(px, &c);
+		}
+		px_row_des += graph->width;
+		byte_row_ptr += bmp->width;
+	}
+}
+
+static void FontBitmap_MixRGB(LCUI_Graph *graph, LCUI_Rect *write_rect,
+			      const LCUI_FontBitmap *bmp, LCUI_Color color,
+			      LCUI_Rect *read_rect)
+{
+	int x, y;
+	uchar_t *byte_src, *byte_row_src, *byte_row_des, *byte_des, alpha;
+	byte_row_src = bmp->buffer + read_rect->y * bmp->width + read_rect->x;
+	byte_row_des = graph->bytes + write_rect->y * graph->bytes_per_row;
+	byte_row_des += write_rect->x * graph->bytes_per_pixel;
+	for (y = 0; y < read_rect->height; ++y) {
+		byte_src = byte_row_src;
+		byte_des = byte_row_des;
+		for (x = 0; x < read_rect->width; ++x) {
+			alpha = (uchar_t)(*byte_src * color.alpha / 255);
+			ALPHA_BLEND(*byte_des, color.b, alpha);
+			++byte_des;
+			ALPHA_BLEND(*byte_des, color.g, alpha);
+			++byte_des;
+			ALPHA_BLEND(*byte_des, color.r, alpha);
+			++byte_des;
+			++byte_src;
+		}
+		byte_row_des += graph->bytes_per_row;
+		byte_row_src += bmp->width;
+	}
+}
+
+/*
+ * 在 x86 平台上使用 SIMD 指令同时混合多个像素，SSE2 版本每次处理 4 个 ARGB
+ * 像素或 16 个 RGB 像素，AVX2 版本每次处理 8 个 ARGB 像素。ARGB 像素的混合
+ * 公式与 LCUI_OverPixel() 相同，但使用单精度浮点数计算，结果可能会有 1 的
+ * 误差。RGB 像素的混合只用到整数运算，结果与 ALPHA_BLEND() 完全一致。
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FONT_BITMAP_MIX_SIMD
+#include <immintrin.h>
+
+/** 混合 4 个 ARGB 像素 */
+__attribute__((target("sse2"))) static inline void FontBitmap_BlendARGB_SSE2(
+    LCUI_ARGB *px, uint32_t coverage, LCUI_Color color)
+{
+	__m128i cov, dst, r, g, b, a;
+	__m128 src_a, dst_a, out_a, inv, opaque, fr, fg, fb;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i mask = _mm_set1_epi32(0xff);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+
+	/* alpha = coverage * color.alpha / 255 */
+	cov = _mm_unpacklo_epi8(_mm_cvtsi32_si128(coverage), zero);
+	cov = _mm_mullo_epi16(cov, _mm_set1_epi16(color.alpha));
+	cov = _mm_add_epi16(cov, _mm_set1_epi16(1));
+	cov = _mm_srli_epi16(_mm_add_epi16(cov, _mm_srli_epi16(cov, 8)), 8);
+	cov = _mm_unpacklo_epi16(cov, zero);
+	dst = _mm_loadu_si128((__m128i *)px);
+	src_a = _mm_mul_ps(_mm_cvtepi32_ps(cov), scale);
+	dst_a = _mm_cvtepi32_ps(_mm_srli_epi32(dst, 24));
+	dst_a = _mm_mul_ps(_mm_mul_ps(dst_a, scale), _mm_sub_ps(one, src_a));
+	out_a = _mm_add_ps(src_a, dst_a);
+	opaque = _mm_cmpgt_ps(out_a, _mm_setzero_ps());
+	inv = _mm_or_ps(_mm_and_ps(opaque, _mm_div_ps(one, out_a)),
+			_mm_andnot_ps(opaque, one));
+	src_a = _mm_mul_ps(src_a, inv);
+	dst_a = _mm_mul_ps(dst_a, inv);
+	fb = _mm_cvtepi32_ps(_mm_and_si128(dst, mask));
+	fg = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(dst, 8), mask));
+	fr = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(dst, 16), mask));
+	b = _mm_cvttps_epi32(_mm_add_ps(
+	    _mm_mul_ps(_mm_set1_ps(color.b), src_a), _mm_mul_ps(fb, dst_a)));
+	g = _mm_cvttps_epi32(_mm_add_ps(
+	    _mm_mul_ps(_mm_set1_ps(color.g), src_a), _mm_mul_ps(fg, dst_a)));
+	r = _mm_cvttps_epi32(_mm_add_ps(
+	    _mm_mul_ps(_mm_set1_ps(color.r), src_a), _mm_mul_ps(fr, dst_a)));
+	a = _mm_cvttps_epi32(_mm_mul_ps(_mm_set1_ps(255.0f), out_a));
+	a = _mm_or_si128(
+	    _mm_or_si128(b, _mm_slli_epi32(g, 8)),
+	    _mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(a, 24)));
+	/* 保持透明度为 0 的像素不变，避免浮点误差使背景的透明度逐渐降低 */
+	cov = _mm_and_si128(_mm_cmpeq_epi32(cov, zero),
+			    _mm_castps_si128(opaque));
+	dst = _mm_or_si128(_mm_and_si128(cov, dst), _mm_andnot_si128(cov, a));
+	_mm_storeu_si128((__m128i *)px, dst);
+}
+
+__attribute__((target("sse2"))) static void FontBitmap_MixARGB_SSE2(
+    LCUI_Graph *graph, LCUI_Rect *write_rect, const LCUI_FontBitmap *bmp,
+    LCUI_Color color, LCUI_Rect *read_rect)
+{
+	int x, y, n;
+	uint32_t coverage;
+	LCUI_ARGB *px, *px_row_des, tail[4];
+	uchar_t *byte_ptr, *byte_row_ptr;
+
+	byte_row_ptr = bmp->buffer + read_rect->y * bmp->width;
+	px_row_des = graph->argb + write_rect->y * graph->width;
+	byte_row_ptr += read_rect->x;
+	px_row_des += write_rect->x;
+	for (y = 0; y < read_rect->height; ++y) {
+		px = px_row_des;
+		byte_ptr = byte_row_ptr;
+		for (x = 0; x + 4 <= read_rect->width;
+		     x += 4, byte_ptr += 4, px += 4) {
+			memcpy(&coverage, byte_ptr, sizeof(coverage));
+			if (coverage) {
+				FontBitmap_BlendARGB_SSE2(px, coverage, color);
+			}
+		}
+		/* 字形通常很窄，剩余的像素也放到寄存器中一起混合 */
+		n = read_rect->width - x;
+		if (n > 0) {
+			coverage = 0;
+			memcpy(&coverage, byte_ptr, n);
+			memcpy(tail, px, sizeof(LCUI_ARGB) * n);
+			FontBitmap_BlendARGB_SSE2(tail, coverage, color);
+			memcpy(px, tail, sizeof(LCUI_ARGB) * n);
+		}
+		px_row_des += graph->width;
+		byte_row_ptr += bmp->width;
+	}
+}
+
+/** 混合 8 个 ARGB 像素 */
+__attribute__((target("avx2"))) static inline void FontBitmap_BlendARGB_AVX2(
+    LCUI_ARGB *px, const uchar_t *coverage, LCUI_Color color)
+{
+	__m256i cov, dst, r, g, b, a;
+	__m256 src_a, dst_a, out_a, inv, opaque, fr, fg, fb;
+	const __m256i mask = _mm256_set1_epi32(0xff);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+
+	cov = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)coverage));
+	cov = _mm256_mullo_epi32(cov, _mm256_set1_epi32(color.alpha));
+	cov = _mm256_add_epi32(cov, _mm256_set1_epi32(1));
+	cov = _mm256_srli_epi32(
+	    _mm256_add_epi32(cov, _mm256_srli_epi32(cov, 8)), 8);
+	dst = _mm256_loadu_si256((__m256i *)px);
+	src_a = _mm256_mul_ps(_mm256_cvtepi32_ps(cov), scale);
+	dst_a = _mm256_cvtepi32_ps(_mm256_srli_epi32(dst, 24));
+	dst_a = _mm256_mul_ps(_mm256_mul_ps(dst_a, scale),
+			      _mm256_sub_ps(one, src_a));
+	out_a = _mm256_add_ps(src_a, dst_a);
+	opaque = _mm256_cmp_ps(out_a, _mm256_setzero_ps(), _CMP_GT_OQ);
+	inv = _mm256_blendv_ps(one, _mm256_div_ps(one, out_a), opaque);
+	src_a = _mm256_mul_ps(src_a, inv);
+	dst_a = _mm256_mul_ps(dst_a, inv);
+	fb = _mm256_cvtepi32_ps(_mm256_and_si256(dst, mask));
+	fg = _mm256_cvtepi32_ps(
+	    _mm256_and_si256(_mm256_srli_epi32(dst, 8), mask));
+	fr = _mm256_cvtepi32_ps(
+	    _mm256_and_si256(_mm256_srli_epi32(dst, 16), mask));
+	b = _mm256_cvttps_epi32(
+	    _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(color.b), src_a),
+			  _mm256_mul_ps(fb, dst_a)));
+	g = _mm256_cvttps_epi32(
+	    _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(color.g), src_a),
+			  _mm256_mul_ps(fg, dst_a)));
+	r = _mm256_cvttps_epi32(
+	    _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(color.r), src_a),
+			  _mm256_mul_ps(fr, dst_a)));
+	a = _mm256_cvttps_epi32(
+	    _mm256_mul_ps(_mm256_set1_ps(255.0f), out_a));
+	a = _mm256_or_si256(
+	    _mm256_or_si256(b, _mm256_slli_epi32(g, 8)),
+	    _mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_slli_epi32(a, 24)));
+	cov = _mm256_and_si256(_mm256_cmpeq_epi32(cov, _mm256_setzero_si256()),
+			       _mm256_castps_si256(opaque));
+	dst = _mm256_blendv_epi8(a, dst, cov);
+	_mm256_storeu_si256((__m256i *)px, dst);
+}
+
+__attribute__((target("avx2"))) static void FontBitmap_MixARGB_AVX2(
+    LCUI_Graph *graph, LCUI_Rect *write_rect, const LCUI_FontBitmap *bmp,
+    LCUI_Color color, LCUI_Rect *read_rect)
+{
+	int x, y, n;
+	uint64_t coverage;
+	LCUI_ARGB *px, *px_row_des, tail[8];
+	uchar_t *byte_ptr, *byte_row_ptr, tail_coverage[8];
+
+	byte_row_ptr = bmp->buffer + read_rect->y * bmp->width;
+	px_row_des = graph->argb + write_rect->y * graph->width;
+	byte_row_ptr += read_rect->x;
+	px_row_des += write_rect->x;
+	for (y = 0; y < read_rect->height; ++y) {
+		px = px_row_des;
+		byte_ptr = byte_row_ptr;
+		for (x = 0; x + 8 <= read_rect->width;
+		     x += 8, byte_ptr += 8, px += 8) {
+			memcpy(&coverage, byte_ptr, sizeof(coverage));
+			if (coverage) {
+				FontBitmap_BlendARGB_AVX2(px, byte_ptr, color);
+			}
+		}
+		n = read_rect->width - x;
+		if (n > 0) {
+			memset(tail_coverage, 0, sizeof(tail_coverage));
+			memcpy(tail_coverage, byte_ptr, n);
+			memcpy(tail, px, sizeof(LCUI_ARGB) * n);
+			FontBitmap_BlendARGB_AVX2(tail, tail_coverage, color);
+			memcpy(px, tail, sizeof(LCUI_ARGB) * n);
+		}
+		px_row_des += graph->width;
+		byte_row_ptr += bmp->width;
+	}
+}
+
+/**
+ * 混合 16 个 RGB 像素
+ * back + (fore - back) * alpha >> 8 等价于 (fore * alpha + back * (256 - alpha))
+ * >> 8，后者的中间结果不会超出 16 位无符号整数的范围。
+ */
+__attribute__((target("sse2"))) static inline void FontBitmap_BlendRGB_SSE2(
+    uchar_t *bytes, const uchar_t *coverage, LCUI_Color color,
+    const uchar_t *colors)
+{
+	int i;
+	uchar_t alpha, alphas[48];
+	__m128i src, dst, fore, back, lo, hi;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(256);
+
+	for (i = 0; i < 16; ++i) {
+		alpha = (uchar_t)(coverage[i] * color.alpha / 255);
+		alphas[i * 3] = alpha;
+		alphas[i * 3 + 1] = alpha;
+		alphas[i * 3 + 2] = alpha;
+	}
+	for (i = 0; i < 48; i += 16) {
+		src = _mm_loadu_si128((__m128i *)(alphas + i));
+		fore = _mm_loadu_si128((const __m128i *)(colors + i));
+		dst = _mm_loadu_si128((__m128i *)(bytes + i));
+		back = _mm_unpacklo_epi8(dst, zero);
+		lo = _mm_unpacklo_epi8(src, zero);
+		lo = _mm_add_epi16(
+		    _mm_mullo_epi16(_mm_unpacklo_epi8(fore, zero), lo),
+		    _mm_mullo_epi16(back, _mm_sub_epi16(full, lo)));
+		back = _mm_unpackhi_epi8(dst, zero);
+		hi = _mm_unpackhi_epi8(src, zero);
+		hi = _mm_add_epi16(
+		    _mm_mullo_epi16(_mm_unpackhi_epi8(fore, zero), hi),
+		    _mm_mullo_epi16(back, _mm_sub_epi16(full, hi)));
+		dst = _mm_packus_epi16(_mm_srli_epi16(lo, 8),
+				       _mm_srli_epi16(hi, 8));
+		_mm_storeu_si128((__m128i *)(bytes + i), dst);
+	}
+}
+
+__attribute__((target("sse2"))) static void FontBitmap_MixRGB_SSE2(
+    LCUI_Graph *graph, LCUI_Rect *write_rect, const LCUI_FontBitmap *bmp,
+    LCUI_Color color, LCUI_Rect *read_rect)
+{
+	int i, x, y;
+	uchar_t colors[48], alpha;
+	uchar_t *byte_src, *byte_row_src, *byte_row_des, *byte_des;
+	const __m128i zero = _mm_setzero_si128();
+
+	/* 16 个像素刚好占 3 个 128 位寄存器，前景色按同样的排列方式展开 */
+	for (i = 0; i < 48; i += 3) {
+		colors[i] = color.b;
+		colors[i + 1] = color.g;
+		colors[i + 2] = color.r;
+	}
+	byte_row_src = bmp->buffer + read_rect->y * bmp->width + read_rect->x;
+	byte_row_des = graph->bytes + write_rect->y * graph->bytes_per_row;
+	byte_row_des += write_rect->x * graph->bytes_per_pixel;
+	for (y = 0; y < read_rect->height; ++y) {
+		byte_src = byte_row_src;
+		byte_des = byte_row_des;
+		for (x = 0; x + 16 <= read_rect->width;
+		     x += 16, byte_src += 16, byte_des += 48) {
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(
+				_mm_loadu_si128((const __m128i *)byte_src),
+				zero)) != 0xffff) {
+				FontBitmap_BlendRGB_SSE2(byte_des, byte_src,
+							 color, colors);
+			}
+		}
+		/* RGB 像素的混合只需整数运算，剩余的像素逐个混合更快 */
+		for (; x < read_rect->width; ++x) {
+			alpha = (uchar_t)(*byte_src * color.alpha / 255);
+			ALPHA_BLEND(*byte_des, color.b, alpha);
+			++byte_des;
+			ALPHA_BLEND(*byte_des, color.g, alpha);
+			++byte_des;
+			ALPHA_BLEND(*byte_des, color.r, alpha);
+			++byte_des;
+			++byte_src;
+		}
+		byte_row_des += graph->bytes_per_row;
+		byte_row_src += bmp->width;
+	}
+}
+#endif
+
+typedef void (*FontBitmapMixFunc)(LCUI_Graph *, LCUI_Rect *,
+				  const LCUI_FontBitmap *, LCUI_Color,
+				  LCUI_Rect *);
+
+static struct FontBitmapMixer {
+	FontBitmapMixFunc argb;
+	FontBitmapMixFunc rgb;
+} fontbitmap_mixer = { FontBitmap_MixARGB, FontBitmap_MixRGB };
+
+/** 根据 CPU 支持的指令集选择字体位图的混合函数 */
+static void FontBitmap_InitMixer(void)
+{
+	fontbitmap_mixer.argb = FontBitmap_MixARGB;
+	fontbitmap_mixer.rgb = FontBitmap_MixRGB;
+#ifdef FONT_BITMAP_MIX_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		fontbitmap_mixer.argb = FontBitmap_MixARGB_SSE2;
+		fontbitmap_mixer.rgb = FontBitmap_MixRGB_SSE2;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		fontbitmap_mixer.argb = FontBitmap_MixARGB_AVX2;
+	}
+#endif
+}
+
+int FontBitmap_SetMixer(LCUI_FontBitmapMixerType type)
+{
+	switch (type) {
+	case FONT_BITMAP_MIXER_AUTO:
+		FontBitmap_InitMixer();
+		break;
+	case FONT_BITMAP_MIXER_SCALAR:
+		fontbitmap_mixer.argb = FontBitmap_MixARGB;
+		fontbitmap_mixer.rgb = FontBitmap_MixRGB;
+		break;
+#ifdef FONT_BITMAP_MIX_SIMD
+	case FONT_BITMAP_MIXER_SSE2:
+		__builtin_cpu_init();
+		if (!__builtin_cpu_supports("sse2")) {
+			return -ENOTSUP;
+		}
+		fontbitmap_mixer.argb = FontBitmap_MixARGB_SSE2;
+		fontbitmap_mixer.rgb = FontBitmap_MixRGB_SSE2;
+		break;
+	case FONT_BITMAP_MIXER_AVX2:
+		__builtin_cpu_init();
+		if (!__builtin_cpu_supports("avx2")) {
+			return -ENOTSUP;
+		}
+		fontbitmap_mixer.argb = FontBitmap_MixARGB_AVX2;
+		fontbitmap_mixer.rgb = FontBitmap_MixRGB_SSE2;
+		break;
+#endif
+	default:
+		return -ENOTSUP;
+	}
+	return 0;
+}
+
+int FontBitmap_Mix(LCUI_Graph *graph, LCUI_Pos pos, const LCUI_FontBitmap *bmp,
+		   LCUI_Color color)
+{
+	LCUI_Graph write_slot;
+	LCUI_Rect r_rect, w_rect;
+	if (!bmp->buffer) {
+		return -1;
+	}
+	if (pos.x > (int)graph->width || pos.y > (int)graph->height) {
+		return -2;
+	}
+	/* 获取写入区域 */
+	w_rect.x = pos.x;
+	w_rect.y = pos.y;
+	w_rect.width = bmp->width;
+	w_rect.height = bmp->rows;
+	/* 获取需要裁剪的区域 */
+	LCUIRect_GetCutArea(graph->width, graph->height, w_rect, &r_rect);
+	w_rect.x += r_rect.x;
+	w_rect.y += r_rect.y;
+	w_rect.width = r_rect.width;
+	w_rect.height = r_rect.height;
+	Graph_Quote(&write_slot, graph, &w_rect);
+	Graph_GetValidRect(&write_slot, &w_rect);
+	/* 获取背景图引用的源图形 */
+	graph = Graph_GetQuote(graph);
+	if (graph->color_type == LCUI_COLOR_TYPE_ARGB) {
+		fontbitmap_mixer.argb(graph, &w_rect, bmp, color, &r_rect);
+	} else {
+		fontbitmap_mixer.rgb(graph, &w_rect, bmp, color, &r_rect);
+	}
+	return 0;
+}
+
+int LCUIFont_RenderBitmap(LCUI_FontBitmap *buff, wchar_t ch, int font_id,
+			  int pixel_size)
+{
+	LCUI_Font font = fontlib.default_font;
+	do {
+		if (font_id < 0 || !fontlib.engine) {
+			break;
+		}
+		font = LCUIFont_GetById(font_id);
+		if (font) {
+			break;
+		}
+		if (fontlib.default_font) {
+			font = fontlib.default_font;
+		} else {
+			font = fontlib.incore_font;
+		}
+		break;
+	} while (0);
+	if (!font) {
+		return -1;
+	}
+	return font->engine->render(buff, ch, pixel_size, font);
+}
+
+static void LCUIFont_InitBase(void)
+{
+	fontlib.count = 0;
+	fontlib.font_cache_num = 1;
+	fontlib.font_cache = NEW(LCUI_FontCache, 1);
+	fontlib.font_cache[0] = FontCache();
+	FontBitmapCache_Init(&fontlib.bitmap_cache);
+	FontFallbackCache_Init(&fontlib.fallback_cache);
+	Dict_InitStringKeyType(&fontlib.font_families_type);
+	fontlib.font_families_type.valDestructor = DestroyFontFamilyNode;
+	fontlib.font_families = Dict_Create(&fontlib.font_families_type, NULL);
+	fontlib.active = TRUE;
+}
+
+static void LCUIFont_InitEngine(void)
+{
+	int fid;
+	/* 先初始化内置的字体引擎 */
+	fontlib.engine = &fontlib.engines[0];
+	LCUIFont_InitInCoreFont(fontlib.engine);
+	LCUIFont_LoadFile("in-core.inconsolata");
+	fid = LCUIFont_GetId("inconsolata", 0, 0);
+	fontlib.incore_font = LCUIFont_GetById(fid);
+	fontlib.default_font = fontlib.incore_font;
+	/* 然后看情况启用其它字体引擎 */
+#ifdef LCUI_FONT_ENGINE_FREETYPE
+	if (LCUIFont_InitFreeType(&fontlib.engines[1]) == 0) {
+		fontlib.engine = &fontlib.engines[1];
+	}
+#endif
+	if (fontlib.engine && fontlib.engine != &fontlib.engines[0]) {
+		Logger_Debug("[font] current font engine is: %s\n",
+		    fontlib.engine->name);
+	} else {
+		Logger_Warning("[font] warning: not font engine support!\n");
+	}
+}
+
+static void LCUIFont_FreeBase(void)
+{
+	if (!fontlib.active) {
+		return;
+	}
+	fontlib.active = FALSE;
+	while (fontlib.font_cache_num > 0) {
+		--fontlib.font_cache_num;
+		DeleteFontCache(fontlib.font_cache[fontlib.font_cache_num]);
+	}
+	Dict_Release(fontlib.font_families);
+	FontBitmapCache_Destroy(&fontlib.bitmap_cache);
+	FontFallbackCache_Destroy(&fontlib.fallback_cache);
+	free(fontlib.font_cache);
+	fontlib.font_cache = NULL;
+}
+
+static void LCUIFont_FreeEngine(void)
+{
+	LCUIFont_ExitInCoreFont();
+#ifdef LCUI_FONT_ENGINE_FREETYPE
+	LCUIFont_ExitFreeType();
+#endif
+}
+
+#ifdef LCUI_BUILD_IN_WIN32
+static void LCUIFont_LoadFontsForWindows(void)
+{
+	size_t i;
+	int *ids = NULL;
+	const char *names = "Consola, Simsun, Microsoft YaHei";
+	const char *fonts[] = { "C:/Windows/Fonts/consola.ttf",
+				"C:/Windows/Fonts/simsun.ttc",
+				"C:/Windows/Fonts/msyh.ttf",
+				"C:/Windows/Fonts/msyh.ttc" };
+
+	for (i = 0; i < sizeof(fonts) / sizeof(char *); ++i) {
+		LCUIFont_LoadFile(fonts[i]);
+	}
+	i = LCUIFont_GetIdByNames(&ids, FONT_STYLE_NORMAL, FONT_WEIGHT_NORMAL,
+				  names);
+	if (i > 0) {
+		LCUIFont_SetDefault(ids[i - 1]);
+	}
+	free(ids);
+}
+
+#else
+
+#ifdef USE_FONTCONFIG
+
+static void LCUIFont_LoadFontsByFontConfig(void)
+{
+	size_t i;
+	char *path;
+	int *ids = NULL;
+	const char *names = "Noto Sans CJK, Ubuntu, WenQuanYi Micro Hei";
+	const char *fonts[] = { "Ubuntu", "Noto Sans CJK SC",
+				"WenQuanYi Micro Hei" };
+
+	for (i = 0; i < sizeof(fonts) / sizeof(char *); ++i) {
+		path = Fontconfig_GetPath(fonts[i]);
+		LCUIFont_LoadFile(path);
+		free(path);
+	}
+	i = LCUIFont_GetIdByNames(&ids, FONT_STYLE_NORMAL, FONT_WEIGHT_NORMAL,
+				  names);
+	if (i > 0) {
+		LCUIFont_SetDefault(ids[i - 1]);
+	}
+	free(ids);
+}
+
+#else
+
+static void LCUIFont_LoadFontsForLinux(void)
+{
+	size_t i;
+	int *ids = NULL;
+	const char *names = "Noto Sans CJK SC, Ubuntu, WenQuanYi Micro Hei";
+	const char *fonts[] = {
+		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-R.ttf",
+		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-RI.ttf",
+		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-B.ttf",
+		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-BI.ttf",
+		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-M.ttf",
+		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-MI.ttf",
+		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-L.ttf",
+		"/usr/share/fonts/truetype/ubuntu-font-family/Ubuntu-LI.ttf",
+		"/usr/share/fonts/opentype/noto/NotoSansCJK-Regular.ttc",
+		"/usr/share/fonts/opentype/noto/NotoSansCJK.ttc",
+		"/usr/share/fonts/truetype/wqy/wqy-microhei.ttc"
+	};
+
+	for (i = 0; i < sizeof(fonts) / sizeof(char *); ++i) {
+		LCUIFont_LoadFile(fonts[i]);
+	}
+	i = LCUIFont_GetIdByNames(&ids, FONT_STYLE_NORMAL, FONT_WEIGHT_NORMAL,
+				  names);
+	if (i > 0) {
+		LCUIFont_SetDefault(ids[i - 1]);
+	}
+	free(ids);
+}
+#endif
+
+#endif
+
+static void LCUIFont_LoadDefaultFonts(void)
+{
+#ifdef LCUI_BUILD_IN_WIN32
+	LCUIFont_LoadFontsForWindows();
+#elif defined(USE_FONTCONFIG)
+	Logger_Debug("[font] fontconfig enabled\n");
+	LCUIFont_LoadFontsByFontConfig();
+#else
+	LCUIFont_LoadFontsForLinux();
+#endif
+}
+
+void LCUI_InitFontLibrary(void)
+{
+	FontBitmap_InitMixer();
+	LCUIFont_InitBase();
+	LCUIFont_InitEngine();
+	LCUIFont_InitCatalog();
+	LCUIFont_InitGlyphCache();
+	LCUIFont_LoadDefaultFonts();
+	LCUIFont_SaveCatalog();
+}
+
+void LCUI_FreeFontLibrary(void)
+{
+	LCUIFont_FreeCatalog();
+	LCUIFont_FreeGlyphCache();
+	LCUIFont_FreeBase();
+	LCUIFont_FreeEngine();
+}
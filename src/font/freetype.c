@@ -32,11 +32,27 @@
 #include <LCUI_Build.h>
 #ifdef LCUI_FONT_ENGINE_FREETYPE
 #include <LCUI/types.h>
-#include <LCUI/util/linkedlist.h>
+#include <LCUI/util.h>
+#include <LCUI/thread.h>
 #include <LCUI/font.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
+#if defined(LCUI_THREAD_WIN32)
+#include <windows.h>
+#elif defined(LCUI_THREAD_PTHREAD)
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
@@ -46,48 +62,403 @@
 #define LCUI_FONT_RENDER_MODE	FT_RENDER_MODE_NORMAL
 #define LCUI_FONT_LOAD_FALGS	(FT_LOAD_RENDER | FT_LOAD_FORCE_AUTOHINT)
 
+/* 线程局部存储，用于在线程退出时释放它打开的字形对象 */
+#if defined(LCUI_THREAD_WIN32)
+#define FREETYPE_THREAD_DATA
+#define FreeType_GetThreadData() FlsGetValue(freetype.thread_key)
+#define FreeType_SetThreadData(V) \
+	(FlsSetValue(freetype.thread_key, V) ? 0 : -1)
+#elif defined(LCUI_THREAD_PTHREAD)
+#define FREETYPE_THREAD_DATA
+#define FreeType_GetThreadData() pthread_getspecific(freetype.thread_key)
+#define FreeType_SetThreadData(V) pthread_setspecific(freetype.thread_key, V)
+#endif
+
+/**
+ * 映射至内存中的字体文件
+ * 同一个字体文件中的各个字体，以及它们在各个线程中的字形对象都共用这份映射，
+ * 字体文件只需读取一次，多个进程还能共享它所占用的页缓存。
+ * 映射的文件在使用期间被截断会导致进程崩溃，如果字体文件可能被修改，可以设
+ * 置环境变量 LCUI_FONT_MMAP=0，改为由 FreeType 直接读取字体文件。
+ */
+typedef struct FreeTypeFileRec_ {
+	char *path;
+	FT_Byte *data;
+	size_t size;
+	unsigned refs;
+	LinkedListNode node;
+} FreeTypeFileRec, *FreeTypeFile;
+
+/** 线程打开的字形对象列表，线程退出时释放这些字形对象 */
+typedef struct FreeTypeThreadRec_ {
+	LinkedList faces;
+	LinkedListNode node;
+} FreeTypeThreadRec, *FreeTypeThread;
+
+/** 字体在某个线程中使用的字形对象 */
+typedef struct FreeTypeFaceRec_ {
+	LCUI_Thread tid;
+	FT_Face face;
+	struct FreeTypeFontRec_ *font;	/**< 所属的字体 */
+	FreeTypeThread thread;		/**< 打开它的线程 */
+	LinkedListNode node;		/**< 在字体的字形对象列表中的结点 */
+	LinkedListNode thread_node;	/**< 在线程的字形对象列表中的结点 */
+} FreeTypeFaceRec, *FreeTypeFace;
+
+/** 字体中连续有字形的字符码区间 */
+typedef struct FreeTypeCharRangeRec_ {
+	FT_ULong first;
+	FT_ULong last;
+} FreeTypeCharRangeRec, *FreeTypeCharRange;
+
+/**
+ * 字体数据
+ * FT_Face 对象不能被多个线程同时使用，因此每个线程都会打开各自的 FT_Face，
+ * 以便在多个线程中同时渲染字形。
+ * 查找回退字体时需要检查很多字体是否有某个字符，为避免为此打开并一直持有它们
+ * 的字形对象，字符集会在首次检查时读取一次，之后只查询这份字符集。
+ */
+typedef struct FreeTypeFontRec_ {
+	char *filepath;
+	FT_Long index;
+	FreeTypeFile file;
+	LinkedList faces;
+	LCUI_BOOL charset_loaded;
+	size_t charset_length;
+	FreeTypeCharRange charset;
+} FreeTypeFontRec, *FreeTypeFont;
+
 static struct {
 	FT_Library library;
+	/**
+	 * 用于保护 FT_Face 的创建和销毁，各个字体和线程的字形对象列表，以及
+	 * 已映射至内存中的字体文件列表
+	 */
+	LCUI_Mutex mutex;
+	LinkedList files;
+	LCUI_BOOL mmap_enabled;		/**< 是否将字体文件映射至内存中 */
+	/** 已打开字形对象的线程，线程退出时会被移除 */
+	LinkedList threads;
+#if defined(LCUI_THREAD_WIN32)
+	DWORD thread_key;
+#elif defined(LCUI_THREAD_PTHREAD)
+	pthread_key_t thread_key;
+#endif
+	LCUI_BOOL thread_key_created;
 } freetype;
 
+/** 将字体文件映射至内存中，已映射过的文件直接增加引用计数，需持有 freetype.mutex */
+static FreeTypeFile FreeType_MapFile(const char *path)
+{
+#ifdef HAVE_SYS_MMAN_H
+	int fd;
+	void *data;
+	struct stat buf;
+	FreeTypeFile file;
+	LinkedListNode *node;
+
+	if (!freetype.mmap_enabled) {
+		return NULL;
+	}
+	for (LinkedList_Each(node, &freetype.files)) {
+		file = node->data;
+		if (strcmp(file->path, path) == 0) {
+			file->refs += 1;
+			return file;
+		}
+	}
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &buf) != 0 || buf.st_size < 1) {
+		close(fd);
+		return NULL;
+	}
+	data = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+	file = malloc(sizeof(FreeTypeFileRec));
+	if (!file) {
+		munmap(data, buf.st_size);
+		return NULL;
+	}
+	file->path = strdup2(path);
+	file->data = data;
+	file->size = buf.st_size;
+	file->refs = 1;
+	file->node.data = file;
+	LinkedList_AppendNode(&freetype.files, &file->node);
+	return file;
+#else
+	return NULL;
+#endif
+}
+
+/** 减少字体文件的引用计数，没有字体使用它时解除映射，需持有 freetype.mutex */
+static void FreeTypeFile_Release(FreeTypeFile file)
+{
+#ifdef HAVE_SYS_MMAN_H
+	file->refs -= 1;
+	if (file->refs > 0) {
+		return;
+	}
+	LinkedList_Unlink(&freetype.files, &file->node);
+	munmap(file->data, file->size);
+	free(file->path);
+	free(file);
+#endif
+}
+
+/**
+ * 打开字体文件中的字形对象，需持有 freetype.mutex
+ * 字体文件已映射至内存中时，直接在映射的内存上创建字形对象
+ */
+static FT_Error FreeType_NewFace(const char *path, FreeTypeFile file,
+				 FT_Long index, FT_Face *face)
+{
+	if (file) {
+		return FT_New_Memory_Face(freetype.library, file->data,
+					  (FT_Long)file->size, index, face);
+	}
+	return FT_New_Face(freetype.library, path, index, face);
+}
+
+/** 关闭字形对象，并将它从所属的字体和线程中移除，需持有 freetype.mutex */
+static void FreeTypeFace_Destroy(FreeTypeFace face)
+{
+	LinkedList_Unlink(&face->font->faces, &face->node);
+	if (face->thread) {
+		LinkedList_Unlink(&face->thread->faces, &face->thread_node);
+	}
+	FT_Done_Face(face->face);
+	free(face);
+}
+
+/** 关闭线程打开的全部字形对象，需持有 freetype.mutex */
+static void FreeTypeThread_Destroy(FreeTypeThread thread)
+{
+	LinkedListNode *node;
+
+	while ((node = LinkedList_GetNode(&thread->faces, 0))) {
+		FreeTypeFace_Destroy(node->data);
+	}
+	LinkedList_Unlink(&freetype.threads, &thread->node);
+	free(thread);
+}
+
+#if defined(LCUI_THREAD_WIN32)
+static void WINAPI FreeType_OnThreadExit(void *arg)
+#else
+static void FreeType_OnThreadExit(void *arg)
+#endif
+{
+	if (arg) {
+		LCUIMutex_Lock(&freetype.mutex);
+		FreeTypeThread_Destroy(arg);
+		LCUIMutex_Unlock(&freetype.mutex);
+	}
+}
+
+/**
+ * 获取当前线程的字形对象列表，没有时新建一个，需持有 freetype.mutex
+ * 不支持线程局部存储时返回 NULL，字形对象等到字体被关闭时才释放
+ */
+static FreeTypeThread FreeType_GetThread(void)
+{
+#ifdef FREETYPE_THREAD_DATA
+	FreeTypeThread thread;
+
+	if (!freetype.thread_key_created) {
+		return NULL;
+	}
+	thread = FreeType_GetThreadData();
+	if (thread) {
+		return thread;
+	}
+	thread = malloc(sizeof(FreeTypeThreadRec));
+	if (!thread) {
+		return NULL;
+	}
+	if (FreeType_SetThreadData(thread) != 0) {
+		free(thread);
+		return NULL;
+	}
+	LinkedList_Init(&thread->faces);
+	thread->node.data = thread;
+	LinkedList_AppendNode(&freetype.threads, &thread->node);
+	return thread;
+#else
+	return NULL;
+#endif
+}
+
+/** 为当前线程打开字体的字形对象，需持有 freetype.mutex */
+static FT_Face FreeTypeFont_OpenFace(FreeTypeFont font)
+{
+	FreeTypeFace face;
+
+	face = malloc(sizeof(FreeTypeFaceRec));
+	if (!face) {
+		return NULL;
+	}
+	if (!font->file) {
+		font->file = FreeType_MapFile(font->filepath);
+	}
+	if (FreeType_NewFace(font->filepath, font->file, font->index,
+			     &face->face)) {
+		free(face);
+		return NULL;
+	}
+	FT_Select_Charmap(face->face, FT_ENCODING_UNICODE);
+	face->tid = LCUIThread_SelfID();
+	face->font = font;
+	face->node.data = face;
+	face->thread_node.data = face;
+	face->thread = FreeType_GetThread();
+	LinkedList_AppendNode(&font->faces, &face->node);
+	if (face->thread) {
+		LinkedList_AppendNode(&face->thread->faces, &face->thread_node);
+	}
+	return face->face;
+}
+
+/** 获取当前线程使用的字形对象 */
+static FT_Face FreeTypeFont_GetFace(FreeTypeFont font)
+{
+	FT_Face ft_face = NULL;
+	FreeTypeFace face;
+	LinkedListNode *node;
+	LCUI_Thread tid = LCUIThread_SelfID();
+
+	LCUIMutex_Lock(&freetype.mutex);
+	for (LinkedList_Each(node, &font->faces)) {
+		face = node->data;
+		if (face->tid == tid) {
+			ft_face = face->face;
+			break;
+		}
+	}
+	if (!ft_face) {
+		ft_face = FreeTypeFont_OpenFace(font);
+	}
+	LCUIMutex_Unlock(&freetype.mutex);
+	return ft_face;
+}
+
+static void FreeTypeFont_Destroy(FreeTypeFont font)
+{
+	LinkedListNode *node;
+
+	LCUIMutex_Lock(&freetype.mutex);
+	while ((node = LinkedList_GetNode(&font->faces, 0))) {
+		FreeTypeFace_Destroy(node->data);
+	}
+	if (font->file) {
+		FreeTypeFile_Release(font->file);
+	}
+	LCUIMutex_Unlock(&freetype.mutex);
+	free(font->charset);
+	free(font->filepath);
+	free(font);
+}
+
+static FreeTypeFont FreeTypeFont_Create(const char *filepath, int index)
+{
+	FreeTypeFont font;
+
+	font = malloc(sizeof(FreeTypeFontRec));
+	if (!font) {
+		return NULL;
+	}
+	font->index = index;
+	font->file = NULL;
+	font->charset = NULL;
+	font->charset_length = 0;
+	font->charset_loaded = FALSE;
+	font->filepath = strdup2(filepath);
+	if (!font->filepath) {
+		free(font);
+		return NULL;
+	}
+	LinkedList_Init(&font->faces);
+	return font;
+}
+
+/** 创建字体数据，字形对象等到渲染字形时再打开 */
+static void *FreeType_OpenFace(const char *filepath, int index)
+{
+	return FreeTypeFont_Create(filepath, index);
+}
+
 static int FreeType_Open(const char *filepath, LCUI_Font **outfonts)
 {
 	FT_Face face;
+	FreeTypeFont data;
+	FreeTypeFile file;
 	LCUI_Font font, *fonts;
 	int i, err, num_faces;
 
-	err = FT_New_Face(freetype.library, filepath, -1, &face);
+	/* 先映射字体文件，让后面打开的各个字体都共用它 */
+	LCUIMutex_Lock(&freetype.mutex);
+	file = FreeType_MapFile(filepath);
+	err = FreeType_NewFace(filepath, file, -1, &face);
+	if (!err) {
+		num_faces = face->num_faces;
+		FT_Done_Face(face);
+	}
+	LCUIMutex_Unlock(&freetype.mutex);
 	if (err) {
+		if (file) {
+			LCUIMutex_Lock(&freetype.mutex);
+			FreeTypeFile_Release(file);
+			LCUIMutex_Unlock(&freetype.mutex);
+		}
 		*outfonts = NULL;
 		return -1;
 	}
-	num_faces = face->num_faces;
-	FT_Done_Face(face);
-	if (num_faces < 1) {
-		return 0;
-	}
-	fonts = malloc(sizeof(LCUI_FontRec*) * num_faces);
-	if (!fonts) {
-		return -ENOMEM;
+	fonts = NULL;
+	if (num_faces > 0) {
+		fonts = malloc(sizeof(LCUI_FontRec*) * num_faces);
 	}
-	for (i = 0; i < num_faces; ++i) {
-		err = FT_New_Face(freetype.library, filepath, i, &face);
-		if (err) {
-			fonts[i] = NULL;
+	for (i = 0; fonts && i < num_faces; ++i) {
+		fonts[i] = NULL;
+		data = FreeTypeFont_Create(filepath, i);
+		if (!data) {
+			continue;
+		}
+		LCUIMutex_Lock(&freetype.mutex);
+		face = FreeTypeFont_OpenFace(data);
+		LCUIMutex_Unlock(&freetype.mutex);
+		if (!face) {
+			FreeTypeFont_Destroy(data);
 			continue;
 		}
-		FT_Select_Charmap(face, FT_ENCODING_UNICODE);
 		font = Font(face->family_name, face->style_name);
-		font->data = face;
+		font->data = data;
 		fonts[i] = font;
 	}
+	/* 各个字体已持有字体文件的引用，释放用于统计字体数量的引用 */
+	if (file) {
+		LCUIMutex_Lock(&freetype.mutex);
+		FreeTypeFile_Release(file);
+		LCUIMutex_Unlock(&freetype.mutex);
+	}
+	if (num_faces < 1) {
+		return 0;
+	}
+	if (!fonts) {
+		return -ENOMEM;
+	}
 	*outfonts = fonts;
 	return num_faces;
 }
 
-static void FreeType_Close(void *face)
+static void FreeType_Close(void *data)
 {
-	FT_Done_Face(face);
+	FreeTypeFont_Destroy(data);
 }
 
 /** 转换 FT_GlyphSlot 类型数据为 LCUI_FontBitmap */
@@ -181,8 +552,11 @@ static int FreeType_Render(LCUI_FontBitmap *bmp, wchar_t ch,
 {
 	int ret = 0;
 	FT_UInt index;
-	FT_Face ft_face = (FT_Face)font->data;
+	FT_Face ft_face = FreeTypeFont_GetFace(font->data);
 
+	if (!ft_face) {
+		return -2;
+	}
 	/* 设定字体尺寸 */
 	FT_Set_Pixel_Sizes(ft_face, 0, pixel_size);
 	index = FT_Get_Char_Index(ft_face, ch);
@@ -197,21 +571,141 @@ static int FreeType_Render(LCUI_FontBitmap *bmp, wchar_t ch,
 	return ret;
 }
 
+/** 读取字形对象的字符集 */
+static int FreeTypeFont_ReadCharset(FreeTypeFont font, FT_Face face)
+{
+	FT_UInt gindex;
+	FT_ULong code;
+	size_t size = 0;
+	FreeTypeCharRange ranges = NULL, range = NULL;
+
+	code = FT_Get_First_Char(face, &gindex);
+	for (; gindex != 0; code = FT_Get_Next_Char(face, code, &gindex)) {
+		if (range && range->last + 1 == code) {
+			range->last = code;
+			continue;
+		}
+		if (font->charset_length >= size) {
+			size = size > 0 ? size * 2 : 64;
+			range = realloc(ranges, sizeof(FreeTypeCharRangeRec) * size);
+			if (!range) {
+				free(ranges);
+				font->charset_length = 0;
+				return -ENOMEM;
+			}
+			ranges = range;
+		}
+		range = &ranges[font->charset_length++];
+		range->first = code;
+		range->last = code;
+	}
+	font->charset = ranges;
+	return 0;
+}
+
+/**
+ * 载入字体的字符集，需持有 freetype.mutex
+ * 当前线程没有该字体的字形对象时，临时打开一个，读完字符集后就关闭它
+ */
+static void FreeTypeFont_LoadCharset(FreeTypeFont font)
+{
+	FT_Face face = NULL;
+	FreeTypeFace tface;
+	LinkedListNode *node;
+	LCUI_Thread tid = LCUIThread_SelfID();
+
+	font->charset_loaded = TRUE;
+	for (LinkedList_Each(node, &font->faces)) {
+		tface = node->data;
+		if (tface->tid == tid) {
+			FreeTypeFont_ReadCharset(font, tface->face);
+			return;
+		}
+	}
+	if (FreeType_NewFace(font->filepath, font->file, font->index, &face)) {
+		return;
+	}
+	FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+	FreeTypeFont_ReadCharset(font, face);
+	FT_Done_Face(face);
+}
+
+static LCUI_BOOL FreeType_HasChar(LCUI_Font font, wchar_t ch)
+{
+	size_t low, high, mid;
+	FT_ULong code = (FT_ULong)ch;
+	FreeTypeFont data = font->data;
+
+	LCUIMutex_Lock(&freetype.mutex);
+	if (!data->charset_loaded) {
+		FreeTypeFont_LoadCharset(data);
+	}
+	LCUIMutex_Unlock(&freetype.mutex);
+	low = 0;
+	high = data->charset_length;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (code < data->charset[mid].first) {
+			high = mid;
+		} else if (code > data->charset[mid].last) {
+			low = mid + 1;
+		} else {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 int LCUIFont_InitFreeType(LCUI_FontEngine *engine)
 {
+	const char *mmap_env;
+
 	if (FT_Init_FreeType(&freetype.library)) {
 		return -1;
 	}
+	mmap_env = getenv("LCUI_FONT_MMAP");
+	freetype.mmap_enabled = !mmap_env || strcmp(mmap_env, "0") != 0;
+	LCUIMutex_Init(&freetype.mutex);
+	LinkedList_Init(&freetype.files);
+	LinkedList_Init(&freetype.threads);
+#if defined(LCUI_THREAD_WIN32)
+	freetype.thread_key = FlsAlloc(FreeType_OnThreadExit);
+	freetype.thread_key_created = freetype.thread_key != FLS_OUT_OF_INDEXES;
+#elif defined(LCUI_THREAD_PTHREAD)
+	freetype.thread_key_created =
+	    pthread_key_create(&freetype.thread_key, FreeType_OnThreadExit) == 0;
+#else
+	freetype.thread_key_created = FALSE;
+#endif
 	strcpy(engine->name, "FreeType");
 	engine->render = FreeType_Render;
 	engine->open = FreeType_Open;
 	engine->close = FreeType_Close;
+	engine->open_face = FreeType_OpenFace;
+	engine->has_char = FreeType_HasChar;
 	return 0;
 }
 
 int LCUIFont_ExitFreeType(void)
 {
+	LinkedListNode *node;
+
+	/* 删除线程局部存储后，仍在运行的线程退出时就不会再访问这里的数据 */
+	if (freetype.thread_key_created) {
+#if defined(LCUI_THREAD_WIN32)
+		FlsFree(freetype.thread_key);
+#elif defined(LCUI_THREAD_PTHREAD)
+		pthread_key_delete(freetype.thread_key);
+#endif
+		freetype.thread_key_created = FALSE;
+	}
+	LCUIMutex_Lock(&freetype.mutex);
+	while ((node = LinkedList_GetNode(&freetype.threads, 0))) {
+		FreeTypeThread_Destroy(node->data);
+	}
+	LCUIMutex_Unlock(&freetype.mutex);
 	FT_Done_FreeType(freetype.library);
+	LCUIMutex_Destroy(&freetype.mutex);
 	return 0;
 }
 
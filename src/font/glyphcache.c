@@ -0,0 +1,518 @@
+/*
+ * glyphcache.c -- The on-disk cache of the rendered glyph bitmaps
+ *
+ * Copyright (c) 2019, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/util.h>
+#include <LCUI/font.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define GLYPH_CACHE_MAGIC "LCUIGLYF"
+#define GLYPH_CACHE_VERSION 1
+#define GLYPH_CACHE_MAX_SIZE (32 * 1024 * 1024)
+/** 新增的、尚未保存的字形最多能占用的内存大小 */
+#define GLYPH_CACHE_MAX_PENDING_SIZE (8 * 1024 * 1024)
+#define GLYPH_MAX_SIZE 0xffff
+
+/**
+ * 缓存文件的文件头，后面紧跟着字形记录列表和位图数据
+ * 缓存文件只在本机上使用，因此各个字段都按本机的字节序存放，字节序不同时版本
+ * 号也对不上，缓存文件会被当成无效的文件而忽略。
+ */
+typedef struct GlyphCacheHeaderRec_ {
+	char magic[8];
+	uint32_t version;
+	uint32_t entry_size;
+	uint64_t length;
+} GlyphCacheHeaderRec;
+
+/** 新增的字形，位图数据紧跟在记录之后 */
+typedef struct GlyphCacheGlyphRec_ {
+	LCUI_GlyphCacheEntryRec entry;
+	const uchar_t *data;
+} GlyphCacheGlyphRec, *GlyphCacheGlyph;
+
+/** 保存缓存文件时用到的字形 */
+typedef struct GlyphCacheItemRec_ {
+	const LCUI_GlyphCacheEntryRec *entry;
+	const uchar_t *data;
+	size_t order;
+} GlyphCacheItemRec, *GlyphCacheItem;
+
+#define GlyphCacheEntry_GetDataSize(E) ((size_t)(E)->width * (E)->rows)
+
+static int GlyphCacheEntry_Compare(const LCUI_GlyphCacheEntryRec *a,
+				   uint64_t font_key, uint32_t code,
+				   int32_t size)
+{
+	if (a->font_key != font_key) {
+		return a->font_key < font_key ? -1 : 1;
+	}
+	if (a->code != code) {
+		return a->code < code ? -1 : 1;
+	}
+	if (a->size != size) {
+		return a->size < size ? -1 : 1;
+	}
+	return 0;
+}
+
+/** 原有的字形排在新增的字形前面，以便在去重时保留新增的字形 */
+static int CompareGlyphCacheItem(const void *a, const void *b)
+{
+	int ret;
+	const GlyphCacheItemRec *item_a = a;
+	const GlyphCacheItemRec *item_b = b;
+
+	ret = GlyphCacheEntry_Compare(item_a->entry, item_b->entry->font_key,
+				      item_b->entry->code,
+				      item_b->entry->size);
+	if (ret != 0) {
+		return ret;
+	}
+	return item_a->order < item_b->order ? -1 : 1;
+}
+
+void GlyphCache_Init(LCUI_GlyphCache cache)
+{
+	cache->data = NULL;
+	cache->size = 0;
+	cache->mapped = FALSE;
+	cache->length = 0;
+	cache->entries = NULL;
+	cache->glyphs_size = 0;
+	LinkedList_Init(&cache->glyphs);
+	LCUIMutex_Init(&cache->mutex);
+}
+
+/** 释放缓存文件的内容 */
+static void GlyphCache_Unload(LCUI_GlyphCache cache)
+{
+	if (cache->data) {
+#ifdef HAVE_SYS_MMAN_H
+		if (cache->mapped) {
+			munmap(cache->data, cache->size);
+		} else {
+			free(cache->data);
+		}
+#else
+		free(cache->data);
+#endif
+	}
+	cache->data = NULL;
+	cache->size = 0;
+	cache->mapped = FALSE;
+	cache->length = 0;
+	cache->entries = NULL;
+}
+
+void GlyphCache_Destroy(LCUI_GlyphCache cache)
+{
+	GlyphCache_Unload(cache);
+	LinkedList_Clear(&cache->glyphs, free);
+	LCUIMutex_Destroy(&cache->mutex);
+	cache->glyphs_size = 0;
+}
+
+uint64_t GlyphCache_GetFontKey(const char *path, int index)
+{
+	int i, j;
+	struct stat buf;
+	uint64_t values[3];
+	uint64_t hash = 14695981039346656037ULL;
+	const unsigned char *p;
+
+	if (stat(path, &buf) != 0) {
+		return 0;
+	}
+	values[0] = (uint64_t)buf.st_mtime;
+	values[1] = (uint64_t)buf.st_size;
+	values[2] = (uint64_t)index;
+	/* FNV-1a */
+	for (p = (const unsigned char *)path; *p; ++p) {
+		hash = (hash ^ *p) * 1099511628211ULL;
+	}
+	for (i = 0; i < 3; ++i) {
+		for (j = 0; j < 64; j += 8) {
+			hash = (hash ^ ((values[i] >> j) & 0xff)) *
+			       1099511628211ULL;
+		}
+	}
+	return hash ? hash : 1;
+}
+
+static const LCUI_GlyphCacheEntryRec *GlyphCache_Find(LCUI_GlyphCache cache,
+						      uint64_t font_key,
+						      uint32_t code,
+						      int32_t size)
+{
+	int ret;
+	size_t low = 0, high = cache->length, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		ret = GlyphCacheEntry_Compare(&cache->entries[mid], font_key,
+					      code, size);
+		if (ret == 0) {
+			return &cache->entries[mid];
+		}
+		if (ret < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return NULL;
+}
+
+static LCUI_BOOL GlyphCache_IsValidEntry(LCUI_GlyphCache cache,
+					 const LCUI_GlyphCacheEntryRec *entry)
+{
+	if (entry->width < 0 || entry->rows < 0 ||
+	    entry->width > GLYPH_MAX_SIZE || entry->rows > GLYPH_MAX_SIZE) {
+		return FALSE;
+	}
+	return entry->offset <= cache->size &&
+	       GlyphCacheEntry_GetDataSize(entry) <=
+		   cache->size - entry->offset;
+}
+
+int GlyphCache_Read(LCUI_GlyphCache cache, uint64_t font_key, unsigned code,
+		    int size, LCUI_FontBitmap *bmp)
+{
+	size_t data_size;
+	const LCUI_GlyphCacheEntryRec *entry;
+
+	entry = GlyphCache_Find(cache, font_key, code, size);
+	if (!entry || !GlyphCache_IsValidEntry(cache, entry)) {
+		return -1;
+	}
+	FontBitmap_Init(bmp);
+	data_size = GlyphCacheEntry_GetDataSize(entry);
+	if (data_size > 0) {
+		bmp->buffer = malloc(data_size);
+		if (!bmp->buffer) {
+			return -ENOMEM;
+		}
+		memcpy(bmp->buffer, cache->data + entry->offset, data_size);
+	}
+	bmp->top = entry->top;
+	bmp->left = entry->left;
+	bmp->width = entry->width;
+	bmp->rows = entry->rows;
+	bmp->pitch = entry->pitch;
+	bmp->num_grays = (short)entry->num_grays;
+	bmp->pixel_mode = (char)entry->pixel_mode;
+	bmp->advance.x = entry->advance_x;
+	bmp->advance.y = entry->advance_y;
+	return 0;
+}
+
+int GlyphCache_Add(LCUI_GlyphCache cache, uint64_t font_key, unsigned code,
+		   int size, const LCUI_FontBitmap *bmp)
+{
+	int ret = 0;
+	size_t data_size;
+	GlyphCacheGlyph glyph;
+	LCUI_GlyphCacheEntry entry;
+
+	if (bmp->width < 0 || bmp->rows < 0 || bmp->width > GLYPH_MAX_SIZE ||
+	    bmp->rows > GLYPH_MAX_SIZE) {
+		return -1;
+	}
+	data_size = (size_t)bmp->width * bmp->rows;
+	if (data_size > 0 && !bmp->buffer) {
+		return -1;
+	}
+	LCUIMutex_Lock(&cache->mutex);
+	if (cache->glyphs_size >= GLYPH_CACHE_MAX_PENDING_SIZE) {
+		ret = -ENOSPC;
+	}
+	LCUIMutex_Unlock(&cache->mutex);
+	if (ret != 0) {
+		return ret;
+	}
+	/* 在锁外复制位图数据，锁只用于保护字形列表 */
+	glyph = malloc(sizeof(GlyphCacheGlyphRec) + data_size);
+	if (!glyph) {
+		return -ENOMEM;
+	}
+	entry = &glyph->entry;
+	entry->font_key = font_key;
+	entry->code = code;
+	entry->size = size;
+	entry->top = bmp->top;
+	entry->left = bmp->left;
+	entry->width = bmp->width;
+	entry->rows = bmp->rows;
+	entry->pitch = bmp->pitch;
+	entry->num_grays = bmp->num_grays;
+	entry->pixel_mode = bmp->pixel_mode;
+	entry->advance_x = bmp->advance.x;
+	entry->advance_y = bmp->advance.y;
+	entry->offset = 0;
+	glyph->data = (uchar_t *)(glyph + 1);
+	if (data_size > 0) {
+		memcpy(glyph + 1, bmp->buffer, data_size);
+	}
+	data_size += sizeof(GlyphCacheGlyphRec);
+	LCUIMutex_Lock(&cache->mutex);
+	if (cache->glyphs_size + data_size > GLYPH_CACHE_MAX_PENDING_SIZE) {
+		ret = -ENOSPC;
+	} else {
+		cache->glyphs_size += data_size;
+		LinkedList_Append(&cache->glyphs, glyph);
+		glyph = NULL;
+	}
+	LCUIMutex_Unlock(&cache->mutex);
+	free(glyph);
+	return ret;
+}
+
+/** 将缓存文件映射至内存中，不支持时读取它的全部内容 */
+static int GlyphCache_LoadData(LCUI_GlyphCache cache, const char *filepath)
+{
+	FILE *fp;
+	struct stat buf;
+
+	if (stat(filepath, &buf) != 0 || buf.st_size < 1) {
+		return -1;
+	}
+#ifdef HAVE_SYS_MMAN_H
+	{
+		int fd;
+		void *data;
+
+		fd = open(filepath, O_RDONLY);
+		if (fd >= 0) {
+			data = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED,
+				    fd, 0);
+			close(fd);
+			if (data != MAP_FAILED) {
+				cache->data = data;
+				cache->size = buf.st_size;
+				cache->mapped = TRUE;
+				return 0;
+			}
+		}
+	}
+#endif
+	fp = fopen(filepath, "rb");
+	if (!fp) {
+		return -1;
+	}
+	cache->data = malloc(buf.st_size);
+	if (!cache->data) {
+		fclose(fp);
+		return -ENOMEM;
+	}
+	cache->size = buf.st_size;
+	if (fread(cache->data, 1, cache->size, fp) != cache->size) {
+		fclose(fp);
+		GlyphCache_Unload(cache);
+		return -1;
+	}
+	fclose(fp);
+	return 0;
+}
+
+int GlyphCache_Load(LCUI_GlyphCache cache, const char *filepath)
+{
+	int ret;
+	GlyphCacheHeaderRec header;
+
+	GlyphCache_Unload(cache);
+	ret = GlyphCache_LoadData(cache, filepath);
+	if (ret != 0) {
+		return ret;
+	}
+	if (cache->size < sizeof(header)) {
+		GlyphCache_Unload(cache);
+		return -2;
+	}
+	memcpy(&header, cache->data, sizeof(header));
+	if (memcmp(header.magic, GLYPH_CACHE_MAGIC, 8) != 0 ||
+	    header.version != GLYPH_CACHE_VERSION ||
+	    header.entry_size != sizeof(LCUI_GlyphCacheEntryRec) ||
+	    header.length > (cache->size - sizeof(header)) /
+				sizeof(LCUI_GlyphCacheEntryRec)) {
+		GlyphCache_Unload(cache);
+		return -2;
+	}
+	cache->length = (size_t)header.length;
+	cache->entries = (const LCUI_GlyphCacheEntryRec *)(cache->data +
+							    sizeof(header));
+	return 0;
+}
+
+/**
+ * 收集需要保存的字形，按键值排序并去掉重复的字形
+ * 数据量超出限制时，丢弃缓存文件中原有的字形，只保留新增的字形。
+ */
+static size_t GlyphCache_CollectItems(LCUI_GlyphCache cache,
+				      GlyphCacheItem items)
+{
+	size_t i, j, n = 0, data_size = 0;
+	GlyphCacheGlyph glyph;
+	LinkedListNode *node;
+
+	for (LinkedList_Each(node, &cache->glyphs)) {
+		glyph = node->data;
+		data_size += GlyphCacheEntry_GetDataSize(&glyph->entry);
+	}
+	for (i = 0; i < cache->length; ++i) {
+		if (!GlyphCache_IsValidEntry(cache, &cache->entries[i])) {
+			continue;
+		}
+		data_size += GlyphCacheEntry_GetDataSize(&cache->entries[i]);
+		if (data_size > GLYPH_CACHE_MAX_SIZE) {
+			n = 0;
+			break;
+		}
+		items[n].entry = &cache->entries[i];
+		items[n].data = cache->data + cache->entries[i].offset;
+		items[n].order = n;
+		++n;
+	}
+	for (LinkedList_Each(node, &cache->glyphs)) {
+		glyph = node->data;
+		items[n].entry = &glyph->entry;
+		items[n].data = glyph->data;
+		items[n].order = n;
+		++n;
+	}
+	qsort(items, n, sizeof(GlyphCacheItemRec), CompareGlyphCacheItem);
+	for (i = 0, j = 0; i < n; ++i) {
+		if (i + 1 < n &&
+		    GlyphCacheEntry_Compare(items[i].entry,
+					    items[i + 1].entry->font_key,
+					    items[i + 1].entry->code,
+					    items[i + 1].entry->size) == 0) {
+			continue;
+		}
+		items[j++] = items[i];
+	}
+	return j;
+}
+
+static int GlyphCache_WriteFile(FILE *fp, GlyphCacheItem items, size_t n)
+{
+	size_t i, offset;
+	GlyphCacheHeaderRec header;
+	LCUI_GlyphCacheEntryRec entry;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GLYPH_CACHE_MAGIC, 8);
+	header.version = GLYPH_CACHE_VERSION;
+	header.entry_size = sizeof(LCUI_GlyphCacheEntryRec);
+	header.length = n;
+	if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+		return -1;
+	}
+	offset = sizeof(header) + n * sizeof(LCUI_GlyphCacheEntryRec);
+	for (i = 0; i < n; ++i) {
+		entry = *items[i].entry;
+		entry.offset = (uint32_t)offset;
+		offset += GlyphCacheEntry_GetDataSize(&entry);
+		if (fwrite(&entry, sizeof(entry), 1, fp) != 1) {
+			return -1;
+		}
+	}
+	for (i = 0; i < n; ++i) {
+		offset = GlyphCacheEntry_GetDataSize(items[i].entry);
+		if (offset > 0 &&
+		    fwrite(items[i].data, 1, offset, fp) != offset) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int GlyphCache_Save(LCUI_GlyphCache cache, const char *filepath)
+{
+	int ret;
+	FILE *fp;
+	size_t n;
+	char *tmp_path;
+	GlyphCacheItem items;
+
+	if (cache->glyphs.length < 1) {
+		return 0;
+	}
+	tmp_path = malloc(strlen(filepath) + 5);
+	items = malloc(sizeof(GlyphCacheItemRec) *
+		       (cache->length + cache->glyphs.length));
+	if (!tmp_path || !items) {
+		free(tmp_path);
+		free(items);
+		return -ENOMEM;
+	}
+	n = GlyphCache_CollectItems(cache, items);
+	/* 先写入临时文件再替换，避免其它进程读到不完整的缓存文件 */
+	sprintf(tmp_path, "%s.tmp", filepath);
+	fp = fopen(tmp_path, "wb");
+	if (!fp) {
+		free(tmp_path);
+		free(items);
+		return -1;
+	}
+	ret = GlyphCache_WriteFile(fp, items, n);
+	free(items);
+	if (fclose(fp) != 0 || ret != 0) {
+		remove(tmp_path);
+		free(tmp_path);
+		return -1;
+	}
+	/* Windows 中的 rename() 不能覆盖已有的文件 */
+	if (rename(tmp_path, filepath) != 0) {
+		remove(filepath);
+		ret = rename(tmp_path, filepath);
+	}
+	if (ret == 0) {
+		LinkedList_Clear(&cache->glyphs, free);
+		cache->glyphs_size = 0;
+	} else {
+		remove(tmp_path);
+	}
+	free(tmp_path);
+	return ret;
+}
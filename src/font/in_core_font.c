@@ -74,9 +74,15 @@ static int InCoreFont_Render(LCUI_FontBitmap *bmp, wchar_t ch,
 	return -1;
 }
 
+static LCUI_BOOL InCoreFont_HasChar(LCUI_Font font, wchar_t ch)
+{
+	return ch >= ' ' && ch <= '~';
+}
+
 int LCUIFont_InitInCoreFont(LCUI_FontEngine *engine)
 {
 	engine->render = InCoreFont_Render;
+	engine->has_char = InCoreFont_HasChar;
 	engine->close = InCoreFont_Close;
 	engine->open = InCoreFont_Open;
 	strcpy(engine->name, "in-core");
@@ -28,7 +28,11 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "config.h"
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
 #include <wctype.h>
 #include <LCUI_Build.h>
 #include <LCUI/types.h>
@@ -47,6 +51,12 @@ typedef enum { TEXT_ACTION_INSERT, TEXT_ACTION_APPEND } TextAction;
 #define GetDefaultLineHeight(H) iround(H * 1.42857143)
 #define ISALPHA(CH) (CH >= 'a' && CH <= 'z') || (CH >= 'A' && CH <= 'Z')
 
+/* 不同字符的数量少于此值时，直接在当前线程中载入字体位图 */
+#define PARALLEL_LOAD_MIN_CHARS 64
+
+/* 文本行的字符数组的最小容量 */
+#define TEXT_ROW_MIN_CAPACITY 16
+
 /* 根据对齐方式，计算文本行的起始X轴位置 */
 static int TextLayer_GetRowStartX(LCUI_TextLayer layer, LCUI_TextRow txtrow)
 {
@@ -92,41 +102,254 @@ int TextLayer_GetRowTextLength(LCUI_TextLayer layer, int row)
 	return layer->text_rows.rows[row]->length;
 }
 
-/** 添加 更新文本排版 的任务 */
-void TextLayer_AddUpdateTypeset(LCUI_TextLayer layer, int start_row)
+/**
+ * 标记指定范围内的文本行需要重新排版
+ * 上一行可能需要将修改后的文本行中的文字转移过去，因此也需要标记
+ */
+static void TextLayer_AddUpdateRowsTypeset(LCUI_TextLayer layer,
+					   int start_row, int end_row)
 {
-	if (start_row < layer->task.typeset_start_row) {
+	int row;
+
+	if (start_row > 0) {
+		--start_row;
+	}
+	if (end_row < 0 || end_row >= layer->text_rows.length) {
+		end_row = layer->text_rows.length - 1;
+	}
+	for (row = start_row; row <= end_row; ++row) {
+		layer->text_rows.rows[row]->need_typeset = TRUE;
+	}
+	if (!layer->task.update_typeset ||
+	    start_row < layer->task.typeset_start_row) {
 		layer->task.typeset_start_row = start_row;
 	}
 	layer->task.update_typeset = TRUE;
 }
 
+/** 添加 更新文本排版 的任务 */
+void TextLayer_AddUpdateTypeset(LCUI_TextLayer layer, int start_row)
+{
+	TextLayer_AddUpdateRowsTypeset(layer, start_row, -1);
+}
+
 static void TextRow_Init(LCUI_TextRow txtrow)
 {
+	txtrow->y = 0;
+	txtrow->offset = 0;
 	txtrow->width = 0;
 	txtrow->height = 0;
 	txtrow->length = 0;
+	txtrow->capacity = 0;
+	txtrow->chars_x = NULL;
+	txtrow->words = NULL;
+	txtrow->words_length = 0;
 	txtrow->string = NULL;
 	txtrow->eol = LCUI_EOL_NONE;
+	txtrow->need_typeset = TRUE;
 	txtrow->text_height = 0;
 }
 
 static void TextRow_Destroy(LCUI_TextRow txtrow)
 {
-	int i;
-	for (i = 0; i < txtrow->length; ++i) {
-		if (txtrow->string[i]) {
-			free(txtrow->string[i]);
-		}
-	}
 	txtrow->width = 0;
 	txtrow->height = 0;
 	txtrow->length = 0;
+	txtrow->capacity = 0;
 	txtrow->text_height = 0;
 	if (txtrow->string) {
 		free(txtrow->string);
 	}
+	if (txtrow->chars_x) {
+		free(txtrow->chars_x);
+	}
+	if (txtrow->words) {
+		free(txtrow->words);
+	}
 	txtrow->string = NULL;
+	txtrow->chars_x = NULL;
+	txtrow->words = NULL;
+	txtrow->words_length = 0;
+}
+
+/** 标记文本行中各个字符的X轴坐标为无效 */
+static void TextRow_InvalidateCharsX(LCUI_TextRow txtrow)
+{
+	if (txtrow->chars_x) {
+		free(txtrow->chars_x);
+		txtrow->chars_x = NULL;
+	}
+}
+
+/** 标记文本行中各个词语的尺寸为无效 */
+static void TextRow_InvalidateWords(LCUI_TextRow txtrow)
+{
+	if (txtrow->words) {
+		free(txtrow->words);
+		txtrow->words = NULL;
+	}
+	txtrow->words_length = 0;
+}
+
+/** 判断字符后面是否可以断行 */
+static LCUI_BOOL TextChar_IsWordEnd(LCUI_TextChar txtchar)
+{
+	if (!txtchar->bitmap || ISALPHA(txtchar->code)) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * 统计文本行中指定范围内的词语
+ * @param[out] words 用于存放词语尺寸的数组，为 NULL 时只统计数量
+ * @returns 词语的数量
+ */
+static int TextRow_ScanWords(LCUI_TextRow txtrow, int start, int end,
+			     LCUI_TextWord words)
+{
+	int col, n = 0, width = 0, height = 0;
+	LCUI_TextChar txtchar;
+
+	for (col = start; col < end; ++col) {
+		txtchar = &txtrow->string[col];
+		if (!txtchar->bitmap) {
+			continue;
+		}
+		width += txtchar->bitmap->advance.x;
+		height = max(height, txtchar->bitmap->advance.y);
+		if (!TextChar_IsWordEnd(txtchar)) {
+			continue;
+		}
+		if (words) {
+			words[n].end = col + 1;
+			words[n].width = width;
+			words[n].height = height;
+		}
+		start = col + 1;
+		width = height = 0;
+		++n;
+	}
+	/* 范围末尾没有可断行的字符，剩余的字符也算作一个词语 */
+	if (start < end) {
+		if (words) {
+			words[n].end = end;
+			words[n].width = width;
+			words[n].height = height;
+		}
+		++n;
+	}
+	return n;
+}
+
+/** 计算文本行中各个词语的尺寸 */
+static int TextRow_UpdateWords(LCUI_TextRow txtrow)
+{
+	int n;
+
+	if (txtrow->words || txtrow->length < 1) {
+		return 0;
+	}
+	n = TextRow_ScanWords(txtrow, 0, txtrow->length, NULL);
+	txtrow->words = malloc(sizeof(LCUI_TextWordRec) * n);
+	if (!txtrow->words) {
+		return -1;
+	}
+	txtrow->words_length =
+	    TextRow_ScanWords(txtrow, 0, txtrow->length, txtrow->words);
+	return 0;
+}
+
+/**
+ * 查找文本行中包含指定字符的词语
+ * @returns 词语的序号，字符在行尾之后时返回词语的数量
+ */
+static int TextRow_FindWord(LCUI_TextRow txtrow, int col)
+{
+	int low = 0, high = txtrow->words_length, mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (txtrow->words[mid].end > col) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low;
+}
+
+/** 获取文本行中指定词语的开始位置 */
+static int TextRow_GetWordStart(LCUI_TextRow txtrow, int i)
+{
+	return i > 0 ? txtrow->words[i - 1].end : 0;
+}
+
+/**
+ * 计算文本行中各个字符的X轴坐标
+ * 坐标以前缀和的形式存放，第 i 个元素是前 i 个字符的宽度之和，以便通过二分
+ * 查找定位某个X轴坐标上的字符
+ */
+static int TextRow_UpdateCharsX(LCUI_TextRow txtrow)
+{
+	int i, x;
+
+	if (txtrow->chars_x) {
+		return 0;
+	}
+	txtrow->chars_x = malloc(sizeof(int) * (txtrow->length + 1));
+	if (!txtrow->chars_x) {
+		return -1;
+	}
+	for (i = 0, x = 0; i < txtrow->length; ++i) {
+		txtrow->chars_x[i] = x;
+		if (txtrow->string[i].bitmap) {
+			x += txtrow->string[i].bitmap->advance.x;
+		}
+	}
+	txtrow->chars_x[i] = x;
+	return 0;
+}
+
+/**
+ * 获取文本行中指定字符相对于行首的X轴坐标
+ * 只读取已计算好的坐标，不修改文本行，绘制时可在多个线程中同时调用
+ */
+static int TextRow_GetCharX(LCUI_TextRow txtrow, int col)
+{
+	int i, x;
+
+	if (col > txtrow->length) {
+		col = txtrow->length;
+	}
+	if (txtrow->chars_x) {
+		return txtrow->chars_x[col];
+	}
+	for (i = 0, x = 0; i < col; ++i) {
+		if (txtrow->string[i].bitmap) {
+			x += txtrow->string[i].bitmap->advance.x;
+		}
+	}
+	return x;
+}
+
+/**
+ * 查找文本行中覆盖指定X轴坐标的字符
+ * @returns 字符的位置，坐标在行尾之后时返回文本行的长度
+ */
+static int TextRow_FindCharByX(LCUI_TextRow txtrow, int x)
+{
+	int low = 0, high = txtrow->length, mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (TextRow_GetCharX(txtrow, mid + 1) > x) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low;
 }
 
 /** 向文本行列表中插入新的文本行 */
@@ -157,6 +380,8 @@ static LCUI_TextRow TextRowList_InsertNewRow(LCUI_TextRowList rowlist,
 	}
 	txtrows[i_row] = txtrow;
 	rowlist->rows = txtrows;
+	rowlist->valid_y_length = min(rowlist->valid_y_length, i_row);
+	rowlist->valid_offset_length = min(rowlist->valid_offset_length, i_row);
 	return txtrow;
 }
 
@@ -166,6 +391,8 @@ static int TextRowList_RemoveRow(LCUI_TextRowList rowlist, int i_row)
 	if (i_row < 0 || i_row >= rowlist->length) {
 		return -1;
 	}
+	rowlist->valid_y_length = min(rowlist->valid_y_length, i_row);
+	rowlist->valid_offset_length = min(rowlist->valid_offset_length, i_row);
 	TextRow_Destroy(rowlist->rows[i_row]);
 	free(rowlist->rows[i_row]);
 	for (; i_row < rowlist->length - 1; ++i_row) {
@@ -176,15 +403,135 @@ static int TextRowList_RemoveRow(LCUI_TextRowList rowlist, int i_row)
 	return 0;
 }
 
+/**
+ * 计算文本行的Y轴坐标
+ * 从第一个坐标无效的行开始计算，直到计算完指定行，并且已计算的最后一行的底
+ * 部超过指定的Y轴坐标为止
+ */
+static void TextRowList_UpdateRowsY(LCUI_TextRowList rowlist, int end_row,
+				    int end_y)
+{
+	int row = rowlist->valid_y_length;
+	LCUI_TextRow prev;
+
+	if (row == 0 && rowlist->length > 0) {
+		rowlist->rows[0]->y = 0;
+		row = 1;
+	}
+	for (; row < rowlist->length; ++row) {
+		prev = rowlist->rows[row - 1];
+		if (row > end_row && prev->y + prev->height > end_y) {
+			break;
+		}
+		rowlist->rows[row]->y = prev->y + prev->height;
+	}
+	rowlist->valid_y_length = row;
+}
+
+/**
+ * 获取文本行的Y轴坐标
+ * 只读取已计算好的坐标，不修改文本行列表，绘制时可在多个线程中同时调用
+ */
+static int TextRowList_GetRowY(LCUI_TextRowList rowlist, int row)
+{
+	int i, y = 0;
+	LCUI_TextRow txtrow;
+
+	if (row < rowlist->valid_y_length) {
+		return rowlist->rows[row]->y;
+	}
+	i = rowlist->valid_y_length;
+	if (i > 0) {
+		txtrow = rowlist->rows[i - 1];
+		y = txtrow->y + txtrow->height;
+	}
+	for (; i < row; ++i) {
+		y += rowlist->rows[i]->height;
+	}
+	return y;
+}
+
+/** 查找覆盖指定Y轴坐标的文本行，与 TextRowList_GetRowY() 一样不修改列表 */
+static int TextRowList_FindRowByY(LCUI_TextRowList rowlist, int y)
+{
+	int low = 0, high = rowlist->valid_y_length, mid, bottom;
+	LCUI_TextRow txtrow;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		txtrow = rowlist->rows[mid];
+		if (txtrow->y + txtrow->height > y) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	if (low < rowlist->valid_y_length) {
+		return low;
+	}
+	bottom = TextRowList_GetRowY(rowlist, low);
+	for (; low < rowlist->length; ++low) {
+		bottom += rowlist->rows[low]->height;
+		if (bottom > y) {
+			break;
+		}
+	}
+	return low;
+}
+
+/** 获取文本行相对于首行顶部的Y轴坐标 */
+static int TextLayer_GetRowY(LCUI_TextLayer layer, int row)
+{
+	TextRowList_UpdateRowsY(&layer->text_rows, row, -1);
+	return layer->text_rows.rows[row]->y;
+}
+
+/**
+ * 查找覆盖指定Y轴坐标的文本行，坐标相对于首行顶部
+ * @returns 文本行的位置，坐标在末行之后时返回文本行总数
+ */
+static int TextLayer_FindRowByY(LCUI_TextLayer layer, int y)
+{
+	int low = 0, high, mid;
+	LCUI_TextRow txtrow;
+
+	TextRowList_UpdateRowsY(&layer->text_rows, 0, y);
+	high = layer->text_rows.valid_y_length;
+	while (low < high) {
+		mid = (low + high) / 2;
+		txtrow = layer->text_rows.rows[mid];
+		if (txtrow->y + txtrow->height > y) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low;
+}
+
 /** 更新文本行的尺寸 */
-static void TextLayer_UpdateRowSize(LCUI_TextLayer layer, LCUI_TextRow txtrow)
+static void TextLayer_UpdateRowSize(LCUI_TextLayer layer, int row)
 {
-	int i;
+	int i, height;
 	LCUI_TextChar txtchar;
+	LCUI_TextRow txtrow = layer->text_rows.rows[row];
+
+	height = txtrow->height;
+	TextRow_InvalidateCharsX(txtrow);
+	/* 本行的文本或行尾符可能有变化，后面各行的行首位置需要重新计算 */
+	layer->text_rows.valid_offset_length =
+	    min(layer->text_rows.valid_offset_length, row + 1);
 	txtrow->width = 0;
 	txtrow->text_height = layer->text_default_style.pixel_size;
-	for (i = 0; i < txtrow->length; ++i) {
-		txtchar = txtrow->string[i];
+	if (TextRow_UpdateWords(txtrow) == 0) {
+		for (i = 0; i < txtrow->words_length; ++i) {
+			txtrow->width += txtrow->words[i].width;
+			txtrow->text_height = max(txtrow->text_height,
+						  txtrow->words[i].height);
+		}
+	}
+	for (i = 0; !txtrow->words && i < txtrow->length; ++i) {
+		txtchar = &txtrow->string[i];
 		if (!txtchar->bitmap) {
 			continue;
 		}
@@ -198,79 +545,455 @@ static void TextLayer_UpdateRowSize(LCUI_TextLayer layer, LCUI_TextRow txtrow)
 	} else {
 		txtrow->height = GetDefaultLineHeight(txtrow->text_height);
 	}
+	/* 行高有变化，后面各行的Y轴坐标也就失效了 */
+	if (txtrow->height != height) {
+		layer->text_rows.valid_y_length =
+		    min(layer->text_rows.valid_y_length, row + 1);
+	}
 }
 
-/** 设置文本行的字符串长度 */
+/**
+ * 设置文本行的字符串长度
+ * 字符数组的容量不足时成倍扩充，空余过多时收缩，避免频繁地重新分配内存
+ */
 static int TextRow_SetLength(LCUI_TextRow txtrow, int len)
 {
-	LCUI_TextChar *txtstr;
+	int capacity;
+	LCUI_TextChar txtstr;
+
 	if (len < 0) {
 		len = 0;
 	}
-	txtstr = realloc(txtrow->string, sizeof(LCUI_TextChar) * (len + 1));
-	if (!txtstr) {
-		return -1;
+	TextRow_InvalidateCharsX(txtrow);
+	TextRow_InvalidateWords(txtrow);
+	capacity = txtrow->capacity;
+	if (len > capacity) {
+		capacity = max(capacity * 2, TEXT_ROW_MIN_CAPACITY);
+		capacity = max(capacity, len);
+	} else if (capacity > TEXT_ROW_MIN_CAPACITY && len < capacity / 4) {
+		capacity = max(len * 2, TEXT_ROW_MIN_CAPACITY);
+	}
+	if (capacity != txtrow->capacity) {
+		txtstr = realloc(txtrow->string,
+				 sizeof(LCUI_TextCharRec) * capacity);
+		if (txtstr) {
+			txtrow->string = txtstr;
+			txtrow->capacity = capacity;
+		} else if (len > txtrow->capacity) {
+			return -1;
+		}
 	}
-	txtstr[len] = NULL;
-	txtrow->string = txtstr;
 	txtrow->length = len;
 	return 0;
 }
 
-/** 将字符数据直接插入至文本行 */
+/** 向文本行中插入多个字符 */
 static int TextRow_Insert(LCUI_TextRow txtrow, int ins_pos,
-			  LCUI_TextChar txtchar)
+			  const LCUI_TextCharRec *chars, int n)
 {
-	int i;
+	int len = txtrow->length;
+
 	if (ins_pos < 0) {
-		ins_pos = txtrow->length + 1 + ins_pos;
+		ins_pos = len + 1 + ins_pos;
 		if (ins_pos < 0) {
 			ins_pos = 0;
 		}
-	} else if (ins_pos > txtrow->length) {
-		ins_pos = txtrow->length;
+	} else if (ins_pos > len) {
+		ins_pos = len;
 	}
-	TextRow_SetLength(txtrow, txtrow->length + 1);
-	for (i = txtrow->length - 1; i > ins_pos; --i) {
-		txtrow->string[i] = txtrow->string[i - 1];
+	if (n < 1) {
+		return 0;
+	}
+	if (TextRow_SetLength(txtrow, len + n) != 0) {
+		return -1;
 	}
-	txtrow->string[ins_pos] = txtchar;
+	memmove(txtrow->string + ins_pos + n, txtrow->string + ins_pos,
+		sizeof(LCUI_TextCharRec) * (len - ins_pos));
+	memcpy(txtrow->string + ins_pos, chars, sizeof(LCUI_TextCharRec) * n);
 	return 0;
 }
 
-/** 向文本行插入一个字符数据副本 */
-static int TextRow_InsertCopy(LCUI_TextRow txtrow, int ins_pos,
-			      LCUI_TextChar txtchar)
+/** 获取字符使用的样式，字符未使用样式标签时返回 NULL */
+static LCUI_TextStyle TextLayer_GetCharStyle(LCUI_TextLayer layer,
+					     LCUI_TextChar ch)
+{
+	if (ch->style < 1 || ch->style > layer->text_styles_length) {
+		return NULL;
+	}
+	return layer->text_styles[ch->style - 1];
+}
+
+static LCUI_BOOL TextStyle_IsEqual(LCUI_TextStyle a, LCUI_TextStyle b)
+{
+	int i;
+
+	if (a->has_family != b->has_family || a->has_style != b->has_style ||
+	    a->has_weight != b->has_weight ||
+	    a->has_back_color != b->has_back_color ||
+	    a->has_fore_color != b->has_fore_color ||
+	    a->has_pixel_size != b->has_pixel_size || a->style != b->style ||
+	    a->weight != b->weight || a->pixel_size != b->pixel_size ||
+	    a->fore_color.value != b->fore_color.value ||
+	    a->back_color.value != b->back_color.value) {
+		return FALSE;
+	}
+	if (!a->font_ids || !b->font_ids) {
+		return a->font_ids == b->font_ids;
+	}
+	for (i = 0; a->font_ids[i] && a->font_ids[i] == b->font_ids[i]; ++i);
+	return a->font_ids[i] == b->font_ids[i];
+}
+
+/**
+ * 向样式表中添加样式，返回该样式的序号，失败时返回 0
+ * 样式表中已有相同的样式时，释放传入的样式并返回已有样式的序号，否则优先
+ * 使用已被释放的序号，以免样式表随着文本的编辑而不断增长。
+ */
+static unsigned TextLayer_AddStyle(LCUI_TextLayer layer, LCUI_TextStyle style)
+{
+	unsigned i, index = 0;
+	size_t *refs;
+	LCUI_TextStyle *styles;
+
+	for (i = 0; i < layer->text_styles_length; ++i) {
+		if (!layer->text_styles[i]) {
+			if (index == 0) {
+				index = i + 1;
+			}
+			continue;
+		}
+		if (TextStyle_IsEqual(layer->text_styles[i], style)) {
+			TextStyle_Destroy(style);
+			free(style);
+			return i + 1;
+		}
+	}
+	if (index > 0) {
+		layer->text_styles[index - 1] = style;
+		layer->text_style_refs[index - 1] = 0;
+		return index;
+	}
+	i = layer->text_styles_length + 1;
+	styles = realloc(layer->text_styles, sizeof(LCUI_TextStyle) * i);
+	if (!styles) {
+		return 0;
+	}
+	layer->text_styles = styles;
+	refs = realloc(layer->text_style_refs, sizeof(size_t) * i);
+	if (!refs) {
+		return 0;
+	}
+	layer->text_style_refs = refs;
+	styles[layer->text_styles_length] = style;
+	refs[layer->text_styles_length] = 0;
+	return ++layer->text_styles_length;
+}
+
+/** 释放样式表中的样式，字符的序号不会改变，之后新增的样式可以复用它 */
+static void TextLayer_FreeStyle(LCUI_TextLayer layer, unsigned i)
+{
+	TextStyle_Destroy(layer->text_styles[i]);
+	free(layer->text_styles[i]);
+	layer->text_styles[i] = NULL;
+	layer->text_style_refs[i] = 0;
+}
+
+/** 释放没有被字符引用的样式，例如样式标签中没有字符时新增的样式 */
+static void TextLayer_FreeUnusedStyles(LCUI_TextLayer layer)
+{
+	unsigned i;
+
+	for (i = 0; i < layer->text_styles_length; ++i) {
+		if (layer->text_styles[i] && layer->text_style_refs[i] == 0) {
+			TextLayer_FreeStyle(layer, i);
+		}
+	}
+}
+
+/** 增加字符对样式的引用计数 */
+static void TextLayer_RefCharStyles(LCUI_TextLayer layer,
+				    const LCUI_TextCharRec *chars, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		if (chars[i].style > 0 &&
+		    chars[i].style <= layer->text_styles_length) {
+			layer->text_style_refs[chars[i].style - 1] += 1;
+		}
+	}
+}
+
+/** 减少被删除的字符对样式的引用计数，释放不再被引用的样式 */
+static void TextLayer_UnrefCharStyles(LCUI_TextLayer layer,
+				      const LCUI_TextCharRec *chars, int n)
+{
+	int i;
+	unsigned style;
+
+	for (i = 0; i < n; ++i) {
+		style = chars[i].style;
+		if (style < 1 || style > layer->text_styles_length ||
+		    !layer->text_styles[style - 1]) {
+			continue;
+		}
+		if (--layer->text_style_refs[style - 1] == 0) {
+			TextLayer_FreeStyle(layer, style - 1);
+		}
+	}
+}
+
+static size_t TextGlyph_Hash(const LCUI_TextGlyphRec *glyph)
 {
-	LCUI_TextChar txtchar2;
-	txtchar2 = malloc(sizeof(LCUI_TextCharRec));
-	*txtchar2 = *txtchar;
-	return TextRow_Insert(txtrow, ins_pos, txtchar2);
+	size_t hash = (size_t)glyph->code * 2654435761u;
+	hash ^= (size_t)glyph->font_id * 40503u;
+	return hash ^ ((size_t)glyph->size * 2246822519u);
+}
+
+static void TextGlyphTable_Init(LCUI_TextGlyphTable table)
+{
+	table->size = 0;
+	table->length = 0;
+	table->slots = NULL;
+}
+
+static void TextGlyphTable_Clear(LCUI_TextGlyphTable table)
+{
+	size_t i;
+
+	for (i = 0; i < table->size; ++i) {
+		free(table->slots[i]);
+	}
+	free(table->slots);
+	TextGlyphTable_Init(table);
+}
+
+static void TextGlyphTable_Put(LCUI_TextGlyphTable table, LCUI_TextGlyph glyph)
+{
+	size_t mask = table->size - 1;
+	size_t i = TextGlyph_Hash(glyph) & mask;
+
+	while (table->slots[i]) {
+		i = (i + 1) & mask;
+	}
+	table->slots[i] = glyph;
+}
+
+static int TextGlyphTable_Grow(LCUI_TextGlyphTable table)
+{
+	size_t i;
+	LCUI_TextGlyphTableRec new_table;
+
+	new_table.length = table->length;
+	new_table.size = table->size ? table->size * 2 : 64;
+	new_table.slots = calloc(new_table.size, sizeof(LCUI_TextGlyph));
+	if (!new_table.slots) {
+		return -ENOMEM;
+	}
+	for (i = 0; i < table->size; ++i) {
+		if (table->slots[i]) {
+			TextGlyphTable_Put(&new_table, table->slots[i]);
+		}
+	}
+	free(table->slots);
+	*table = new_table;
+	return 0;
+}
+
+/**
+ * 向字形表中添加字形
+ * @returns 字形表中的字形，已有相同的字形时返回已有的字形，内存不足时返回 NULL
+ */
+static LCUI_TextGlyph TextGlyphTable_Add(LCUI_TextGlyphTable table,
+					 const LCUI_TextGlyphRec *glyph)
+{
+	size_t i, mask;
+	LCUI_TextGlyph slot;
+
+	if (table->size > 0) {
+		mask = table->size - 1;
+		i = TextGlyph_Hash(glyph) & mask;
+		while ((slot = table->slots[i])) {
+			if (slot->code == glyph->code &&
+			    slot->font_id == glyph->font_id &&
+			    slot->size == glyph->size) {
+				return slot;
+			}
+			i = (i + 1) & mask;
+		}
+	}
+	if ((table->length + 1) * 2 > table->size &&
+	    TextGlyphTable_Grow(table) != 0) {
+		return NULL;
+	}
+	slot = malloc(sizeof(LCUI_TextGlyphRec));
+	if (!slot) {
+		return NULL;
+	}
+	*slot = *glyph;
+	TextGlyphTable_Put(table, slot);
+	table->length += 1;
+	return slot;
+}
+
+/**
+ * 从字体位图缓存中获取字符的字形
+ * 只复制字体位图的度量信息，字体位图缓存中的位图之后可能会被回收。
+ * 此函数不会修改文本图层，可以在多个线程中同时调用。
+ */
+static void TextLayer_GetCharGlyph(LCUI_TextLayer layer, LCUI_TextChar ch,
+				   LCUI_TextGlyph glyph)
+{
+	size_t epoch;
+	const LCUI_FontBitmap *bmp;
+	int size = layer->text_default_style.pixel_size;
+	int *font_ids = layer->text_default_style.font_ids;
+	LCUI_TextStyle style = TextLayer_GetCharStyle(layer, ch);
+
+	if (style) {
+		if (style->has_family) {
+			font_ids = style->font_ids;
+		}
+		if (style->has_pixel_size) {
+			size = style->pixel_size;
+		}
+	}
+	glyph->code = ch->code;
+	glyph->font_id = LCUIFont_GetIdByChar(font_ids, ch->code);
+	glyph->size = size;
+	epoch = LCUIFont_BeginRead();
+	LCUIFont_GetBitmap(ch->code, glyph->font_id, size, &bmp);
+	if (bmp) {
+		glyph->bitmap = *bmp;
+		glyph->bitmap.buffer = NULL;
+	} else {
+		glyph->size = 0;
+	}
+	LCUIFont_EndRead(epoch);
+}
+
+/** 将字形存入文本图层，并让字符引用它 */
+static void TextLayer_SetCharGlyph(LCUI_TextLayer layer, LCUI_TextChar ch,
+				   const LCUI_TextGlyphRec *glyph)
+{
+	LCUI_TextGlyph stored = NULL;
+
+	if (glyph->size > 0) {
+		stored = TextGlyphTable_Add(&layer->glyphs, glyph);
+	}
+	ch->bitmap = stored ? &stored->bitmap : NULL;
 }
 
 /** 更新字体位图 */
-static void TextChar_UpdateBitmap(LCUI_TextChar ch, LCUI_TextStyle style)
+static void TextLayer_UpdateCharBitmap(LCUI_TextLayer layer, LCUI_TextChar ch)
 {
-	int i = 0;
-	int size = style->pixel_size;
-	int *font_ids = style->font_ids;
-	if (ch->style) {
-		if (ch->style->has_family) {
-			font_ids = ch->style->font_ids;
+	LCUI_TextGlyphRec glyph;
+
+	TextLayer_GetCharGlyph(layer, ch, &glyph);
+	TextLayer_SetCharGlyph(layer, ch, &glyph);
+}
+
+static size_t TextChar_Hash(LCUI_TextChar ch)
+{
+	size_t hash = (size_t)ch->code * 2654435761u;
+	return hash ^ ((size_t)ch->style * 40503u);
+}
+
+/**
+ * 收集字体位图各不相同的字符
+ * 同一字符在相同样式下的字体位图相同，只需载入一次
+ * @param[out] distinct 各不相同的字符
+ * @param[out] owners 每个字符在 distinct 中对应的字符的下标
+ * @returns 各不相同的字符的数量，内存不足时返回 0
+ */
+static size_t TextChars_CollectDistinct(LCUI_TextChar chars, size_t n,
+					LCUI_TextChar *distinct,
+					size_t *owners)
+{
+	size_t i, j, mask, count = 0, size = 16;
+	size_t *slots;
+
+	while (size < n * 2) {
+		size *= 2;
+	}
+	slots = malloc(size * sizeof(size_t));
+	if (!slots) {
+		return 0;
+	}
+	/* 槽位中存放的是 distinct 中的下标加一，0 表示空槽位 */
+	memset(slots, 0, size * sizeof(size_t));
+	mask = size - 1;
+	for (i = 0; i < n; ++i) {
+		j = TextChar_Hash(&chars[i]) & mask;
+		while (slots[j]) {
+			if (distinct[slots[j] - 1]->code == chars[i].code &&
+			    distinct[slots[j] - 1]->style == chars[i].style) {
+				break;
+			}
+			j = (j + 1) & mask;
 		}
-		if (ch->style->has_pixel_size) {
-			size = ch->style->pixel_size;
+		if (!slots[j]) {
+			distinct[count++] = &chars[i];
+			slots[j] = count;
 		}
+		owners[i] = slots[j] - 1;
 	}
-	while (font_ids && font_ids[i] > 0) {
-		int ret = LCUIFont_GetBitmap(ch->code, font_ids[i], size,
-					     &ch->bitmap);
-		if (ret == 0) {
-			return;
+	free(slots);
+	return count;
+}
+
+/**
+ * 载入多个字符的字体位图
+ * 字符较多时，先为各不相同的字符载入字体位图，然后让其余字符共用这些字体位
+ * 图。各不相同的字符较多时，它们的字体位图会在多个线程中同时渲染。
+ */
+static void TextLayer_LoadCharBitmaps(LCUI_TextLayer layer,
+				      LCUI_TextChar chars, size_t n)
+{
+	int i, count = 0;
+	size_t *owners = NULL;
+	LCUI_TextChar *distinct = NULL;
+	LCUI_TextGlyph glyphs = NULL;
+
+	if (n >= PARALLEL_LOAD_MIN_CHARS) {
+		distinct = malloc(sizeof(LCUI_TextChar) * n);
+		owners = malloc(sizeof(size_t) * n);
+		if (distinct && owners) {
+			count = (int)TextChars_CollectDistinct(
+			    chars, n, distinct, owners);
 		}
-		++i;
 	}
-	LCUIFont_GetBitmap(ch->code, -1, size, &ch->bitmap);
+	if (count >= PARALLEL_LOAD_MIN_CHARS) {
+		glyphs = malloc(sizeof(LCUI_TextGlyphRec) * count);
+	}
+	if (count < 1) {
+		for (i = 0; i < (int)n; ++i) {
+			TextLayer_UpdateCharBitmap(layer, &chars[i]);
+		}
+	} else if (!glyphs) {
+		for (i = 0; i < count; ++i) {
+			TextLayer_UpdateCharBitmap(layer, distinct[i]);
+		}
+	} else {
+		/* 字形表不能被多个线程同时修改，先并行获取字形，再逐个存入 */
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+		for (i = 0; i < count; ++i) {
+			TextLayer_GetCharGlyph(layer, distinct[i], &glyphs[i]);
+		}
+		for (i = 0; i < count; ++i) {
+			TextLayer_SetCharGlyph(layer, distinct[i], &glyphs[i]);
+		}
+	}
+	if (count > 0) {
+		for (i = 0; i < (int)n; ++i) {
+			chars[i].bitmap = distinct[owners[i]]->bitmap;
+		}
+	}
+	free(distinct);
+	free(owners);
+	free(glyphs);
 }
 
 /** 新建文本图层 */
@@ -292,6 +1015,8 @@ LCUI_TextLayer TextLayer_New(void)
 	layer->new_offset_y = 0;
 	layer->line_height = -1;
 	layer->text_rows.length = 0;
+	layer->text_rows.valid_y_length = 0;
+	layer->text_rows.valid_offset_length = 0;
 	layer->text_rows.rows = NULL;
 	layer->text_align = SV_LEFT;
 	layer->enable_autowrap = FALSE;
@@ -299,7 +1024,10 @@ LCUI_TextLayer TextLayer_New(void)
 	layer->enable_style_tag = FALSE;
 	layer->word_break = LCUI_WORD_BREAK_NORMAL;
 	TextStyle_Init(&layer->text_default_style);
-	LinkedList_Init(&layer->text_styles);
+	TextGlyphTable_Init(&layer->glyphs);
+	layer->text_styles = NULL;
+	layer->text_style_refs = NULL;
+	layer->text_styles_length = 0;
 	layer->task.typeset_start_row = 0;
 	layer->task.update_typeset = 0;
 	layer->task.update_bitmap = 0;
@@ -318,21 +1046,28 @@ static void TextRowList_Destroy(LCUI_TextRowList list)
 		list->rows[row] = NULL;
 	}
 	list->length = 0;
+	list->valid_y_length = 0;
+	list->valid_offset_length = 0;
 	if (list->rows) {
 		free(list->rows);
 	}
 	list->rows = NULL;
 }
 
-static void OnDestroyTextStyle(void *data)
-{
-	TextStyle_Destroy(data);
-	free(data);
-}
-
 static void TextLayer_DestroyStyleCache(LCUI_TextLayer layer)
 {
-	LinkedList_Clear(&layer->text_styles, OnDestroyTextStyle);
+	unsigned i;
+	for (i = 0; i < layer->text_styles_length; ++i) {
+		if (layer->text_styles[i]) {
+			TextStyle_Destroy(layer->text_styles[i]);
+			free(layer->text_styles[i]);
+		}
+	}
+	free(layer->text_styles);
+	free(layer->text_style_refs);
+	layer->text_styles = NULL;
+	layer->text_style_refs = NULL;
+	layer->text_styles_length = 0;
 }
 
 /** 销毁TextLayer */
@@ -342,6 +1077,7 @@ void TextLayer_Destroy(LCUI_TextLayer layer)
 	TextStyle_Destroy(&layer->text_default_style);
 	TextRowList_Destroy(&layer->text_rows);
 	TextLayer_DestroyStyleCache(layer);
+	TextGlyphTable_Clear(&layer->glyphs);
 	free(layer);
 }
 
@@ -349,18 +1085,13 @@ void TextLayer_Destroy(LCUI_TextLayer layer)
 static int TextLayer_GetRowRect(LCUI_TextLayer layer, int i_row, int start_col,
 				int end_col, LCUI_Rect *rect)
 {
-	int i;
 	LCUI_TextRow txtrow;
 
 	if (i_row >= layer->text_rows.length) {
 		return -1;
 	}
-	/* 先计算在有效区域内的起始行的Y轴坐标 */
-	rect->y = layer->offset_y;
+	rect->y = layer->offset_y + TextLayer_GetRowY(layer, i_row);
 	rect->x = layer->offset_x;
-	for (i = 0; i < i_row; ++i) {
-		rect->y += layer->text_rows.rows[i]->height;
-	}
 	txtrow = layer->text_rows.rows[i_row];
 	if (end_col < 0 || end_col >= txtrow->length) {
 		end_col = txtrow->length - 1;
@@ -370,19 +1101,10 @@ static int TextLayer_GetRowRect(LCUI_TextLayer layer, int i_row, int start_col,
 	if (start_col == 0 && end_col == txtrow->length - 1) {
 		rect->width = txtrow->width;
 	} else {
-		for (i = 0; i < start_col; ++i) {
-			if (!txtrow->string[i]->bitmap) {
-				continue;
-			}
-			rect->x += txtrow->string[i]->bitmap->advance.x;
-		}
-		rect->width = 0;
-		for (i = start_col; i <= end_col && i < txtrow->length; ++i) {
-			if (!txtrow->string[i]->bitmap) {
-				continue;
-			}
-			rect->width += txtrow->string[i]->bitmap->advance.x;
-		}
+		TextRow_UpdateCharsX(txtrow);
+		rect->x += TextRow_GetCharX(txtrow, start_col);
+		rect->width = TextRow_GetCharX(txtrow, end_col + 1) -
+			      TextRow_GetCharX(txtrow, start_col);
 	}
 	if (rect->width <= 0 || rect->height <= 0) {
 		return 1;
@@ -410,15 +1132,13 @@ void TextLayer_InvalidateRowsRect(LCUI_TextLayer layer, int start_row,
 	if (end_row < 0 || end_row >= layer->text_rows.length) {
 		end_row = layer->text_rows.length - 1;
 	}
-
-	y = layer->offset_y;
-	for (i = 0; i < layer->text_rows.length; ++i) {
-		y += layer->text_rows.rows[i]->height;
-		if (i >= start_row && y >= 0) {
-			y -= layer->text_rows.rows[i]->height;
-			break;
-		}
+	/* 跳过在可见区域上方的文本行 */
+	i = TextLayer_FindRowByY(layer, -layer->offset_y - 1);
+	i = max(i, start_row);
+	if (i >= layer->text_rows.length) {
+		return;
 	}
+	y = layer->offset_y + TextLayer_GetRowY(layer, i);
 	for (; i <= end_row; ++i) {
 		TextLayer_GetRowRect(layer, i, 0, -1, &rect);
 		RectList_Add(&layer->dirty_rects, &rect);
@@ -458,38 +1178,34 @@ void TextLayer_SetCaretPos(LCUI_TextLayer layer, int row, int col)
 int TextLayer_SetCaretPosByPixelPos(LCUI_TextLayer layer, int x, int y)
 {
 	LCUI_TextRow txtrow;
-	int i, pixel_pos, ins_x, ins_y;
-	pixel_pos = layer->offset_y;
-	for (i = 0; i < layer->text_rows.length; ++i) {
-		pixel_pos += layer->text_rows.rows[i]->height;
-		if (pixel_pos >= y) {
-			ins_y = i;
-			break;
-		}
+	int low, high, mid, x1, x2, ins_x, ins_y;
+
+	if (layer->text_rows.length < 1) {
+		layer->insert_x = 0;
+		layer->insert_y = 0;
+		return -1;
 	}
-	if (i >= layer->text_rows.length) {
-		if (layer->text_rows.length > 0) {
-			ins_y = layer->text_rows.length - 1;
-		} else {
-			layer->insert_x = 0;
-			layer->insert_y = 0;
-			return -1;
-		}
+	ins_y = TextLayer_FindRowByY(layer, y - layer->offset_y - 1);
+	if (ins_y >= layer->text_rows.length) {
+		ins_y = layer->text_rows.length - 1;
 	}
 	txtrow = layer->text_rows.rows[ins_y];
-	ins_x = txtrow->length;
-	pixel_pos = layer->offset_x;
-	pixel_pos += TextLayer_GetRowStartX(layer, txtrow);
-	for (i = 0; i < txtrow->length; ++i) {
-		LCUI_TextChar txtchar;
-		txtchar = txtrow->string[i];
-		if (!txtchar->bitmap) {
-			continue;
+	TextRow_UpdateCharsX(txtrow);
+	x -= layer->offset_x + TextLayer_GetRowStartX(layer, txtrow);
+	/* 查找中心点在该坐标右边的第一个字 */
+	for (low = 0, high = txtrow->length; low < high;) {
+		mid = (low + high) / 2;
+		x1 = TextRow_GetCharX(txtrow, mid);
+		x2 = TextRow_GetCharX(txtrow, mid + 1);
+		if (x <= x2 - (x2 - x1) / 2) {
+			high = mid;
+		} else {
+			low = mid + 1;
 		}
-		pixel_pos += txtchar->bitmap->advance.x;
-		/* 如果在当前字中心点的前面 */
-		if (x <= pixel_pos - txtchar->bitmap->advance.x / 2) {
-			ins_x = i;
+	}
+	/* 忽略无字体位图的文字 */
+	for (ins_x = low; ins_x < txtrow->length; ++ins_x) {
+		if (txtrow->string[ins_x].bitmap) {
 			break;
 		}
 	}
@@ -502,7 +1218,6 @@ int TextLayer_GetCharPixelPos(LCUI_TextLayer layer, int row, int col,
 			      LCUI_Pos *pixel_pos)
 {
 	LCUI_TextRow txtrow;
-	int i, pixel_x = 0, pixel_y = 0;
 	if (row < 0 || row >= layer->text_rows.length) {
 		return -1;
 	}
@@ -511,21 +1226,11 @@ int TextLayer_GetCharPixelPos(LCUI_TextLayer layer, int row, int col,
 	} else if (col > layer->text_rows.rows[row]->length) {
 		return -3;
 	}
-	/* 累加前几行的高度 */
-	for (i = 0; i < row; ++i) {
-		pixel_y += layer->text_rows.rows[i]->height;
-	}
 	txtrow = layer->text_rows.rows[row];
-	pixel_x = TextLayer_GetRowStartX(layer, txtrow);
-	for (i = 0; i < col; ++i) {
-		LCUI_TextChar txtchar = txtrow->string[i];
-		if (!txtchar || !txtchar->bitmap) {
-			continue;
-		}
-		pixel_x += txtchar->bitmap->advance.x;
-	}
-	pixel_pos->x = pixel_x;
-	pixel_pos->y = pixel_y;
+	TextRow_UpdateCharsX(txtrow);
+	pixel_pos->x = TextLayer_GetRowStartX(layer, txtrow);
+	pixel_pos->x += TextRow_GetCharX(txtrow, col);
+	pixel_pos->y = TextLayer_GetRowY(layer, row);
 	return 0;
 }
 
@@ -547,173 +1252,484 @@ void TextLayer_ClearText(LCUI_TextLayer layer)
 	TextLayer_DestroyStyleCache(layer);
 	TextRowList_Destroy(&layer->text_rows);
 	TextRowList_InsertNewRow(&layer->text_rows, 0);
+	TextGlyphTable_Clear(&layer->glyphs);
 	layer->task.redraw_all = TRUE;
 }
 
-/** 对文本行进行断行 */
-static void TextLayer_BreakTextRow(LCUI_TextLayer layer, int row, int col,
+/**
+ * 拆分文本行的词语，将截点后面的词语转移至下一行
+ * 调用前，截点后面的字符已经转移至下一行，只有截点所在的词语需要重新计算
+ * @param words 本行原有的词语
+ * @param i 截点所在的词语的序号
+ */
+static void TextRow_SplitWords(LCUI_TextRow txtrow, LCUI_TextRow next,
+			       LCUI_TextWord words, int n_words, int i)
+{
+	int j, n, start, col = txtrow->length;
+	LCUI_TextWord next_words, head_words;
+
+	if (!words || i >= n_words) {
+		free(words);
+		return;
+	}
+	next_words = malloc(sizeof(LCUI_TextWordRec) * (n_words - i));
+	if (!next_words) {
+		free(words);
+		return;
+	}
+	start = i > 0 ? words[i - 1].end : 0;
+	n = TextRow_ScanWords(next, 0, words[i].end - col, next_words);
+	for (j = i + 1; j < n_words; ++j, ++n) {
+		next_words[n] = words[j];
+		next_words[n].end -= col;
+	}
+	next->words = next_words;
+	next->words_length = n;
+	n = i + TextRow_ScanWords(txtrow, start, col, words + i);
+	if (n < 1) {
+		free(words);
+		return;
+	}
+	head_words = realloc(words, sizeof(LCUI_TextWordRec) * n);
+	txtrow->words = head_words ? head_words : words;
+	txtrow->words_length = n;
+}
+
+/** 将文本行中截点后面的字符整段转移至新的下一行，不更新本行的尺寸 */
+static void TextLayer_SplitTextRow(LCUI_TextLayer layer, int row, int col,
 				   LCUI_EOLChar eol)
 {
-	int n;
+	int i_word, n_words;
+	LCUI_TextWord words;
 	LCUI_TextRow txtrow, next;
 	txtrow = TextLayer_GetRow(layer, row);
 	next = TextRowList_InsertNewRow(&layer->text_rows, row + 1);
 	/* 将本行原有的行尾符转移至下一行 */
 	next->eol = txtrow->eol;
 	txtrow->eol = eol;
-	for (n = txtrow->length - 1; n >= col; --n) {
-		TextRow_Insert(next, 0, txtrow->string[n]);
-		txtrow->string[n] = NULL;
+	/* 先取出词语，避免它们在转移字符时被清除 */
+	words = txtrow->words;
+	n_words = txtrow->words_length;
+	i_word = words ? TextRow_FindWord(txtrow, col) : 0;
+	txtrow->words = NULL;
+	txtrow->words_length = 0;
+	if (col < txtrow->length &&
+	    TextRow_Insert(next, 0, txtrow->string + col,
+			   txtrow->length - col) == 0) {
+		TextRow_SetLength(txtrow, col);
+		TextRow_SplitWords(txtrow, next, words, n_words, i_word);
+	} else {
+		txtrow->words = words;
+		txtrow->words_length = n_words;
+	}
+	TextLayer_UpdateRowSize(layer, row + 1);
+}
+
+/** 对文本行进行断行 */
+static void TextLayer_BreakTextRow(LCUI_TextLayer layer, int row, int col,
+				   LCUI_EOLChar eol)
+{
+	TextLayer_SplitTextRow(layer, row, col, eol);
+	TextLayer_UpdateRowSize(layer, row);
+}
+
+/**
+ * 将下一行的词语追加到本行的词语后面
+ * 调用前，下一行的字符已经追加到本行，如果本行末尾的词语没有结束，则它与下
+ * 一行的首个词语是同一个词语
+ * @param len 本行原有的字符数量
+ */
+static void TextRow_MergeWords(LCUI_TextRow txtrow, int len,
+			       LCUI_TextWord words, int n_words,
+			       LCUI_TextWord next_words, int n_next_words)
+{
+	int i = 0;
+	LCUI_TextWord new_words;
+
+	if ((!words && len > 0) || (!next_words && txtrow->length > len) ||
+	    n_words + n_next_words < 1) {
+		free(words);
+		free(next_words);
+		return;
+	}
+	new_words =
+	    realloc(words, sizeof(LCUI_TextWordRec) * (n_words + n_next_words));
+	if (!new_words) {
+		free(words);
+		free(next_words);
+		return;
 	}
-	txtrow->length = col;
-	TextLayer_UpdateRowSize(layer, txtrow);
-	TextLayer_UpdateRowSize(layer, next);
+	if (n_words > 0 && n_next_words > 0 &&
+	    !TextChar_IsWordEnd(&txtrow->string[len - 1])) {
+		new_words[n_words - 1].end = next_words[0].end + len;
+		new_words[n_words - 1].width += next_words[0].width;
+		new_words[n_words - 1].height = max(
+		    new_words[n_words - 1].height, next_words[0].height);
+		i = 1;
+	}
+	for (; i < n_next_words; ++i, ++n_words) {
+		new_words[n_words] = next_words[i];
+		new_words[n_words].end += len;
+	}
+	free(next_words);
+	txtrow->words = new_words;
+	txtrow->words_length = n_words;
 }
 
 /** 将指定行与下一行合并 */
-static void TextLayer_MergeRow(LCUI_TextLayer layer, int row)
+static int TextLayer_MergeRow(LCUI_TextLayer layer, int row)
 {
-	int i, j;
+	int len, n_words, n_next_words;
+	LCUI_TextWord words, next_words;
 	LCUI_TextRow txtrow = TextLayer_GetRow(layer, row);
 	LCUI_TextRow next = TextLayer_GetRow(layer, row + 1);
 
 	if (!txtrow || !next) {
-		return;
+		return -1;
 	}
+	len = txtrow->length;
+	/* 先取出词语，避免它们在转移字符时被清除 */
+	words = txtrow->words;
+	n_words = txtrow->words_length;
+	next_words = next->words;
+	n_next_words = next->words_length;
+	txtrow->words = NULL;
+	txtrow->words_length = 0;
+	if (TextRow_Insert(txtrow, len, next->string, next->length) != 0) {
+		txtrow->words = words;
+		txtrow->words_length = n_words;
+		return -2;
+	}
+	next->words = NULL;
+	next->words_length = 0;
+	TextRow_MergeWords(txtrow, len, words, n_words, next_words,
+			   n_next_words);
 	if (layer->insert_y > row) {
 		--layer->insert_y;
 		if (layer->insert_y == row) {
-			layer->insert_x += txtrow->length;
+			layer->insert_x += len;
 		}
 	}
-	i = txtrow->length;
-	TextRow_SetLength(txtrow, txtrow->length + next->length);
-	for (j = 0; j < next->length; ++i, ++j) {
-		txtrow->string[i] = next->string[j];
-		next->string[j] = NULL;
-	}
 	txtrow->eol = next->eol;
-	TextLayer_UpdateRowSize(layer, txtrow);
+	TextLayer_UpdateRowSize(layer, row);
 	TextRowList_RemoveRow(&layer->text_rows, row + 1);
+	return 0;
 }
 
-/** 对指定行的文本进行排版 */
-static void TextLayer_TextRowTypeset(LCUI_TextLayer layer, int row)
+/**
+ * 逐个字符查找文本行中从指定列开始的文本需要断行的位置
+ * @returns 断行的位置，不需要断行时返回 -1
+ */
+static int TextLayer_FindRowBreakByChars(LCUI_TextLayer layer,
+					 LCUI_TextRow txtrow, int start_col,
+					 int max_width)
 {
-	int col, row_width = 0, word_col = 0;
-	int max_width =
-	    layer->fixed_width > 0 ? layer->fixed_width : layer->max_width;
-
+	int col, row_width = 0, word_col = start_col;
 	LCUI_TextChar txtchar;
-	LCUI_TextRow txtrow = layer->text_rows.rows[row];
-	LCUI_BOOL autowrap =
-	    max_width > 0 && layer->enable_autowrap && layer->enable_mulitiline;
 
-	for (col = 0; col < txtrow->length; ++col) {
-		txtchar = txtrow->string[col];
+	for (col = start_col; col < txtrow->length; ++col) {
+		txtchar = &txtrow->string[col];
 		if (!txtchar->bitmap) {
 			continue;
 		}
 		/* 累加行宽度 */
 		row_width += txtchar->bitmap->advance.x;
 		/* 如果是当前行的第一个字符，或者行宽度没有超过宽度限制 */
-		if (!autowrap || col < 1 || row_width <= max_width) {
+		if (col <= start_col || row_width <= max_width) {
 			if (ISALPHA(txtchar->code)) {
 			} else {
 				word_col = col + 1;
 			}
 			continue;
 		}
+		/* 行宽度只增不减，后面不会再有断行的位置 */
+		if (layer->word_break == LCUI_WORD_BREAK_NORMAL) {
+			return word_col > start_col ? word_col : -1;
+		}
+		return col;
+	}
+	return -1;
+}
+
+/**
+ * 查找文本行中从指定列开始的文本需要断行的位置
+ * 逐个词语累加宽度，只在超出宽度限制的词语中逐个字符查找
+ * @returns 断行的位置，不需要断行时返回 -1
+ */
+static int TextLayer_FindRowBreak(LCUI_TextLayer layer, LCUI_TextRow txtrow,
+				  int start_col, int max_width)
+{
+	int i, col, width;
+	LCUI_TextChar txtchar;
+	LCUI_TextWordRec word;
+
+	if (TextRow_UpdateWords(txtrow) != 0) {
+		return TextLayer_FindRowBreakByChars(layer, txtrow, start_col,
+						     max_width);
+	}
+	i = TextRow_FindWord(txtrow, start_col);
+	if (i >= txtrow->words_length) {
+		return -1;
+	}
+	/* 断行位置可能在词语中间，此时只需计算该词语的后半部分 */
+	word = txtrow->words[i];
+	if (TextRow_GetWordStart(txtrow, i) != start_col) {
+		TextRow_ScanWords(txtrow, start_col, word.end, &word);
+	}
+	/* 行首的字符不受宽度限制，首个词语超出宽度限制时按字符查找 */
+	if (word.width > max_width) {
+		return TextLayer_FindRowBreakByChars(layer, txtrow, start_col,
+						     max_width);
+	}
+	for (width = word.width, ++i; i < txtrow->words_length; ++i) {
+		if (width + txtrow->words[i].width <= max_width) {
+			width += txtrow->words[i].width;
+			continue;
+		}
+		col = TextRow_GetWordStart(txtrow, i);
 		if (layer->word_break == LCUI_WORD_BREAK_NORMAL) {
-			if (word_col < 1) {
+			return col;
+		}
+		for (; col < txtrow->words[i].end; ++col) {
+			txtchar = &txtrow->string[col];
+			if (!txtchar->bitmap) {
 				continue;
 			}
-			col = word_col;
+			width += txtchar->bitmap->advance.x;
+			if (width > max_width) {
+				return col;
+			}
+		}
+	}
+	return -1;
+}
+
+/**
+ * 对指定行的文本进行排版
+ * 一行文本需要断成多行时，先找出所有断行位置，再从后往前断行，让每个字符只
+ * 需转移一次
+ * @returns 在本行后面新增的、已经排版完的文本行的数量
+ */
+static int TextLayer_TextRowTypeset(LCUI_TextLayer layer, int row)
+{
+	int i, col, len, n_cols = 0, max_cols = 0;
+	int *cols = NULL, *new_cols;
+	int insert_x, insert_y;
+	int max_width =
+	    layer->fixed_width > 0 ? layer->fixed_width : layer->max_width;
+
+	LCUI_BOOL next_need_typeset;
+	LCUI_TextRow txtrow = layer->text_rows.rows[row];
+	LCUI_BOOL autowrap =
+	    max_width > 0 && layer->enable_autowrap && layer->enable_mulitiline;
+
+	txtrow->need_typeset = FALSE;
+	col = autowrap ? TextLayer_FindRowBreak(layer, txtrow, 0, max_width)
+		       : -1;
+	while (col > 0) {
+		if (n_cols >= max_cols) {
+			max_cols = max(max_cols * 2, 16);
+			new_cols = realloc(cols, sizeof(int) * max_cols);
+			if (!new_cols) {
+				break;
+			}
+			cols = new_cols;
+		}
+		cols[n_cols++] = col;
+		col = TextLayer_FindRowBreak(layer, txtrow, col, max_width);
+	}
+	if (n_cols > 0) {
+		for (i = n_cols - 1; i >= 0; --i) {
+			TextLayer_SplitTextRow(layer, row, cols[i],
+					       LCUI_EOL_NONE);
+		}
+		for (i = 1; i < n_cols; ++i) {
+			layer->text_rows.rows[row + i]->need_typeset = FALSE;
 		}
+		TextLayer_UpdateRowSize(layer, row);
+		free(cols);
+		/* 最后一行的后面可能还有文本，需要继续排版 */
+		return n_cols - 1;
+	}
+	if (col > 0) {
 		TextLayer_BreakTextRow(layer, row, col, LCUI_EOL_NONE);
-		return;
+		return 0;
 	}
-	TextLayer_UpdateRowSize(layer, txtrow);
+	TextLayer_UpdateRowSize(layer, row);
 	/* 如果本行有换行符，或者是最后一行 */
 	if (txtrow->eol != LCUI_EOL_NONE ||
 	    row == layer->text_rows.length - 1) {
-		return;
+		return 0;
+	}
+	/* 本行的文本宽度未达到限制宽度，需要将下行的文本转移至本行。
+	 * 排版前已经记录过可见的文本行的矩形区域，这里不用再记录 */
+	len = txtrow->length;
+	insert_x = layer->insert_x;
+	insert_y = layer->insert_y;
+	next_need_typeset = layer->text_rows.rows[row + 1]->need_typeset;
+	if (TextLayer_MergeRow(layer, row) != 0) {
+		return 0;
 	}
-	row_width = txtrow->width;
-	/* 本行的文本宽度未达到限制宽度，需要将下行的文本转移至本行 */
-	if (txtrow->eol == LCUI_EOL_NONE) {
-		TextLayer_InvalidateRowRect(layer, row, 0, -1);
-		TextLayer_InvalidateRowRect(layer, row + 1, 0, -1);
-		TextLayer_MergeRow(layer, row);
-		TextLayer_TextRowTypeset(layer, row);
+	/* 如果合并后的文本仍在原来的位置断行，并且下一行的文本不用再断行，
+	 * 则说明排版结果与之前的相同，恢复原来的下一行即可 */
+	col = autowrap ? TextLayer_FindRowBreak(layer, txtrow, 0, max_width)
+		       : -1;
+	if (col > 0 && col == len &&
+	    TextLayer_FindRowBreak(layer, txtrow, col, max_width) < 0) {
+		TextLayer_SplitTextRow(layer, row, col, LCUI_EOL_NONE);
+		TextLayer_UpdateRowSize(layer, row);
+		layer->text_rows.rows[row + 1]->need_typeset =
+		    next_need_typeset;
+		layer->insert_x = insert_x;
+		layer->insert_y = insert_y;
+		return 0;
 	}
+	return TextLayer_TextRowTypeset(layer, row);
 }
 
-/** 从指定行开始，对文本进行排版 */
-static void TextLayer_TextTypeset(LCUI_TextLayer layer, int start_row)
+/**
+ * 从指定行开始，对文本进行排版
+ * 只处理需要排版的行。当一行文本排版后，它的下一行仍是未被修改过的行，则说
+ * 明下一行的断行位置与之前的相同，可以跳过它。
+ * 如果文本图层的高度有限制，则只排版到可见区域下方一屏的位置，更后面的文本
+ * 行等到它们接近可见区域时再排版
+ * @returns 排版停止时所在的行，全部排版完时返回文本行总数
+ */
+static int TextLayer_TextTypeset(LCUI_TextLayer layer, int start_row)
 {
-	int row;
+	int row, end_y = 0;
+	int height =
+	    layer->fixed_height > 0 ? layer->fixed_height : layer->max_height;
+	LCUI_BOOL lazy = height > 0;
+
+	if (lazy) {
+		end_y = height * 2 - layer->new_offset_y;
+	}
 	/* 记录排版前各个文本行的矩形区域 */
 	TextLayer_InvalidateRowsRect(layer, start_row, -1);
 	for (row = start_row; row < layer->text_rows.length; ++row) {
-		TextLayer_TextRowTypeset(layer, row);
+		if (!layer->text_rows.rows[row]->need_typeset) {
+			continue;
+		}
+		if (lazy && TextLayer_GetRowY(layer, row) > end_y) {
+			break;
+		}
+		row += TextLayer_TextRowTypeset(layer, row);
 	}
 	/* 记录排版后各个文本行的矩形区域 */
 	TextLayer_InvalidateRowsRect(layer, start_row, -1);
+	return row;
 }
 
 static const wchar_t *TextLayer_ProcessStyleTag(LCUI_TextLayer layer,
 						const wchar_t *p,
 						LinkedList *tags,
-						LCUI_TextStyle *style)
+						unsigned *style)
 {
 	LCUI_TextStyle s;
 	const wchar_t *pp;
 	pp = StyleTags_GetEnd(tags, p);
-	if (pp) {
-		s = StyleTags_GetTextStyle(tags);
-		if (s) {
-			TextStyle_Merge(s, &layer->text_default_style);
-			LinkedList_Append(&layer->text_styles, s);
+	if (!pp) {
+		pp = StyleTags_GetStart(tags, p);
+		if (!pp) {
+			return NULL;
 		}
-		*style = s;
-		return pp;
 	}
-	pp = StyleTags_GetStart(tags, p);
-	if (pp) {
-		s = StyleTags_GetTextStyle(tags);
-		if (s) {
-			TextStyle_Merge(s, &layer->text_default_style);
-			LinkedList_Append(&layer->text_styles, s);
+	*style = 0;
+	s = StyleTags_GetTextStyle(tags);
+	if (s) {
+		TextStyle_Merge(s, &layer->text_default_style);
+		/* 相同的样式会被合并，s 可能已被释放 */
+		*style = TextLayer_AddStyle(layer, s);
+		if (*style == 0) {
+			TextStyle_Destroy(s);
+			free(s);
 		}
-		*style = s;
-		return pp;
 	}
-	return NULL;
+	return pp;
 }
 
+/** 文本中的一段连续的字符，以及跟在它后面的换行符 */
+typedef struct TextSegmentRec_ {
+	size_t start;     /**< 在字符数组中的起始位置 */
+	size_t length;    /**< 字符数量 */
+	LCUI_EOLChar eol; /**< 换行符类型，最后一段文本没有换行符 */
+} TextSegmentRec, *TextSegment;
+
 /** 对文本进行预处理 */
 static int TextLayer_ProcessText(LCUI_TextLayer layer, const wchar_t *wstr,
 				 TextAction action, LinkedList *tags)
 {
 	LCUI_EOLChar eol;
 	LCUI_TextRow txtrow;
-	LCUI_TextCharRec txtchar;
+	LCUI_TextChar chars;
+	TextSegment segs;
 	LinkedList tmp_tags;
 	const wchar_t *p;
 	int cur_col, cur_row, start_row, ins_x, ins_y;
 	LCUI_BOOL need_typeset, rect_has_added;
-	LCUI_TextStyle style = NULL;
+	size_t k, n_chars = 0, n_segs = 1;
+	unsigned style = 0;
 
 	if (!wstr) {
 		return -1;
 	}
+	for (p = wstr; *p; ++p) {
+		if (*p == '\r' || *p == '\n') {
+			++n_segs;
+		}
+	}
+	/* 先将文本解析成多段字符，待载入字体位图后再整段插入至文本行 */
+	chars = malloc(sizeof(LCUI_TextCharRec) * (p - wstr + 1));
+	segs = malloc(sizeof(TextSegmentRec) * n_segs);
+	if (!chars || !segs) {
+		free(chars);
+		free(segs);
+		return -1;
+	}
 	need_typeset = FALSE;
 	rect_has_added = FALSE;
 	StyleTags_Init(&tmp_tags);
 	if (!tags) {
 		tags = &tmp_tags;
 	}
+	n_segs = 0;
+	segs[0].start = 0;
+	for (p = wstr; *p; ++p) {
+		if (layer->enable_style_tag) {
+			const wchar_t *pp;
+			pp = TextLayer_ProcessStyleTag(layer, p, tags, &style);
+			if (pp) {
+				p = pp - 1;
+				continue;
+			}
+		}
+		if (*p == '\r' || *p == '\n') {
+			/* 判断是哪一种换行模式 */
+			if (*p == '\r') {
+				if (*(p + 1) == '\n') {
+					eol = LCUI_EOL_CR_LF;
+					++p;
+				} else {
+					eol = LCUI_EOL_CR;
+				}
+			} else {
+				eol = LCUI_EOL_LF;
+			}
+			segs[n_segs].length = n_chars - segs[n_segs].start;
+			segs[n_segs].eol = eol;
+			segs[++n_segs].start = n_chars;
+			continue;
+		}
+		chars[n_chars].code = *p;
+		chars[n_chars].style = style;
+		chars[n_chars].bitmap = NULL;
+		++n_chars;
+	}
+	segs[n_segs].length = n_chars - segs[n_segs].start;
+	segs[n_segs].eol = LCUI_EOL_NONE;
+	++n_segs;
+	TextLayer_LoadCharBitmaps(layer, chars, n_chars);
 	/* 如果是将文本追加至文本末尾 */
 	if (action == TEXT_ACTION_APPEND) {
 		if (layer->text_rows.length > 0) {
@@ -737,51 +1753,37 @@ static int TextLayer_ProcessText(LCUI_TextLayer layer, const wchar_t *wstr,
 	start_row = cur_row;
 	ins_x = cur_col;
 	ins_y = cur_row;
-	for (p = wstr; *p; ++p) {
-		if (layer->enable_style_tag) {
-			const wchar_t *pp;
-			pp = TextLayer_ProcessStyleTag(layer, p, tags, &style);
-			if (pp) {
-				p = pp - 1;
-				continue;
-			}
+	for (k = 0; k < n_segs; ++k) {
+		if (TextRow_Insert(txtrow, ins_x, chars + segs[k].start,
+				   (int)segs[k].length) == 0) {
+			TextLayer_RefCharStyles(layer, chars + segs[k].start,
+						segs[k].length);
+			layer->length += segs[k].length;
+			ins_x += (int)segs[k].length;
 		}
-		if (*p == '\r' || *p == '\n') {
-			/* 判断是哪一种换行模式 */
-			if (*p == '\r') {
-				if (*(p + 1) == '\n') {
-					eol = LCUI_EOL_CR_LF;
-				} else {
-					eol = LCUI_EOL_CR;
-				}
-			} else {
-				eol = LCUI_EOL_LF;
-			}
-			/* 如果没有记录过文本行的矩形区域 */
-			if (!rect_has_added) {
-				TextLayer_InvalidateRowsRect(layer, ins_y, -1);
-				rect_has_added = TRUE;
-				start_row = ins_y;
-			}
-			/* 将当前行中的插入点为截点，进行断行 */
-			TextLayer_BreakTextRow(layer, ins_y, ins_x, eol);
-			layer->width = max(layer->width, txtrow->width);
-			need_typeset = TRUE;
-			++layer->length;
-			ins_x = 0;
-			++ins_y;
-			txtrow = TextLayer_GetRow(layer, ins_y);
+		if (segs[k].eol == LCUI_EOL_NONE) {
 			continue;
 		}
-		txtchar.style = style;
-		txtchar.code = *p;
-		TextChar_UpdateBitmap(&txtchar, &layer->text_default_style);
-		TextRow_InsertCopy(txtrow, ins_x, &txtchar);
+		/* 如果没有记录过文本行的矩形区域 */
+		if (!rect_has_added) {
+			TextLayer_InvalidateRowsRect(layer, ins_y, -1);
+			rect_has_added = TRUE;
+			start_row = ins_y;
+		}
+		/* 将当前行中的插入点为截点，进行断行 */
+		TextLayer_BreakTextRow(layer, ins_y, ins_x, segs[k].eol);
+		layer->width = max(layer->width, txtrow->width);
+		need_typeset = TRUE;
 		++layer->length;
-		++ins_x;
+		ins_x = 0;
+		++ins_y;
+		txtrow = TextLayer_GetRow(layer, ins_y);
 	}
+	free(chars);
+	free(segs);
+	TextLayer_FreeUnusedStyles(layer);
 	/* 更新当前行的尺寸 */
-	TextLayer_UpdateRowSize(layer, txtrow);
+	TextLayer_UpdateRowSize(layer, ins_y);
 	layer->width = max(layer->width, txtrow->width);
 	if (action == TEXT_ACTION_INSERT) {
 		layer->insert_x = ins_x;
@@ -789,7 +1791,7 @@ static int TextLayer_ProcessText(LCUI_TextLayer layer, const wchar_t *wstr,
 	}
 	/* 若启用了自动换行模式，则标记需要重新对文本进行排版 */
 	if (layer->enable_autowrap || need_typeset) {
-		TextLayer_AddUpdateTypeset(layer, cur_row);
+		TextLayer_AddUpdateRowsTypeset(layer, cur_row, ins_y);
 	} else {
 		TextLayer_InvalidateRowRect(layer, cur_row, 0, -1);
 	}
@@ -861,6 +1863,58 @@ int TextLayer_SetText(LCUI_TextLayer layer, const char *utf8_text)
 	return 0;
 }
 
+/** 获取文本行的行尾符长度 */
+static size_t TextRow_GetEOLLength(LCUI_TextRow txtrow)
+{
+	switch (txtrow->eol) {
+	case LCUI_EOL_CR_LF:
+		return 2;
+	case LCUI_EOL_CR:
+	case LCUI_EOL_LF:
+		return 1;
+	default:
+		break;
+	}
+	return 0;
+}
+
+/** 计算文本行的行首位置，从第一个位置无效的行开始计算，直到计算完指定行 */
+static void TextRowList_UpdateRowsOffset(LCUI_TextRowList rowlist,
+					 int end_row)
+{
+	int row = rowlist->valid_offset_length;
+	LCUI_TextRow prev;
+
+	if (row == 0 && rowlist->length > 0) {
+		rowlist->rows[0]->offset = 0;
+		row = 1;
+	}
+	for (; row <= end_row && row < rowlist->length; ++row) {
+		prev = rowlist->rows[row - 1];
+		rowlist->rows[row]->offset =
+		    prev->offset + prev->length + TextRow_GetEOLLength(prev);
+	}
+	rowlist->valid_offset_length = row;
+}
+
+size_t TextLayer_GetTextOffset(LCUI_TextLayer layer, int row, int col)
+{
+	LCUI_TextRow txtrow;
+	LCUI_TextRowList rowlist = &layer->text_rows;
+
+	if (row < 0 || rowlist->length < 1) {
+		return col;
+	}
+	if (row < rowlist->length) {
+		TextRowList_UpdateRowsOffset(rowlist, row);
+		return rowlist->rows[row]->offset + col;
+	}
+	txtrow = rowlist->rows[rowlist->length - 1];
+	TextRowList_UpdateRowsOffset(rowlist, rowlist->length - 1);
+	return txtrow->offset + txtrow->length + TextRow_GetEOLLength(txtrow) +
+	       col;
+}
+
 /** 获取文本图层中的文本（宽字符版） */
 size_t TextLayer_GetTextW(LCUI_TextLayer layer, size_t start_pos,
 			  size_t max_len, wchar_t *wstr_buff)
@@ -884,7 +1938,7 @@ size_t TextLayer_GetTextW(LCUI_TextLayer layer, size_t start_pos,
 	for (i = 0; row < layer->text_rows.length && i < max_len; ++row) {
 		row_ptr = layer->text_rows.rows[row];
 		for (; col < row_ptr->length && i < max_len; ++col, ++i) {
-			wstr_buff[i] = row_ptr->string[col]->code;
+			wstr_buff[i] = row_ptr->string[col].code;
 		}
 	}
 	wstr_buff[i] = 0;
@@ -893,23 +1947,19 @@ size_t TextLayer_GetTextW(LCUI_TextLayer layer, size_t start_pos,
 
 int TextLayer_GetWidth(LCUI_TextLayer layer)
 {
-	int i, row, w, max_w;
+	int row, w, max_w;
 	LCUI_TextRow txtrow;
+	int max_width =
+	    layer->fixed_width > 0 ? layer->fixed_width : layer->max_width;
+	LCUI_BOOL autowrap =
+	    max_width > 0 && layer->enable_autowrap && layer->enable_mulitiline;
 
-	DEBUG_MSG("rows: %d, font-size: %d\n", layer->text_rows.length,
-		  layer->text_default_style.pixel_size);
 	for (row = 0, max_w = 0; row < layer->text_rows.length; ++row) {
 		txtrow = layer->text_rows.rows[row];
-		for (i = 0, w = 0; i < txtrow->length; ++i) {
-			if (!txtrow->string[i]->bitmap ||
-			    !txtrow->string[i]->bitmap->buffer) {
-				continue;
-			}
-			w += txtrow->string[i]->bitmap->advance.x;
-			DEBUG_MSG("[%d/%d] %d %c, width: %d/%d\n", i,
-				  txtrow->length, txtrow->string[i]->code,
-				  txtrow->string[i]->code,
-				  txtrow->string[i]->bitmap->advance.x, w);
+		w = txtrow->width;
+		/* 尚未排版的文本行在自动换行后不会超过最大宽度 */
+		if (autowrap && txtrow->need_typeset && w > max_width) {
+			w = max_width;
 		}
 		if (w > max_w) {
 			max_w = w;
@@ -920,11 +1970,12 @@ int TextLayer_GetWidth(LCUI_TextLayer layer)
 
 int TextLayer_GetHeight(LCUI_TextLayer layer)
 {
-	int i, h;
-	for (i = 0, h = 0; i < layer->text_rows.length; ++i) {
-		h += layer->text_rows.rows[i]->height;
+	int row = layer->text_rows.length - 1;
+	if (row < 0) {
+		return 0;
 	}
-	return h;
+	return TextLayer_GetRowY(layer, row) +
+	       layer->text_rows.rows[row]->height;
 }
 
 int TextLayer_SetFixedSize(LCUI_TextLayer layer, int width, int height)
@@ -933,8 +1984,7 @@ int TextLayer_SetFixedSize(LCUI_TextLayer layer, int width, int height)
 	layer->fixed_height = height;
 	layer->task.redraw_all = TRUE;
 	if (layer->enable_autowrap) {
-		layer->task.typeset_start_row = 0;
-		layer->task.update_typeset = TRUE;
+		TextLayer_AddUpdateTypeset(layer, 0);
 	}
 	return 0;
 }
@@ -945,8 +1995,7 @@ int TextLayer_SetMaxSize(LCUI_TextLayer layer, int width, int height)
 	layer->max_height = height;
 	layer->task.redraw_all = TRUE;
 	if (layer->enable_autowrap) {
-		layer->task.typeset_start_row = 0;
-		layer->task.update_typeset = TRUE;
+		TextLayer_AddUpdateTypeset(layer, 0);
 	}
 	return 0;
 }
@@ -988,14 +2037,14 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 	end_y = char_y;
 	/* 计算结束点的位置 */
 	for (; end_y < layer->text_rows.length && n_char > 0; ++end_y) {
-		txtrow = layer->text_rows.rows[end_y];
-		if (end_x + n_char <= txtrow->length) {
+		end_txtrow = layer->text_rows.rows[end_y];
+		if (end_x + n_char <= end_txtrow->length) {
 			end_x += n_char;
 			n_char = 0;
 			break;
 		}
-		n_char -= (txtrow->length - end_x);
-		if (txtrow->eol == LCUI_EOL_NONE) {
+		n_char -= (end_txtrow->length - end_x);
+		if (end_txtrow->eol == LCUI_EOL_NONE) {
 			end_x = 0;
 		} else {
 			n_char -= 1;
@@ -1021,7 +2070,7 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 		return 0;
 	}
 	/* 获取上一行文本 */
-	prev_txtrow = layer->text_rows.rows[char_y - 1];
+	prev_txtrow = char_y > 0 ? layer->text_rows.rows[char_y - 1] : NULL;
 	// 计算起始行与结束行拼接后的长度
 	// 起始行：0 1 2 3 4 5，起点位置：2
 	// 结束行：0 1 2 3 4 5，终点位置：4
@@ -1036,19 +2085,21 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 			return -4;
 		}
 		TextLayer_InvalidateRowRect(layer, char_y, char_x, -1);
-		TextLayer_AddUpdateTypeset(layer, char_y);
-		for (i = char_x, j = end_x; j < txtrow->length; ++i, ++j) {
-			txtrow->string[i] = txtrow->string[j];
-		}
+		TextLayer_AddUpdateRowsTypeset(layer, char_y, char_y);
+		TextLayer_UnrefCharStyles(layer, txtrow->string + char_x,
+					  end_x - char_x);
+		memmove(txtrow->string + char_x, txtrow->string + end_x,
+			sizeof(LCUI_TextCharRec) * (txtrow->length - end_x));
 		/* 如果当前行为空，也不是第一行，并且上一行没有结束符 */
-		if (len <= 0 && end_y > 0 &&
+		if (len <= 0 && prev_txtrow &&
 		    prev_txtrow->eol != LCUI_EOL_NONE) {
 			TextRowList_RemoveRow(&layer->text_rows, end_y);
+			return 0;
 		}
 		/* 调整起始行的容量 */
 		TextRow_SetLength(txtrow, len);
 		/* 更新文本行的尺寸 */
-		TextLayer_UpdateRowSize(layer, txtrow);
+		TextLayer_UpdateRowSize(layer, char_y);
 		return 0;
 	}
 	/* 如果结束点在行尾，并且该行不是最后一行 */
@@ -1059,7 +2110,19 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 		end_x = -1;
 		len = char_x + end_txtrow->length;
 	}
-	TextRow_SetLength(txtrow, len);
+	/* 被删除的字符不再引用样式，之后的操作可能会截断起始行，需先处理 */
+	TextLayer_UnrefCharStyles(layer, txtrow->string + char_x,
+				  txtrow->length - char_x);
+	for (i = char_y + 1; i < end_y; ++i) {
+		prev_txtrow = layer->text_rows.rows[i];
+		TextLayer_UnrefCharStyles(layer, prev_txtrow->string,
+					  prev_txtrow->length);
+	}
+	prev_txtrow = char_y > 0 ? layer->text_rows.rows[char_y - 1] : NULL;
+	TextLayer_UnrefCharStyles(layer, end_txtrow->string, max(end_x, 0));
+	if (TextRow_SetLength(txtrow, len) != 0) {
+		return -5;
+	}
 	/* 标记当前行后面的所有行的矩形需区域需要刷新 */
 	TextLayer_InvalidateRowsRect(layer, char_y + 1, -1);
 	/* 移除起始行与结束行之间的文本行 */
@@ -1067,24 +2130,26 @@ static int TextLayer_TextDeleteEx(LCUI_TextLayer layer, int char_y, int char_x,
 		TextLayer_InvalidateRowRect(layer, i, 0, -1);
 		TextRowList_RemoveRow(&layer->text_rows, i);
 	}
-	i = char_x;
-	j = end_x + 1;
+	j = max(end_x, 0);
 	end_y = char_y + 1;
 	/* 将结束行的内容拼接至起始行 */
-	for (; i < len && j < end_txtrow->length; ++i, ++j) {
-		txtrow->string[i] = end_txtrow->string[j];
-	}
-	TextLayer_UpdateRowSize(layer, txtrow);
+	i = max(0, min(len - char_x, end_txtrow->length - j));
+	memcpy(txtrow->string + char_x, end_txtrow->string + j,
+	       sizeof(LCUI_TextCharRec) * i);
+	txtrow->length = char_x + i;
+	/* 拼接后的文本行使用结束行的行尾符 */
+	txtrow->eol = end_txtrow->eol;
+	TextLayer_UpdateRowSize(layer, char_y);
 	TextLayer_InvalidateRowRect(layer, end_y, 0, -1);
 	/* 移除结束行 */
 	TextRowList_RemoveRow(&layer->text_rows, end_y);
 	/* 如果起始行无内容，并且上一行没有结束符（换行符），则
 	 * 说明需要删除起始行 */
-	if (len <= 0 && char_y > 0 && prev_txtrow->eol != LCUI_EOL_NONE) {
+	if (len <= 0 && prev_txtrow && prev_txtrow->eol != LCUI_EOL_NONE) {
 		TextLayer_InvalidateRowRect(layer, char_y, 0, -1);
 		TextRowList_RemoveRow(&layer->text_rows, char_y);
 	}
-	TextLayer_AddUpdateTypeset(layer, char_y);
+	TextLayer_AddUpdateRowsTypeset(layer, char_y, char_y);
 	return 0;
 }
 
@@ -1166,13 +2231,16 @@ void TextLayer_EnableStyleTag(LCUI_TextLayer layer, LCUI_BOOL enable)
 
 static void TextLayer_UpdateTextStyleCache(LCUI_TextLayer layer)
 {
-	LinkedListNode *node;
+	unsigned i;
 	if (!layer->text_default_style.has_family) {
 		TextStyle_SetDefaultFont(&layer->text_default_style);
 	}
 	/* 替换缺省字体，确保能够正确应用字体设置 */
-	for (LinkedList_Each(node, &layer->text_styles)) {
-		TextStyle_Merge(node->data, &layer->text_default_style);
+	for (i = 0; i < layer->text_styles_length; ++i) {
+		if (layer->text_styles[i]) {
+			TextStyle_Merge(layer->text_styles[i],
+					&layer->text_default_style);
+		}
 	}
 }
 
@@ -1180,20 +2248,68 @@ static void TextLayer_UpdateTextStyleCache(LCUI_TextLayer layer)
 void TextLayer_ReloadCharBitmap(LCUI_TextLayer layer)
 {
 	int row, col;
+	size_t n_chars = 0;
+	LCUI_TextRow txtrow;
+	LCUI_TextChar chars;
+
 	TextLayer_UpdateTextStyleCache(layer);
+	/* 所有字符都会重新获取字形，旧的字形不再需要 */
+	TextGlyphTable_Clear(&layer->glyphs);
 	for (row = 0; row < layer->text_rows.length; ++row) {
-		LCUI_TextRow txtrow = layer->text_rows.rows[row];
-		for (col = 0; col < txtrow->length; ++col) {
-			LCUI_TextChar txtchar = txtrow->string[col];
-			TextChar_UpdateBitmap(txtchar,
-					      &layer->text_default_style);
+		n_chars += layer->text_rows.rows[row]->length;
+	}
+	/* 将各行的字符汇集到一起载入，以便让所有行共用相同的字体位图 */
+	chars = malloc(sizeof(LCUI_TextCharRec) * (n_chars + 1));
+	if (!chars) {
+		for (row = 0; row < layer->text_rows.length; ++row) {
+			txtrow = layer->text_rows.rows[row];
+			TextLayer_LoadCharBitmaps(layer, txtrow->string,
+						  txtrow->length);
+			TextRow_InvalidateWords(txtrow);
+			TextLayer_UpdateRowSize(layer, row);
+		}
+		return;
+	}
+	for (row = 0, n_chars = 0; row < layer->text_rows.length; ++row) {
+		txtrow = layer->text_rows.rows[row];
+		memcpy(chars + n_chars, txtrow->string,
+		       sizeof(LCUI_TextCharRec) * txtrow->length);
+		n_chars += txtrow->length;
+	}
+	TextLayer_LoadCharBitmaps(layer, chars, n_chars);
+	for (row = 0, n_chars = 0; row < layer->text_rows.length; ++row) {
+		txtrow = layer->text_rows.rows[row];
+		for (col = 0; col < txtrow->length; ++col, ++n_chars) {
+			txtrow->string[col].bitmap = chars[n_chars].bitmap;
 		}
-		TextLayer_UpdateRowSize(layer, txtrow);
+		TextRow_InvalidateWords(txtrow);
+	}
+	free(chars);
+	for (row = 0; row < layer->text_rows.length; ++row) {
+		TextLayer_UpdateRowSize(layer, row);
+	}
+}
+
+/**
+ * 计算各个文本行的Y轴坐标和各个字符的X轴坐标
+ * 绘制时可能有多个线程同时绘制同一个文本图层，所以要在更新时算好这些坐标，
+ * 让绘制过程只读取它们
+ */
+static void TextLayer_UpdateCoords(LCUI_TextLayer layer)
+{
+	int row;
+	LCUI_TextRowList rowlist = &layer->text_rows;
+
+	TextRowList_UpdateRowsY(rowlist, rowlist->length, 0);
+	for (row = 0; row < rowlist->length; ++row) {
+		TextRow_UpdateCharsX(rowlist->rows[row]);
 	}
 }
 
 void TextLayer_Update(LCUI_TextLayer layer, LinkedList *rects)
 {
+	int row;
+
 	if (layer->task.update_bitmap) {
 		TextLayer_InvalidateRowsRect(layer, 0, -1);
 		TextLayer_ReloadCharBitmap(layer);
@@ -1202,9 +2318,15 @@ void TextLayer_Update(LCUI_TextLayer layer, LinkedList *rects)
 		layer->task.redraw_all = TRUE;
 	}
 	if (layer->task.update_typeset) {
-		TextLayer_TextTypeset(layer, layer->task.typeset_start_row);
-		layer->task.update_typeset = FALSE;
-		layer->task.typeset_start_row = 0;
+		row = TextLayer_TextTypeset(layer,
+					    layer->task.typeset_start_row);
+		/* 可见区域下方还有未排版的文本行，留到下次更新时再排版 */
+		if (row < layer->text_rows.length) {
+			layer->task.typeset_start_row = row;
+		} else {
+			layer->task.update_typeset = FALSE;
+			layer->task.typeset_start_row = 0;
+		}
 	}
 	layer->width = TextLayer_GetWidth(layer);
 	/* 如果坐标偏移量有变化，记录各个文本行区域 */
@@ -1216,6 +2338,7 @@ void TextLayer_Update(LCUI_TextLayer layer, LinkedList *rects)
 		TextLayer_InvalidateRowsRect(layer, 0, -1);
 		layer->task.redraw_all = TRUE;
 	}
+	TextLayer_UpdateCoords(layer);
 	if (rects) {
 		LinkedList_Concat(rects, &layer->dirty_rects);
 	}
@@ -1223,7 +2346,9 @@ void TextLayer_Update(LCUI_TextLayer layer, LinkedList *rects)
 
 static void TextLayer_ValidateArea(LCUI_TextLayer layer, LCUI_Rect *area)
 {
-	int width, height;
+	int width, height, row;
+	LCUI_TextRowList rowlist = &layer->text_rows;
+
 	if (layer->fixed_width > 0) {
 		width = layer->fixed_width;
 	} else if (layer->max_width > 0) {
@@ -1233,8 +2358,12 @@ static void TextLayer_ValidateArea(LCUI_TextLayer layer, LCUI_Rect *area)
 	}
 	if (layer->fixed_height > 0) {
 		height = layer->fixed_height;
+	} else if (rowlist->length > 0) {
+		row = rowlist->length - 1;
+		height = TextRowList_GetRowY(rowlist, row) +
+			 rowlist->rows[row]->height;
 	} else {
-		height = TextLayer_GetHeight(layer);
+		height = 0;
 	}
 	LCUIRect_ValidateArea(area, width, height);
 }
@@ -1242,12 +2371,20 @@ static void TextLayer_ValidateArea(LCUI_TextLayer layer, LCUI_Rect *area)
 static void TextLayer_DrawChar(LCUI_TextLayer layer, LCUI_TextChar ch,
 			       LCUI_Graph *graph, LCUI_Pos ch_pos)
 {
+	const LCUI_FontBitmap *bmp;
+	LCUI_TextStyle style = TextLayer_GetCharStyle(layer, ch);
+	LCUI_TextGlyph glyph = (LCUI_TextGlyph)ch->bitmap;
+
+	/* 字符只引用了字形的度量信息，位图数据需要从字体位图缓存中获取 */
+	LCUIFont_GetBitmap(glyph->code, glyph->font_id, glyph->size, &bmp);
+	if (!bmp) {
+		return;
+	}
 	/* 判断文字使用的前景颜色，再进行绘制 */
-	if (ch->style && ch->style->has_fore_color) {
-		FontBitmap_Mix(graph, ch_pos, ch->bitmap,
-			       ch->style->fore_color);
+	if (style && style->has_fore_color) {
+		FontBitmap_Mix(graph, ch_pos, bmp, style->fore_color);
 	} else {
-		FontBitmap_Mix(graph, ch_pos, ch->bitmap,
+		FontBitmap_Mix(graph, ch_pos, bmp,
 			       layer->text_default_style.fore_color);
 	}
 }
@@ -1257,45 +2394,35 @@ static void TextLayer_DrawTextRow(LCUI_TextLayer layer, LCUI_Rect *area,
 				  LCUI_TextRow txtrow, int y)
 {
 	LCUI_TextChar txtchar;
+	LCUI_TextStyle style;
 	LCUI_Pos ch_pos;
 	int baseline, col, x;
 	baseline = txtrow->text_height * 4 / 5;
 	x = TextLayer_GetRowStartX(layer, txtrow) + layer->offset_x;
 	/* 确定从哪个文字开始绘制 */
-	for (col = 0; col < txtrow->length; ++col) {
-		txtchar = txtrow->string[col];
-		/* 忽略无字体位图的文字 */
-		if (!txtchar->bitmap) {
-			continue;
-		}
-		x += txtchar->bitmap->advance.x;
-		if (x > area->x) {
-			x -= txtchar->bitmap->advance.x;
-			break;
-		}
-	}
+	col = TextRow_FindCharByX(txtrow, area->x - x);
 	/* 若一整行的文本都不在可绘制区域内 */
 	if (col >= txtrow->length) {
-		y += txtrow->height;
 		return;
 	}
+	x += TextRow_GetCharX(txtrow, col);
 	/* 遍历该行的文字 */
 	for (; col < txtrow->length; ++col) {
-		txtchar = txtrow->string[col];
+		txtchar = &txtrow->string[col];
 		if (!txtchar->bitmap) {
 			continue;
 		}
 		/* 计算字体位图的绘制坐标 */
 		ch_pos.x = layer_pos.x + x;
 		ch_pos.y = layer_pos.y + y;
-		if (txtchar->style && txtchar->style->has_back_color) {
+		style = TextLayer_GetCharStyle(layer, txtchar);
+		if (style && style->has_back_color) {
 			LCUI_Rect rect;
 			rect.x = ch_pos.x;
 			rect.y = ch_pos.y;
 			rect.height = txtrow->height;
 			rect.width = txtchar->bitmap->advance.x;
-			Graph_FillRect(graph, txtchar->style->back_color, &rect,
-				       TRUE);
+			Graph_FillRect(graph, style->back_color, &rect, TRUE);
 		}
 		ch_pos.x += txtchar->bitmap->left;
 		ch_pos.y += baseline;
@@ -1314,23 +2441,20 @@ int TextLayer_RenderTo(LCUI_TextLayer layer, LCUI_Rect area, LCUI_Pos layer_pos,
 		       LCUI_Graph *canvas)
 {
 	int y, row;
+	size_t epoch;
 	LCUI_TextRow txtrow;
 
-	y = layer->offset_y;
 	/* 确定可绘制的最大区域范围 */
 	TextLayer_ValidateArea(layer, &area);
-	for (row = 0; row < layer->text_rows.length; ++row) {
-		txtrow = TextLayer_GetRow(layer, row);
-		y += txtrow->height;
-		if (y > area.y) {
-			y -= txtrow->height;
-			break;
-		}
-	}
+	row = TextRowList_FindRowByY(&layer->text_rows,
+				     area.y - layer->offset_y);
 	/* 如果没有可绘制的文本行 */
 	if (row >= layer->text_rows.length) {
 		return -1;
 	}
+	/* 绘制期间其它线程可能会回收字体位图缓存，需登记读取 */
+	epoch = LCUIFont_BeginRead();
+	y = layer->offset_y + TextRowList_GetRowY(&layer->text_rows, row);
 	for (; row < layer->text_rows.length; ++row) {
 		txtrow = TextLayer_GetRow(layer, row);
 		TextLayer_DrawTextRow(layer, &area, canvas, layer_pos, txtrow,
@@ -1341,6 +2465,7 @@ int TextLayer_RenderTo(LCUI_TextLayer layer, LCUI_Rect area, LCUI_Pos layer_pos,
 			break;
 		}
 	}
+	LCUIFont_EndRead(epoch);
 	return 0;
 }
 
@@ -1362,16 +2487,14 @@ void TextLayer_SetTextStyle(LCUI_TextLayer layer, LCUI_TextStyle style)
 void TextLayer_SetTextAlign(LCUI_TextLayer layer, int align)
 {
 	layer->text_align = align;
-	layer->task.update_typeset = TRUE;
-	layer->task.typeset_start_row = 0;
+	TextLayer_AddUpdateTypeset(layer, 0);
 }
 
 /** 设置文本行的高度 */
 void TextLayer_SetLineHeight(LCUI_TextLayer layer, int height)
 {
 	layer->line_height = height;
-	layer->task.update_typeset = TRUE;
-	layer->task.typeset_start_row = 0;
+	TextLayer_AddUpdateTypeset(layer, 0);
 }
 
 LCUI_BOOL TextLayer_SetOffset(LCUI_TextLayer layer, int offset_x, int offset_y)
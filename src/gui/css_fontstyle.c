@@ -55,7 +55,7 @@
 
 enum FontStyleType { FS_NORMAL, FS_ITALIC, FS_OBLIQUE };
 
-typedef void (*StyleHandler)(LCUI_CSSFontStyle, LCUI_Style);
+typedef void (*StyleHandler)(LCUI_CSSFontStyle, const LCUI_StyleRec *);
 
 static struct LCUI_CSSFontStyleModule {
 	int keys[TOTAL_FONT_STYLE_KEY];
@@ -226,7 +226,7 @@ static LCUI_CSSPropertyParserRec style_parsers[] = {
 	{ key_white_space, "white-space", OnParseStyleOption }
 };
 
-static void OnComputeFontSize(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeFontSize(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	if (s->is_valid) {
 		fs->font_size =
@@ -236,7 +236,7 @@ static void OnComputeFontSize(LCUI_CSSFontStyle fs, LCUI_Style s)
 	fs->font_size = ComputeActual(DEFAULT_FONT_SIZE, LCUI_STYPE_PX);
 }
 
-static void OnComputeColor(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeColor(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	if (s->is_valid) {
 		fs->color = s->color;
@@ -245,7 +245,7 @@ static void OnComputeColor(LCUI_CSSFontStyle fs, LCUI_Style s)
 	}
 }
 
-static void OnComputeFontFamily(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeFontFamily(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	if (fs->font_ids) {
 		free(fs->font_ids);
@@ -263,7 +263,7 @@ static void OnComputeFontFamily(LCUI_CSSFontStyle fs, LCUI_Style s)
 			      fs->font_family);
 }
 
-static void OnComputeFontStyle(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeFontStyle(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	if (s->is_valid) {
 		fs->font_style = s->val_int;
@@ -272,7 +272,7 @@ static void OnComputeFontStyle(LCUI_CSSFontStyle fs, LCUI_Style s)
 	}
 }
 
-static void OnComputeFontWeight(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeFontWeight(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	if (s->is_valid) {
 		fs->font_weight = s->val_int;
@@ -281,7 +281,7 @@ static void OnComputeFontWeight(LCUI_CSSFontStyle fs, LCUI_Style s)
 	}
 }
 
-static void OnComputeTextAlign(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeTextAlign(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	if (s->is_valid) {
 		fs->text_align = s->val_style;
@@ -290,7 +290,7 @@ static void OnComputeTextAlign(LCUI_CSSFontStyle fs, LCUI_Style s)
 	}
 }
 
-static void OnComputeLineHeight(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeLineHeight(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	int h;
 	if (s->is_valid) {
@@ -307,7 +307,7 @@ static void OnComputeLineHeight(LCUI_CSSFontStyle fs, LCUI_Style s)
 	fs->line_height = h;
 }
 
-static void OnComputeContent(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeContent(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	size_t i;
 	size_t len;
@@ -339,7 +339,7 @@ static void OnComputeContent(LCUI_CSSFontStyle fs, LCUI_Style s)
 	fs->content = content;
 }
 
-static void OnComputeWhiteSpace(LCUI_CSSFontStyle fs, LCUI_Style s)
+static void OnComputeWhiteSpace(LCUI_CSSFontStyle fs, const LCUI_StyleRec *s)
 {
 	if (s->is_valid && s->type == LCUI_STYPE_STYLE) {
 		fs->white_space = s->val_style;
@@ -426,7 +426,7 @@ void CSSFontStyle_Compute(LCUI_CSSFontStyle fs, LCUI_StyleSheet ss)
 		if (self.keys[i] < 0) {
 			continue;
 		}
-		self.handlers[i](fs, &ss->sheet[self.keys[i]]);
+		self.handlers[i](fs, StyleSheet_GetStyle(ss, self.keys[i]));
 	}
 }
 
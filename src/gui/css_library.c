@@ -28,10 +28,12 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "config.h"
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <LCUI_Build.h>
 #include <LCUI/types.h>
 #include <LCUI/util.h>
@@ -39,9 +41,18 @@
 #include <LCUI/gui/css_library.h>
 #include <LCUI/gui/css_parser.h>
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 /* clang-format off */
 
 #define MAX_NAME_LEN	256
+#define MAX_CHECKED_PARENTS	8
+#define MAX_SUBSET_NAMES	16
 #define LEN(A)		sizeof(A) / sizeof(*A)
 
 enum SelectorRank {
@@ -52,6 +63,16 @@ enum SelectorRank {
 	ID_RANK = 100
 };
 
+/** 选择器名称的种类，与名称的原子一起编码，避免不同种类的同名名称冲突 */
+enum SelectorNameKind {
+	NAME_TYPE,
+	NAME_ID,
+	NAME_CLASS,
+	NAME_STATUS
+};
+
+#define SelectorName(ATOM, KIND)	((ATOM) << 2 | (KIND))
+
 enum SelectorFinderLevel {
 	LEVEL_NONE,
 	LEVEL_TYPE,
@@ -73,11 +94,19 @@ typedef struct NamesFinderRec_ {
 	LCUI_SelectorNode node;		/**< 针对的选择器结点 */
 } NamesFinderRec, *NamesFinder;
 
+/** 选择器结点的名称集合，用作样式组和父级链接表的键 */
+typedef struct SelectorNamesKeyRec_ {
+	unsigned hash;			/**< 哈希值 */
+	unsigned length;		/**< 名称数量 */
+	const unsigned *atoms;		/**< 名称的原子，已排序 */
+} SelectorNamesKeyRec, *SelectorNamesKey;
+
 /** 样式链接记录组 */
 typedef struct StyleLinkGroupRec_ {
 	Dict *links;             /**< 样式链接表 */
 	char *name;              /**< 选择器名称 */
 	LCUI_SelectorNode snode; /**< 选择器结点 */
+	SelectorNamesKeyRec key; /**< 选择器结点的名称集合 */
 } StyleLinkGroupRec, *StyleLinkGroup;
 
 /** 样式结点记录 */
@@ -96,13 +125,22 @@ typedef struct StyleLinkRec_ {
 	StyleLinkGroup group;	/**< 所属组 */
 	LinkedList styles;	/**< 作用于当前选择器的样式 */
 	Dict *parents;		/**< 父级节点 */
+	LinkedList parent_list;	/**< 父级节点列表，用于逐个检查是否可能匹配 */
+	LCUI_SelectorBloomFilterRec parents_bloom;	/**< 父级节点名称的并集 */
 } StyleLinkRec, *StyleLink;
 
 static struct {
 	LCUI_BOOL active;
 	LCUI_Mutex mutex;		/**< 互斥锁 */
 	LinkedList groups;		/**< 样式组列表 */
+	Dict *ancestor_names;		/**< 在选择器的祖先结点中出现过的类和状态名称 */
 	Dict *cache;			/**< 样式表缓存，以选择器的 hash 值索引 */
+	Dict *cache_index;		/**< 缓存索引，以选择器末尾结点的名称索引 */
+	Dict *cache_keys;		/**< 各个缓存所在的索引名称列表，以选择器的 hash 值索引 */
+	LinkedList dirty_names;		/**< 待清除的缓存索引名称 */
+	LCUI_BOOL dirty_all;		/**< 是否需要清除全部缓存 */
+	int batch_level;		/**< 批量添加样式表的嵌套层数 */
+	unsigned cache_version;		/**< 缓存版本号，每次清除缓存后递增 */
 	Dict *names;			/**< 样式属性名称表，以值的名称索引 */
 	Dict *value_keys;		/**< 样式属性值表，以值的名称索引 */
 	Dict *value_names;		/**< 样式属性值名称表，以值索引 */
@@ -111,9 +149,15 @@ static struct {
 	DictType value_names_dict;	/**< 样式属性值名称表的类型 */
 	DictType style_link_dict;	/**< 样式链接表的类型 */
 	DictType style_group_dict;	/**< 样式组的类型 */
+	DictType style_parents_dict;	/**< 父级链接表的类型 */
 	DictType cache_dict;		/**< 样式表缓存的类型 */
+	DictType cache_index_dict;	/**< 缓存索引的类型 */
+	DictType cache_set_dict;	/**< 缓存索引中的选择器 hash 值集合的类型 */
+	DictType cache_keys_dict;	/**< 缓存索引名称列表的类型 */
+	DictType ancestor_names_dict;	/**< 祖先结点名称表的类型 */
 	strpool_t *strpool;		/**< 字符串池 */
 	int count;			/**< 当前记录的属性数量 */
+	unsigned universal_name;	/**< 通用选择器 * 的名称 */
 } library;
 
 /** 样式字符串值与标识码 */
@@ -314,6 +358,8 @@ int LCUI_AddStyleValue(int key, const char *name)
 		DestroyKeyNameGroup(group);
 		return -2;
 	}
+	/* 完成渐进式 rehash，之后的查找不会再修改字典，可以在多个线程中进行 */
+	while (Dict_Rehash(library.value_keys, 100));
 	return 0;
 }
 
@@ -342,52 +388,40 @@ int LCUI_GetStyleTotal(void)
 	return library.count;
 }
 
-LCUI_BOOL SelectorNode_Match(LCUI_SelectorNode sn1, LCUI_SelectorNode sn2)
+/** 判断已排序的名称集合中是否含有另一个集合的全部名称 */
+static LCUI_BOOL SelectorNames_Contains(const unsigned *names, unsigned length,
+					const unsigned *subset,
+					unsigned subset_length)
 {
-	int i, j;
-	if (sn2->id) {
-		if (!sn1->id || strcmp(sn1->id, sn2->id) != 0) {
-			return FALSE;
+	unsigned i, j;
+
+	for (i = 0, j = 0; i < subset_length; ++i, ++j) {
+		while (j < length && names[j] < subset[i]) {
+			++j;
 		}
-	}
-	if (sn2->type && strcmp(sn2->type, "*") != 0) {
-		if (!sn1->type || strcmp(sn1->type, sn2->type) != 0) {
+		if (j >= length || names[j] != subset[i]) {
 			return FALSE;
 		}
 	}
-	if (sn2->classes) {
-		if (!sn1->classes) {
-			return FALSE;
+	return TRUE;
+}
+
+LCUI_BOOL SelectorNode_Match(LCUI_SelectorNode sn1, LCUI_SelectorNode sn2)
+{
+	unsigned i, j;
+
+	for (i = 0, j = 0; i < sn2->atoms_length; ++i) {
+		/* 通用选择器能匹配任意类型 */
+		if (sn2->atoms[i] == library.universal_name) {
+			continue;
 		}
-		for (i = 0; sn2->classes[i]; ++i) {
-			for (j = 0; sn1->classes[j]; ++j) {
-				if (strcmp(sn2->classes[i], sn1->classes[i]) ==
-				    0) {
-					j = -1;
-					break;
-				}
-			}
-			if (j != -1) {
-				return FALSE;
-			}
+		while (j < sn1->atoms_length && sn1->atoms[j] < sn2->atoms[i]) {
+			++j;
 		}
-	}
-	if (sn2->status) {
-		if (!sn1->status) {
+		if (j >= sn1->atoms_length || sn1->atoms[j] != sn2->atoms[i]) {
 			return FALSE;
 		}
-		for (i = 0; sn2->status[i]; ++i) {
-			for (j = 0; sn1->status[j]; ++j) {
-				if (strcmp(sn2->status[i], sn1->status[i]) ==
-				    0) {
-					j = -1;
-					break;
-				}
-			}
-			if (j != -1) {
-				return FALSE;
-			}
-		}
+		++j;
 	}
 	return TRUE;
 }
@@ -398,6 +432,17 @@ static void SelectorNode_Copy(LCUI_SelectorNode dst, LCUI_SelectorNode src)
 	dst->id = src->id ? strdup2(src->id) : NULL;
 	dst->type = src->type ? strdup2(src->type) : NULL;
 	dst->fullname = src->fullname ? strdup2(src->fullname) : NULL;
+	dst->rank = src->rank;
+	dst->hash = src->hash;
+	dst->bloom = src->bloom;
+	dst->atoms_length = src->atoms_length;
+	if (src->atoms_length > 0) {
+		dst->atoms = malloc(sizeof(unsigned) * src->atoms_length);
+		memcpy(dst->atoms, src->atoms,
+		       sizeof(unsigned) * src->atoms_length);
+	} else {
+		dst->atoms = NULL;
+	}
 	if (src->classes) {
 		for (i = 0; src->classes[i]; ++i) {
 			sortedstrlist_add(&dst->classes, src->classes[i]);
@@ -432,6 +477,10 @@ void SelectorNode_Delete(LCUI_SelectorNode node)
 		free(node->fullname);
 		node->fullname = NULL;
 	}
+	if (node->atoms) {
+		free(node->atoms);
+		node->atoms = NULL;
+	}
 	free(node);
 }
 
@@ -513,15 +562,7 @@ void StyleList_Delete(LCUI_StyleList list)
 
 LCUI_StyleSheet StyleSheet(void)
 {
-	LCUI_StyleSheet ss;
-
-	ss = NEW(LCUI_StyleSheetRec, 1);
-	if (!ss) {
-		return ss;
-	}
-	ss->length = LCUI_GetStyleTotal();
-	ss->sheet = NEW(LCUI_StyleRec, ss->length + 1);
-	return ss;
+	return NEW(LCUI_StyleSheetRec, 1);
 }
 
 void StyleSheet_Clear(LCUI_StyleSheet ss)
@@ -529,17 +570,147 @@ void StyleSheet_Clear(LCUI_StyleSheet ss)
 	int i;
 
 	for (i = 0; i < ss->length; ++i) {
-		DestroyStyle(&ss->sheet[i]);
+		DestroyStyle(&ss->styles[i]);
 	}
+	if (ss->bits) {
+		memset(ss->bits, 0, sizeof(unsigned) * ss->bits_length);
+	}
+	ss->length = 0;
 }
 
 void StyleSheet_Delete(LCUI_StyleSheet ss)
 {
 	StyleSheet_Clear(ss);
-	free(ss->sheet);
+	free(ss->bits);
+	free(ss->styles);
 	free(ss);
 }
 
+static int CountBits(unsigned x)
+{
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	x = (x + (x >> 4)) & 0x0f0f0f0f;
+	return (int)((x * 0x01010101) >> 24);
+}
+
+static LCUI_BOOL StyleSheet_HasKey(const LCUI_StyleSheetRec *ss, int key)
+{
+	int i = key / 32;
+
+	if (key < 0 || i >= ss->bits_length) {
+		return FALSE;
+	}
+	return (ss->bits[i] & (1u << (key % 32))) != 0;
+}
+
+/** 获取属性键对应的样式在样式列表中的位置，即位图中排在它前面的键的数量 */
+static int StyleSheet_GetIndex(const LCUI_StyleSheetRec *ss, int key)
+{
+	int i, n = key / 32, count = 0;
+
+	if (n >= ss->bits_length) {
+		return ss->length;
+	}
+	for (i = 0; i < n; ++i) {
+		count += CountBits(ss->bits[i]);
+	}
+	return count + CountBits(ss->bits[n] & ((1u << (key % 32)) - 1));
+}
+
+/**
+ * 扩充样式表的空间
+ * @param capacity 样式列表需要的容量
+ * @param bits_length 位图需要的长度
+ */
+static int StyleSheet_Reserve(LCUI_StyleSheet ss, int capacity,
+			      int bits_length)
+{
+	unsigned *bits;
+	LCUI_Style styles;
+
+	if (bits_length > ss->bits_length) {
+		bits = realloc(ss->bits, sizeof(unsigned) * bits_length);
+		if (!bits) {
+			return -1;
+		}
+		memset(bits + ss->bits_length, 0,
+		       sizeof(unsigned) * (bits_length - ss->bits_length));
+		ss->bits = bits;
+		ss->bits_length = bits_length;
+	}
+	if (capacity > ss->capacity) {
+		styles = realloc(ss->styles, sizeof(LCUI_StyleRec) * capacity);
+		if (!styles) {
+			return -1;
+		}
+		ss->styles = styles;
+		ss->capacity = capacity;
+	}
+	return 0;
+}
+
+const LCUI_StyleRec *StyleSheet_GetStyle(const LCUI_StyleSheetRec *ss, int key)
+{
+	/* 多个线程会同时读取它，初始化后不再修改 */
+	static const LCUI_StyleRec none_style = { FALSE, LCUI_STYPE_NONE };
+
+	if (StyleSheet_HasKey(ss, key)) {
+		return &ss->styles[StyleSheet_GetIndex(ss, key)];
+	}
+	return &none_style;
+}
+
+LCUI_Style StyleSheet_AddStyle(LCUI_StyleSheet ss, int key)
+{
+	int i, capacity = ss->capacity;
+
+	if (key < 0) {
+		return NULL;
+	}
+	if (StyleSheet_HasKey(ss, key)) {
+		return &ss->styles[StyleSheet_GetIndex(ss, key)];
+	}
+	if (ss->length >= capacity) {
+		capacity = max(ss->length * 2, 4);
+	}
+	if (StyleSheet_Reserve(ss, capacity, key / 32 + 1) != 0) {
+		return NULL;
+	}
+	i = StyleSheet_GetIndex(ss, key);
+	memmove(ss->styles + i + 1, ss->styles + i,
+		sizeof(LCUI_StyleRec) * (ss->length - i));
+	ss->styles[i].is_valid = FALSE;
+	ss->styles[i].type = LCUI_STYPE_NONE;
+	ss->styles[i].val_int = 0;
+	ss->bits[key / 32] |= 1u << (key % 32);
+	ss->length += 1;
+	return &ss->styles[i];
+}
+
+void StyleSheet_RemoveStyle(LCUI_StyleSheet ss, int key)
+{
+	int i;
+
+	if (!StyleSheet_HasKey(ss, key)) {
+		return;
+	}
+	i = StyleSheet_GetIndex(ss, key);
+	DestroyStyle(&ss->styles[i]);
+	ss->length -= 1;
+	memmove(ss->styles + i, ss->styles + i + 1,
+		sizeof(LCUI_StyleRec) * (ss->length - i));
+	ss->bits[key / 32] &= ~(1u << (key % 32));
+}
+
+LCUI_BOOL StyleSheet_CheckStyleType(const LCUI_StyleSheetRec *ss, int key,
+				    LCUI_StyleType type)
+{
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(ss, key);
+
+	return s->is_valid && s->type == type;
+}
+
 LCUI_StyleListNode StyleList_GetNode(LCUI_StyleList list, int key)
 {
 	LinkedListNode *node;
@@ -586,44 +757,103 @@ LCUI_StyleListNode StyleList_AddNode(LCUI_StyleList list, int key)
 
 static unsigned StyleList_Merge(LCUI_StyleList list, const LCUI_StyleSheetRec *sheet)
 {
-	int i, count;
+	int i, key;
+	unsigned count;
 	LCUI_StyleListNode node;
 
-	for (count = 0, i = 0; i < sheet->length; ++i) {
-		if (!sheet->sheet[i].is_valid) {
+	for (count = 0, i = 0, key = 0; i < sheet->length; ++key) {
+		if (!StyleSheet_HasKey(sheet, key)) {
 			continue;
 		}
-		node = StyleList_AddNode(list, i);
-		MergeStyle(&node->style, &sheet->sheet[i]);
-		count += 1;
+		if (sheet->styles[i].is_valid) {
+			node = StyleList_AddNode(list, key);
+			MergeStyle(&node->style, &sheet->styles[i]);
+			count += 1;
+		}
+		++i;
 	}
 	return count;
 }
 
-int StyleSheet_Merge(LCUI_StyleSheet dest, const LCUI_StyleSheetRec *src)
+/**
+ * 将源样式表中的有效样式合并到目标样式表中
+ * 先统计需要新增的样式数量，然后按属性键从大到小合并，让目标样式表中的
+ * 样式一次移动到位
+ * @param replace 是否覆盖目标样式表中已有的有效样式
+ * @returns 成功返回合并的样式数量，失败返回 -1
+ */
+static int StyleSheet_MergeSheet(LCUI_StyleSheet dest,
+				 const LCUI_StyleSheetRec *src,
+				 LCUI_BOOL replace)
 {
-	int i;
-	size_t size;
 	LCUI_Style s;
-
-	if (src->length > dest->length) {
-		size = sizeof(LCUI_StyleRec) * src->length;
-		s = realloc(dest->sheet, size);
-		if (!s) {
-			return -1;
-		}
-		for (i = dest->length; i < src->length; ++i) {
-			s[i].is_valid = FALSE;
+	unsigned sbits, dbits, mask;
+	int i, j, k, n, key, count = 0, added = 0;
+
+	for (n = 0, j = 0; n < src->bits_length; ++n) {
+		sbits = src->bits[n];
+		dbits = n < dest->bits_length ? dest->bits[n] : 0;
+		for (mask = 1; sbits; mask <<= 1) {
+			if (!(sbits & mask)) {
+				continue;
+			}
+			if (src->styles[j++].is_valid && !(dbits & mask)) {
+				++added;
+			}
+			sbits &= ~mask;
 		}
-		dest->sheet = s;
-		dest->length = src->length;
 	}
-	for (i = 0; i < src->length; ++i) {
-		if (src->sheet[i].is_valid && !dest->sheet[i].is_valid) {
-			MergeStyle(&dest->sheet[i], &src->sheet[i]);
+	if (StyleSheet_Reserve(dest, dest->length + added,
+			       src->bits_length) != 0) {
+		return -1;
+	}
+	i = dest->length - 1;
+	j = src->length - 1;
+	k = dest->length + added - 1;
+	for (n = dest->bits_length - 1; n >= 0 && j >= 0; --n) {
+		sbits = n < src->bits_length ? src->bits[n] : 0;
+		dbits = dest->bits[n];
+		/* 这段属性键只有目标样式表中有，只需将它们后移 */
+		if (!sbits) {
+			for (mask = dbits; mask; mask &= mask - 1) {
+				dest->styles[k--] = dest->styles[i--];
+			}
+			continue;
+		}
+		for (key = n * 32 + 31; key >= n * 32; --key) {
+			mask = 1u << (key % 32);
+			if (dbits & mask) {
+				dest->styles[k] = dest->styles[i--];
+				if (sbits & mask) {
+					s = &src->styles[j--];
+					if (s->is_valid &&
+					    (replace ||
+					     !dest->styles[k].is_valid)) {
+						DestroyStyle(&dest->styles[k]);
+						MergeStyle(&dest->styles[k], s);
+						++count;
+					}
+				}
+				--k;
+			} else if (sbits & mask) {
+				s = &src->styles[j--];
+				if (s->is_valid) {
+					dest->styles[k].is_valid = FALSE;
+					dest->styles[k].type = LCUI_STYPE_NONE;
+					MergeStyle(&dest->styles[k--], s);
+					dest->bits[n] |= mask;
+					++count;
+				}
+			}
 		}
 	}
-	return 0;
+	dest->length += added;
+	return count;
+}
+
+int StyleSheet_Merge(LCUI_StyleSheet dest, const LCUI_StyleSheetRec *src)
+{
+	return StyleSheet_MergeSheet(dest, src, FALSE) < 0 ? -1 : 0;
 }
 
 int StyleSheet_MergeList(LCUI_StyleSheet ss, LCUI_StyleList list)
@@ -631,58 +861,28 @@ int StyleSheet_MergeList(LCUI_StyleSheet ss, LCUI_StyleList list)
 	LCUI_Style s;
 	LCUI_StyleListNode snode;
 	LinkedListNode *node;
-	size_t size;
-	int i = 0, count = 0;
+	int count = 0;
 
 	for (LinkedList_Each(node, list)) {
 		snode = node->data;
-		if (snode->key > ss->length) {
-			size = sizeof(LCUI_StyleRec) * (snode->key + 1);
-			s = realloc(ss->sheet, size);
-			if (!s) {
-				return -1;
-			}
-			for (i = ss->length; i <= snode->key; ++i) {
-				s[i].is_valid = FALSE;
-			}
-			ss->sheet = s;
-			ss->length = snode->key + 1;
+		if (!snode->style.is_valid) {
+			continue;
+		}
+		s = StyleSheet_AddStyle(ss, snode->key);
+		if (!s) {
+			return -1;
 		}
-		if (!ss->sheet[snode->key].is_valid && snode->style.is_valid) {
-			MergeStyle(&ss->sheet[snode->key], &snode->style);
+		if (!s->is_valid) {
+			MergeStyle(s, &snode->style);
 			++count;
 		}
 	}
-	return (int)count;
+	return count;
 }
 
 int StyleSheet_Replace(LCUI_StyleSheet dest, const LCUI_StyleSheetRec *src)
 {
-	int i;
-	LCUI_Style s;
-	size_t count, size;
-
-	if (src->length > dest->length) {
-		size = sizeof(LCUI_StyleRec) * src->length;
-		s = realloc(dest->sheet, size);
-		if (!s) {
-			return -1;
-		}
-		for (i = dest->length; i < src->length; ++i) {
-			s[i].is_valid = FALSE;
-		}
-		dest->sheet = s;
-		dest->length = src->length;
-	}
-	for (count = 0, i = 0; i < src->length; ++i) {
-		if (!src->sheet[i].is_valid) {
-			continue;
-		}
-		DestroyStyle(&dest->sheet[i]);
-		MergeStyle(&dest->sheet[i], &src->sheet[i]);
-		++count;
-	}
-	return (int)count;
+	return StyleSheet_MergeSheet(dest, src, TRUE);
 }
 
 /** 初始化样式表查找器 */
@@ -911,10 +1111,128 @@ int SelectorNode_GetNames(LCUI_SelectorNode sn, LinkedList *names)
 	return count;
 }
 
+static void SelectorBloomFilter_Add(LCUI_SelectorBloomFilter filter,
+				    unsigned name)
+{
+	/* 原子是连续的小整数，先打散再取高位 */
+	unsigned hash = (name * 2654435761u) >> 16;
+
+	filter->bits[(hash & 0xff) >> 5] |= 1u << (hash & 31);
+	hash >>= 8;
+	filter->bits[(hash & 0xff) >> 5] |= 1u << (hash & 31);
+}
+
+static void SelectorBloomFilter_Merge(LCUI_SelectorBloomFilter dst,
+				      const LCUI_SelectorBloomFilterRec *src)
+{
+	int i;
+
+	for (i = 0; i < SELECTOR_BLOOM_FILTER_SIZE; ++i) {
+		dst->bits[i] |= src->bits[i];
+	}
+}
+
+/** 判断两个过滤器是否可能含有相同的名称 */
+static LCUI_BOOL SelectorBloomFilter_Intersects(
+    const LCUI_SelectorBloomFilterRec *a, const LCUI_SelectorBloomFilterRec *b)
+{
+	int i;
+
+	for (i = 0; i < SELECTOR_BLOOM_FILTER_SIZE; ++i) {
+		if (a->bits[i] & b->bits[i]) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/** 判断过滤器中是否可能含有另一个过滤器记录的全部名称 */
+static LCUI_BOOL SelectorBloomFilter_Contains(
+    const LCUI_SelectorBloomFilterRec *filter,
+    const LCUI_SelectorBloomFilterRec *names)
+{
+	int i;
+
+	for (i = 0; i < SELECTOR_BLOOM_FILTER_SIZE; ++i) {
+		if (names->bits[i] & ~filter->bits[i]) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static void SelectorNames_Sort(unsigned *names, unsigned length)
+{
+	unsigned i, j, name;
+
+	for (i = 1; i < length; ++i) {
+		name = names[i];
+		for (j = i; j > 0 && names[j - 1] > name; --j) {
+			names[j] = names[j - 1];
+		}
+		names[j] = name;
+	}
+}
+
+/** 为结点的每个名称取得原子，然后更新名称过滤器 */
+static int SelectorNode_UpdateAtoms(LCUI_SelectorNode node)
+{
+	size_t i;
+	unsigned *atoms, length = 0;
+
+	if (node->type) {
+		length += 1;
+	}
+	if (node->id) {
+		length += 1;
+	}
+	for (i = 0; node->classes && node->classes[i]; ++i) {
+		length += 1;
+	}
+	for (i = 0; node->status && node->status[i]; ++i) {
+		length += 1;
+	}
+	atoms = NULL;
+	if (length > 0) {
+		atoms = malloc(sizeof(unsigned) * length);
+		if (!atoms) {
+			return -ENOMEM;
+		}
+	}
+	length = 0;
+	if (node->type) {
+		atoms[length++] =
+		    SelectorName(atom_from_str(node->type), NAME_TYPE);
+	}
+	if (node->id) {
+		atoms[length++] = SelectorName(atom_from_str(node->id), NAME_ID);
+	}
+	for (i = 0; node->classes && node->classes[i]; ++i) {
+		atoms[length++] =
+		    SelectorName(atom_from_str(node->classes[i]), NAME_CLASS);
+	}
+	for (i = 0; node->status && node->status[i]; ++i) {
+		atoms[length++] =
+		    SelectorName(atom_from_str(node->status[i]), NAME_STATUS);
+	}
+	SelectorNames_Sort(atoms, length);
+	if (node->atoms) {
+		free(node->atoms);
+	}
+	node->atoms = atoms;
+	node->atoms_length = length;
+	memset(&node->bloom, 0, sizeof(node->bloom));
+	for (i = 0; i < length; ++i) {
+		SelectorBloomFilter_Add(&node->bloom, atoms[i]);
+	}
+	return 0;
+}
+
 int SelectorNode_Update(LCUI_SelectorNode node)
 {
 	size_t i, len = 0;
 	char *fullname;
+	const unsigned char *p;
 
 	node->rank = 0;
 	if (node->id) {
@@ -971,27 +1289,27 @@ int SelectorNode_Update(LCUI_SelectorNode node)
 		free(node->fullname);
 	}
 	node->fullname = fullname;
-	return 0;
+	node->hash = 5381;
+	for (p = (unsigned char *)fullname; p && *p; ++p) {
+		node->hash = ((node->hash << 5) + node->hash) + *p;
+	}
+	return SelectorNode_UpdateAtoms(node);
 }
 
 void Selector_Update(LCUI_Selector s)
 {
 	int i;
-	const unsigned char *p;
 	unsigned int hash = 5381;
+
+	/* 结点在更新时已经计算好了全名的哈希值，这里只需组合它们 */
 	for (i = 0; i < s->length; ++i) {
-		p = (unsigned char *)s->nodes[i]->fullname;
-		while (*p) {
-			hash = ((hash << 5) + hash) + (*p++);
-		}
+		hash = ((hash << 5) + hash) + s->nodes[i]->hash;
 	}
 	s->hash = hash;
 }
 
 int Selector_AppendNode(LCUI_Selector selector, LCUI_SelectorNode node)
 {
-	const unsigned char *p;
-
 	if (selector->length >= MAX_SELECTOR_DEPTH) {
 		Logger_Warning("[css] warning: the number of nodes in the "
 			       "selector has exceeded the %d limit\n",
@@ -1000,10 +1318,7 @@ int Selector_AppendNode(LCUI_Selector selector, LCUI_SelectorNode node)
 	}
 	selector->nodes[selector->length++] = node;
 	selector->nodes[selector->length] = NULL;
-	p = (unsigned char *)node->fullname;
-	while (*p) {
-		selector->hash = ((selector->hash << 5) + selector->hash) + (*p++);
-	}
+	selector->hash = ((selector->hash << 5) + selector->hash) + node->hash;
 	return 0;
 }
 
@@ -1161,21 +1476,60 @@ static void DeleteStyleNode(StyleNode node)
 	free(node);
 }
 
+static void SelectorNamesKey_Init(SelectorNamesKey key, const unsigned *atoms,
+				  unsigned length)
+{
+	unsigned i;
+
+	key->hash = 2166136261u;
+	for (i = 0; i < length; ++i) {
+		key->hash = (key->hash ^ atoms[i]) * 16777619u;
+	}
+	key->atoms = atoms;
+	key->length = length;
+}
+
+static unsigned int SelectorNamesKeyDict_HashFunction(const void *key)
+{
+	return ((const SelectorNamesKeyRec *)key)->hash;
+}
+
+static int SelectorNamesKeyDict_KeyCompare(void *privdata, const void *key1,
+					   const void *key2)
+{
+	const SelectorNamesKeyRec *a = key1;
+	const SelectorNamesKeyRec *b = key2;
+
+	return a->hash == b->hash && a->length == b->length &&
+	       memcmp(a->atoms, b->atoms, sizeof(unsigned) * a->length) == 0;
+}
+
+/** 初始化以名称集合为键的表的类型，键由记录组持有，表不复制也不释放它 */
+static void SelectorNamesKeyDict_InitType(DictType *t)
+{
+	t->hashFunction = SelectorNamesKeyDict_HashFunction;
+	t->keyCompare = SelectorNamesKeyDict_KeyCompare;
+	t->keyDup = NULL;
+	t->valDup = NULL;
+	t->keyDestructor = NULL;
+	t->valDestructor = NULL;
+}
+
 static StyleLink CreateStyleLink(void)
 {
 	StyleLink link = NEW(StyleLinkRec, 1);
-	static DictType t;
 
-	Dict_InitStringCopyKeyType(&t);
 	link->group = NULL;
 	LinkedList_Init(&link->styles);
-	link->parents = Dict_Create(&t, NULL);
+	LinkedList_Init(&link->parent_list);
+	link->parents = Dict_Create(&library.style_parents_dict, NULL);
 	return link;
 }
 
 static void DeleteStyleLink(StyleLink link)
 {
 	Dict_Release(link->parents);
+	LinkedList_Clear(&link->parent_list, NULL);
 	LinkedList_ClearData(&link->styles, (FuncPtr)DeleteStyleNode);
 	free(link->selector);
 	link->selector = NULL;
@@ -1189,6 +1543,8 @@ static StyleLinkGroup CreateStyleLinkGroup(LCUI_SelectorNode snode)
 	StyleLinkGroup group = NEW(StyleLinkGroupRec, 1);
 	group->snode = NEW(LCUI_SelectorNodeRec, 1);
 	SelectorNode_Copy(group->snode, snode);
+	SelectorNamesKey_Init(&group->key, group->snode->atoms,
+			      group->snode->atoms_length);
 	group->name = group->snode->fullname;
 	group->links = Dict_Create(&library.style_link_dict, NULL);
 	return group;
@@ -1213,8 +1569,9 @@ static void InitStyleGroupDict(void)
 {
 	DictType *dt = &library.style_group_dict;
 
-	Dict_InitStringCopyKeyType(dt);
+	SelectorNamesKeyDict_InitType(dt);
 	dt->valDestructor = StyleLinkGroupDestructor;
+	SelectorNamesKeyDict_InitType(&library.style_parents_dict);
 }
 
 static Dict *CreateStyleGroup(void)
@@ -1232,16 +1589,17 @@ static LCUI_StyleList LCUI_SelectStyleList(LCUI_Selector selector,
 					   const char *space)
 {
 	int i, right;
-	StyleLink link;
 	StyleNode snode;
 	StyleLinkGroup slg;
 	LCUI_SelectorNode sn;
-	Dict *group, *parents;
+	StyleLink link, child;
+	SelectorNamesKeyRec key;
+	Dict *group;
 	char buf[MAX_SELECTOR_LEN];
 	char fullname[MAX_SELECTOR_LEN];
 
 	link = NULL;
-	parents = NULL;
+	child = NULL;
 	for (i = 0, right = selector->length - 1; right >= 0; --right, ++i) {
 		group = LinkedList_Get(&library.groups, i);
 		if (!group) {
@@ -1249,10 +1607,11 @@ static LCUI_StyleList LCUI_SelectStyleList(LCUI_Selector selector,
 			LinkedList_Append(&library.groups, group);
 		}
 		sn = selector->nodes[right];
-		slg = Dict_FetchValue(group, sn->fullname);
+		SelectorNamesKey_Init(&key, sn->atoms, sn->atoms_length);
+		slg = Dict_FetchValue(group, &key);
 		if (!slg) {
 			slg = CreateStyleLinkGroup(sn);
-			Dict_Add(group, sn->fullname, slg);
+			Dict_Add(group, &slg->key, slg);
 		}
 		if (i == 0) {
 			strcpy(fullname, "*");
@@ -1274,12 +1633,13 @@ static LCUI_StyleList LCUI_SelectStyleList(LCUI_Selector selector,
 			sprintf(buf, "%s %s", sn->fullname, fullname);
 		}
 		/* 如果有上一级的父链接记录，则将当前链接添加进去 */
-		if (parents) {
-			if (!Dict_FetchValue(parents, sn->fullname)) {
-				Dict_Add(parents, sn->fullname, link);
-			}
+		if (child && !Dict_FetchValue(child->parents, &slg->key)) {
+			Dict_Add(child->parents, &slg->key, link);
+			LinkedList_Append(&child->parent_list, link);
+			SelectorBloomFilter_Merge(&child->parents_bloom,
+						  &sn->bloom);
 		}
-		parents = link->parents;
+		child = link;
 	}
 	if (!link) {
 		return NULL;
@@ -1300,31 +1660,270 @@ static LCUI_StyleList LCUI_SelectStyleList(LCUI_Selector selector,
 	return snode->list;
 }
 
-int LCUI_PutStyleSheet(LCUI_Selector selector, LCUI_StyleSheet in_ss,
-		       const char *space)
+/**
+ * 获取选择器结点中用于索引样式表缓存的名称
+ * 依次选用 ID、类名、类型名和状态名，只要求末尾结点带有该名称的缓存才可能受影响
+ * @returns 结点能匹配任意部件时返回 FALSE
+ */
+static LCUI_BOOL SelectorNode_GetCacheKey(LCUI_SelectorNode sn, char *key)
+{
+	if (sn->id) {
+		snprintf(key, MAX_NAME_LEN, "#%s", sn->id);
+	} else if (sn->classes && sn->classes[0]) {
+		snprintf(key, MAX_NAME_LEN, ".%s", sn->classes[0]);
+	} else if (sn->type && strcmp(sn->type, "*") != 0) {
+		snprintf(key, MAX_NAME_LEN, "%s", sn->type);
+	} else if (sn->status && sn->status[0]) {
+		snprintf(key, MAX_NAME_LEN, ":%s", sn->status[0]);
+	} else {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void StyleSheetCache_AddKey(const char *key, unsigned hash)
 {
-	LCUI_StyleList list;
-	LCUIMutex_Lock(&library.mutex);
-	Dict_Empty(library.cache);
-	list = LCUI_SelectStyleList(selector, space);
-	if (list) {
-		StyleList_Merge(list, in_ss);
+	Dict *set;
+	LinkedList *keys;
+
+	set = Dict_FetchValue(library.cache_index, key);
+	if (!set) {
+		set = Dict_Create(&library.cache_set_dict, NULL);
+		Dict_Add(library.cache_index, (void *)key, set);
 	}
-	LCUIMutex_Unlock(&library.mutex);
-	return 0;
+	if (Dict_Add(set, &hash, NULL) != 0) {
+		return;
+	}
+	keys = Dict_FetchValue(library.cache_keys, &hash);
+	if (!keys) {
+		keys = NEW(LinkedList, 1);
+		LinkedList_Init(keys);
+		Dict_Add(library.cache_keys, &hash, keys);
+	}
+	LinkedList_Append(keys, strdup2(key));
 }
 
-static size_t StyleLink_GetStyleSheets(StyleLink link, LinkedList *outlist)
+/** 从缓存所在的全部索引中移除它的 hash 值，除了正在清除的 except_key */
+static void StyleSheetCache_RemoveKeys(unsigned hash, const char *except_key)
+{
+	Dict *set;
+	LinkedList *keys;
+	LinkedListNode *node;
+
+	keys = Dict_FetchValue(library.cache_keys, &hash);
+	if (!keys) {
+		return;
+	}
+	for (LinkedList_Each(node, keys)) {
+		if (strcmp(node->data, except_key) == 0) {
+			continue;
+		}
+		set = Dict_FetchValue(library.cache_index, node->data);
+		if (!set) {
+			continue;
+		}
+		Dict_Delete(set, &hash);
+		if (Dict_Size(set) < 1) {
+			Dict_Delete(library.cache_index, node->data);
+		}
+	}
+	Dict_Delete(library.cache_keys, &hash);
+}
+
+/** 以选择器末尾结点的各个名称索引缓存的样式表 */
+static void StyleSheetCache_AddIndex(LCUI_Selector s)
 {
 	size_t i;
-	LCUI_BOOL found;
-	StyleNode snode, out_snode;
-	LinkedListNode *node, *out_node;
+	LCUI_SelectorNode sn;
+	char key[MAX_NAME_LEN];
 
-	if (!outlist) {
-		return link->styles.length;
+	if (s->length < 1) {
+		return;
 	}
-	for (LinkedList_Each(node, &link->styles)) {
+	sn = s->nodes[s->length - 1];
+	if (sn->id) {
+		snprintf(key, MAX_NAME_LEN, "#%s", sn->id);
+		StyleSheetCache_AddKey(key, s->hash);
+	}
+	if (sn->type) {
+		StyleSheetCache_AddKey(sn->type, s->hash);
+	}
+	for (i = 0; sn->classes && sn->classes[i]; ++i) {
+		snprintf(key, MAX_NAME_LEN, ".%s", sn->classes[i]);
+		StyleSheetCache_AddKey(key, s->hash);
+	}
+	for (i = 0; sn->status && sn->status[i]; ++i) {
+		snprintf(key, MAX_NAME_LEN, ":%s", sn->status[i]);
+		StyleSheetCache_AddKey(key, s->hash);
+	}
+}
+
+static void StyleSheetCache_Clear(void)
+{
+	Dict_Empty(library.cache);
+	Dict_Empty(library.cache_index);
+	Dict_Empty(library.cache_keys);
+	library.cache_version += 1;
+}
+
+static void StyleSheetCache_ClearByKey(const char *key)
+{
+	Dict *set;
+	DictEntry *entry;
+	DictIterator *iter;
+
+	set = Dict_FetchValue(library.cache_index, key);
+	if (!set) {
+		return;
+	}
+	iter = Dict_GetIterator(set);
+	while ((entry = Dict_Next(iter))) {
+		StyleSheetCache_RemoveKeys(
+		    *(unsigned *)DictEntry_GetKey(entry), key);
+		Dict_Delete(library.cache, DictEntry_GetKey(entry));
+	}
+	Dict_ReleaseIterator(iter);
+	Dict_Delete(library.cache_index, key);
+	library.cache_version += 1;
+}
+
+unsigned LCUI_GetStyleSheetCacheVersion(void)
+{
+	return library.cache_version;
+}
+
+size_t LCUI_GetStyleSheetCacheIndexSize(const char *name)
+{
+	Dict *set;
+
+	set = Dict_FetchValue(library.cache_index, name);
+	return set ? Dict_Size(set) : 0;
+}
+
+/** 清除可能受到新样式规则影响的缓存 */
+static void StyleSheetCache_Invalidate(LCUI_Selector selector)
+{
+	char key[MAX_NAME_LEN];
+
+	if (selector->length < 1 ||
+	    !SelectorNode_GetCacheKey(selector->nodes[selector->length - 1],
+				      key)) {
+		if (library.batch_level > 0) {
+			library.dirty_all = TRUE;
+		} else {
+			StyleSheetCache_Clear();
+		}
+		return;
+	}
+	if (library.batch_level > 0) {
+		if (!library.dirty_all) {
+			LinkedList_Append(&library.dirty_names, strdup2(key));
+		}
+	} else {
+		StyleSheetCache_ClearByKey(key);
+	}
+}
+
+void LCUI_BeginPutStyleSheets(void)
+{
+	LCUIMutex_Lock(&library.mutex);
+	library.batch_level += 1;
+	LCUIMutex_Unlock(&library.mutex);
+}
+
+void LCUI_EndPutStyleSheets(void)
+{
+	LinkedListNode *node;
+
+	LCUIMutex_Lock(&library.mutex);
+	if (library.batch_level < 1 || --library.batch_level > 0) {
+		LCUIMutex_Unlock(&library.mutex);
+		return;
+	}
+	if (library.dirty_all) {
+		StyleSheetCache_Clear();
+	} else {
+		for (LinkedList_Each(node, &library.dirty_names)) {
+			StyleSheetCache_ClearByKey(node->data);
+		}
+	}
+	LinkedList_Clear(&library.dirty_names, free);
+	library.dirty_all = FALSE;
+	LCUIMutex_Unlock(&library.mutex);
+}
+
+void LCUI_LockCSSLibrary(void)
+{
+	LCUIMutex_Lock(&library.mutex);
+}
+
+void LCUI_UnlockCSSLibrary(void)
+{
+	LCUIMutex_Unlock(&library.mutex);
+}
+
+/** 记录选择器中除了最后一个结点以外的结点所用到的类和状态名称 */
+static void AncestorNames_Add(LCUI_Selector selector)
+{
+	int i, j;
+	LCUI_SelectorNode sn;
+	char key[MAX_NAME_LEN];
+
+	for (i = 0; i < selector->length - 1; ++i) {
+		sn = selector->nodes[i];
+		for (j = 0; sn->classes && sn->classes[j]; ++j) {
+			snprintf(key, MAX_NAME_LEN, ".%s", sn->classes[j]);
+			if (!Dict_Find(library.ancestor_names, key)) {
+				Dict_Add(library.ancestor_names, key, NULL);
+			}
+		}
+		for (j = 0; sn->status && sn->status[j]; ++j) {
+			snprintf(key, MAX_NAME_LEN, ":%s", sn->status[j]);
+			if (!Dict_Find(library.ancestor_names, key)) {
+				Dict_Add(library.ancestor_names, key, NULL);
+			}
+		}
+	}
+}
+
+LCUI_BOOL LCUI_IsAncestorSelectorName(char prefix, const char *name)
+{
+	char key[MAX_NAME_LEN];
+	LCUI_BOOL found;
+
+	snprintf(key, MAX_NAME_LEN, "%c%s", prefix, name);
+	LCUIMutex_Lock(&library.mutex);
+	found = Dict_Find(library.ancestor_names, key) != NULL;
+	LCUIMutex_Unlock(&library.mutex);
+	return found;
+}
+
+int LCUI_PutStyleSheet(LCUI_Selector selector, LCUI_StyleSheet in_ss,
+		       const char *space)
+{
+	LCUI_StyleList list;
+	LCUIMutex_Lock(&library.mutex);
+	StyleSheetCache_Invalidate(selector);
+	AncestorNames_Add(selector);
+	list = LCUI_SelectStyleList(selector, space);
+	if (list) {
+		StyleList_Merge(list, in_ss);
+	}
+	LCUIMutex_Unlock(&library.mutex);
+	return 0;
+}
+
+static size_t StyleLink_GetStyleSheets(StyleLink link, LinkedList *outlist)
+{
+	size_t i;
+	LCUI_BOOL found;
+	StyleNode snode, out_snode;
+	LinkedListNode *node, *out_node;
+
+	if (!outlist) {
+		return link->styles.length;
+	}
+	for (LinkedList_Each(node, &link->styles)) {
 		i = 0;
 		found = FALSE;
 		snode = node->data;
@@ -1353,72 +1952,231 @@ static size_t StyleLink_GetStyleSheets(StyleLink link, LinkedList *outlist)
 	return link->styles.length;
 }
 
-static size_t LCUI_FindStyleSheetFromLink(StyleLink link, LCUI_Selector s,
-					  int i, LinkedList *list)
+/** 判断父级链接中是否有可能与名称过滤器匹配的 */
+static LCUI_BOOL StyleLink_MayMatchParent(StyleLink link,
+					  const LCUI_SelectorBloomFilterRec *f)
 {
-	size_t count = 0;
 	StyleLink parent;
-	LinkedList names;
 	LinkedListNode *node;
-	LCUI_SelectorNode sn;
 
-	LinkedList_Init(&names);
-	count += StyleLink_GetStyleSheets(link, list);
-	while (--i >= 0) {
-		sn = s->nodes[i];
-		SelectorNode_GetNames(sn, &names);
-		for (LinkedList_Each(node, &names)) {
-			parent = Dict_FetchValue(link->parents, node->data);
-			if (!parent) {
-				continue;
+	if (!SelectorBloomFilter_Intersects(f, &link->parents_bloom)) {
+		return FALSE;
+	}
+	/* 父级链接较多时逐个检查的开销比直接查表还大，交给后面的查表处理 */
+	if (link->parent_list.length > MAX_CHECKED_PARENTS) {
+		return TRUE;
+	}
+	for (LinkedList_Each(node, &link->parent_list)) {
+		parent = node->data;
+		if (SelectorBloomFilter_Contains(
+			f, &parent->group->snode->bloom)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/** 查找记录时对每条记录调用的函数 */
+typedef size_t (*SelectorNamesHandler)(void *, void *);
+
+/**
+ * 在以名称集合为键的表中查找键为 names 的非空子集的记录
+ * 名称较少时逐个生成子集去查表，子集比表中的记录还多时改为遍历表
+ */
+static size_t SelectorNames_EachSubset(Dict *dict, const unsigned *names,
+				       unsigned length,
+				       SelectorNamesHandler handler, void *arg)
+{
+	void *value;
+	size_t count = 0;
+	unsigned i, n, mask;
+	unsigned subset[MAX_SUBSET_NAMES];
+	SelectorNamesKeyRec key;
+	SelectorNamesKey entry_key;
+	DictEntry *entry;
+	DictIterator *iter;
+
+	if (length < 1 || Dict_Size(dict) < 1) {
+		return 0;
+	}
+	if (length <= MAX_SUBSET_NAMES &&
+	    (1ul << length) - 1 <= Dict_Size(dict)) {
+		for (mask = 1; mask < 1u << length; ++mask) {
+			for (i = 0, n = 0; i < length; ++i) {
+				if (mask & (1u << i)) {
+					subset[n++] = names[i];
+				}
+			}
+			SelectorNamesKey_Init(&key, subset, n);
+			value = Dict_FetchValue(dict, &key);
+			if (value) {
+				count += handler(value, arg);
 			}
-			count +=
-			    LCUI_FindStyleSheetFromLink(parent, s, i, list);
 		}
-		LinkedList_Clear(&names, free);
+		return count;
+	}
+	iter = Dict_GetIterator(dict);
+	while ((entry = Dict_Next(iter))) {
+		entry_key = DictEntry_GetKey(entry);
+		if (entry_key->length > 0 &&
+		    SelectorNames_Contains(names, length, entry_key->atoms,
+					   entry_key->length)) {
+			count += handler(DictEntry_GetVal(entry), arg);
+		}
 	}
+	Dict_ReleaseIterator(iter);
 	return count;
 }
 
+/** 样式表查找器 */
+typedef struct StyleSheetFinderRec_ {
+	int i;					/**< 当前结点在选择器中的位置 */
+	LCUI_Selector selector;			/**< 要匹配的选择器 */
+	LinkedList *list;			/**< 用于保存找到的样式表 */
+
+	/**
+	 * 选择器中末尾结点之前的全部结点的名称过滤器
+	 * 父级链接中的名称不在过滤器中时，说明祖先结点不可能匹配，不必再逐个检查
+	 */
+	LCUI_SelectorBloomFilterRec ancestors;
+} StyleSheetFinderRec, *StyleSheetFinder;
+
+/** 从样式链接中查找匹配选择器第 i 个结点及其祖先结点的样式表 */
+static size_t StyleSheetFinder_FindFromLink(void *data, void *arg)
+{
+	int i;
+	size_t count = 0;
+	StyleLink link = data;
+	StyleSheetFinder finder = arg;
+	LCUI_SelectorNode sn;
+
+	count += StyleLink_GetStyleSheets(link, finder->list);
+	if (link->parent_list.length < 1 ||
+	    !StyleLink_MayMatchParent(link, &finder->ancestors)) {
+		return count;
+	}
+	for (i = finder->i; --finder->i >= 0;) {
+		sn = finder->selector->nodes[finder->i];
+		if (!StyleLink_MayMatchParent(link, &sn->bloom)) {
+			continue;
+		}
+		count += SelectorNames_EachSubset(
+		    link->parents, sn->atoms, sn->atoms_length,
+		    StyleSheetFinder_FindFromLink, finder);
+	}
+	finder->i = i;
+	return count;
+}
+
+/** 从样式链接记录组中查找匹配选择器的样式表 */
+static size_t StyleSheetFinder_FindFromGroup(void *data, void *arg)
+{
+	size_t count = 0;
+	StyleLinkGroup slg = data;
+	DictEntry *entry;
+	DictIterator *iter;
+
+	iter = Dict_GetIterator(slg->links);
+	while ((entry = Dict_Next(iter))) {
+		count +=
+		    StyleSheetFinder_FindFromLink(DictEntry_GetVal(entry), arg);
+	}
+	Dict_ReleaseIterator(iter);
+	return count;
+}
+
+/**
+ * 将选择器结点的全名转换为名称集合
+ * @returns 名称数量，有名称不在原子表中时返回 -1，说明不会有匹配的记录
+ */
+static int SelectorNames_Parse(const char *str, unsigned *names,
+			       unsigned max_length)
+{
+	size_t len;
+	atom_t atom;
+	unsigned length = 0;
+	int kind = NAME_TYPE;
+	char name[MAX_NAME_LEN];
+
+	while (*str) {
+		len = strcspn(str, "#.:");
+		if (len > 0) {
+			if (len >= MAX_NAME_LEN || length >= max_length) {
+				return -1;
+			}
+			memcpy(name, str, len);
+			name[len] = 0;
+			atom = atom_find(name);
+			if (atom == ATOM_NONE) {
+				return -1;
+			}
+			names[length++] = SelectorName(atom, kind);
+			str += len;
+		}
+		switch (*str) {
+		case '#':
+			kind = NAME_ID;
+			break;
+		case '.':
+			kind = NAME_CLASS;
+			break;
+		case ':':
+			kind = NAME_STATUS;
+			break;
+		default:
+			continue;
+		}
+		++str;
+	}
+	SelectorNames_Sort(names, length);
+	return (int)length;
+}
+
 int LCUI_FindStyleSheetFromGroup(int group, const char *name, LCUI_Selector s,
 				 LinkedList *list)
 {
-	int i;
+	int i, length;
 	size_t count;
 	Dict *groups;
 	StyleLinkGroup slg;
-	LinkedListNode *node;
-	LinkedList names;
+	StyleSheetFinderRec finder;
+	SelectorNamesKeyRec key;
+	LCUI_SelectorNode sn;
+	unsigned names[MAX_SUBSET_NAMES];
 
 	groups = LinkedList_Get(&library.groups, group);
 	if (!groups || s->length < 1) {
 		return 0;
 	}
-	count = 0;
-	i = s->length - 1;
-	LinkedList_Init(&names);
+	finder.list = list;
+	finder.selector = s;
+	finder.i = s->length - 1;
+	memset(&finder.ancestors, 0, sizeof(finder.ancestors));
+	for (i = 0; i < finder.i; ++i) {
+		SelectorBloomFilter_Merge(&finder.ancestors,
+					  &s->nodes[i]->bloom);
+	}
 	if (name) {
-		LinkedList_Append(&names, strdup2(name));
-	} else {
-		SelectorNode_GetNames(s->nodes[i], &names);
-		LinkedList_Append(&names, strdup2("*"));
-	}
-	for (LinkedList_Each(node, &names)) {
-		DictEntry *entry;
-		DictIterator *iter;
-		char *name = node->data;
-		slg = Dict_FetchValue(groups, name);
-		if (!slg) {
-			continue;
+		length = SelectorNames_Parse(name, names, MAX_SUBSET_NAMES);
+		if (length < 0) {
+			return 0;
 		}
-		iter = Dict_GetIterator(slg->links);
-		while ((entry = Dict_Next(iter))) {
-			StyleLink link = DictEntry_GetVal(entry);
-			count += LCUI_FindStyleSheetFromLink(link, s, i, list);
+		SelectorNamesKey_Init(&key, names, length);
+		slg = Dict_FetchValue(groups, &key);
+		if (!slg) {
+			return 0;
 		}
-		Dict_ReleaseIterator(iter);
+		return (int)StyleSheetFinder_FindFromGroup(slg, &finder);
+	}
+	sn = s->nodes[finder.i];
+	count = SelectorNames_EachSubset(groups, sn->atoms, sn->atoms_length,
+					 StyleSheetFinder_FindFromGroup,
+					 &finder);
+	SelectorNamesKey_Init(&key, &library.universal_name, 1);
+	slg = Dict_FetchValue(groups, &key);
+	if (slg) {
+		count += StyleSheetFinder_FindFromGroup(slg, &finder);
 	}
-	LinkedList_Clear(&names, free);
 	return (int)count;
 }
 
@@ -1501,15 +2259,17 @@ void LCUI_PrintStyleList(LCUI_StyleList list)
 
 void LCUI_PrintStyleSheet(LCUI_StyleSheet ss)
 {
-	int key;
-	LCUI_Style s;
+	int i, key;
 
-	for (key = 0; key < ss->length; ++key) {
-		s = &ss->sheet[key];
-		if (s->is_valid) {
+	for (i = 0, key = 0; i < ss->length; ++key) {
+		if (!StyleSheet_HasKey(ss, key)) {
+			continue;
+		}
+		if (ss->styles[i].is_valid) {
 			PrintStyleName(key);
-			PrintStyleValue(s);
+			PrintStyleValue(&ss->styles[i]);
 		}
+		++i;
 	}
 }
 
@@ -1601,6 +2361,7 @@ LCUI_CachedStyleSheet LCUI_GetCachedStyleSheet(LCUI_Selector s)
 	}
 	LinkedList_Clear(&list, NULL);
 	Dict_Add(library.cache, &s->hash, ss);
+	StyleSheetCache_AddIndex(s);
 	return ss;
 }
 
@@ -1638,11 +2399,703 @@ void LCUI_PrintStyleSheetsBySelector(LCUI_Selector s)
 	Logger_Debug("selector(%u) stylesheets end\n", s->hash);
 }
 
+/**
+ * 预编译样式表的文件头，后面依次是样式规则列表、样式列表、扩展属性的名称列表
+ * 和字符串表
+ * 与字形缓存文件一样，各个字段都按本机的字节序存放。内置属性的键直接存放，
+ * 而扩展属性（例如 word-break）的键取决于注册的顺序，因此按名称存放，在载入
+ * 时重新查找。
+ */
+typedef struct CompiledCSSHeaderRec_ {
+	char magic[8];
+	uint32_t version;
+	uint32_t key_total;		/**< 内置属性的数量 */
+	uint32_t rules_length;		/**< 样式规则的数量 */
+	uint32_t styles_length;		/**< 样式的数量 */
+	uint32_t keys_length;		/**< 扩展属性的数量 */
+	uint32_t strings_size;		/**< 字符串表的大小 */
+} CompiledCSSHeaderRec;
+
+/** 样式规则，按它们被添加到样式库中的顺序存放 */
+typedef struct CompiledCSSRuleRec_ {
+	uint32_t selector;		/**< 选择器在字符串表中的偏移量 */
+	uint32_t space;			/**< 所属空间在字符串表中的偏移量 */
+	uint32_t styles;		/**< 第一个样式的序号 */
+	uint32_t length;		/**< 样式的数量 */
+} CompiledCSSRuleRec, *CompiledCSSRule;
+
+/** 样式，字符串值存放的是它在字符串表中的偏移量 */
+typedef struct CompiledCSSStyleRec_ {
+	int32_t key;			/**< 属性键，扩展属性从 key_total 开始编号 */
+	int32_t type;			/**< 值的类型 */
+	union {
+		int32_t val_int;
+		float val_float;
+		uint32_t val_string;
+	};
+} CompiledCSSStyleRec, *CompiledCSSStyle;
+
+/** 需要保存的样式规则 */
+typedef struct CompiledCSSItemRec_ {
+	StyleNode snode;
+	uint32_t selector;
+} CompiledCSSItemRec, *CompiledCSSItem;
+
+/** 生成预编译样式表时用到的数据 */
+typedef struct CompiledCSSWriterRec_ {
+	CompiledCSSItem items;
+	size_t items_length;
+	CompiledCSSRule rules;
+	size_t rules_length;
+	CompiledCSSStyle styles;
+	size_t styles_length;
+	uint32_t *keys;			/**< 扩展属性名称在字符串表中的偏移量 */
+	int *key_index;			/**< 扩展属性在名称列表中的序号 */
+	size_t keys_length;
+	char *strings;			/**< 字符串表 */
+	size_t strings_size;
+	size_t strings_capacity;
+	Dict *string_offsets;		/**< 已添加的字符串，用于合并相同的字符串 */
+	DictType string_offsets_dict;
+	size_t skipped;			/**< 无法保存而被跳过的样式数量 */
+} CompiledCSSWriterRec, *CompiledCSSWriter;
+
+#define COMPILED_CSS_VERSION 1
+#define COMPILED_CSS_NONE 0xffffffff
+
+static void CompiledCSSWriter_Init(CompiledCSSWriter writer)
+{
+	memset(writer, 0, sizeof(CompiledCSSWriterRec));
+	Dict_InitStringCopyKeyType(&writer->string_offsets_dict);
+	writer->string_offsets =
+	    Dict_Create(&writer->string_offsets_dict, NULL);
+}
+
+static void CompiledCSSWriter_Destroy(CompiledCSSWriter writer)
+{
+	Dict_Release(writer->string_offsets);
+	free(writer->items);
+	free(writer->rules);
+	free(writer->styles);
+	free(writer->keys);
+	free(writer->key_index);
+	free(writer->strings);
+}
+
+/** 将字符串添加至字符串表，相同的字符串只存一份 */
+static uint32_t CompiledCSSWriter_AddString(CompiledCSSWriter writer,
+					    const char *str)
+{
+	char *strings;
+	size_t len, capacity;
+	uint32_t offset;
+	void *val;
+
+	if (!str) {
+		return COMPILED_CSS_NONE;
+	}
+	val = Dict_FetchValue(writer->string_offsets, str);
+	if (val) {
+		return (uint32_t)((size_t)val - 1);
+	}
+	len = strlen(str) + 1;
+	if (writer->strings_size + len > writer->strings_capacity) {
+		capacity = max(writer->strings_capacity * 2,
+			       writer->strings_size + len);
+		strings = realloc(writer->strings, capacity);
+		if (!strings) {
+			return COMPILED_CSS_NONE;
+		}
+		writer->strings = strings;
+		writer->strings_capacity = capacity;
+	}
+	offset = (uint32_t)writer->strings_size;
+	memcpy(writer->strings + offset, str, len);
+	writer->strings_size += len;
+	Dict_Add(writer->string_offsets, (void *)str,
+		 (void *)((size_t)offset + 1));
+	return offset;
+}
+
+static int CompiledCSSWriter_AddItem(CompiledCSSWriter writer,
+				     StyleNode snode, const char *selector)
+{
+	size_t n = writer->items_length + 1;
+	CompiledCSSItem items;
+
+	items = realloc(writer->items, sizeof(CompiledCSSItemRec) * n);
+	if (!items) {
+		return -ENOMEM;
+	}
+	writer->items = items;
+	items[n - 1].snode = snode;
+	items[n - 1].selector = CompiledCSSWriter_AddString(writer, selector);
+	if (items[n - 1].selector == COMPILED_CSS_NONE) {
+		return -ENOMEM;
+	}
+	writer->items_length = n;
+	return 0;
+}
+
+/** 收集样式组中属于指定空间的样式规则 */
+static int CompiledCSSWriter_CollectGroup(CompiledCSSWriter writer,
+					  Dict *group, int level,
+					  const char *space)
+{
+	int ret = 0;
+	StyleLink link;
+	StyleNode snode;
+	StyleLinkGroup slg;
+	DictEntry *entry, *link_entry;
+	DictIterator *iter, *link_iter;
+	LinkedListNode *node;
+	char selector[MAX_SELECTOR_LEN];
+
+	iter = Dict_GetIterator(group);
+	while (ret == 0 && (entry = Dict_Next(iter))) {
+		slg = DictEntry_GetVal(entry);
+		if (!slg->name) {
+			continue;
+		}
+		link_iter = Dict_GetIterator(slg->links);
+		while (ret == 0 && (link_entry = Dict_Next(link_iter))) {
+			link = DictEntry_GetVal(link_entry);
+			/* 链接记录的选择器是右边的结点，拼上当前结点即可还原 */
+			if (level == 0) {
+				strcpy(selector, slg->name);
+			} else {
+				snprintf(selector, MAX_SELECTOR_LEN, "%s %s",
+					 slg->name, link->selector);
+			}
+			for (LinkedList_Each(node, &link->styles)) {
+				snode = node->data;
+				if (space && (!snode->space ||
+					      strcmp(snode->space, space) != 0)) {
+					continue;
+				}
+				ret = CompiledCSSWriter_AddItem(writer, snode,
+								selector);
+				if (ret != 0) {
+					break;
+				}
+			}
+		}
+		Dict_ReleaseIterator(link_iter);
+	}
+	Dict_ReleaseIterator(iter);
+	return ret;
+}
+
+static int CompareCompiledCSSItem(const void *a, const void *b)
+{
+	const CompiledCSSItemRec *item_a = a;
+	const CompiledCSSItemRec *item_b = b;
+
+	return item_a->snode->batch_num - item_b->snode->batch_num;
+}
+
+/**
+ * 获取属性键在预编译样式表中的编号，扩展属性的名称会被添加至名称列表
+ * @returns 属性没有名称时返回 -1，内存不足时返回 -ENOMEM
+ */
+static int CompiledCSSWriter_GetKey(CompiledCSSWriter writer, int key)
+{
+	int i = key - STYLE_KEY_TOTAL;
+	uint32_t offset;
+	const char *name;
+
+	if (key < STYLE_KEY_TOTAL) {
+		return key;
+	}
+	if (i >= library.count - STYLE_KEY_TOTAL) {
+		return -1;
+	}
+	if (writer->key_index[i] < 0) {
+		name = LCUI_GetStyleName(key);
+		if (!name) {
+			return -1;
+		}
+		offset = CompiledCSSWriter_AddString(writer, name);
+		if (offset == COMPILED_CSS_NONE) {
+			return -ENOMEM;
+		}
+		writer->keys[writer->keys_length] = offset;
+		writer->key_index[i] = (int)writer->keys_length++;
+	}
+	return STYLE_KEY_TOTAL + writer->key_index[i];
+}
+
+/**
+ * 将样式转换为预编译样式表中的样式
+ * @returns 样式无法保存时返回 -1，内存不足时返回 -ENOMEM
+ */
+static int CompiledCSSWriter_AddStyle(CompiledCSSWriter writer, int key,
+				      LCUI_Style s)
+{
+	size_t len;
+	char *str;
+	CompiledCSSStyle style;
+
+	style = &writer->styles[writer->styles_length];
+	style->key = CompiledCSSWriter_GetKey(writer, key);
+	style->type = s->type;
+	style->val_int = 0;
+	if (style->key < 0) {
+		return style->key;
+	}
+	switch (s->type) {
+	case LCUI_STYPE_SCALE:
+	case LCUI_STYPE_PX:
+	case LCUI_STYPE_PT:
+	case LCUI_STYPE_DIP:
+	case LCUI_STYPE_SP:
+		style->val_float = s->value;
+		break;
+	case LCUI_STYPE_COLOR:
+		style->val_int = s->color.value;
+		break;
+	case LCUI_STYPE_STRING:
+		if (!s->string) {
+			return -1;
+		}
+		style->val_string = CompiledCSSWriter_AddString(writer,
+								s->string);
+		if (style->val_string == COMPILED_CSS_NONE) {
+			return -ENOMEM;
+		}
+		break;
+	case LCUI_STYPE_WSTRING:
+		if (!s->wstring) {
+			return -1;
+		}
+		len = LCUI_EncodeUTF8String(NULL, s->wstring, 0);
+		str = malloc(len + 1);
+		if (!str) {
+			return -ENOMEM;
+		}
+		LCUI_EncodeUTF8String(str, s->wstring, len + 1);
+		style->val_string = CompiledCSSWriter_AddString(writer, str);
+		free(str);
+		if (style->val_string == COMPILED_CSS_NONE) {
+			return -ENOMEM;
+		}
+		break;
+	case LCUI_STYPE_IMAGE:
+		/* 图像是运行时才有的数据，无法保存 */
+		return -1;
+	default:
+		style->val_int = s->val_int;
+		break;
+	}
+	writer->styles_length += 1;
+	return 0;
+}
+
+/** 按样式规则被添加的顺序生成样式规则列表和样式列表 */
+static int CompiledCSSWriter_Build(CompiledCSSWriter writer)
+{
+	int ret;
+	size_t i, n = 0;
+	const char *name;
+	int key_total = library.count - STYLE_KEY_TOTAL;
+	LinkedListNode *node;
+	LCUI_StyleListNode snode;
+	CompiledCSSRule rule;
+
+	qsort(writer->items, writer->items_length, sizeof(CompiledCSSItemRec),
+	      CompareCompiledCSSItem);
+	for (i = 0; i < writer->items_length; ++i) {
+		n += writer->items[i].snode->list->length;
+	}
+	writer->rules = malloc(sizeof(CompiledCSSRuleRec) *
+			       (writer->items_length + 1));
+	writer->styles = malloc(sizeof(CompiledCSSStyleRec) * (n + 1));
+	writer->keys = malloc(sizeof(uint32_t) * (key_total + 1));
+	writer->key_index = malloc(sizeof(int) * (key_total + 1));
+	if (!writer->rules || !writer->styles || !writer->keys ||
+	    !writer->key_index) {
+		return -ENOMEM;
+	}
+	memset(writer->key_index, -1, sizeof(int) * (key_total + 1));
+	for (i = 0; i < writer->items_length; ++i) {
+		rule = &writer->rules[writer->rules_length++];
+		rule->selector = writer->items[i].selector;
+		rule->space = CompiledCSSWriter_AddString(
+		    writer, writer->items[i].snode->space);
+		rule->styles = (uint32_t)writer->styles_length;
+		for (LinkedList_Each(node, writer->items[i].snode->list)) {
+			snode = node->data;
+			if (!snode->style.is_valid) {
+				continue;
+			}
+			ret = CompiledCSSWriter_AddStyle(writer, snode->key,
+							 &snode->style);
+			if (ret == -ENOMEM) {
+				return ret;
+			}
+			if (ret != 0) {
+				name = LCUI_GetStyleName(snode->key);
+				Logger_Warning("[css] warning: the style %s "
+					       "cannot be compiled, skipped\n",
+					       name ? name : "(unknown)");
+				writer->skipped += 1;
+			}
+		}
+		rule->length = (uint32_t)writer->styles_length - rule->styles;
+	}
+	return 0;
+}
+
+static int CompiledCSSWriter_Collect(CompiledCSSWriter writer,
+				     const char *space)
+{
+	int ret, level = 0;
+	LinkedListNode *node;
+
+	for (LinkedList_Each(node, &library.groups)) {
+		ret = CompiledCSSWriter_CollectGroup(writer, node->data,
+						     level++, space);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+	return CompiledCSSWriter_Build(writer);
+}
+
+static int CompiledCSSWriter_Write(CompiledCSSWriter writer, FILE *fp)
+{
+	CompiledCSSHeaderRec header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LCUI_COMPILED_CSS_MAGIC, 8);
+	header.version = COMPILED_CSS_VERSION;
+	header.key_total = STYLE_KEY_TOTAL;
+	header.rules_length = (uint32_t)writer->rules_length;
+	header.styles_length = (uint32_t)writer->styles_length;
+	header.keys_length = (uint32_t)writer->keys_length;
+	header.strings_size = (uint32_t)writer->strings_size;
+	if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+	    fwrite(writer->rules, sizeof(CompiledCSSRuleRec),
+		   writer->rules_length, fp) != writer->rules_length ||
+	    fwrite(writer->styles, sizeof(CompiledCSSStyleRec),
+		   writer->styles_length, fp) != writer->styles_length ||
+	    fwrite(writer->keys, sizeof(uint32_t), writer->keys_length, fp) !=
+		writer->keys_length ||
+	    fwrite(writer->strings, 1, writer->strings_size, fp) !=
+		writer->strings_size) {
+		return -1;
+	}
+	return 0;
+}
+
+int LCUI_SaveCompiledCSS(const char *filepath, const char *space)
+{
+	int ret;
+	FILE *fp;
+	CompiledCSSWriterRec writer;
+
+	CompiledCSSWriter_Init(&writer);
+	LCUIMutex_Lock(&library.mutex);
+	ret = CompiledCSSWriter_Collect(&writer, space);
+	LCUIMutex_Unlock(&library.mutex);
+	if (ret == 0) {
+		fp = fopen(filepath, "wb");
+		if (fp) {
+			ret = CompiledCSSWriter_Write(&writer, fp);
+			fclose(fp);
+		} else {
+			ret = -1;
+		}
+	}
+	if (ret == 0) {
+		ret = (int)writer.skipped;
+	}
+	CompiledCSSWriter_Destroy(&writer);
+	return ret;
+}
+
+/** 预编译样式表的内容，各个列表都直接指向载入的数据 */
+typedef struct CompiledCSSRec_ {
+	const CompiledCSSRuleRec *rules;
+	size_t rules_length;
+	const CompiledCSSStyleRec *styles;
+	size_t styles_length;
+	const uint32_t *keys;
+	size_t keys_length;
+	const char *strings;
+	size_t strings_size;
+} CompiledCSSRec, *CompiledCSS;
+
+/** 检查预编译样式表的格式，并定位其中的各个列表 */
+static int CompiledCSS_Init(CompiledCSS css, const char *data, size_t size)
+{
+	size_t n;
+	CompiledCSSHeaderRec header;
+
+	if (size < sizeof(header)) {
+		return -2;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, LCUI_COMPILED_CSS_MAGIC, 8) != 0 ||
+	    header.version != COMPILED_CSS_VERSION ||
+	    header.key_total != STYLE_KEY_TOTAL) {
+		return -2;
+	}
+	data += sizeof(header);
+	size -= sizeof(header);
+	css->rules_length = header.rules_length;
+	css->styles_length = header.styles_length;
+	css->keys_length = header.keys_length;
+	css->strings_size = header.strings_size;
+	if (css->rules_length > size / sizeof(CompiledCSSRuleRec)) {
+		return -2;
+	}
+	n = css->rules_length * sizeof(CompiledCSSRuleRec);
+	css->rules = (const CompiledCSSRuleRec *)data;
+	data += n;
+	size -= n;
+	if (css->styles_length > size / sizeof(CompiledCSSStyleRec)) {
+		return -2;
+	}
+	n = css->styles_length * sizeof(CompiledCSSStyleRec);
+	css->styles = (const CompiledCSSStyleRec *)data;
+	data += n;
+	size -= n;
+	if (css->keys_length > size / sizeof(uint32_t)) {
+		return -2;
+	}
+	n = css->keys_length * sizeof(uint32_t);
+	css->keys = (const uint32_t *)data;
+	data += n;
+	size -= n;
+	/* 字符串表必须以结束符结尾，这样表中的任意偏移量都是有效的字符串 */
+	if (css->strings_size != size ||
+	    (size > 0 && data[size - 1] != 0)) {
+		return -2;
+	}
+	css->strings = data;
+	return 0;
+}
+
+static const char *CompiledCSS_GetString(CompiledCSS css, uint32_t offset)
+{
+	if (offset >= css->strings_size) {
+		return NULL;
+	}
+	return css->strings + offset;
+}
+
+/** 将扩展属性的名称映射为当前的属性键，未注册的属性映射为 -1 */
+static int *CompiledCSS_MapKeys(CompiledCSS css)
+{
+	size_t i;
+	int key, *keys;
+	const char *name, *key_name;
+
+	keys = malloc(sizeof(int) * (css->keys_length + 1));
+	if (!keys) {
+		return NULL;
+	}
+	for (i = 0; i < css->keys_length; ++i) {
+		keys[i] = -1;
+		name = CompiledCSS_GetString(css, css->keys[i]);
+		if (!name) {
+			continue;
+		}
+		for (key = STYLE_KEY_TOTAL; key < library.count; ++key) {
+			key_name = LCUI_GetStyleName(key);
+			if (key_name && strcmp(key_name, name) == 0) {
+				keys[i] = key;
+				break;
+			}
+		}
+	}
+	return keys;
+}
+
+/** 将预编译样式表中的样式还原为样式 */
+static int CompiledCSS_GetStyle(CompiledCSS css, const int *keys,
+				const CompiledCSSStyleRec *style,
+				LCUI_Style s)
+{
+	size_t len;
+	const char *str;
+	int key = style->key;
+
+	s->is_valid = FALSE;
+	if (key < 0 || (size_t)key >= STYLE_KEY_TOTAL + css->keys_length ||
+	    style->type < LCUI_STYPE_NONE ||
+	    style->type > LCUI_STYPE_WSTRING ||
+	    style->type == LCUI_STYPE_IMAGE) {
+		return -1;
+	}
+	if (key >= STYLE_KEY_TOTAL) {
+		key = keys[key - STYLE_KEY_TOTAL];
+	}
+	s->is_valid = TRUE;
+	s->type = style->type;
+	switch (style->type) {
+	case LCUI_STYPE_SCALE:
+	case LCUI_STYPE_PX:
+	case LCUI_STYPE_PT:
+	case LCUI_STYPE_DIP:
+	case LCUI_STYPE_SP:
+		s->value = style->val_float;
+		break;
+	case LCUI_STYPE_COLOR:
+		s->color.value = style->val_int;
+		break;
+	case LCUI_STYPE_STRING:
+		str = CompiledCSS_GetString(css, style->val_string);
+		if (!str) {
+			return -1;
+		}
+		s->string = strdup2(str);
+		break;
+	case LCUI_STYPE_WSTRING:
+		str = CompiledCSS_GetString(css, style->val_string);
+		if (!str) {
+			return -1;
+		}
+		len = LCUI_DecodeUTF8String(NULL, str, 0);
+		s->wstring = malloc(sizeof(wchar_t) * (len + 1));
+		if (!s->wstring) {
+			return -ENOMEM;
+		}
+		LCUI_DecodeUTF8String(s->wstring, str, len + 1);
+		break;
+	default:
+		s->val_int = style->val_int;
+		break;
+	}
+	return key;
+}
+
+/** 将一条样式规则添加至样式库，样式的值直接写入样式库中的样式表 */
+static void CompiledCSS_PutRule(CompiledCSS css, const int *keys,
+				const CompiledCSSRuleRec *rule)
+{
+	int key;
+	uint32_t i;
+	const char *str, *space;
+	LCUI_StyleRec style;
+	LCUI_StyleList list;
+	LCUI_Selector selector;
+
+	str = CompiledCSS_GetString(css, rule->selector);
+	if (!str || rule->styles > css->styles_length ||
+	    rule->length > css->styles_length - rule->styles) {
+		return;
+	}
+	space = CompiledCSS_GetString(css, rule->space);
+	selector = Selector(str);
+	if (!selector) {
+		return;
+	}
+	LCUIMutex_Lock(&library.mutex);
+	StyleSheetCache_Invalidate(selector);
+	AncestorNames_Add(selector);
+	list = LCUI_SelectStyleList(selector, space);
+	for (i = 0; list && i < rule->length; ++i) {
+		key = CompiledCSS_GetStyle(css, keys,
+					   &css->styles[rule->styles + i],
+					   &style);
+		if (key >= 0) {
+			StyleList_AddNode(list, key)->style = style;
+		} else if (style.is_valid) {
+			DestroyStyle(&style);
+		}
+	}
+	LCUIMutex_Unlock(&library.mutex);
+	Selector_Delete(selector);
+}
+
+int LCUI_LoadCompiledCSS(const void *data, size_t size)
+{
+	int ret, *keys;
+	size_t i;
+	CompiledCSSRec css;
+
+	ret = CompiledCSS_Init(&css, data, size);
+	if (ret != 0) {
+		return ret;
+	}
+	keys = CompiledCSS_MapKeys(&css);
+	if (!keys) {
+		return -ENOMEM;
+	}
+	LCUI_BeginPutStyleSheets();
+	for (i = 0; i < css.rules_length; ++i) {
+		CompiledCSS_PutRule(&css, keys, &css.rules[i]);
+	}
+	LCUI_EndPutStyleSheets();
+	free(keys);
+	return 0;
+}
+
+int LCUI_LoadCompiledCSSFile(const char *filepath)
+{
+	int ret;
+	FILE *fp;
+	char *data;
+	struct stat buf;
+
+	if (stat(filepath, &buf) != 0 || buf.st_size < 1) {
+		return -1;
+	}
+#ifdef HAVE_SYS_MMAN_H
+	{
+		int fd;
+		void *mapped;
+
+		fd = open(filepath, O_RDONLY);
+		if (fd >= 0) {
+			mapped = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED,
+				      fd, 0);
+			close(fd);
+			if (mapped != MAP_FAILED) {
+				ret = LCUI_LoadCompiledCSS(mapped, buf.st_size);
+				munmap(mapped, buf.st_size);
+				return ret;
+			}
+		}
+	}
+#endif
+	fp = fopen(filepath, "rb");
+	if (!fp) {
+		return -1;
+	}
+	data = malloc(buf.st_size);
+	if (!data) {
+		fclose(fp);
+		return -ENOMEM;
+	}
+	if (fread(data, 1, buf.st_size, fp) != (size_t)buf.st_size) {
+		ret = -1;
+	} else {
+		ret = LCUI_LoadCompiledCSS(data, buf.st_size);
+	}
+	free(data);
+	fclose(fp);
+	return ret;
+}
+
 static void StyleSheetCacheDestructor(void *privdata, void *val)
 {
 	StyleSheet_Delete(val);
 }
 
+static void StyleSheetCacheIndexDestructor(void *privdata, void *val)
+{
+	Dict_Release(val);
+}
+
+static void StyleSheetCacheKeysDestructor(void *privdata, void *val)
+{
+	LinkedList_Clear(val, free);
+	free(val);
+}
+
 static void *DupStyleName(void *privdata, const void *val)
 {
 	return strdup2(val);
@@ -1688,11 +3141,31 @@ static void InitStylesheetCache(void)
 	dt->valDestructor = StyleSheetCacheDestructor;
 	dt->keyDestructor = IntKeyDict_KeyDestructor;
 	library.cache = Dict_Create(dt, NULL);
+	dt = &library.cache_set_dict;
+	*dt = library.cache_dict;
+	dt->valDestructor = NULL;
+	dt = &library.cache_keys_dict;
+	*dt = library.cache_dict;
+	dt->valDestructor = StyleSheetCacheKeysDestructor;
+	library.cache_keys = Dict_Create(dt, NULL);
+	dt = &library.cache_index_dict;
+	Dict_InitStringCopyKeyType(dt);
+	dt->valDestructor = StyleSheetCacheIndexDestructor;
+	library.cache_index = Dict_Create(dt, NULL);
+	LinkedList_Init(&library.dirty_names);
+	library.dirty_all = FALSE;
+	library.batch_level = 0;
+	library.cache_version = 0;
 }
 
 static void DestroyStylesheetCache(void)
 {
+	Dict_Release(library.cache_index);
+	Dict_Release(library.cache_keys);
 	Dict_Release(library.cache);
+	LinkedList_Clear(&library.dirty_names, free);
+	library.cache_index = NULL;
+	library.cache_keys = NULL;
 	library.cache = NULL;
 }
 
@@ -1762,6 +3235,10 @@ void LCUI_InitCSSLibrary(void)
 	InitStyleValueLibrary();
 	LCUIMutex_Init(&library.mutex);
 	LinkedList_Init(&library.groups);
+	atom_table_init();
+	library.universal_name = SelectorName(atom_from_str("*"), NAME_TYPE);
+	Dict_InitStringCopyKeyType(&library.ancestor_names_dict);
+	library.ancestor_names = Dict_Create(&library.ancestor_names_dict, NULL);
 	skn_end = style_name_map + LEN(style_name_map);
 	for (skn = style_name_map; skn < skn_end; ++skn) {
 		LCUI_DirectAddStyleName(skn->key, skn->name);
@@ -1782,5 +3259,8 @@ void LCUI_FreeCSSLibrary(void)
 	DestroyStyleValueLibrary();
 	LCUIMutex_Destroy(&library.mutex);
 	LinkedList_Clear(&library.groups, (FuncPtr)DeleteStyleGroup);
+	Dict_Release(library.ancestor_names);
+	library.ancestor_names = NULL;
 	strpool_destroy(library.strpool);
+	atom_table_destroy();
 }
@@ -28,6 +28,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "config.h"
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,97 +48,133 @@
 
 #define LEN(A) sizeof(A) / sizeof(*A)
 
+/* 各解析目标遇到后需要停下来处理的字符 */
+#define CHAR_SELECTOR (1 << 0)
+#define CHAR_KEY (1 << 1)
+#define CHAR_VALUE (1 << 2)
+
+#define MAX_INDEX_SEED 0x10000
+
 #define SetCSSProperty CSSStyleParser_SetCSSProperty
 
+/** 在 LCUI_LoadCSSFiles() 中等待添加的 CSS 文件 */
+typedef struct CSSFileRec_ {
+	const char *path;
+	LinkedList rules; /**< 解析出的样式规则 */
+	int ret;          /**< 解析结果 */
+} CSSFileRec;
+
 static struct CSSParserModule {
 	int count;
 	DictType dicttype; /**< 解析器表的字典类型数据 */
 	Dict *parsers;     /**< 解析器表，以名称进行索引 */
+
+	/** 以属性名的完美哈希值为下标的解析器索引，查找时只需比较一次名称 */
+	struct {
+		unsigned mask;        /**< 解析器表的下标掩码 */
+		unsigned bucket_mask; /**< 种子表的下标掩码 */
+		unsigned *seeds;      /**< 每个桶在二次哈希时使用的种子 */
+		LCUI_CSSPropertyParser *table;
+	} index;
+
+	/** 字符分类表，用于成段扫描无需特殊处理的字符 */
+	unsigned char chars[256];
 } self;
 
 void CSSStyleParser_SetCSSProperty(LCUI_CSSParserStyleContext ctx, int key,
 				   LCUI_Style s)
 {
+	LCUI_Style style;
+
 	if (ctx->style_handler) {
 		ctx->style_handler(key, s, ctx->style_handler_arg);
+		return;
+	}
+	style = StyleSheet_AddStyle(ctx->sheet, key);
+	if (style) {
+		*style = *s;
 	} else {
-		ctx->sheet->sheet[key] = *s;
+		DestroyStyle(s);
 	}
 }
 
+static LCUI_BOOL ParseValue(LCUI_Style s, const char *str, int mode)
+{
+	int val;
+
+	if (strcmp(str, "auto") == 0) {
+		s->type = LCUI_STYPE_AUTO;
+		s->val_style = SV_AUTO;
+		s->is_valid = TRUE;
+		return TRUE;
+	}
+	if ((mode & SPLIT_NUMBER) && ParseNumber(s, str)) {
+		return TRUE;
+	}
+	if ((mode & SPLIT_COLOR) && ParseColor(s, str)) {
+		return TRUE;
+	}
+	if (mode & SPLIT_STYLE) {
+		val = LCUI_GetStyleValue(str);
+		if (val > 0) {
+			s->style = val;
+			s->type = LCUI_STYPE_style;
+			s->is_valid = TRUE;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * 将值按空格拆分后逐个解析
+ * 在一份可写的副本上原地截断各个值，不再为每个值分配内存
+ */
 static int SplitValues(const char *str, LCUI_Style slist, int max_len, int mode)
 {
-	char **values;
-	const char *p;
-	int val, vi = 0, vj = 0, n_quotes = 0;
+	int i, vi, n_quotes = 0;
+	char *p, *copy, *values[8];
+	char buf[256];
+	size_t len = strlen(str);
 
+	if (max_len > (int)LEN(values)) {
+		return -1;
+	}
 	memset(slist, 0, sizeof(LCUI_StyleRec) * max_len);
-	values = (char **)calloc(max_len, sizeof(char *));
-	values[0] = (char *)malloc(sizeof(char) * 64);
-	for (p = str; *p; ++p) {
-		if (*p == '(') {
-			n_quotes += 1;
-			values[vi][vj++] = *p;
-			continue;
-		} else if (*p == ')') {
-			n_quotes -= 1;
-			values[vi][vj++] = *p;
-			continue;
-		} else if (*p != ' ' || n_quotes != 0) {
-			values[vi][vj++] = *p;
+	copy = len < sizeof(buf) ? buf : malloc(len + 1);
+	if (!copy) {
+		return -1;
+	}
+	memcpy(copy, str, len + 1);
+	for (p = copy, vi = 0; *p; ++p) {
+		if (*p == ' ' && n_quotes == 0) {
+			*p = 0;
 			continue;
 		}
-		if (vj > 0) {
-			values[vi][vj] = 0;
-			++vi;
-			vj = 0;
+		if (p == copy || !*(p - 1)) {
 			if (vi >= max_len) {
+				vi = -1;
 				goto clean;
 			}
-			values[vi] = (char *)malloc(sizeof(char) * 64);
-		}
-	}
-	values[vi][vj] = 0;
-	vi++;
-	for (vj = 0; vj < vi; ++vj) {
-		DEBUG_MSG("[%d] %s\n", vj, values[vj]);
-		if (strcmp(values[vj], "auto") == 0) {
-			slist[vj].type = LCUI_STYPE_AUTO;
-			slist[vj].val_style = SV_AUTO;
-			slist[vj].is_valid = TRUE;
-			continue;
-		}
-		if (mode & SPLIT_NUMBER) {
-			if (ParseNumber(&slist[vj], values[vj])) {
-				DEBUG_MSG("[%d]:parse ok\n", vj);
-				continue;
-			}
+			values[vi++] = p;
 		}
-		if (mode & SPLIT_COLOR) {
-			if (ParseColor(&slist[vj], values[vj])) {
-				DEBUG_MSG("[%d]:parse ok\n", vj);
-				continue;
-			}
+		if (*p == '(') {
+			n_quotes += 1;
+		} else if (*p == ')') {
+			n_quotes -= 1;
 		}
-		if (mode & SPLIT_STYLE) {
-			val = LCUI_GetStyleValue(values[vj]);
-			if (val > 0) {
-				slist[vj].style = val;
-				slist[vj].type = LCUI_STYPE_style;
-				slist[vj].is_valid = TRUE;
-				DEBUG_MSG("[%d]:parse ok\n", vj);
-				continue;
-			}
+	}
+	for (i = 0; i < vi; ++i) {
+		if (!ParseValue(&slist[i], values[i], mode)) {
+			DEBUG_MSG("[%d]:parse error\n", i);
+			vi = -1;
+			break;
 		}
-		vi = -1;
-		DEBUG_MSG("[%d]:parse error\n", vj);
-		goto clean;
 	}
 clean:
-	for (vj = 0; vj < max_len; ++vj) {
-		values[vj] ? free(values[vj]) : 0;
+	if (copy != buf) {
+		free(copy);
 	}
-	free(values);
 	return vi;
 }
 
@@ -870,16 +907,48 @@ static LCUI_CSSPropertyParserRec style_parser_map[] = {
 	{ -1, "flex", OnParseFlex }
 };
 
+/**
+ * 将当前字符以及之后一段不含 flag 所标记的字符的内容一次性存入缓存
+ * 结束后 ctx->cur 指向这段内容的最后一个字符
+ */
+static void CSSParser_GetChars(LCUI_CSSParserContext ctx, int flag)
+{
+	size_t len, max_len;
+	const char *p = ctx->cur + 1;
+
+	while (!(self.chars[(unsigned char)*p] & flag)) {
+		++p;
+	}
+	len = p - ctx->cur;
+	max_len = ctx->buffer_size - ctx->pos - 1;
+	memcpy(ctx->buffer + ctx->pos, ctx->cur, min(len, max_len));
+	ctx->pos += (int)min(len, max_len);
+	ctx->cur = p - 1;
+}
+
 static int CSSParser_ParseComment(LCUI_CSSParserContext ctx)
 {
+	const char *p;
+
 	if (ctx->comment.is_line_comment) {
 		if (*ctx->cur == '\n') {
 			ctx->target = ctx->comment.prev_target;
+			return 0;
 		}
-		return 0;
+		p = strchr(ctx->cur, '\n');
+	} else {
+		if (*ctx->cur == '/' && *(ctx->cur - 1) == '*') {
+			ctx->target = ctx->comment.prev_target;
+			return 0;
+		}
+		p = strchr(ctx->cur + 1, '/');
+	}
+	/* 跳过注释内容，停在下一个可能结束注释的字符之前 */
+	if (!p) {
+		p = ctx->cur + strlen(ctx->cur);
 	}
-	if (*ctx->cur == '/' && *(ctx->cur - 1) == '*') {
-		ctx->target = ctx->comment.prev_target;
+	if (p > ctx->cur + 1) {
+		ctx->cur = p - 1;
 	}
 	return 0;
 }
@@ -904,9 +973,33 @@ int CSSParser_BeginParseComment(LCUI_CSSParserContext ctx)
 	return 0;
 }
 
+static void DeleteParsedRule(LCUI_CSSParsedRule rule)
+{
+	LinkedList_Clear(&rule->selectors, free);
+	if (rule->sheet) {
+		StyleSheet_Delete(rule->sheet);
+	}
+	if (rule->font_src) {
+		free(rule->font_src);
+	}
+	free(rule);
+}
+
 static void CSSParser_EndParseSheet(LCUI_CSSParserContext ctx)
 {
 	LinkedListNode *node;
+	LCUI_CSSParsedRule rule;
+
+	/* 暂存解析结果，选择器等到添加至样式库时再解析 */
+	if (ctx->rules) {
+		rule = NEW(LCUI_CSSParsedRuleRec, 1);
+		rule->type = CSS_RULE_NONE;
+		rule->sheet = ctx->style.sheet;
+		LinkedList_Init(&rule->selectors);
+		LinkedList_Concat(&rule->selectors, &ctx->style.selectors);
+		LinkedList_Append(ctx->rules, rule);
+		return;
+	}
 	/* 将记录的样式表添加至匹配到的选择器中 */
 	for (LinkedList_Each(node, &ctx->style.selectors)) {
 		LCUI_PutStyleSheet(node->data, ctx->style.sheet, ctx->space);
@@ -928,6 +1021,11 @@ static int CSSParser_ParseSelector(LCUI_CSSParserContext ctx)
 	case ',':
 		CSSParser_EndBuffer(ctx);
 		DEBUG_MSG("selector: %s\n", ctx->buffer);
+		if (ctx->rules) {
+			LinkedList_Append(&ctx->style.selectors,
+					  strdup2(ctx->buffer));
+			break;
+		}
 		s = Selector(ctx->buffer);
 		if (!s) {
 			return -1;
@@ -935,7 +1033,7 @@ static int CSSParser_ParseSelector(LCUI_CSSParserContext ctx)
 		LinkedList_Append(&ctx->style.selectors, s);
 		break;
 	default:
-		CSSParser_GetChar(ctx);
+		CSSParser_GetChars(ctx, CHAR_SELECTOR);
 		break;
 	}
 	return 0;
@@ -1008,7 +1106,7 @@ static int CSSParser_ParseStyleName(LCUI_CSSParserContext ctx)
 		CSSParser_EndParseSheet(ctx);
 		break;
 	default:
-		CSSParser_GetChar(ctx);
+		CSSParser_GetChars(ctx, CHAR_KEY);
 		break;
 	}
 	return 0;
@@ -1027,7 +1125,7 @@ static int CSSParser_ParseStyleValue(LCUI_CSSParserContext ctx)
 			return 0;
 		}
 	default:
-		CSSParser_GetChar(ctx);
+		CSSParser_GetChars(ctx, CHAR_VALUE);
 		return 0;
 	}
 	if (*ctx->cur == ';') {
@@ -1082,12 +1180,12 @@ static void LoadFontFile(void *arg1, void *arg2)
 	LCUIWidget_RefreshTextView();
 }
 
-static void OnParsedFontFace(LCUI_CSSFontFace face)
+static void PostFontFile(const char *src)
 {
 	static int worker_id = -1;
 	LCUI_TaskRec task = { 0 };
 	task.func = LoadFontFile;
-	task.arg[0] = strdup2(face->src);
+	task.arg[0] = strdup2(src);
 	task.destroy_arg[0] = free;
 	if (worker_id > -1) {
 		LCUI_PostAsyncTaskTo(&task, worker_id);
@@ -1096,6 +1194,11 @@ static void OnParsedFontFace(LCUI_CSSFontFace face)
 	}
 }
 
+static void OnParsedFontFace(LCUI_CSSFontFace face)
+{
+	PostFontFile(face->src);
+}
+
 static char *getdirname(const char *path)
 {
 	char *dirname;
@@ -1172,6 +1275,7 @@ LCUI_CSSParserContext CSSParser_Begin(size_t buffer_size, const char *space)
 	ctx->style.space = ctx->space;
 	ctx->style.style_handler = NULL;
 	ctx->style.style_handler_arg = NULL;
+	ctx->rules = NULL;
 	ctx->parsers[CSS_TARGET_NONE].parse = CSSParser_ParseTarget;
 	ctx->parsers[CSS_TARGET_RULE_NAME].parse = CSSParser_ParseRuleName;
 	ctx->parsers[CSS_TARGET_RULE_DATA].parse = CSSParser_ParseRuleData;
@@ -1184,12 +1288,19 @@ LCUI_CSSParserContext CSSParser_Begin(size_t buffer_size, const char *space)
 	memset(&ctx->rule, 0, sizeof(ctx->rule));
 	CSSParser_InitFontFaceRuleParser(ctx);
 	CSSRuleParser_OnFontFace(ctx, OnParsedFontFace);
+	LCUI_BeginPutStyleSheets();
 	return ctx;
 }
 
 void CSSParser_End(LCUI_CSSParserContext ctx)
 {
-	LinkedList_Clear(&ctx->style.selectors, (FuncPtr)Selector_Delete);
+	LCUI_EndPutStyleSheets();
+	if (ctx->rules) {
+		LinkedList_Clear(&ctx->style.selectors, free);
+	} else {
+		LinkedList_Clear(&ctx->style.selectors,
+				 (FuncPtr)Selector_Delete);
+	}
 	CSSParser_FreeFontFaceRuleParser(ctx);
 	if (ctx->space) {
 		free(ctx->space);
@@ -1204,23 +1315,188 @@ void CSSParser_End(LCUI_CSSParserContext ctx)
 /** 载入CSS代码块，用于实现CSS代码的分块载入 */
 static size_t LCUI_LoadCSSBlock(LCUI_CSSParserContext ctx, const char *str)
 {
-	size_t size = 0;
+	const char *end = str + ctx->buffer_size;
 
 	ctx->cur = str;
-	while (*ctx->cur && size < ctx->buffer_size) {
+	while (*ctx->cur && ctx->cur < end) {
 		ctx->parsers[ctx->target].parse(ctx);
 		++ctx->cur;
-		++size;
 	}
-	return size;
+	return ctx->cur - str;
+}
+
+static unsigned MixHash(unsigned hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bU;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35U;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+static unsigned HashPropertyName(const char *name)
+{
+	unsigned hash = 2166136261U;
+	const unsigned char *p = (const unsigned char *)name;
+
+	for (; *p; ++p) {
+		hash ^= *p;
+		hash *= 16777619U;
+	}
+	return MixHash(hash);
+}
+
+#define PropertySlot(HASH, SEED) (MixHash((HASH) ^ (SEED)) & self.index.mask)
+
+static void CSSParser_FreeIndex(void)
+{
+	free(self.index.seeds);
+	free(self.index.table);
+	self.index.seeds = NULL;
+	self.index.table = NULL;
+}
+
+/** 为一个桶找出能让桶内所有属性名都落在空位上的种子，找不到时返回 0 */
+static unsigned CSSParser_FindBucketSeed(const unsigned *hashes, unsigned n,
+					 unsigned bucket, unsigned *slots)
+{
+	unsigned i, j, k, seed;
+
+	for (seed = 1; seed < MAX_INDEX_SEED; ++seed) {
+		for (i = 0, j = 0; i < n; ++i) {
+			if ((hashes[i] & self.index.bucket_mask) != bucket) {
+				continue;
+			}
+			slots[j] = PropertySlot(hashes[i], seed);
+			if (self.index.table[slots[j]]) {
+				break;
+			}
+			for (k = 0; k < j && slots[k] != slots[j]; ++k);
+			if (k < j) {
+				break;
+			}
+			++j;
+		}
+		if (i >= n) {
+			return seed;
+		}
+	}
+	return 0;
+}
+
+static LCUI_BOOL CSSParser_TryBuildIndex(LCUI_CSSPropertyParser *parsers,
+					 const unsigned *hashes, unsigned n,
+					 unsigned size, unsigned *slots)
+{
+	unsigned i, seed, bucket, bucket_size, buckets = size / 4;
+	unsigned *bucket_sizes;
+
+	self.index.mask = size - 1;
+	self.index.bucket_mask = buckets - 1;
+	self.index.seeds = calloc(buckets, sizeof(unsigned));
+	self.index.table = calloc(size, sizeof(LCUI_CSSPropertyParser));
+	bucket_sizes = calloc(buckets, sizeof(unsigned));
+	if (!self.index.seeds || !self.index.table || !bucket_sizes) {
+		free(bucket_sizes);
+		return FALSE;
+	}
+	for (i = 0; i < n; ++i) {
+		bucket_sizes[hashes[i] & self.index.bucket_mask] += 1;
+	}
+	/* 先安排属性名较多的桶，此时空位较多，更容易找到种子 */
+	for (bucket_size = n; bucket_size > 0; --bucket_size) {
+		for (bucket = 0; bucket < buckets; ++bucket) {
+			if (bucket_sizes[bucket] != bucket_size) {
+				continue;
+			}
+			seed = CSSParser_FindBucketSeed(hashes, n, bucket,
+							slots);
+			if (!seed) {
+				free(bucket_sizes);
+				return FALSE;
+			}
+			self.index.seeds[bucket] = seed;
+			for (i = 0; i < n; ++i) {
+				if ((hashes[i] & self.index.bucket_mask) ==
+				    bucket) {
+					self.index.table[PropertySlot(
+					    hashes[i], seed)] = parsers[i];
+				}
+			}
+		}
+	}
+	free(bucket_sizes);
+	return TRUE;
+}
+
+/**
+ * 为属性解析器表建立完美哈希索引
+ * 先按属性名的哈希值分桶，然后为每个桶找一个能让桶内所有属性名都落在
+ * 空位上的种子。找不到合适的种子时扩大表再重试，仍然失败则不使用索引，
+ * 查找时退回到字典。
+ */
+static void CSSParser_BuildIndex(void)
+{
+	unsigned i = 0, n, size;
+	unsigned *hashes, *slots;
+	DictEntry *entry;
+	DictIterator *iter;
+	LCUI_CSSPropertyParser *parsers;
+
+	CSSParser_FreeIndex();
+	n = (unsigned)self.count;
+	parsers = malloc(sizeof(LCUI_CSSPropertyParser) * (n + 1));
+	hashes = malloc(sizeof(unsigned) * (n + 1));
+	slots = malloc(sizeof(unsigned) * (n + 1));
+	if (!parsers || !hashes || !slots) {
+		goto clean;
+	}
+	iter = Dict_GetIterator(self.parsers);
+	while (i < n && (entry = Dict_Next(iter))) {
+		parsers[i] = DictEntry_GetVal(entry);
+		hashes[i] = HashPropertyName(parsers[i]->name);
+		++i;
+	}
+	Dict_ReleaseIterator(iter);
+	n = i;
+	for (size = 16; size < n * 2; size <<= 1);
+	for (; size <= n * 16; size <<= 1) {
+		if (CSSParser_TryBuildIndex(parsers, hashes, n, size, slots)) {
+			break;
+		}
+		CSSParser_FreeIndex();
+	}
+
+clean:
+	free(parsers);
+	free(hashes);
+	free(slots);
 }
 
 LCUI_CSSPropertyParser LCUI_GetCSSPropertyParser(const char *name)
 {
-	return Dict_FetchValue(self.parsers, name);
+	unsigned hash;
+	LCUI_CSSPropertyParser sp;
+
+	if (!self.index.table) {
+		return Dict_FetchValue(self.parsers, name);
+	}
+	hash = HashPropertyName(name);
+	sp = self.index.table[PropertySlot(
+	    hash, self.index.seeds[hash & self.index.bucket_mask])];
+	if (sp && strcmp(sp->name, name) == 0) {
+		return sp;
+	}
+	return NULL;
 }
 
-int LCUI_LoadCSSFile(const char *filepath)
+/**
+ * 解析 CSS 文件
+ * @param[out] rules 暂存解析结果的规则列表，为 NULL 时直接导入至样式库
+ * @returns 成功返回 0，文件是预编译样式表时返回 1，失败返回 -1
+ */
+static int LCUI_ParseCSSFile(const char *filepath, LinkedList *rules)
 {
 	size_t n;
 	FILE *fp;
@@ -1231,8 +1507,13 @@ int LCUI_LoadCSSFile(const char *filepath)
 	if (!fp) {
 		return -1;
 	}
-	ctx = CSSParser_Begin(512, filepath);
 	n = fread(buff, 1, 511, fp);
+	if (n >= 8 && memcmp(buff, LCUI_COMPILED_CSS_MAGIC, 8) == 0) {
+		fclose(fp);
+		return 1;
+	}
+	ctx = CSSParser_Begin(512, filepath);
+	ctx->rules = rules;
 	while (n > 0) {
 		buff[n] = 0;
 		LCUI_LoadCSSBlock(ctx, buff);
@@ -1243,6 +1524,97 @@ int LCUI_LoadCSSFile(const char *filepath)
 	return 0;
 }
 
+int LCUI_LoadCSSFile(const char *filepath)
+{
+	int ret;
+
+	ret = LCUI_ParseCSSFile(filepath, NULL);
+	/* 预编译样式表不需要解析 */
+	if (ret == 1) {
+		return LCUI_LoadCompiledCSSFile(filepath);
+	}
+	return ret;
+}
+
+/** 将暂存的样式规则添加至样式库，@font-face 规则需要另外处理 */
+static void CSSParser_PutRules(LinkedList *rules, const char *space)
+{
+	LCUI_Selector s;
+	LCUI_CSSParsedRule rule;
+	LinkedListNode *node, *sel_node;
+
+	for (LinkedList_Each(node, rules)) {
+		rule = node->data;
+		if (rule->type != CSS_RULE_NONE) {
+			continue;
+		}
+		for (LinkedList_Each(sel_node, &rule->selectors)) {
+			s = Selector(sel_node->data);
+			if (s) {
+				LCUI_PutStyleSheet(s, rule->sheet, space);
+				Selector_Delete(s);
+			}
+		}
+	}
+}
+
+static void CSSParser_PostFontFiles(LinkedList *rules)
+{
+	LinkedListNode *node;
+	LCUI_CSSParsedRule rule;
+
+	for (LinkedList_Each(node, rules)) {
+		rule = node->data;
+		if (rule->type == CSS_RULE_FONT_FACE) {
+			PostFontFile(rule->font_src);
+		}
+	}
+}
+
+size_t LCUI_LoadCSSFiles(const char **filepaths, size_t n_files)
+{
+	int i;
+	size_t count = 0;
+	CSSFileRec *files;
+
+	files = NEW(CSSFileRec, n_files + 1);
+	if (!files) {
+		return 0;
+	}
+	for (i = 0; i < (int)n_files; ++i) {
+		files[i].path = filepaths[i];
+		LinkedList_Init(&files[i].rules);
+	}
+	/* 解析过程只会把结果记录在各个文件自己的规则列表中，不会访问样式库 */
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (i = 0; i < (int)n_files; ++i) {
+		files[i].ret = LCUI_ParseCSSFile(files[i].path, &files[i].rules);
+	}
+	/* 按文件顺序添加规则，选择器的批次号与依次载入这些文件时的一致 */
+	LCUI_BeginPutStyleSheets();
+	LCUI_LockCSSLibrary();
+	for (i = 0; i < (int)n_files; ++i) {
+		if (files[i].ret == 1) {
+			files[i].ret = LCUI_LoadCompiledCSSFile(files[i].path);
+		} else if (files[i].ret == 0) {
+			CSSParser_PutRules(&files[i].rules, files[i].path);
+		}
+	}
+	LCUI_UnlockCSSLibrary();
+	LCUI_EndPutStyleSheets();
+	for (i = 0; i < (int)n_files; ++i) {
+		if (files[i].ret == 0) {
+			count += 1;
+		}
+		CSSParser_PostFontFiles(&files[i].rules);
+		LinkedList_Clear(&files[i].rules, (FuncPtr)DeleteParsedRule);
+	}
+	free(files);
+	return count;
+}
+
 size_t LCUI_LoadCSSString(const char *str, const char *space)
 {
 	size_t len = 1;
@@ -1274,6 +1646,8 @@ int LCUI_AddCSSPropertyParser(LCUI_CSSPropertyParser sp)
 	new_sp->parse = sp->parse;
 	new_sp->name = strdup2(sp->name);
 	Dict_Add(self.parsers, new_sp->name, new_sp);
+	while (Dict_Rehash(self.parsers, 100));
+	CSSParser_BuildIndex();
 	return 0;
 }
 
@@ -1308,10 +1682,26 @@ void LCUI_InitCSSParser(void)
 			new_sp->name = strdup2(sp->name);
 		}
 		Dict_Add(self.parsers, new_sp->name, new_sp);
-	}
+		self.count += 1;
+	}
+	while (Dict_Rehash(self.parsers, 100));
+	CSSParser_BuildIndex();
+	memset(self.chars, 0, sizeof(self.chars));
+	self.chars[0] = CHAR_SELECTOR | CHAR_KEY | CHAR_VALUE;
+	self.chars['/'] = CHAR_SELECTOR | CHAR_VALUE;
+	self.chars['{'] = CHAR_SELECTOR;
+	self.chars[','] = CHAR_SELECTOR;
+	self.chars[';'] = CHAR_KEY | CHAR_VALUE;
+	self.chars['}'] = CHAR_KEY | CHAR_VALUE;
+	self.chars[':'] = CHAR_KEY;
+	self.chars[' '] = CHAR_KEY;
+	self.chars['\n'] = CHAR_KEY;
+	self.chars['\r'] = CHAR_KEY;
+	self.chars['\t'] = CHAR_KEY;
 }
 
 void LCUI_FreeCSSParser(void)
 {
+	CSSParser_FreeIndex();
 	Dict_Release(self.parsers);
 }
@@ -120,9 +120,17 @@ static int FontFaceParser_ParseHead(LCUI_CSSParserContext ctx)
 
 static int FontFaceParser_ParseTail(LCUI_CSSParserContext ctx)
 {
+	LCUI_CSSParsedRule rule;
 	FontFaceParserContext data;
 	data = GetParserContext(ctx);
-	if (data->callback) {
+	/* 暂存解析结果时只记录字体文件路径，等到添加样式规则时再载入 */
+	if (ctx->rules && data->face->src) {
+		rule = NEW(LCUI_CSSParsedRuleRec, 1);
+		rule->type = CSS_RULE_FONT_FACE;
+		rule->font_src = strdup2(data->face->src);
+		LinkedList_Init(&rule->selectors);
+		LinkedList_Append(ctx->rules, rule);
+	} else if (!ctx->rules && data->callback) {
 		data->callback(data->face);
 	}
 	FontFaceParser_End(ctx);
@@ -44,6 +44,8 @@
 #include <LCUI/ime.h>
 
 #define TEXT_BLOCK_SIZE 512
+/* 每帧处理文本块的时间上限（毫秒），超出的部分留到下一帧处理 */
+#define TEXT_BLOCK_TIME_LIMIT 8
 #define DEFAULT_WIDTH 176.0f
 #define PLACEHOLDER_COLOR RGB(140, 140, 140)
 #define GetData(W) Widget_GetData(W, self.prototype)
@@ -69,6 +71,8 @@ typedef struct LCUI_TextEditRec_ {
 	size_t text_block_size;         /**< 块大小 */
 	LinkedList text_blocks;         /**< 文本块缓冲区 */
 	LinkedList text_tags;           /**< 当前处理的标签列表 */
+	Rope text_buffer;               /**< 文本缓冲区，存放完整的源文本 */
+	LCUI_BOOL text_buffer_enabled;  /**< 是否启用文本缓冲区 */
 	LCUI_BOOL tasks[TASK_TOTAL];    /**< 待处理的任务 */
 	LCUI_Mutex mutex;               /**< 互斥锁 */
 } LCUI_TextEditRec, *LCUI_TextEdit;
@@ -196,16 +200,6 @@ static void TextEdit_UpdateCaret(LCUI_Widget widget)
 	}
 }
 
-void TextEdit_MoveCaret(LCUI_Widget widget, int row, int col)
-{
-	LCUI_TextEdit edit = Widget_GetData(widget, self.prototype);
-	if (edit->is_placeholder_shown) {
-		row = col = 0;
-	}
-	TextLayer_SetCaretPos(edit->layer, row, col);
-	TextEdit_UpdateCaret(widget);
-}
-
 static void TextBlock_OnDestroy(void *arg)
 {
 	LCUI_TextBlock blk = arg;
@@ -214,6 +208,96 @@ static void TextBlock_OnDestroy(void *arg)
 	free(blk);
 }
 
+/** 获取文本插入符在源文本中的位置 */
+static size_t TextEdit_GetCaretOffset(LCUI_TextLayer layer)
+{
+	return TextLayer_GetTextOffset(layer, layer->insert_y, layer->insert_x);
+}
+
+/**
+ * 获取向前删除文本后，被删除的文本在源文本中的起始位置
+ * 末行被整行删除后，插入符会移至上一行的行尾符前面，但该行尾符并未被删除，
+ * 被删除的文本是从它后面开始的
+ */
+static size_t TextEdit_GetBackspaceOffset(LCUI_TextLayer layer)
+{
+	LCUI_TextRow txtrow;
+	int row = layer->insert_y;
+
+	if (row == layer->text_rows.length - 1) {
+		txtrow = layer->text_rows.rows[row];
+		if (txtrow->eol != LCUI_EOL_NONE &&
+		    layer->insert_x >= txtrow->length) {
+			return TextLayer_GetTextOffset(layer, row + 1, 0);
+		}
+	}
+	return TextEdit_GetCaretOffset(layer);
+}
+
+/**
+ * 获取从插入符开始的 n 个字符之后的位置
+ * 与 TextLayer_TextDelete() 一样，行尾符算作一个字符
+ */
+static size_t TextEdit_GetCaretOffsetAfter(LCUI_TextLayer layer, int n)
+{
+	LCUI_TextRow txtrow;
+	int row = layer->insert_y, col = layer->insert_x;
+
+	for (; row < layer->text_rows.length; ++row, col = 0) {
+		txtrow = layer->text_rows.rows[row];
+		if (col + n <= txtrow->length) {
+			col += n;
+			break;
+		}
+		n -= txtrow->length - col;
+		if (txtrow->eol != LCUI_EOL_NONE) {
+			n -= 1;
+		}
+	}
+	return TextLayer_GetTextOffset(layer, row, col);
+}
+
+/**
+ * 将文本写入文本缓冲区
+ * 文本块是在之后的帧中分批载入文本图层的，所以插入位置需要加上尚未载入的、
+ * 插入在文本插入符处的文本块长度
+ */
+static int TextEdit_InsertToBuffer(LCUI_TextEdit edit, const wchar_t *wtext,
+				   size_t len, TextBlockAction action)
+{
+	int ret;
+	size_t pos;
+	LCUI_TextBlock block;
+	LinkedListNode *node;
+	LCUI_TextLayer layer = edit->layer_source;
+
+	LCUIMutex_Lock(&edit->mutex);
+	if (action == TEXT_BLOCK_ACTION_APPEND) {
+		pos = Rope_GetLength(&edit->text_buffer);
+	} else {
+		pos = TextEdit_GetCaretOffset(layer);
+		for (LinkedList_Each(node, &edit->text_blocks)) {
+			block = node->data;
+			if (block->owner == TEXT_BLOCK_OWNER_SOURCE &&
+			    block->action == TEXT_BLOCK_ACTION_INSERT) {
+				pos += block->length;
+			}
+		}
+	}
+	ret = Rope_Insert(&edit->text_buffer, pos, wtext, len);
+	LCUIMutex_Unlock(&edit->mutex);
+	return ret;
+}
+
+/** 在文本图层中删除文本后，同步删除文本缓冲区中的 [start, end) 范围内的文本 */
+static void TextEdit_SyncBufferDeletion(LCUI_TextEdit edit, size_t start,
+					size_t end)
+{
+	if (edit->text_buffer_enabled && end > start) {
+		Rope_Delete(&edit->text_buffer, start, end - start);
+	}
+}
+
 static int TextEdit_AddTextBlock(LCUI_Widget widget, const wchar_t *wtext,
 				 TextBlockAction action, TextBlockOwner owner)
 {
@@ -227,6 +311,11 @@ static int TextEdit_AddTextBlock(LCUI_Widget widget, const wchar_t *wtext,
 	}
 	len = wcslen(wtext);
 	edit = Widget_GetData(widget, self.prototype);
+	if (owner == TEXT_BLOCK_OWNER_SOURCE && edit->text_buffer_enabled) {
+		if (TextEdit_InsertToBuffer(edit, wtext, len, action) != 0) {
+			return -ENOMEM;
+		}
+	}
 	for (i = 0; i < len; ++i) {
 		block = NEW(LCUI_TextBlockRec, 1);
 		if (!block) {
@@ -240,7 +329,8 @@ static int TextEdit_AddTextBlock(LCUI_Widget widget, const wchar_t *wtext,
 		} else if (len - i > edit->text_block_size) {
 			block->type = TEXT_BLOCK_BODY;
 		} else {
-			size = len - i;
+			/* 留出结束符的位置 */
+			size = len - i + 1;
 			block->type = TEXT_BLOCK_END;
 		}
 		block->text = NEW(wchar_t, size);
@@ -252,6 +342,12 @@ static int TextEdit_AddTextBlock(LCUI_Widget widget, const wchar_t *wtext,
 			for (j = 0; i < len && j < size - 1; ++j, ++i) {
 				block->text[j] = wtext[i];
 			}
+			/* 避免将 \r\n 拆分到两个文本块中 */
+			if (j > 1 && i < len && wtext[i] == '\n' &&
+			    block->text[j - 1] == '\r') {
+				--j;
+				--i;
+			}
 			--i;
 			block->text[j] = 0;
 			block->length = j;
@@ -339,6 +435,87 @@ static void TextEdit_ProcTextBlock(LCUI_Widget widget, LCUI_TextBlock txtblk)
 	}
 }
 
+/**
+ * 将缓冲区中的文本块载入文本图层
+ * 粘贴大段文本时，一次性载入全部文本块会让界面卡住很久，所以每次只处理限定
+ * 时间内能处理完的文本块
+ * @param time_limit 时间上限（毫秒），小于 0 时处理全部文本块
+ * @returns 是否已经处理完全部文本块
+ */
+static LCUI_BOOL TextEdit_ProcTextBlocks(LCUI_Widget widget, int time_limit)
+{
+	LCUI_BOOL done;
+	LinkedListNode *node;
+	LCUI_TextEdit edit = Widget_GetData(widget, self.prototype);
+	int64_t start = LCUI_GetTime();
+
+	while (1) {
+		LCUIMutex_Lock(&edit->mutex);
+		node = LinkedList_GetNode(&edit->text_blocks, 0);
+		if (node) {
+			LinkedList_Unlink(&edit->text_blocks, node);
+		}
+		LCUIMutex_Unlock(&edit->mutex);
+		if (!node) {
+			return TRUE;
+		}
+		TextEdit_ProcTextBlock(widget, node->data);
+		TextBlock_OnDestroy(node->data);
+		LinkedListNode_Delete(node);
+		if (time_limit >= 0 && LCUI_GetTimeDelta(start) >= time_limit) {
+			break;
+		}
+	}
+	LCUIMutex_Lock(&edit->mutex);
+	done = edit->text_blocks.length == 0;
+	LCUIMutex_Unlock(&edit->mutex);
+	return done;
+}
+
+/**
+ * 立即载入尚未处理的文本块
+ * 在移动文本插入符和删除文本之前调用，确保操作的是完整的文本
+ * @param insert_only 是否只在有待插入至文本插入符处的文本块时才载入
+ */
+static void TextEdit_FlushTextBlocks(LCUI_Widget widget,
+				     LCUI_BOOL insert_only)
+{
+	LCUI_BOOL found = FALSE;
+	LCUI_TextBlock block;
+	LinkedListNode *node;
+	LCUI_TextEdit edit = Widget_GetData(widget, self.prototype);
+
+	LCUIMutex_Lock(&edit->mutex);
+	if (!insert_only) {
+		found = edit->text_blocks.length > 0;
+	}
+	for (LinkedList_Each(node, &edit->text_blocks)) {
+		block = node->data;
+		if (block->owner == TEXT_BLOCK_OWNER_SOURCE &&
+		    block->action == TEXT_BLOCK_ACTION_INSERT) {
+			found = TRUE;
+			break;
+		}
+	}
+	LCUIMutex_Unlock(&edit->mutex);
+	if (found) {
+		TextEdit_ProcTextBlocks(widget, -1);
+		edit->tasks[TASK_UPDATE] = TRUE;
+		Widget_AddTask(widget, LCUI_WTASK_USER);
+	}
+}
+
+void TextEdit_MoveCaret(LCUI_Widget widget, int row, int col)
+{
+	LCUI_TextEdit edit = Widget_GetData(widget, self.prototype);
+	TextEdit_FlushTextBlocks(widget, TRUE);
+	if (edit->is_placeholder_shown) {
+		row = col = 0;
+	}
+	TextLayer_SetCaretPos(edit->layer, row, col);
+	TextEdit_UpdateCaret(widget);
+}
+
 /** 更新文本框的文本图层 */
 static void TextEdit_UpdateTextLayer(LCUI_Widget w)
 {
@@ -373,22 +550,19 @@ static void TextEdit_OnTask(LCUI_Widget widget, int task)
 {
 	LCUI_TextEdit edit = Widget_GetData(widget, self.prototype);
 
-	if (edit->tasks[TASK_SET_TEXT]) {
-		LinkedList blocks;
-		LinkedListNode *node;
+	/* 每次更新部件时只在处理用户任务时载入一批文本块，避免同一帧内因为
+	 * 处理其它任务而多次载入 */
+	if (edit->tasks[TASK_SET_TEXT] && task == LCUI_WTASK_USER) {
 		LCUI_WidgetEventRec ev;
 
-		LinkedList_Init(&blocks);
-		LCUIMutex_Lock(&edit->mutex);
-		LinkedList_Concat(&blocks, &edit->text_blocks);
-		LCUIMutex_Unlock(&edit->mutex);
-		for (LinkedList_Each(node, &blocks)) {
-			TextEdit_ProcTextBlock(widget, node->data);
+		if (TextEdit_ProcTextBlocks(widget, TEXT_BLOCK_TIME_LIMIT)) {
+			LCUI_InitWidgetEvent(&ev, "change");
+			Widget_TriggerEvent(widget, &ev, NULL);
+			edit->tasks[TASK_SET_TEXT] = FALSE;
+		} else {
+			/* 剩余的文本块留到下一帧处理 */
+			Widget_AddTask(widget, LCUI_WTASK_USER);
 		}
-		TextBlocks_Clear(&blocks);
-		LCUI_InitWidgetEvent(&ev, "change");
-		Widget_TriggerEvent(widget, &ev, NULL);
-		edit->tasks[TASK_SET_TEXT] = FALSE;
 		edit->tasks[TASK_UPDATE] = TRUE;
 	}
 	if (edit->tasks[TASK_UPDATE]) {
@@ -484,6 +658,14 @@ void TextEdit_EnableStyleTag(LCUI_Widget widget, LCUI_BOOL enable)
 {
 	LCUI_TextEdit edit = Widget_GetData(widget, self.prototype);
 	TextLayer_EnableStyleTag(edit->layer, enable);
+	/* 文本缓冲区中的文本不包含样式标签，与文本图层中的文本对应不上，
+	 * 所以在启用样式标签后改为从文本图层中获取文本 */
+	if (enable && edit->text_buffer_enabled) {
+		LCUIMutex_Lock(&edit->mutex);
+		Rope_Clear(&edit->text_buffer);
+		edit->text_buffer_enabled = FALSE;
+		LCUIMutex_Unlock(&edit->mutex);
+	}
 }
 
 /* FIXME: improve multiline editing mode of the textedit widget
@@ -519,6 +701,8 @@ void TextEdit_ClearText(LCUI_Widget widget)
 	}
 	TextLayer_ClearText(edit->layer_source);
 	StyleTags_Clear(&edit->text_tags);
+	Rope_Clear(&edit->text_buffer);
+	edit->text_buffer_enabled = !edit->layer_source->enable_style_tag;
 	edit->tasks[TASK_UPDATE] = TRUE;
 	Widget_AddTask(widget, LCUI_WTASK_USER);
 	LCUIMutex_Unlock(&edit->mutex);
@@ -528,13 +712,26 @@ void TextEdit_ClearText(LCUI_Widget widget)
 size_t TextEdit_GetTextW(LCUI_Widget w, size_t start, size_t max_len,
 			 wchar_t *buf)
 {
+	size_t len;
 	LCUI_TextEdit edit = GetData(w);
-	return TextLayer_GetTextW(edit->layer_source, start, max_len, buf);
+
+	if (!edit->text_buffer_enabled) {
+		return TextLayer_GetTextW(edit->layer_source, start, max_len,
+					  buf);
+	}
+	LCUIMutex_Lock(&edit->mutex);
+	len = Rope_GetText(&edit->text_buffer, start, max_len, buf);
+	LCUIMutex_Unlock(&edit->mutex);
+	return len;
 }
 
 size_t TextEdit_GetTextLength(LCUI_Widget w)
 {
 	LCUI_TextEdit edit = GetData(w);
+
+	if (edit->text_buffer_enabled) {
+		return Rope_GetLength(&edit->text_buffer);
+	}
 	return edit->layer_source->length;
 }
 
@@ -583,6 +780,7 @@ void TextEdit_SetPasswordChar(LCUI_Widget w, wchar_t ch)
 	wchar_t text[256];
 	LCUI_TextEdit edit = GetData(w);
 
+	TextEdit_FlushTextBlocks(w, FALSE);
 	edit->password_char = ch;
 	edit->tasks[TASK_UPDATE] = TRUE;
 	Widget_AddTask(w, LCUI_WTASK_USER);
@@ -678,12 +876,17 @@ static void TextEdit_OnBlur(LCUI_Widget widget, LCUI_WidgetEvent e, void *arg)
 
 static void TextEdit_TextBackspace(LCUI_Widget widget, int n_ch)
 {
+	size_t start, end;
 	LCUI_TextEdit edit;
 	LCUI_WidgetEventRec ev;
 
 	edit = Widget_GetData(widget, self.prototype);
+	TextEdit_FlushTextBlocks(widget, FALSE);
 	LCUIMutex_Lock(&edit->mutex);
+	end = TextEdit_GetCaretOffset(edit->layer_source);
 	TextLayer_TextBackspace(edit->layer_source, n_ch);
+	start = TextEdit_GetBackspaceOffset(edit->layer_source);
+	TextEdit_SyncBufferDeletion(edit, start, end);
 	if (edit->password_char) {
 		TextLayer_TextBackspace(edit->layer_mask, n_ch);
 	}
@@ -697,12 +900,17 @@ static void TextEdit_TextBackspace(LCUI_Widget widget, int n_ch)
 
 static void TextEdit_TextDelete(LCUI_Widget widget, int n_ch)
 {
+	size_t start, end;
 	LCUI_TextEdit edit;
 	LCUI_WidgetEventRec ev;
 
 	edit = Widget_GetData(widget, self.prototype);
+	TextEdit_FlushTextBlocks(widget, FALSE);
 	LCUIMutex_Lock(&edit->mutex);
+	start = TextEdit_GetCaretOffset(edit->layer_source);
+	end = TextEdit_GetCaretOffsetAfter(edit->layer_source, n_ch);
 	TextLayer_TextDelete(edit->layer_source, n_ch);
+	TextEdit_SyncBufferDeletion(edit, start, end);
 	if (edit->password_char) {
 		TextLayer_TextDelete(edit->layer_mask, n_ch);
 	}
@@ -722,6 +930,7 @@ static void TextEdit_OnKeyDown(LCUI_Widget widget, LCUI_WidgetEvent e,
 	int cur_col, cur_row;
 	LCUI_TextEdit edit = Widget_GetData(widget, self.prototype);
 
+	TextEdit_FlushTextBlocks(widget, TRUE);
 	cur_row = edit->layer->insert_y;
 	cur_col = edit->layer->insert_x;
 	rows = TextLayer_GetRowTotal(edit->layer);
@@ -835,6 +1044,7 @@ static void TextEdit_OnMouseMove(LCUI_Widget w, LCUI_WidgetEvent e, void *arg)
 		TextEdit_UpdateCaret(w);
 		return;
 	}
+	TextEdit_FlushTextBlocks(w, TRUE);
 	scale = LCUIMetrics_GetScale();
 	Widget_GetOffset(w, NULL, &offset_x, &offset_y);
 	x = iround((e->motion.x - offset_x - w->padding.left) * scale);
@@ -856,6 +1066,7 @@ static void TextEdit_OnMouseDown(LCUI_Widget w, LCUI_WidgetEvent e, void *arg)
 	float scale = LCUIMetrics_GetScale();
 	LCUI_TextEdit edit = GetData(w);
 
+	TextEdit_FlushTextBlocks(w, TRUE);
 	Widget_GetOffset(w, NULL, &offset_x, &offset_y);
 	x = iround((e->motion.x - offset_x - w->padding.left) * scale);
 	y = iround((e->motion.y - offset_y - w->padding.top) * scale);
@@ -897,6 +1108,8 @@ static void TextEdit_OnInit(LCUI_Widget w)
 	memset(edit->tasks, 0, sizeof(edit->tasks));
 	LinkedList_Init(&edit->text_blocks);
 	StyleTags_Init(&edit->text_tags);
+	Rope_Init(&edit->text_buffer);
+	edit->text_buffer_enabled = TRUE;
 	TextEdit_EnableMultiline(w, FALSE);
 	TextLayer_SetAutoWrap(edit->layer, TRUE);
 	TextLayer_SetAutoWrap(edit->layer_mask, TRUE);
@@ -924,6 +1137,7 @@ static void TextEdit_OnDestroy(LCUI_Widget widget)
 	TextLayer_Destroy(edit->layer_mask);
 	CSSFontStyle_Destroy(&edit->style);
 	TextBlocks_Clear(&edit->text_blocks);
+	Rope_Clear(&edit->text_buffer);
 	if (edit->value_watcher) {
 		ObjectWatcher_Delete(edit->value_watcher);
 		edit->value_watcher = NULL;
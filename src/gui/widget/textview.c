@@ -79,7 +79,7 @@ static LCUI_BOOL ParseBoolean(const char *str)
 static int OnParseWordBreak(LCUI_CSSParserStyleContext ctx, const char *value)
 {
 	char *str = strdup2(value);
-	LCUI_Style s = &ctx->sheet->sheet[self.key_word_break];
+	LCUI_Style s = StyleSheet_AddStyle(ctx->sheet, self.key_word_break);
 	if (s->is_valid && s->string) {
 		free(s->string);
 	}
@@ -91,7 +91,7 @@ static int OnParseWordBreak(LCUI_CSSParserStyleContext ctx, const char *value)
 
 static LCUI_WordBreakMode ComputeWordBreakMode(LCUI_StyleSheet sheet)
 {
-	LCUI_Style s = &sheet->sheet[self.key_word_break];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(sheet, self.key_word_break);
 	if (s->is_valid && s->type == LCUI_STYPE_STRING && s->string) {
 		if (strcmp(s->string, "break-all") == 0) {
 			return LCUI_WORD_BREAK_BREAK_ALL;
@@ -42,6 +42,7 @@
 
 typedef struct ImageCacheRec_ {
 	char *path;
+	LCUI_BOOL loaded;
 	LCUI_Graph image;
 	LinkedList refs;
 } ImageCacheRec, *ImageCache;
@@ -51,6 +52,11 @@ typedef struct ImageRefRec_ {
 	ImageCache cache;
 } ImageRefRec, *ImageRef;
 
+typedef struct ImageSizeRec_ {
+	int width;
+	int height;
+} ImageSizeRec, *ImageSize;
+
 static struct LCUI_WidgetBackgroundModule {
 	LCUI_BOOL active;
 	DictType dtype;
@@ -79,6 +85,24 @@ static void ImageCacheDestructor(void *privdata, void *data)
 	DestroyImageCache(data);
 }
 
+/**
+ * 将缓存中的图像应用到部件的背景上
+ * 如果图像还未解码完成，则只设置图像尺寸作为占位，以便计算背景尺寸和位置
+ */
+static void ApplyImageCache(LCUI_Widget widget, ImageCache cache)
+{
+	LCUI_Graph *image = &widget->computed_style.background.image;
+
+	if (cache->loaded) {
+		Graph_Quote(image, &cache->image, NULL);
+		Widget_InvalidateArea(widget, NULL, SV_BORDER_BOX);
+		return;
+	}
+	Graph_Init(image);
+	image->width = cache->image.width;
+	image->height = cache->image.height;
+}
+
 static void AddImageRef(LCUI_Widget widget, ImageCache cache)
 {
 	ASSIGN(ref, ImageRef);
@@ -120,28 +144,103 @@ static void DeleteImageRef(LCUI_Widget widget)
 	}
 }
 
+static void PostImageTask(LCUI_TaskFunc func, char *path, void *data)
+{
+	LCUI_TaskRec task = { 0 };
+
+	task.func = func;
+	task.arg[0] = path;
+	task.arg[1] = data;
+	task.destroy_arg[0] = free;
+	task.destroy_arg[1] = free;
+	if (!LCUI_PostTask(&task)) {
+		LCUITask_Run(&task);
+		LCUITask_Destroy(&task);
+	}
+}
+
+static ImageCache GetLoadingImageCache(const char *path)
+{
+	ImageCache cache;
+
+	if (!self.active) {
+		return NULL;
+	}
+	cache = Dict_FetchValue(self.images, path);
+	if (!cache || cache->loaded) {
+		return NULL;
+	}
+	return cache;
+}
+
+static void OnImageLoaded(void *arg1, void *arg2)
+{
+	ImageCache cache;
+	LinkedListNode *node;
+	LCUI_Graph *image = arg2;
+
+	cache = GetLoadingImageCache(arg1);
+	if (!cache) {
+		Graph_Free(image);
+		return;
+	}
+	cache->image = *image;
+	cache->loaded = TRUE;
+	Graph_Init(image);
+	for (LinkedList_Each(node, &cache->refs)) {
+		ApplyImageCache(node->data, cache);
+	}
+}
+
 static void ExecLoadImage(void *arg1, void *arg2)
 {
-	char *path = arg2;
-	LCUI_Graph image;
-	LCUI_Widget w = arg1;
+	char *path = arg1;
+	LCUI_Graph *image;
+
+	image = NEW(LCUI_Graph, 1);
+	Graph_Init(image);
+	if (LCUI_ReadImageFile(path, image) != 0) {
+		free(image);
+		return;
+	}
+	PostImageTask(OnImageLoaded, strdup2(path), image);
+}
+
+static void OnImageHeaderLoaded(void *arg1, void *arg2)
+{
 	ImageCache cache;
+	ImageSize size = arg2;
+	LinkedListNode *node;
+	LCUI_TaskRec task = { 0 };
 
-	Graph_Init(&image);
-	if (LCUI_ReadImageFile(path, &image) != 0) {
+	cache = GetLoadingImageCache(arg1);
+	if (!cache) {
 		return;
 	}
-	cache = NEW(ImageCacheRec, 1);
-	cache->image = image;
-	cache->path = strdup2(path);
-	LinkedList_Init(&cache->refs);
-	if (Dict_Add(self.images, cache->path, cache) == 0) {
-		AddImageRef(w, cache);
-	} else {
-		DestroyImageCache(cache);
+	cache->image.width = size->width;
+	cache->image.height = size->height;
+	for (LinkedList_Each(node, &cache->refs)) {
+		ApplyImageCache(node->data, cache);
+	}
+	task.func = ExecLoadImage;
+	task.arg[0] = strdup2(cache->path);
+	task.destroy_arg[0] = free;
+	LCUI_PostAsyncTask(&task);
+}
+
+static void ExecLoadImageHeader(void *arg1, void *arg2)
+{
+	char *path = arg1;
+	ImageSize size;
+
+	size = NEW(ImageSizeRec, 1);
+	/* 读不出图像尺寸时，直接解码完整的图像 */
+	if (LCUI_GetImageSize(path, &size->width, &size->height) != 0) {
+		free(size);
+		ExecLoadImage(path, NULL);
+		return;
 	}
-	Graph_Quote(&w->computed_style.background.image, &cache->image, NULL);
-	Widget_InvalidateArea(w, NULL, SV_BORDER_BOX);
+	PostImageTask(OnImageHeaderLoaded, strdup2(path), size);
 }
 
 static int OnCompareWidget(void *data, const void *keydata)
@@ -156,12 +255,17 @@ static int OnCompareWidget(void *data, const void *keydata)
 	return -1;
 }
 
+/**
+ * 异步加载背景图像
+ * 先在工作线程中读取图像头部信息，在主线程中发布图像尺寸，然后再解码完整的
+ * 图像数据，这样背景尺寸和位置的计算无需等待解码完成。
+ */
 static void AsyncLoadImage(LCUI_Widget widget, const char *path)
 {
 	ImageRef ref;
 	ImageCache cache;
 	LCUI_TaskRec task = { 0 };
-	LCUI_Style s = &widget->style->sheet[key_background_image];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(widget->style, key_background_image);
 
 	if (!self.active) {
 		return;
@@ -178,15 +282,19 @@ static void AsyncLoadImage(LCUI_Widget widget, const char *path)
 	cache = Dict_FetchValue(self.images, path);
 	if (cache) {
 		AddImageRef(widget, cache);
-		Graph_Quote(&widget->computed_style.background.image,
-			    &cache->image, NULL);
-		Widget_InvalidateArea(widget, NULL, SV_BORDER_BOX);
+		ApplyImageCache(widget, cache);
 		return;
 	}
-	task.func = ExecLoadImage;
-	task.arg[0] = widget;
-	task.arg[1] = strdup2(path);
-	task.destroy_arg[1] = free;
+	cache = NEW(ImageCacheRec, 1);
+	cache->loaded = FALSE;
+	cache->path = strdup2(path);
+	Graph_Init(&cache->image);
+	LinkedList_Init(&cache->refs);
+	Dict_Add(self.images, cache->path, cache);
+	AddImageRef(widget, cache);
+	task.func = ExecLoadImageHeader;
+	task.arg[0] = strdup2(path);
+	task.destroy_arg[0] = free;
 	LCUI_PostAsyncTask(&task);
 }
 
@@ -232,13 +340,13 @@ void Widget_DestroyBackground(LCUI_Widget w)
 
 void Widget_ComputeBackgroundStyle(LCUI_Widget widget)
 {
-	LCUI_Style s;
+	const LCUI_StyleRec *s;
 	LCUI_StyleSheet ss = widget->style;
 	LCUI_BackgroundStyle *bg = &widget->computed_style.background;
 	int key = key_background_start;
 
 	for (; key <= key_background_end; ++key) {
-		s = &ss->sheet[key];
+		s = StyleSheet_GetStyle(ss, key);
 		switch (key) {
 		case key_background_color:
 			if (s->is_valid) {
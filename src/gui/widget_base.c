@@ -358,7 +358,7 @@ void Widget_AddState(LCUI_Widget w, LCUI_WidgetState state)
 
 float Widget_ComputeXMetric(LCUI_Widget w, int key)
 {
-	LCUI_Style s = &w->style->sheet[key];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(w->style, key);
 
 	if (s->type == LCUI_STYPE_SCALE) {
 		if (!w->parent) {
@@ -374,7 +374,7 @@ float Widget_ComputeXMetric(LCUI_Widget w, int key)
 
 float Widget_ComputeYMetric(LCUI_Widget w, int key)
 {
-	LCUI_Style s = &w->style->sheet[key];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(w->style, key);
 
 	if (s->type == LCUI_STYPE_SCALE) {
 		if (!w->parent) {
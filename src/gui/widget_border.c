@@ -36,7 +36,7 @@
 #include <LCUI/gui/widget.h>
 #include "widget_border.h"
 
-static float ComputeXMetric(LCUI_Widget w, LCUI_Style s)
+static float ComputeXMetric(LCUI_Widget w, const LCUI_StyleRec *s)
 {
 	if (s->type == LCUI_STYPE_SCALE) {
 		return w->width * s->scale;
@@ -44,7 +44,7 @@ static float ComputeXMetric(LCUI_Widget w, LCUI_Style s)
 	return LCUIMetrics_Compute(s->value, s->type);
 }
 
-static float ComputeYMetric(LCUI_Widget w, LCUI_Style s)
+static float ComputeYMetric(LCUI_Widget w, const LCUI_StyleRec *s)
 {
 	if (s->type == LCUI_STYPE_SCALE) {
 		return w->height * s->scale;
@@ -55,12 +55,12 @@ static float ComputeYMetric(LCUI_Widget w, LCUI_Style s)
 void Widget_ComputeBorderStyle(LCUI_Widget w)
 {
 	int key;
-	LCUI_Style s;
+	const LCUI_StyleRec *s;
 	LCUI_BorderStyle *b;
 	b = &w->computed_style.border;
 	memset(b, 0, sizeof(LCUI_BorderStyle));
 	for (key = key_border_start; key <= key_border_end; ++key) {
-		s = &w->style->sheet[key];
+		s = StyleSheet_GetStyle(w->style, key);
 		if (!s->is_valid) {
 			continue;
 		}
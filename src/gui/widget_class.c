@@ -74,6 +74,7 @@ int Widget_AddClass(LCUI_Widget w, const char *class_name)
 	if (strlist_add(&w->classes, class_name) <= 0) {
 		return 0;
 	}
+	Widget_InvalidateSelectorNode(w);
 	return Widget_HandleClassesChange(w, class_name);
 }
 
@@ -90,6 +91,7 @@ int Widget_RemoveClass(LCUI_Widget w, const char *class_name)
 	if (strlist_has(w->classes, class_name)) {
 		Widget_HandleClassesChange(w, class_name);
 		strlist_remove(&w->classes, class_name);
+		Widget_InvalidateSelectorNode(w);
 		return 1;
 	}
 	return 0;
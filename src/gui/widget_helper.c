@@ -137,22 +137,25 @@ int Widget_UnsetStyle(LCUI_Widget w, int key)
 	return StyleList_RemoveNode(w->custom_style, key);
 }
 
-LCUI_Style Widget_GetInheritedStyle(LCUI_Widget w, int key)
+const LCUI_StyleRec *Widget_GetInheritedStyle(LCUI_Widget w, int key)
 {
-	LCUI_Selector selector;
+	static const LCUI_StyleSheetRec empty_sheet = { 0 };
+	LCUI_SelectorRec selector;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
 
 	if (!w->inherited_style) {
-		selector = Widget_GetSelector(w);
-		w->inherited_style = LCUI_GetCachedStyleSheet(selector);
-		Selector_Delete(selector);
+		/* 部件层级过深时无法生成选择器，当作没有继承的样式 */
+		if (Widget_InitSelector(w, &selector, nodes) != 0) {
+			return StyleSheet_GetStyle(&empty_sheet, key);
+		}
+		w->inherited_style = LCUI_GetCachedStyleSheet(&selector);
 	}
-	assert(key >= 0 && key < w->inherited_style->length);
-	return &w->inherited_style->sheet[key];
+	return StyleSheet_GetStyle(w->inherited_style, key);
 }
 
 LCUI_BOOL Widget_CheckStyleBooleanValue(LCUI_Widget w, int key, LCUI_BOOL value)
 {
-	LCUI_Style s = &w->style->sheet[key_focusable];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(w->style, key_focusable);
 
 	return s->is_valid && s->type == LCUI_STYPE_BOOL &&
 	       s->val_bool == value;
@@ -160,7 +163,7 @@ LCUI_BOOL Widget_CheckStyleBooleanValue(LCUI_Widget w, int key, LCUI_BOOL value)
 
 LCUI_BOOL Widget_CheckStyleValid(LCUI_Widget w, int key)
 {
-	return w->style && w->style->sheet[key].is_valid;
+	return w->style && StyleSheet_GetStyle(w->style, key)->is_valid;
 }
 
 void Widget_SetVisibility(LCUI_Widget w, const char *value)
@@ -186,7 +189,7 @@ void Widget_SetHidden(LCUI_Widget w)
 
 void Widget_Show(LCUI_Widget w)
 {
-	LCUI_Style s = Widget_GetStyle(w, key_display);
+	const LCUI_StyleRec *s = Widget_GetStyle(w, key_display);
 
 	if (s->is_valid && s->type == LCUI_STYPE_STYLE &&
 	    s->val_style == SV_NONE) {
@@ -34,6 +34,7 @@
 #include <LCUI/thread.h>
 #include <LCUI/gui/widget_base.h>
 #include <LCUI/gui/widget_id.h>
+#include <LCUI/gui/widget_style.h>
 
 static struct LCUI_WidgetIdLibraryModule {
 	Dict *ids;
@@ -68,6 +69,7 @@ static int Widget_FreeId(LCUI_Widget w)
 int Widget_DestroyId(LCUI_Widget w)
 {
 	int ret;
+	Widget_InvalidateSelectorNode(w);
 	LCUIMutex_Lock(&self.mutex);
 	ret = Widget_FreeId(w);
 	LCUIMutex_Unlock(&self.mutex);
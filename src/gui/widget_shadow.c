@@ -36,7 +36,7 @@
 #include <LCUI/draw/boxshadow.h>
 #include "widget_shadow.h"
 
-static float ComputeXMetric(LCUI_Widget w, LCUI_Style s)
+static float ComputeXMetric(LCUI_Widget w, const LCUI_StyleRec *s)
 {
 	if (s->type == LCUI_STYPE_SCALE) {
 		return w->width * s->scale;
@@ -44,7 +44,7 @@ static float ComputeXMetric(LCUI_Widget w, LCUI_Style s)
 	return LCUIMetrics_Compute(s->value, s->type);
 }
 
-static float ComputeYMetric(LCUI_Widget w, LCUI_Style s)
+static float ComputeYMetric(LCUI_Widget w, const LCUI_StyleRec *s)
 {
 	if (s->type == LCUI_STYPE_SCALE) {
 		return w->height * s->scale;
@@ -55,13 +55,13 @@ static float ComputeYMetric(LCUI_Widget w, LCUI_Style s)
 void Widget_ComputeBoxShadowStyle(LCUI_Widget w)
 {
 	int key;
-	LCUI_Style s;
+	const LCUI_StyleRec *s;
 	LCUI_BoxShadowStyle *sd;
 
 	sd = &w->computed_style.shadow;
 	memset(sd, 0, sizeof(LCUI_BoxShadowStyle));
 	for (key = key_box_shadow_start; key <= key_box_shadow_end; ++key) {
-		s = &w->style->sheet[key];
+		s = StyleSheet_GetStyle(w->style, key);
 		if (!s->is_valid) {
 			continue;
 		}
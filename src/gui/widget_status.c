@@ -73,6 +73,7 @@ int Widget_AddStatus(LCUI_Widget w, const char *status_name)
 	if (strlist_add(&w->status, status_name) <= 0) {
 		return 0;
 	}
+	Widget_InvalidateSelectorNode(w);
 	return Widget_HandleStatusChange(w, status_name);
 }
 
@@ -89,6 +90,7 @@ int Widget_RemoveStatus(LCUI_Widget w, const char *status_name)
 	if (strlist_has(w->status, status_name)) {
 		Widget_HandleStatusChange(w, status_name);
 		strlist_remove(&w->status, status_name);
+		Widget_InvalidateSelectorNode(w);
 		return 1;
 	}
 	return 0;
@@ -73,11 +73,12 @@ root {
 
 INLINE int ComputeStyleOption(LCUI_Widget w, int key, int default_value)
 {
-	if (!w->style->sheet[key].is_valid ||
-	    w->style->sheet[key].type != LCUI_STYPE_STYLE) {
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(w->style, key);
+
+	if (!s->is_valid || s->type != LCUI_STYPE_STYLE) {
 		return default_value;
 	}
-	return w->style->sheet[key].style;
+	return s->style;
 }
 
 void Widget_ComputePaddingStyle(LCUI_Widget w)
@@ -115,10 +116,10 @@ void Widget_ComputeMarginStyle(LCUI_Widget w)
 
 void Widget_ComputeProperties(LCUI_Widget w)
 {
-	LCUI_Style s;
+	const LCUI_StyleRec *s;
 	LCUI_WidgetStyle *style = &w->computed_style;
 
-	s = &w->style->sheet[key_focusable];
+	s = StyleSheet_GetStyle(w->style, key_focusable);
 	style->pointer_events =
 	    ComputeStyleOption(w, key_pointer_events, SV_INHERIT);
 	if (s->is_valid && s->type == LCUI_STYPE_BOOL && s->val_bool == 0) {
@@ -338,7 +339,7 @@ void Widget_ComputeFlexBasisStyle(LCUI_Widget w)
 
 void Widget_ComputeVisibilityStyle(LCUI_Widget w)
 {
-	LCUI_Style s = &w->style->sheet[key_visibility];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(w->style, key_visibility);
 
 	if (w->computed_style.display == SV_NONE) {
 		w->computed_style.visible = FALSE;
@@ -352,7 +353,7 @@ void Widget_ComputeVisibilityStyle(LCUI_Widget w)
 
 void Widget_ComputeDisplayStyle(LCUI_Widget w)
 {
-	LCUI_Style s = &w->style->sheet[key_display];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(w->style, key_display);
 	LCUI_WidgetStyle *style = &w->computed_style;
 
 	if (s->is_valid && s->type == LCUI_STYPE_STYLE) {
@@ -369,7 +370,7 @@ void Widget_ComputeDisplayStyle(LCUI_Widget w)
 void Widget_ComputeOpacityStyle(LCUI_Widget w)
 {
 	float opacity = 1.0;
-	LCUI_Style s = &w->style->sheet[key_opacity];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(w->style, key_opacity);
 
 	if (s->is_valid) {
 		switch (s->type) {
@@ -394,7 +395,7 @@ void Widget_ComputeOpacityStyle(LCUI_Widget w)
 
 void Widget_ComputeZIndexStyle(LCUI_Widget w)
 {
-	LCUI_Style s = &w->style->sheet[key_z_index];
+	const LCUI_StyleRec *s = StyleSheet_GetStyle(w->style, key_z_index);
 
 	if (s->is_valid && s->type == LCUI_STYPE_INT) {
 		w->computed_style.z_index = s->val_int;
@@ -419,7 +420,7 @@ void Widget_ComputePositionStyle(LCUI_Widget w)
 
 void Widget_ComputeFlexBoxStyle(LCUI_Widget w)
 {
-	LCUI_Style s = w->style->sheet;
+	const LCUI_StyleRec *s;
 	LCUI_FlexBoxLayoutStyle *flex = &w->computed_style.flex;
 
 	if (!Widget_IsFlexLayoutStyleWorks(w)) {
@@ -438,37 +439,45 @@ void Widget_ComputeFlexBoxStyle(LCUI_Widget w)
 
 	/* Compute style */
 
-	if (s[key_flex_grow].is_valid &&
-	    s[key_flex_grow].type == LCUI_STYPE_INT) {
-		flex->grow = 1.f * s[key_flex_grow].val_int;
+	s = StyleSheet_GetStyle(w->style, key_flex_grow);
+	if (s->is_valid && s->type == LCUI_STYPE_INT) {
+		flex->grow = 1.f * s->val_int;
 	}
-	if (s[key_flex_shrink].is_valid &&
-	    s[key_flex_shrink].type == LCUI_STYPE_INT) {
-		flex->shrink = 1.f * s[key_flex_shrink].val_int;
+	s = StyleSheet_GetStyle(w->style, key_flex_shrink);
+	if (s->is_valid && s->type == LCUI_STYPE_INT) {
+		flex->shrink = 1.f * s->val_int;
 	}
-	if (s[key_flex_wrap].is_valid &&
-	    s[key_flex_wrap].type == LCUI_STYPE_STYLE) {
-		flex->wrap = s[key_flex_wrap].val_style;
+	s = StyleSheet_GetStyle(w->style, key_flex_wrap);
+	if (s->is_valid && s->type == LCUI_STYPE_STYLE) {
+		flex->wrap = s->val_style;
 	}
-	if (s[key_flex_direction].is_valid &&
-	    s[key_flex_direction].type == LCUI_STYPE_STYLE) {
-		flex->direction = s[key_flex_direction].val_style;
+	s = StyleSheet_GetStyle(w->style, key_flex_direction);
+	if (s->is_valid && s->type == LCUI_STYPE_STYLE) {
+		flex->direction = s->val_style;
 	}
-	if (s[key_justify_content].is_valid &&
-	    s[key_justify_content].type == LCUI_STYPE_STYLE) {
-		flex->justify_content = s[key_justify_content].val_style;
+	s = StyleSheet_GetStyle(w->style, key_justify_content);
+	if (s->is_valid && s->type == LCUI_STYPE_STYLE) {
+		flex->justify_content = s->val_style;
 	}
-	if (s[key_align_content].is_valid &&
-	    s[key_align_content].type == LCUI_STYPE_STYLE) {
-		flex->align_content = s[key_align_content].val_style;
+	s = StyleSheet_GetStyle(w->style, key_align_content);
+	if (s->is_valid && s->type == LCUI_STYPE_STYLE) {
+		flex->align_content = s->val_style;
 	}
-	if (s[key_align_items].is_valid &&
-	    s[key_align_items].type == LCUI_STYPE_STYLE) {
-		flex->align_items = s[key_align_items].val_style;
+	s = StyleSheet_GetStyle(w->style, key_align_items);
+	if (s->is_valid && s->type == LCUI_STYPE_STYLE) {
+		flex->align_items = s->val_style;
 	}
 	Widget_ComputeFlexBasisStyle(w);
 }
 
+void Widget_InvalidateSelectorNode(LCUI_Widget w)
+{
+	if (w->selector_node) {
+		SelectorNode_Delete(w->selector_node);
+		w->selector_node = NULL;
+	}
+}
+
 LCUI_SelectorNode Widget_GetSelectorNode(LCUI_Widget w)
 {
 	int i;
@@ -491,43 +500,61 @@ LCUI_SelectorNode Widget_GetSelectorNode(LCUI_Widget w)
 	return sn;
 }
 
-LCUI_Selector Widget_GetSelector(LCUI_Widget w)
+LCUI_SelectorNode Widget_GetCachedSelectorNode(LCUI_Widget w)
+{
+	if (!w->selector_node) {
+		w->selector_node = Widget_GetSelectorNode(w);
+	}
+	return w->selector_node;
+}
+
+#define Widget_HasSelectorNode(W) \
+	((W)->id || (W)->type || (W)->classes || (W)->status)
+
+int Widget_InitSelector(LCUI_Widget w, LCUI_Selector s,
+			LCUI_SelectorNode *nodes)
 {
 	int i = 0;
-	LinkedList list;
-	LCUI_Selector s;
 	LCUI_Widget parent;
-	LinkedListNode *node;
 
-	s = Selector(NULL);
-	LinkedList_Init(&list);
 	for (parent = w; parent; parent = parent->parent) {
-		if (parent->id || parent->type || parent->classes ||
-		    parent->status) {
-			LinkedList_Append(&list, parent);
+		if (Widget_HasSelectorNode(parent)) {
+			++i;
 		}
 	}
-	if (list.length >= MAX_SELECTOR_DEPTH) {
-		LinkedList_Clear(&list, NULL);
-		Selector_Delete(s);
-		return NULL;
+	if (i >= MAX_SELECTOR_DEPTH) {
+		return -1;
 	}
-	for (LinkedList_EachReverse(node, &list)) {
-		parent = node->data;
-		s->nodes[i] = Widget_GetSelectorNode(parent);
-		s->rank += s->nodes[i]->rank;
-		i += 1;
-	}
-	LinkedList_Clear(&list, NULL);
-	s->nodes[i] = NULL;
+	s->rank = 0;
 	s->length = i;
+	s->batch_num = 0;
+	s->nodes = nodes;
+	s->nodes[i] = NULL;
+	for (parent = w; parent; parent = parent->parent) {
+		if (Widget_HasSelectorNode(parent)) {
+			s->nodes[--i] = Widget_GetCachedSelectorNode(parent);
+			s->rank += s->nodes[i]->rank;
+		}
+	}
 	Selector_Update(s);
-	return s;
+	return 0;
+}
+
+LCUI_Selector Widget_GetSelector(LCUI_Widget w)
+{
+	LCUI_SelectorRec s;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
+
+	if (Widget_InitSelector(w, &s, nodes) != 0) {
+		return NULL;
+	}
+	return Selector_Copy(&s);
 }
 
 size_t Widget_GetChildrenStyleChanges(LCUI_Widget w, int type, const char *name)
 {
-	LCUI_Selector s;
+	LCUI_SelectorRec s;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
 	LinkedList snames;
 	LinkedListNode *node;
 
@@ -545,9 +572,21 @@ size_t Widget_GetChildrenStyleChanges(LCUI_Widget w, int type, const char *name)
 	default:
 		return 0;
 	}
-	LinkedList_Init(&snames);
-	s = Widget_GetSelector(w);
 	n = strsplit(name, " ", &names);
+	/* 没有规则在祖先结点中用到这些名称时，子级部件的样式不会变 */
+	for (i = 0; i < n; ++i) {
+		if (LCUI_IsAncestorSelectorName(ch, names[i])) {
+			break;
+		}
+	}
+	if (i >= n || Widget_InitSelector(w, &s, nodes) != 0) {
+		for (i = 0; names[i]; ++i) {
+			free(names[i]);
+		}
+		free(names);
+		return 0;
+	}
+	LinkedList_Init(&snames);
 	/* 为分割出来的字符串加上前缀 */
 	for (i = 0; i < n; ++i) {
 		len = strlen(names[i]) + 2;
@@ -557,7 +596,7 @@ size_t Widget_GetChildrenStyleChanges(LCUI_Widget w, int type, const char *name)
 		free(names[i]);
 		names[i] = str;
 	}
-	SelectorNode_GetNames(s->nodes[s->length - 1], &snames);
+	SelectorNode_GetNames(s.nodes[s.length - 1], &snames);
 	for (LinkedList_Each(node, &snames)) {
 		char *sname = node->data;
 		/* 过滤掉不包含 name 中存在的名称 */
@@ -578,10 +617,9 @@ size_t Widget_GetChildrenStyleChanges(LCUI_Widget w, int type, const char *name)
 		}
 		if (i < n) {
 			count +=
-			    LCUI_FindStyleSheetFromGroup(1, sname, s, NULL);
+			    LCUI_FindStyleSheetFromGroup(1, sname, &s, NULL);
 		}
 	}
-	Selector_Delete(s);
 	LinkedList_Clear(&snames, free);
 	for (i = 0; names[i]; ++i) {
 		free(names[i]);
@@ -592,9 +630,12 @@ size_t Widget_GetChildrenStyleChanges(LCUI_Widget w, int type, const char *name)
 
 void Widget_PrintStyleSheets(LCUI_Widget w)
 {
-	LCUI_Selector s = Widget_GetSelector(w);
-	LCUI_PrintStyleSheetsBySelector(s);
-	Selector_Delete(s);
+	LCUI_SelectorRec s;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
+
+	if (Widget_InitSelector(w, &s, nodes) == 0) {
+		LCUI_PrintStyleSheetsBySelector(&s);
+	}
 }
 
 void Widget_UpdateStyle(LCUI_Widget w, LCUI_BOOL is_refresh_all)
@@ -693,7 +734,7 @@ void Widget_ExecUpdateStyle(LCUI_Widget w, LCUI_BOOL is_update_all)
 	}
 	StyleSheet_Merge(w->style, w->inherited_style);
 	if (w->proto && w->proto->update &&
-	    w->style->length > STYLE_KEY_TOTAL) {
+	    LCUI_GetStyleTotal() > STYLE_KEY_TOTAL) {
 		/* 扩展部分的样式交给该部件自己处理 */
 		w->proto->update(w);
 	}
@@ -701,6 +742,7 @@ void Widget_ExecUpdateStyle(LCUI_Widget w, LCUI_BOOL is_update_all)
 
 void Widget_DestroyStyleSheets(LCUI_Widget w)
 {
+	Widget_InvalidateSelectorNode(w);
 	w->inherited_style = NULL;
 	if (w->custom_style) {
 		StyleList_Delete(w->custom_style);
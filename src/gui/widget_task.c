@@ -43,9 +43,23 @@
 
 typedef struct LCUI_WidgetTaskContextRec_ *LCUI_WidgetTaskContext;
 
+/** 每个部件为其子部件记录的可共享样式表的数量 */
+#define MAX_SHARED_STYLES 4
+
+/** 子部件查找到的样式表，供后面选择器结点相同的兄弟部件共享 */
+typedef struct LCUI_SharedStyleRec_ {
+	unsigned hash;
+	unsigned parent_hash;
+	char *fullname;
+	unsigned version;
+	LCUI_CachedStyleSheet style;
+} LCUI_SharedStyleRec, *LCUI_SharedStyle;
+
 typedef struct LCUI_WidgetTaskContextRec_ {
 	unsigned style_hash;
 	Dict *style_cache;
+	LCUI_SharedStyleRec shared_styles[MAX_SHARED_STYLES];
+	unsigned shared_index;
 	LCUI_WidgetStyleDiffRec style_diff;
 	LCUI_WidgetLayoutDiffRec layout_diff;
 	LCUI_WidgetTaskContext parent;
@@ -201,14 +215,96 @@ void LCUIWidget_FreeTasks(void)
 	LCUIWidget_ClearTrash();
 }
 
+/**
+ * 判断部件能否共享兄弟部件的样式表
+ * 兄弟部件的祖先相同，只要自身的类型、类和状态也相同，那么选择器也就相同，
+ * 匹配到的样式表自然也相同。带 id 的部件可能会有专属的样式，不参与共享。
+ */
+static LCUI_BOOL Widget_CanShareStyle(LCUI_Widget w)
+{
+	return !w->id && (w->type || w->classes || w->status);
+}
+
+/**
+ * 计算祖先部件的选择器结点的哈希值
+ * 兄弟部件在更新期间，祖先的类或状态可能会变化，共享样式表时需要比较它。
+ */
+static unsigned Widget_GetAncestorsHash(LCUI_Widget w)
+{
+	unsigned hash = 5381;
+	LCUI_Widget parent;
+
+	for (parent = w->parent; parent; parent = parent->parent) {
+		if (parent->id || parent->type || parent->classes ||
+		    parent->status) {
+			hash = ((hash << 5) + hash) ^
+			       Widget_GetCachedSelectorNode(parent)->hash;
+		}
+	}
+	return hash;
+}
+
+static LCUI_CachedStyleSheet Widget_GetSharedStyle(LCUI_Widget w,
+						   LCUI_WidgetTaskContext ctx)
+{
+	int i;
+	unsigned version, parent_hash;
+	LCUI_SelectorNode node;
+	LCUI_SharedStyle shared;
+
+	if (!ctx->shared_styles[0].fullname || !Widget_CanShareStyle(w)) {
+		return NULL;
+	}
+	node = Widget_GetCachedSelectorNode(w);
+	if (!node || !node->fullname) {
+		return NULL;
+	}
+	version = LCUI_GetStyleSheetCacheVersion();
+	parent_hash = Widget_GetAncestorsHash(w);
+	for (i = 0; i < MAX_SHARED_STYLES; ++i) {
+		shared = &ctx->shared_styles[i];
+		if (shared->fullname && shared->hash == node->hash &&
+		    shared->parent_hash == parent_hash &&
+		    shared->version == version &&
+		    strcmp(shared->fullname, node->fullname) == 0) {
+			return shared->style;
+		}
+	}
+	return NULL;
+}
+
+static void Widget_SetSharedStyle(LCUI_Widget w, LCUI_WidgetTaskContext ctx)
+{
+	LCUI_SelectorNode node;
+	LCUI_SharedStyle shared;
+
+	if (!Widget_CanShareStyle(w)) {
+		return;
+	}
+	node = Widget_GetCachedSelectorNode(w);
+	if (!node || !node->fullname) {
+		return;
+	}
+	shared = &ctx->shared_styles[ctx->shared_index];
+	ctx->shared_index = (ctx->shared_index + 1) % MAX_SHARED_STYLES;
+	free(shared->fullname);
+	shared->fullname = strdup2(node->fullname);
+	shared->hash = node->hash;
+	shared->parent_hash = Widget_GetAncestorsHash(w);
+	shared->style = w->inherited_style;
+	shared->version = LCUI_GetStyleSheetCacheVersion();
+}
+
 LCUI_WidgetTaskContext Widget_BeginUpdate(LCUI_Widget w,
 					  LCUI_WidgetTaskContext ctx)
 {
 	unsigned hash;
-	LCUI_Selector selector;
+	LCUI_SelectorRec selector;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
 	LCUI_StyleSheet style;
 	LCUI_WidgetRulesData data;
 	LCUI_CachedStyleSheet inherited_style;
+	LCUI_CachedStyleSheet shared_style;
 	LCUI_WidgetTaskContext self_ctx;
 	LCUI_WidgetTaskContext parent_ctx;
 
@@ -218,6 +314,8 @@ LCUI_WidgetTaskContext Widget_BeginUpdate(LCUI_Widget w,
 	}
 	self_ctx->parent = ctx;
 	self_ctx->style_cache = NULL;
+	self_ctx->shared_index = 0;
+	memset(self_ctx->shared_styles, 0, sizeof(self_ctx->shared_styles));
 	for (parent_ctx = ctx; parent_ctx; parent_ctx = parent_ctx->parent) {
 		if (parent_ctx->style_cache) {
 			self_ctx->style_cache = parent_ctx->style_cache;
@@ -245,22 +343,35 @@ LCUI_WidgetTaskContext Widget_BeginUpdate(LCUI_Widget w,
 		self_ctx->style_cache = data->style_cache;
 	}
 	inherited_style = w->inherited_style;
-	if (self_ctx->style_cache && w->hash) {
+	shared_style = NULL;
+	if (!self_ctx->style_cache && ctx) {
+		shared_style = Widget_GetSharedStyle(w, ctx);
+	}
+	if (shared_style) {
+		w->inherited_style = shared_style;
+		if (self_ctx->profile) {
+			self_ctx->profile->style_share_count += 1;
+		}
+	} else if (Widget_InitSelector(w, &selector, nodes) != 0) {
+		return self_ctx;
+	} else if (self_ctx->style_cache && w->hash) {
 		hash = self_ctx->style_hash;
 		hash = ((hash << 5) + hash) + w->hash;
 		style = Dict_FetchValue(self_ctx->style_cache, &hash);
 		if (!style) {
 			style = StyleSheet();
-			selector = Widget_GetSelector(w);
-			LCUI_GetStyleSheet(selector, style);
+			LCUI_GetStyleSheet(&selector, style);
 			Dict_Add(self_ctx->style_cache, &hash, style);
-			Selector_Delete(selector);
 		}
 		w->inherited_style = style;
 	} else {
-		selector = Widget_GetSelector(w);
-		w->inherited_style = LCUI_GetCachedStyleSheet(selector);
-		Selector_Delete(selector);
+		w->inherited_style = LCUI_GetCachedStyleSheet(&selector);
+		if (ctx) {
+			Widget_SetSharedStyle(w, ctx);
+		}
+		if (self_ctx->profile) {
+			self_ctx->profile->style_lookup_count += 1;
+		}
 	}
 	if (w->inherited_style != inherited_style) {
 		Widget_AddTask(w, LCUI_WTASK_REFRESH_STYLE);
@@ -270,8 +381,13 @@ LCUI_WidgetTaskContext Widget_BeginUpdate(LCUI_Widget w,
 
 void Widget_EndUpdate(LCUI_WidgetTaskContext ctx)
 {
+	int i;
+
 	ctx->style_cache = NULL;
 	ctx->parent = NULL;
+	for (i = 0; i < MAX_SHARED_STYLES; ++i) {
+		free(ctx->shared_styles[i].fullname);
+	}
 	free(ctx);
 }
 
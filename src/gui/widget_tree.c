@@ -259,7 +259,7 @@ static void _LCUIWidget_PrintTree(LCUI_Widget w, int depth, const char *prefix)
 		} else {
 			strcat(str, "┬");
 		}
-		snode = Widget_GetSelectorNode(child);
+		snode = Widget_GetCachedSelectorNode(child);
 		Logger_Error(
 		    "%s%s %s, xy:(%g,%g), size:(%g,%g), "
 		    "visible: %s, display: %d, padding: (%g,%g,%g,%g), margin: "
@@ -271,7 +271,6 @@ static void _LCUIWidget_PrintTree(LCUI_Widget w, int depth, const char *prefix)
 		    child->padding.right, child->padding.bottom,
 		    child->padding.left, child->margin.top, child->margin.right,
 		    child->margin.bottom, child->margin.left);
-		SelectorNode_Delete(snode);
 		_LCUIWidget_PrintTree(child, depth + 1, child_prefix);
 	}
 }
@@ -280,11 +279,10 @@ void Widget_PrintTree(LCUI_Widget w)
 {
 	LCUI_SelectorNode node;
 	w = w ? w : LCUIWidget_GetRoot();
-	node = Widget_GetSelectorNode(w);
+	node = Widget_GetCachedSelectorNode(w);
 	Logger_Error("%s, xy:(%g,%g), size:(%g,%g), visible: %s\n",
 		     node->fullname, w->x, w->y, w->width, w->height,
 		     w->computed_style.visible ? "true" : "false");
-	SelectorNode_Delete(node);
 	_LCUIWidget_PrintTree(w, 0, "  ");
 }
 
@@ -185,6 +185,8 @@ int LCUI_ReadImageFile(const char *filepath, LCUI_Graph *out)
 		}
 	}
 	if (LCUI_SetImageReaderJump(&reader)) {
+		/* 解码出错时，图像数据可能已经分配，需要释放它 */
+		Graph_Free(out);
 		ret = -2;
 	} else {
 		ret = LCUI_ReadImage(&reader, out);
@@ -143,14 +143,18 @@ static void LCUIProfile_Print(LCUI_Profile profile)
 			     "widget_tasks.layout_count: %u\n"
 			     "widget_tasks.user_task_count: %u\n"
 			     "widget_tasks.destroy_count: %u\n"
-			     "widget_tasks.destroy_time: %ldms\n",
+			     "widget_tasks.destroy_time: %ldms\n"
+			     "widget_tasks.style_share_count: %u\n"
+			     "widget_tasks.style_lookup_count: %u\n",
 			     frame->widget_tasks.time,
 			     frame->widget_tasks.update_count,
 			     frame->widget_tasks.refresh_count,
 			     frame->widget_tasks.layout_count,
 			     frame->widget_tasks.user_task_count,
 			     frame->widget_tasks.destroy_count,
-			     frame->widget_tasks.destroy_time);
+			     frame->widget_tasks.destroy_time,
+			     frame->widget_tasks.style_share_count,
+			     frame->widget_tasks.style_lookup_count);
 		Logger_Debug("render: %zu, %ldms, %ldms\n", frame->render_count,
 			     frame->render_time, frame->present_time);
 	}
@@ -209,6 +213,7 @@ void LCUI_RunFrameWithProfile(LCUI_FrameProfile profile)
 	profile->present_time = clock();
 	LCUIDisplay_Present();
 	profile->present_time = clock() - profile->present_time;
+	LCUIFont_EndFrame();
 }
 
 void LCUI_RunFrame(void)
@@ -220,6 +225,7 @@ void LCUI_RunFrame(void)
 	LCUIDisplay_Update();
 	LCUIDisplay_Render();
 	LCUIDisplay_Present();
+	LCUIFont_EndFrame();
 }
 
 static void LCUI_InitEvent(void)
@@ -101,15 +101,18 @@ int LCUIThread_Create(LCUI_Thread *thread, void (*func)(void *), void *arg)
 	ctx->arg = arg;
 	ctx->func = func;
 	ctx->node.data = ctx;
+	/* 新线程退出时需要从列表中移除上下文，因此在它被加入列表前，不能让
+	 * 新线程访问该列表 */
+	LCUIMutex_Lock(&self.mutex);
 	ret = pthread_create(&ctx->tid, NULL, LCUIThread_Run, ctx);
 	if (ret != 0) {
+		LCUIMutex_Unlock(&self.mutex);
 		free(ctx);
 		return ret;
 	}
-	LCUIMutex_Lock(&self.mutex);
+	*thread = ctx->tid;
 	LinkedList_AppendNode(&self.threads, &ctx->node);
 	LCUIMutex_Unlock(&self.mutex);
-	*thread = ctx->tid;
 	return ret;
 }
 
@@ -0,0 +1,168 @@
+﻿/*
+ * atom.c -- the table of interned names
+ *
+ * Copyright (c) 2019, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/thread.h>
+#include <LCUI/util/string.h>
+#include <LCUI/util/dict.h>
+#include <LCUI/util/atom.h>
+
+/**
+ * 原子表
+ * 名称只在第一次用到时复制一份，在原子表被销毁前不会释放，因此原子和名称的
+ * 指针都可以一直保存到那时。查找和新增原子时需持有 mutex，其它线程可以同时
+ * 使用原子表，但初始化和销毁原子表只能在一个线程中进行。
+ */
+static struct atom_table {
+	LCUI_BOOL active;
+	size_t length;
+	size_t capacity;
+	char **names;
+	DictType type;
+	Dict *dict;
+	LCUI_Mutex mutex;
+} atoms;
+
+void atom_table_init(void)
+{
+	if (atoms.active) {
+		return;
+	}
+	Dict_InitStringKeyType(&atoms.type);
+	atoms.type.keyDup = NULL;
+	atoms.type.keyDestructor = NULL;
+	atoms.type.valDestructor = NULL;
+	atoms.dict = Dict_Create(&atoms.type, NULL);
+	atoms.length = 0;
+	atoms.capacity = 0;
+	atoms.names = NULL;
+	LCUIMutex_Init(&atoms.mutex);
+	atoms.active = TRUE;
+}
+
+void atom_table_destroy(void)
+{
+	size_t i;
+
+	if (!atoms.active) {
+		return;
+	}
+	atoms.active = FALSE;
+	Dict_Release(atoms.dict);
+	for (i = 0; i < atoms.length; ++i) {
+		free(atoms.names[i]);
+	}
+	free(atoms.names);
+	atoms.dict = NULL;
+	atoms.names = NULL;
+	atoms.length = 0;
+	atoms.capacity = 0;
+	LCUIMutex_Destroy(&atoms.mutex);
+}
+
+atom_t atom_find(const char *str)
+{
+	atom_t atom;
+
+	if (!str || !atoms.active) {
+		return ATOM_NONE;
+	}
+	LCUIMutex_Lock(&atoms.mutex);
+	atom = (atom_t)(size_t)Dict_FetchValue(atoms.dict, str);
+	LCUIMutex_Unlock(&atoms.mutex);
+	return atom;
+}
+
+static atom_t atom_table_add(const char *str)
+{
+	char *name, **names;
+	size_t capacity;
+	atom_t atom;
+
+	atom = (atom_t)(size_t)Dict_FetchValue(atoms.dict, str);
+	if (atom != ATOM_NONE) {
+		return atom;
+	}
+	if (atoms.length >= atoms.capacity) {
+		capacity = atoms.capacity > 0 ? atoms.capacity * 2 : 256;
+		names = realloc(atoms.names, capacity * sizeof(char *));
+		if (!names) {
+			return ATOM_NONE;
+		}
+		atoms.names = names;
+		atoms.capacity = capacity;
+	}
+	name = strdup2(str);
+	if (!name) {
+		return ATOM_NONE;
+	}
+	atoms.names[atoms.length++] = name;
+	atom = (atom_t)atoms.length;
+	Dict_Add(atoms.dict, name, (void *)(size_t)atom);
+	return atom;
+}
+
+atom_t atom_from_str(const char *str)
+{
+	atom_t atom;
+
+	if (!str) {
+		return ATOM_NONE;
+	}
+	atom_table_init();
+	LCUIMutex_Lock(&atoms.mutex);
+	atom = atom_table_add(str);
+	LCUIMutex_Unlock(&atoms.mutex);
+	return atom;
+}
+
+const char *atom_to_str(atom_t atom)
+{
+	const char *name = NULL;
+
+	if (atom == ATOM_NONE || !atoms.active) {
+		return NULL;
+	}
+	LCUIMutex_Lock(&atoms.mutex);
+	if (atom <= atoms.length) {
+		name = atoms.names[atom - 1];
+	}
+	LCUIMutex_Unlock(&atoms.mutex);
+	return name;
+}
+
+size_t atom_count(void)
+{
+	return atoms.length;
+}
@@ -28,6 +28,7 @@
  */
 
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,9 +37,85 @@
 #include <LCUI/util/parse.h>
 #include <LCUI/font/fontlibrary.h>
 
+/**
+ * 将字符串开头的十进制数转换为浮点数
+ * 用于替代 sscanf("%f")，避免格式字符串解析和区域设置带来的开销
+ * @param[out] value 转换结果
+ * @returns 读取到的数字个数，为 0 时表示转换失败
+ */
+static int ParseDecimal(const char *str, double *value)
+{
+	int digits = 0;
+	double scale = 1.0, sign = 1.0, num = 0;
+	const char *p = str;
+
+	while (isspace((unsigned char)*p)) {
+		++p;
+	}
+	if (*p == '-') {
+		sign = -1.0;
+		++p;
+	} else if (*p == '+') {
+		++p;
+	}
+	for (; *p >= '0' && *p <= '9'; ++p, ++digits) {
+		num = num * 10.0 + (*p - '0');
+	}
+	if (*p == '.') {
+		for (++p; *p >= '0' && *p <= '9'; ++p, ++digits) {
+			num = num * 10.0 + (*p - '0');
+			scale *= 10.0;
+		}
+	}
+	*value = sign * num / scale;
+	return digits;
+}
+
+static int ParseHexDigit(char ch)
+{
+	if (ch >= '0' && ch <= '9') {
+		return ch - '0';
+	}
+	if (ch >= 'a' && ch <= 'f') {
+		return ch - 'a' + 10;
+	}
+	if (ch >= 'A' && ch <= 'F') {
+		return ch - 'A' + 10;
+	}
+	return -1;
+}
+
+/** 解析 #RGB 和 #RRGGBB 格式的颜色值，返回成功读取的颜色分量数 */
+static int ParseHexColor(const char *str, int len, int *r, int *g, int *b)
+{
+	int i, value, rgb[3] = { 0 };
+	int width = len == 4 ? 1 : 2;
+
+	for (i = 0; i < 3; ++i) {
+		value = ParseHexDigit(str[1 + i * width]);
+		if (value < 0) {
+			break;
+		}
+		if (width == 2) {
+			rgb[i] = ParseHexDigit(str[2 + i * width]);
+			if (rgb[i] < 0) {
+				break;
+			}
+			rgb[i] += value * 16;
+		} else {
+			rgb[i] = value;
+		}
+	}
+	*r = rgb[0];
+	*g = rgb[1];
+	*b = rgb[2];
+	return i;
+}
+
 LCUI_BOOL ParseNumber(LCUI_Style s, const char *str)
 {
 	int n = 0;
+	double value;
 	const char *p;
 	char num_str[32];
 	LCUI_BOOL has_point = FALSE;
@@ -69,6 +146,7 @@ LCUI_BOOL ParseNumber(LCUI_Style s, const char *str)
 		return FALSE;
 	}
 	num_str[n] = 0;
+	n = ParseDecimal(num_str, &value);
 	switch (*p) {
 	case 'd':
 	case 'D':
@@ -78,13 +156,13 @@ LCUI_BOOL ParseNumber(LCUI_Style s, const char *str)
 		}
 		if (p[1] == 'p' || p[1] == 'P') {
 			s->type = LCUI_STYPE_DIP;
-			sscanf(num_str, "%f", &s->dip);
+			s->dip = (float)value;
 			break;
 		}
 		if (p[1] == 'i' || p[1] == 'I') {
 			if (p[2] == 'p' || p[2] == 'P') {
 				s->type = LCUI_STYPE_DIP;
-				sscanf(num_str, "%f", &s->dip);
+				s->dip = (float)value;
 				break;
 			}
 		}
@@ -93,7 +171,7 @@ LCUI_BOOL ParseNumber(LCUI_Style s, const char *str)
 	case 'S':
 		if (p[1] == 'p' || p[1] == 'P') {
 			s->type = LCUI_STYPE_SP;
-			sscanf(num_str, "%f", &s->sp);
+			s->sp = (float)value;
 		} else {
 			s->type = LCUI_STYPE_NONE;
 		}
@@ -102,27 +180,36 @@ LCUI_BOOL ParseNumber(LCUI_Style s, const char *str)
 	case 'p':
 		if (p[1] == 'x' || p[1] == 'X') {
 			s->type = LCUI_STYPE_PX;
-			sscanf(num_str, "%f", &s->px);
+			s->px = (float)value;
 		} else if (p[1] == 't' || p[1] == 'T') {
 			s->type = LCUI_STYPE_PT;
-			sscanf(num_str, "%f", &s->pt);
+			s->pt = (float)value;
 		} else {
 			s->type = LCUI_STYPE_NONE;
 		}
 		break;
 	case '%':
-		if (1 != sscanf(num_str, "%f", &s->scale)) {
+		if (n < 1) {
 			return FALSE;
 		}
-		s->scale /= 100.0;
+		s->scale = (float)(value / 100.0);
 		s->type = LCUI_STYPE_SCALE;
 		break;
 	case 0:
-		if (has_point && 1 == sscanf(num_str, "%f", &s->scale)) {
+		if (has_point && n > 0) {
+			s->scale = (float)value;
 			s->type = LCUI_STYPE_SCALE;
 			break;
 		}
-		if (1 == sscanf(num_str, "%d", &s->val_int)) {
+		if (n > 0) {
+			/* 超出 int 范围的值在转换前截断，避免未定义的行为 */
+			if (value > INT_MAX) {
+				s->val_int = INT_MAX;
+			} else if (value < INT_MIN) {
+				s->val_int = INT_MIN;
+			} else {
+				s->val_int = (int)value;
+			}
 			s->type = LCUI_STYPE_INT;
 			break;
 		}
@@ -138,6 +225,7 @@ LCUI_BOOL ParseNumber(LCUI_Style s, const char *str)
 LCUI_BOOL ParseRGBA(LCUI_Style var, const char *str)
 {
 	float data[4];
+	double value;
 	char buf[16];
 	const char *p;
 	int i, buf_i;
@@ -158,7 +246,8 @@ LCUI_BOOL ParseRGBA(LCUI_Style var, const char *str)
 		}
 		if (*p == ',' || *p == ')') {
 			buf[buf_i] = 0;
-			sscanf(buf, "%f", &data[i]);
+			ParseDecimal(buf, &value);
+			data[i] = (float)value;
 			buf_i = 0;
 			i += 1;
 		}
@@ -178,6 +267,7 @@ LCUI_BOOL ParseRGBA(LCUI_Style var, const char *str)
 LCUI_BOOL ParseRGB(LCUI_Style var, const char *str)
 {
 	float data[3];
+	double value;
 	char buf[16];
 	const char *p;
 	int i, buf_i;
@@ -198,7 +288,8 @@ LCUI_BOOL ParseRGB(LCUI_Style var, const char *str)
 		}
 		if (*p == ',' || *p == ')') {
 			buf[buf_i] = 0;
-			sscanf(buf, "%f", &data[i]);
+			ParseDecimal(buf, &value);
+			data[i] = (float)value;
 			buf_i = 0;
 			i += 1;
 		}
@@ -246,10 +337,10 @@ LCUI_BOOL ParseColor(LCUI_Style var, const char *str)
 	case 3:
 		status = 0;
 		if (len == 4) {
-			status = sscanf(str, "#%1X%1X%1X", &r, &g, &b);
+			status = ParseHexColor(str, len, &r, &g, &b);
 			r *= 255 / 0xf; g *= 255 / 0xf; b *= 255 / 0xf;
 		} else if (len == 7) {
-			status = sscanf(str, "#%2X%2X%2X", &r, &g, &b);
+			status = ParseHexColor(str, len, &r, &g, &b);
 		}
 		break;
 	case 4: return ParseRGB(var, str);
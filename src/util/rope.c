@@ -0,0 +1,370 @@
+/*
+ * rope.c -- rope, a text buffer for efficient editing of long text
+ *
+ * Copyright (c) 2019, Liu chao <lc-soft@live.cn> All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of LCUI nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/types.h>
+#include <LCUI/util/math.h>
+#include <LCUI/util/rope.h>
+
+/* 每个文本块最多能容纳的字符数 */
+#define ROPE_CHUNK_SIZE 1024
+
+#define RopeNode_GetTotal(NODE) ((NODE) ? (NODE)->total : 0)
+
+/**
+ * 绳索节点
+ * 每个节点存放一个文本块，节点按照文本块在文本中的顺序排列，同时按照优先级
+ * 构成堆（即树堆，treap），以保持树的平衡
+ */
+struct RopeNodeRec_ {
+	unsigned priority;            /**< 优先级，父节点的优先级不低于子节点 */
+	size_t length;                /**< 文本块的长度 */
+	size_t total;                 /**< 子树中的文本总长度 */
+	RopeNode *left, *right;       /**< 左右子树 */
+	wchar_t text[ROPE_CHUNK_SIZE]; /**< 文本块 */
+};
+
+static unsigned Rope_Random(Rope *rope)
+{
+	rope->seed ^= rope->seed << 13;
+	rope->seed ^= rope->seed >> 17;
+	rope->seed ^= rope->seed << 5;
+	return rope->seed;
+}
+
+static RopeNode *Rope_NewNode(Rope *rope, const wchar_t *wcs, size_t len)
+{
+	RopeNode *node = malloc(sizeof(RopeNode));
+
+	if (!node) {
+		return NULL;
+	}
+	node->priority = Rope_Random(rope);
+	node->length = len;
+	node->total = len;
+	node->left = NULL;
+	node->right = NULL;
+	memcpy(node->text, wcs, sizeof(wchar_t) * len);
+	return node;
+}
+
+static void RopeNode_Update(RopeNode *node)
+{
+	node->total = node->length + RopeNode_GetTotal(node->left) +
+		      RopeNode_GetTotal(node->right);
+}
+
+static void RopeNode_Destroy(RopeNode *node)
+{
+	if (node) {
+		RopeNode_Destroy(node->left);
+		RopeNode_Destroy(node->right);
+		free(node);
+	}
+}
+
+/** 合并两棵树，左树中的文本排在前面 */
+static RopeNode *RopeNode_Merge(RopeNode *a, RopeNode *b)
+{
+	if (!a) {
+		return b;
+	}
+	if (!b) {
+		return a;
+	}
+	if (a->priority >= b->priority) {
+		a->right = RopeNode_Merge(a->right, b);
+		RopeNode_Update(a);
+		return a;
+	}
+	b->left = RopeNode_Merge(a, b->left);
+	RopeNode_Update(b);
+	return b;
+}
+
+/**
+ * 将树在指定位置拆分成两棵树，左树包含前 pos 个字符
+ * 拆分位置在文本块中间时，文本块的后半段会转移到新的节点中
+ * @returns 成功时返回 0，内存不足时返回 -ENOMEM，树保持不变
+ */
+static int RopeNode_Split(RopeNode *node, size_t pos, RopeNode **left,
+			  RopeNode **right)
+{
+	int ret;
+	size_t left_total;
+	RopeNode *tail;
+
+	if (!node) {
+		*left = *right = NULL;
+		return 0;
+	}
+	left_total = RopeNode_GetTotal(node->left);
+	if (pos <= left_total) {
+		ret = RopeNode_Split(node->left, pos, left, &node->left);
+		RopeNode_Update(node);
+		*right = node;
+		return ret;
+	}
+	pos -= left_total;
+	if (pos >= node->length) {
+		ret = RopeNode_Split(node->right, pos - node->length,
+				     &node->right, right);
+		RopeNode_Update(node);
+		*left = node;
+		return ret;
+	}
+	tail = malloc(sizeof(RopeNode));
+	if (!tail) {
+		*left = node;
+		*right = NULL;
+		return -ENOMEM;
+	}
+	/* 后半段与原节点的优先级相同，可以直接作为右子树的根节点 */
+	tail->priority = node->priority;
+	tail->length = node->length - pos;
+	tail->left = NULL;
+	tail->right = node->right;
+	memcpy(tail->text, node->text + pos, sizeof(wchar_t) * tail->length);
+	RopeNode_Update(tail);
+	node->length = pos;
+	node->right = NULL;
+	RopeNode_Update(node);
+	*left = node;
+	*right = tail;
+	return 0;
+}
+
+/**
+ * 尝试将文本直接插入到指定位置所在的文本块中
+ * @returns 文本块容量不足时返回 FALSE
+ */
+static LCUI_BOOL RopeNode_InsertInChunk(RopeNode *node, size_t pos,
+					const wchar_t *wcs, size_t len)
+{
+	size_t left_total;
+	LCUI_BOOL ok;
+
+	if (!node) {
+		return FALSE;
+	}
+	left_total = RopeNode_GetTotal(node->left);
+	/* 插入位置在左子树末尾时，优先追加到左子树的最后一个文本块中 */
+	if (pos <= left_total && node->left) {
+		ok = RopeNode_InsertInChunk(node->left, pos, wcs, len);
+	} else if (pos - left_total <= node->length) {
+		pos -= left_total;
+		if (node->length + len > ROPE_CHUNK_SIZE) {
+			return FALSE;
+		}
+		memmove(node->text + pos + len, node->text + pos,
+			sizeof(wchar_t) * (node->length - pos));
+		memcpy(node->text + pos, wcs, sizeof(wchar_t) * len);
+		node->length += len;
+		ok = TRUE;
+	} else {
+		ok = RopeNode_InsertInChunk(
+		    node->right, pos - left_total - node->length, wcs, len);
+	}
+	if (ok) {
+		node->total += len;
+	}
+	return ok;
+}
+
+/**
+ * 尝试直接在指定位置所在的文本块中删除文本
+ * @returns 删除范围跨越多个文本块，或者会删空文本块时返回 FALSE
+ */
+static LCUI_BOOL RopeNode_DeleteInChunk(RopeNode *node, size_t pos, size_t len)
+{
+	size_t left_total;
+	LCUI_BOOL ok;
+
+	if (!node) {
+		return FALSE;
+	}
+	left_total = RopeNode_GetTotal(node->left);
+	if (pos < left_total) {
+		ok = RopeNode_DeleteInChunk(node->left, pos, len);
+	} else if (pos - left_total < node->length) {
+		pos -= left_total;
+		/* 文本块被删空时需要移除节点，交给拆分操作处理 */
+		if (pos + len > node->length || len >= node->length) {
+			return FALSE;
+		}
+		memmove(node->text + pos, node->text + pos + len,
+			sizeof(wchar_t) * (node->length - pos - len));
+		node->length -= len;
+		ok = TRUE;
+	} else {
+		ok = RopeNode_DeleteInChunk(
+		    node->right, pos - left_total - node->length, len);
+	}
+	if (ok) {
+		node->total -= len;
+	}
+	return ok;
+}
+
+static size_t RopeNode_GetText(const RopeNode *node, size_t pos,
+			       size_t max_len, wchar_t *buf)
+{
+	size_t n, count = 0, left_total;
+
+	if (!node || max_len == 0) {
+		return 0;
+	}
+	left_total = RopeNode_GetTotal(node->left);
+	if (pos < left_total) {
+		count = RopeNode_GetText(node->left, pos, max_len, buf);
+		pos = 0;
+	} else {
+		pos -= left_total;
+	}
+	if (count < max_len && pos < node->length) {
+		n = min(node->length - pos, max_len - count);
+		memcpy(buf + count, node->text + pos, sizeof(wchar_t) * n);
+		count += n;
+		pos = 0;
+	} else if (pos >= node->length) {
+		pos -= node->length;
+	}
+	if (count < max_len) {
+		count += RopeNode_GetText(node->right, pos, max_len - count,
+					  buf + count);
+	}
+	return count;
+}
+
+void Rope_Init(Rope *rope)
+{
+	rope->root = NULL;
+	rope->seed = 2463534242u;
+}
+
+void Rope_Clear(Rope *rope)
+{
+	RopeNode_Destroy(rope->root);
+	rope->root = NULL;
+}
+
+size_t Rope_GetLength(const Rope *rope)
+{
+	return RopeNode_GetTotal(rope->root);
+}
+
+wchar_t Rope_GetChar(const Rope *rope, size_t pos)
+{
+	size_t left_total;
+	const RopeNode *node = rope->root;
+
+	while (node) {
+		left_total = RopeNode_GetTotal(node->left);
+		if (pos < left_total) {
+			node = node->left;
+			continue;
+		}
+		pos -= left_total;
+		if (pos < node->length) {
+			return node->text[pos];
+		}
+		pos -= node->length;
+		node = node->right;
+	}
+	return 0;
+}
+
+int Rope_Insert(Rope *rope, size_t pos, const wchar_t *wcs, size_t len)
+{
+	size_t i, n;
+	RopeNode *left, *right, *node, *middle = NULL;
+
+	if (len == 0) {
+		return 0;
+	}
+	if (pos > Rope_GetLength(rope)) {
+		pos = Rope_GetLength(rope);
+	}
+	if (RopeNode_InsertInChunk(rope->root, pos, wcs, len)) {
+		return 0;
+	}
+	/* 将文本分成多个文本块，再拼接到拆分后的两棵树中间 */
+	for (i = 0; i < len; i += n) {
+		n = min(len - i, ROPE_CHUNK_SIZE);
+		node = Rope_NewNode(rope, wcs + i, n);
+		if (!node) {
+			RopeNode_Destroy(middle);
+			return -ENOMEM;
+		}
+		middle = RopeNode_Merge(middle, node);
+	}
+	if (RopeNode_Split(rope->root, pos, &left, &right) != 0) {
+		rope->root = RopeNode_Merge(left, right);
+		RopeNode_Destroy(middle);
+		return -ENOMEM;
+	}
+	rope->root = RopeNode_Merge(RopeNode_Merge(left, middle), right);
+	return 0;
+}
+
+void Rope_Delete(Rope *rope, size_t pos, size_t len)
+{
+	RopeNode *left, *middle, *right;
+
+	if (pos >= Rope_GetLength(rope) || len == 0) {
+		return;
+	}
+	len = min(len, Rope_GetLength(rope) - pos);
+	if (RopeNode_DeleteInChunk(rope->root, pos, len)) {
+		return;
+	}
+	if (RopeNode_Split(rope->root, pos, &left, &right) != 0) {
+		rope->root = RopeNode_Merge(left, right);
+		return;
+	}
+	if (RopeNode_Split(right, len, &middle, &right) != 0) {
+		rope->root = RopeNode_Merge(left, RopeNode_Merge(middle, right));
+		return;
+	}
+	RopeNode_Destroy(middle);
+	rope->root = RopeNode_Merge(left, right);
+}
+
+size_t Rope_GetText(const Rope *rope, size_t pos, size_t max_len,
+		    wchar_t *buf)
+{
+	size_t len = RopeNode_GetText(rope->root, pos, max_len, buf);
+
+	buf[len] = 0;
+	return len;
+}
@@ -15,10 +15,15 @@ int main(void)
 	describe("test linkedlist", test_linkedlist);
 	describe("test string", test_string);
 	describe("test strpool", test_strpool);
+	describe("test atom", test_atom);
+	describe("test rope", test_rope);
 	describe("test settings", test_settings);
 	describe("test object", test_object);
 	describe("test thread", test_thread);
 	describe("test font load", test_font_load);
+	describe("test font cache", test_font_cache);
+	describe("test font bitmap", test_font_bitmap);
+	describe("test textlayer", test_textlayer);
 	describe("test image reader", test_image_reader);
 	describe("test xml parser", test_xml_parser);
 	describe("test widget event", test_widget_event);
@@ -31,5 +36,6 @@ int main(void)
 	describe("test block layout", test_block_layout);
 	describe("test flex layout", test_flex_layout);
 	describe("test widget rect", test_widget_rect);
+	describe("test widget style", test_widget_style);
 	return ret - print_test_result();
 }
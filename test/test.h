@@ -8,8 +8,13 @@ void test_object(void);
 void test_settings(void);
 void test_thread(void);
 void test_font_load(void);
+void test_font_cache(void);
+void test_font_bitmap(void);
+void test_textlayer(void);
 void test_xml_parser(void);
 void test_strpool(void);
+void test_atom(void);
+void test_rope(void);
 void test_linkedlist(void);
 void test_widget_opacity(void);
 void test_widget_event(void);
@@ -23,3 +28,4 @@ void test_mainloop(void);
 void test_block_layout(void);
 void test_flex_layout(void);
 void test_widget_rect(void);
+void test_widget_style(void);
@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/util/atom.h>
+#include "test.h"
+#include "libtest.h"
+
+void test_atom(void)
+{
+	char name[16];
+	atom_t atom1, atom2;
+	size_t count;
+
+	strcpy(name, "test-atom");
+	it_b("check atom_find() of unknown name",
+	     atom_find(name) == ATOM_NONE, TRUE);
+	count = atom_count();
+	it_b("check atom_from_str()",
+	     (atom1 = atom_from_str(name)) != ATOM_NONE, TRUE);
+	it_b("check atom count increased", atom_count() == count + 1, TRUE);
+	name[0] = 'T';
+	it_b("check atom of other name",
+	     (atom2 = atom_from_str(name)) != atom1, TRUE);
+	it_b("check atom reused", atom_from_str("test-atom") == atom1, TRUE);
+	it_b("check atom_find()", atom_find("Test-atom") == atom2, TRUE);
+	it_s("check atom_to_str()", atom_to_str(atom1), "test-atom");
+	it_b("check atom_to_str() of ATOM_NONE", atom_to_str(ATOM_NONE) == NULL,
+	     TRUE);
+	atom_table_destroy();
+	it_b("check atom count after destroying the atom table",
+	     atom_count() == 0, TRUE);
+	it_b("check atom_find() after destroying the atom table",
+	     atom_find("test-atom") == ATOM_NONE, TRUE);
+	it_b("check atom_to_str() after destroying the atom table",
+	     atom_to_str(atom1) == NULL, TRUE);
+}
@@ -1,114 +1,403 @@
 ﻿#include <stdio.h>
+#include <limits.h>
+#include <string.h>
 #include <LCUI_Build.h>
 #include <LCUI/LCUI.h>
 #include <LCUI/display.h>
 #include <LCUI/gui/builder.h>
+#include <LCUI/gui/css_parser.h>
+#include <LCUI/gui/css_fontstyle.h>
 #include "test.h"
 #include "libtest.h"
 
 static void test_btn_text_style(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-textview")->style->sheet;
-	it_i("width", (int)s[key_width].val_px, 100);
-	it_i("height", (int)s[key_height].val_px, 60);
-	it_i("position", s[key_position].val_style, SV_ABSOLUTE);
-	it_i("top", (int)s[key_top].val_px, 12);
-	it_i("left", (int)s[key_left].val_px, 20);
+	ss = LCUIWidget_GetById("test-textview")->style;
+	it_i("width", (int)StyleSheet_GetStyle(ss, key_width)->val_px, 100);
+	it_i("height", (int)StyleSheet_GetStyle(ss, key_height)->val_px, 60);
+	it_i("position", StyleSheet_GetStyle(ss, key_position)->val_style,
+	     SV_ABSOLUTE);
+	it_i("top", (int)StyleSheet_GetStyle(ss, key_top)->val_px, 12);
+	it_i("left", (int)StyleSheet_GetStyle(ss, key_left)->val_px, 20);
 }
 
 static void test_btn_hover_text_style(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-textview")->style->sheet;
-	it_i("background-color", s[key_background_color].val_color.value,
+	ss = LCUIWidget_GetById("test-textview")->style;
+	it_i("background-color",
+	     StyleSheet_GetStyle(ss, key_background_color)->val_color.value,
 	     0xffff0000);
-	it_i("background-size", s[key_background_size].val_style, SV_CONTAIN);
+	it_i("background-size",
+	     StyleSheet_GetStyle(ss, key_background_size)->val_style,
+	     SV_CONTAIN);
 }
 
 static void test_flex_box(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-flex-box")->style->sheet;
-	it_i("flex-grow", s[key_flex_grow].val_int, 0);
-	it_i("flex-shrink", s[key_flex_shrink].val_int, 0);
-	it_i("flex-basis", s[key_flex_basis].val_style, SV_AUTO);
-	it_i("flex-direction", s[key_flex_direction].val_style, SV_COLUMN);
-	it_i("flex-wrap", s[key_flex_wrap].val_style, SV_NOWRAP);
-	it_i("justify-content", s[key_justify_content].val_style, SV_CENTER);
-	it_i("align-items", s[key_align_items].val_style, SV_FLEX_END);
-	it_i("align-content", s[key_align_content].val_style, SV_FLEX_END);
+	ss = LCUIWidget_GetById("test-flex-box")->style;
+	it_i("flex-grow", StyleSheet_GetStyle(ss, key_flex_grow)->val_int, 0);
+	it_i("flex-shrink", StyleSheet_GetStyle(ss, key_flex_shrink)->val_int,
+	     0);
+	it_i("flex-basis", StyleSheet_GetStyle(ss, key_flex_basis)->val_style,
+	     SV_AUTO);
+	it_i("flex-direction",
+	     StyleSheet_GetStyle(ss, key_flex_direction)->val_style, SV_COLUMN);
+	it_i("flex-wrap", StyleSheet_GetStyle(ss, key_flex_wrap)->val_style,
+	     SV_NOWRAP);
+	it_i("justify-content",
+	     StyleSheet_GetStyle(ss, key_justify_content)->val_style,
+	     SV_CENTER);
+	it_i("align-items", StyleSheet_GetStyle(ss, key_align_items)->val_style,
+	     SV_FLEX_END);
+	it_i("align-content",
+	     StyleSheet_GetStyle(ss, key_align_content)->val_style,
+	     SV_FLEX_END);
 }
 
 static void test_parse_flex_initial(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-flex-initial")->style->sheet;
-	it_i("<flex-grow>", s[key_flex_grow].val_int, 0);
-	it_i("<flex-shrink>", s[key_flex_shrink].val_int, 1);
-	it_i("<flex-basis>", s[key_flex_basis].val_style, SV_AUTO);
+	ss = LCUIWidget_GetById("test-flex-initial")->style;
+	it_i("<flex-grow>", StyleSheet_GetStyle(ss, key_flex_grow)->val_int, 0);
+	it_i("<flex-shrink>", StyleSheet_GetStyle(ss, key_flex_shrink)->val_int,
+	     1);
+	it_i("<flex-basis>", StyleSheet_GetStyle(ss, key_flex_basis)->val_style,
+	     SV_AUTO);
 }
 static void test_parse_flex_auto(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-flex-auto")->style->sheet;
-	it_i("<flex-grow>", s[key_flex_grow].val_int, 1);
-	it_i("<flex-shrink>", s[key_flex_shrink].val_int, 1);
-	it_i("<flex-basis>", s[key_flex_basis].val_style, SV_AUTO);
+	ss = LCUIWidget_GetById("test-flex-auto")->style;
+	it_i("<flex-grow>", StyleSheet_GetStyle(ss, key_flex_grow)->val_int, 1);
+	it_i("<flex-shrink>", StyleSheet_GetStyle(ss, key_flex_shrink)->val_int,
+	     1);
+	it_i("<flex-basis>", StyleSheet_GetStyle(ss, key_flex_basis)->val_style,
+	     SV_AUTO);
 }
 
 static void test_parse_flex_none(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-flex-none")->style->sheet;
-	it_i("<flex-grow>", s[key_flex_grow].val_int, 0);
-	it_i("<flex-shrink>", s[key_flex_shrink].val_int, 0);
-	it_i("<flex-basis>", s[key_flex_basis].val_style, SV_AUTO);
+	ss = LCUIWidget_GetById("test-flex-none")->style;
+	it_i("<flex-grow>", StyleSheet_GetStyle(ss, key_flex_grow)->val_int, 0);
+	it_i("<flex-shrink>", StyleSheet_GetStyle(ss, key_flex_shrink)->val_int,
+	     0);
+	it_i("<flex-basis>", StyleSheet_GetStyle(ss, key_flex_basis)->val_style,
+	     SV_AUTO);
 }
 
 static void test_parse_flex_1(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-flex-1")->style->sheet;
-	it_i("<flex-grow>", s[key_flex_grow].val_int, 1);
-	it_b("<flex-shrink>.isValid?", s[key_flex_shrink].is_valid, FALSE);
-	it_b("<flex-basis>.isValid?", s[key_flex_basis].is_valid, FALSE);
+	ss = LCUIWidget_GetById("test-flex-1")->style;
+	it_i("<flex-grow>", StyleSheet_GetStyle(ss, key_flex_grow)->val_int, 1);
+	it_b("<flex-shrink>.isValid?",
+	     StyleSheet_GetStyle(ss, key_flex_shrink)->is_valid, FALSE);
+	it_b("<flex-basis>.isValid?",
+	     StyleSheet_GetStyle(ss, key_flex_basis)->is_valid, FALSE);
 }
 
 static void test_parse_flex_100px(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-flex-100px")->style->sheet;
-	it_b("<flex-grow>.isValid?", s[key_flex_grow].is_valid, FALSE);
-	it_b("<flex-shrink>.isValid?", s[key_flex_shrink].is_valid, FALSE);
-	it_i("<flex-basis>", (int)s[key_flex_basis].val_px, 100);
+	ss = LCUIWidget_GetById("test-flex-100px")->style;
+	it_b("<flex-grow>.isValid?",
+	     StyleSheet_GetStyle(ss, key_flex_grow)->is_valid, FALSE);
+	it_b("<flex-shrink>.isValid?",
+	     StyleSheet_GetStyle(ss, key_flex_shrink)->is_valid, FALSE);
+	it_i("<flex-basis>",
+	     (int)StyleSheet_GetStyle(ss, key_flex_basis)->val_px, 100);
 }
 
 static void test_parse_flex_1_100px(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-flex-1-100px")->style->sheet;
-	it_b("<flex-grow>.isValid?", s[key_flex_grow].is_valid, FALSE);
-	it_i("<flex-shrink>", s[key_flex_shrink].val_int, 1);
-	it_i("<flex-basis>", (int)s[key_flex_basis].val_px, 100);
+	ss = LCUIWidget_GetById("test-flex-1-100px")->style;
+	it_b("<flex-grow>.isValid?",
+	     StyleSheet_GetStyle(ss, key_flex_grow)->is_valid, FALSE);
+	it_i("<flex-shrink>", StyleSheet_GetStyle(ss, key_flex_shrink)->val_int,
+	     1);
+	it_i("<flex-basis>",
+	     (int)StyleSheet_GetStyle(ss, key_flex_basis)->val_px, 100);
 }
 static void test_parse_flex_0_0_100px(void)
 {
-	LCUI_Style s;
+	LCUI_StyleSheet ss;
 
-	s = LCUIWidget_GetById("test-flex-0-0-100px")->style->sheet;
-	it_i("<flex-grow>", s[key_flex_grow].val_int, 0);
-	it_i("<flex-shrink>", s[key_flex_shrink].val_int, 0);
-	it_i("<flex-basis>", (int)s[key_flex_basis].val_px, 100);
+	ss = LCUIWidget_GetById("test-flex-0-0-100px")->style;
+	it_i("<flex-grow>", StyleSheet_GetStyle(ss, key_flex_grow)->val_int, 0);
+	it_i("<flex-shrink>", StyleSheet_GetStyle(ss, key_flex_shrink)->val_int,
+	     0);
+	it_i("<flex-basis>",
+	     (int)StyleSheet_GetStyle(ss, key_flex_basis)->val_px, 100);
+}
+
+static void test_property_parser_lookup(void)
+{
+	int key;
+	const char *name;
+	LCUI_BOOL ok = TRUE;
+	LCUI_CSSPropertyParser sp;
+
+	for (key = 0; key < STYLE_KEY_TOTAL; ++key) {
+		name = LCUI_GetStyleName(key);
+		sp = name ? LCUI_GetCSSPropertyParser(name) : NULL;
+		if (sp && (sp->key != key || strcmp(sp->name, name) != 0)) {
+			ok = FALSE;
+		}
+	}
+	it_b("should find the parser of each style property", ok, TRUE);
+	sp = LCUI_GetCSSPropertyParser("border-radius");
+	it_b("should find the parser of 'border-radius'",
+	     sp && strcmp(sp->name, "border-radius") == 0, TRUE);
+	it_b("should not find the parser of 'border-radiu'",
+	     !LCUI_GetCSSPropertyParser("border-radiu"), TRUE);
+	it_b("should not find the parser of ''",
+	     !LCUI_GetCSSPropertyParser(""), TRUE);
+}
+
+static void test_parse_split_values(void)
+{
+	LCUI_Widget w;
+	LCUI_StyleSheet ss;
+
+	w = LCUIWidget_New(NULL);
+	Widget_AddClass(w, "test-split-values");
+	Widget_Append(LCUIWidget_GetRoot(), w);
+	LCUI_LoadCSSString(".test-split-values {"
+			   "  padding: 1px 2px 3.5px 4px ;"
+			   "  border-top: 2px solid #0f0;"
+			   "  box-shadow: 1px 2px 3px 4px rgba(0, 0, 255, 0.5);"
+			   "  /* comment: a; b; */ margin: 5px 6px 7px 8px 9px;"
+			   "}",
+			   NULL);
+	LCUIWidget_Update();
+	ss = w->style;
+	it_i("padding-top", (int)StyleSheet_GetStyle(ss, key_padding_top)->px,
+	     1);
+	it_i("padding-bottom (px * 10)",
+	     (int)(StyleSheet_GetStyle(ss, key_padding_bottom)->px * 10), 35);
+	it_i("padding-left", (int)StyleSheet_GetStyle(ss, key_padding_left)->px,
+	     4);
+	it_i("border-top-width",
+	     (int)StyleSheet_GetStyle(ss, key_border_top_width)->px, 2);
+	it_i("border-top-color",
+	     StyleSheet_GetStyle(ss, key_border_top_color)->color.value,
+	     0xff00ff00);
+	it_i("box-shadow-color",
+	     StyleSheet_GetStyle(ss, key_box_shadow_color)->color.value,
+	     0x7f0000ff);
+	it_b("margin with too many values should be ignored",
+	     StyleSheet_GetStyle(ss, key_margin_top)->is_valid &&
+		 StyleSheet_GetStyle(ss, key_margin_top)->px == 5,
+	     FALSE);
+	Widget_Destroy(w);
+
+	w = LCUIWidget_New(NULL);
+	Widget_AddClass(w, "test-split-many");
+	Widget_Append(LCUIWidget_GetRoot(), w);
+	LCUI_LoadCSSString(".test-split-many {"
+			   "  margin: 10px; padding: 11px;"
+			   "  box-shadow: 1px 2px 3px 4px #f00;"
+			   "}"
+			   ".test-split-many {"
+			   "  margin: 1px 2px 3px 4px 5px 6px 7px 8px 9px;"
+			   "  padding: 1px 2px 3px 4px 5px 6px 7px 8px 9px;"
+			   "  box-shadow: 1px 2px 3px 4px 5px 6px 7px 8px #00f;"
+			   "}",
+			   NULL);
+	LCUIWidget_Update();
+	ss = w->style;
+	it_i("margin with more than 8 values should keep the previous value",
+	     (int)StyleSheet_GetStyle(ss, key_margin_top)->px, 10);
+	it_i("padding with more than 8 values should keep the previous value",
+	     (int)StyleSheet_GetStyle(ss, key_padding_left)->px, 11);
+	it_i("box-shadow with more than 8 values should keep the previous "
+	     "value",
+	     StyleSheet_GetStyle(ss, key_box_shadow_color)->color.value,
+	     0xffff0000);
+	Widget_Destroy(w);
+}
+
+static void test_parse_number(void)
+{
+	LCUI_StyleRec s;
+
+	it_b("should parse an integer",
+	     ParseNumber(&s, "-42") && s.type == LCUI_STYPE_INT &&
+		 s.val_int == -42,
+	     TRUE);
+	it_b("should clamp an integer larger than INT_MAX",
+	     ParseNumber(&s, "99999999999999999999") &&
+		 s.type == LCUI_STYPE_INT && s.val_int == INT_MAX,
+	     TRUE);
+	it_b("should clamp an integer smaller than INT_MIN",
+	     ParseNumber(&s, "-99999999999999999999") &&
+		 s.type == LCUI_STYPE_INT && s.val_int == INT_MIN,
+	     TRUE);
+}
+
+#define COMPILED_CSS_FILE "test_css_parser.cssb"
+#define COMPILED_CSS_SPACE "test-compiled-css"
+
+static const char *compiled_css_test_css = ""
+	".compiled-box { width: 100px; height: 20px; color: #f00; }\n"
+	".compiled-box .compiled-text { content: \"hello\"; "
+	"font-family: 'Arial'; display: flex; opacity: 0.5; }\n"
+	".compiled-box:hover .compiled-text { height: 40px; }\n"
+	".compiled-box { width: 200px; background-color: #00ff00; }\n";
+
+static LCUI_Widget CreateCompiledCSSTestWidget(void)
+{
+	LCUI_Widget box, text;
+
+	box = LCUIWidget_New(NULL);
+	text = LCUIWidget_New("textview");
+	Widget_AddClass(box, "compiled-box");
+	Widget_AddClass(text, "compiled-text");
+	Widget_AddStatus(box, "hover");
+	Widget_Append(box, text);
+	Widget_Append(LCUIWidget_GetRoot(), box);
+	LCUIWidget_Update();
+	return box;
+}
+
+/** 检查部件的样式是否与从 CSS 代码载入的样式相同 */
+static LCUI_BOOL CheckCompiledCSSTestWidget(LCUI_Widget box)
+{
+	const LCUI_StyleRec *s;
+	LCUI_StyleSheet ss;
+	LCUI_Widget text = Widget_GetChild(box, 0);
+
+	ss = box->style;
+	if (StyleSheet_GetStyle(ss, key_width)->val_px != 200 ||
+	    StyleSheet_GetStyle(ss, key_height)->val_px != 20 ||
+	    StyleSheet_GetStyle(ss, key_background_color)->val_color.value !=
+		(int)0xff00ff00) {
+		return FALSE;
+	}
+	ss = text->style;
+	if (StyleSheet_GetStyle(ss, key_height)->val_px != 40 ||
+	    StyleSheet_GetStyle(ss, key_display)->val_style != SV_FLEX ||
+	    StyleSheet_GetStyle(ss, key_opacity)->val_scale != 0.5f) {
+		return FALSE;
+	}
+	s = StyleSheet_GetStyle(ss, LCUI_GetFontStyleKey(key_font_family));
+	if (!s->is_valid || s->type != LCUI_STYPE_STRING ||
+	    strcmp(s->val_string, "'Arial'") != 0) {
+		return FALSE;
+	}
+	s = StyleSheet_GetStyle(ss, LCUI_GetFontStyleKey(key_content));
+	return s->is_valid && s->type == LCUI_STYPE_STRING &&
+	       strcmp(s->val_string, "\"hello\"") == 0;
+}
+
+static void test_compiled_css(void)
+{
+	char data[16];
+	LCUI_Graph image;
+	LCUI_Widget box;
+	LCUI_Selector s;
+	LCUI_StyleSheet ss;
+
+	LCUI_Init();
+	LCUI_LoadCSSString(compiled_css_test_css, COMPILED_CSS_SPACE);
+	box = CreateCompiledCSSTestWidget();
+	it_b("check the styles loaded from css code",
+	     CheckCompiledCSSTestWidget(box), TRUE);
+	it_i("check LCUI_SaveCompiledCSS()",
+	     LCUI_SaveCompiledCSS(COMPILED_CSS_FILE, COMPILED_CSS_SPACE), 0);
+	/* 图像样式无法保存，它应该被跳过并计数，而不是被悄悄丢弃 */
+	Graph_Init(&image);
+	ss = StyleSheet();
+	s = Selector(".compiled-css-image");
+	SetStyle(ss, key_background_image, &image, image);
+	LCUI_PutStyleSheet(s, ss, COMPILED_CSS_SPACE);
+	it_i("check LCUI_SaveCompiledCSS() counts the skipped styles",
+	     LCUI_SaveCompiledCSS(COMPILED_CSS_FILE "2", COMPILED_CSS_SPACE),
+	     1);
+	remove(COMPILED_CSS_FILE "2");
+	Selector_Delete(s);
+	StyleSheet_Delete(ss);
+	LCUI_Destroy();
+
+	LCUI_Init();
+	it_i("check LCUI_LoadCSSFile() with a compiled stylesheet",
+	     LCUI_LoadCSSFile(COMPILED_CSS_FILE), 0);
+	box = CreateCompiledCSSTestWidget();
+	it_b("check the styles loaded from the compiled stylesheet",
+	     CheckCompiledCSSTestWidget(box), TRUE);
+	memset(data, 0, sizeof(data));
+	memcpy(data, LCUI_COMPILED_CSS_MAGIC, 8);
+	it_i("check LCUI_LoadCompiledCSS() with broken data",
+	     LCUI_LoadCompiledCSS(data, sizeof(data)), -2);
+	LCUI_Destroy();
+	remove(COMPILED_CSS_FILE);
+}
+
+#define PARALLEL_CSS_FILES 8
+
+/** 生成多个互相覆盖样式的 CSS 文件，然后一次性载入它们 */
+static void test_load_css_files(void)
+{
+	int i;
+	FILE *fp;
+	LCUI_Widget w;
+	LCUI_StyleSheet ss;
+	char names[PARALLEL_CSS_FILES + 1][32];
+	const char *files[PARALLEL_CSS_FILES + 1];
+
+	for (i = 0; i < PARALLEL_CSS_FILES; ++i) {
+		sprintf(names[i], "test_css_parser_%d.css", i);
+		files[i] = names[i];
+		fp = fopen(names[i], "w");
+		if (!fp) {
+			continue;
+		}
+		fprintf(fp,
+			"/* file %d */\n"
+			".parallel-box { width: %dpx; }\n"
+			".parallel-box.parallel-box-%d { height: %dpx; }\n"
+			".parallel-box-%d, .parallel-box { top: %dpx; }\n",
+			i, (i + 1) * 10, i, (i + 1) * 10, i, i);
+		fclose(fp);
+	}
+	strcpy(names[i], "test_css_parser_missing.css");
+	files[i] = names[i];
+	LCUI_Init();
+	it_i("check LCUI_LoadCSSFiles()",
+	     (int)LCUI_LoadCSSFiles(files, PARALLEL_CSS_FILES + 1),
+	     PARALLEL_CSS_FILES);
+	w = LCUIWidget_New(NULL);
+	Widget_AddClass(w, "parallel-box");
+	Widget_AddClass(w, "parallel-box-3");
+	Widget_Append(LCUIWidget_GetRoot(), w);
+	LCUIWidget_Update();
+	ss = w->style;
+	it_i("the last file should take precedence",
+	     (int)StyleSheet_GetStyle(ss, key_width)->val_px,
+	     PARALLEL_CSS_FILES * 10);
+	it_i("the more specific selector should take precedence",
+	     (int)StyleSheet_GetStyle(ss, key_height)->val_px, 40);
+	it_i("the rules with multiple selectors should be loaded",
+	     (int)StyleSheet_GetStyle(ss, key_top)->val_px,
+	     PARALLEL_CSS_FILES - 1);
+	LCUI_Destroy();
+	for (i = 0; i < PARALLEL_CSS_FILES; ++i) {
+		remove(names[i]);
+	}
 }
 
 void test_css_parser(void)
@@ -141,5 +430,10 @@ void test_css_parser(void)
 	describe("parse 'flex: 100px;'", test_parse_flex_100px);
 	describe("parse 'flex: 1 100px;'", test_parse_flex_1_100px);
 	describe("parse 'flex: 0 0 100px;'", test_parse_flex_0_0_100px);
+	describe("parse values separated by spaces", test_parse_split_values);
+	describe("parse numbers", test_parse_number);
+	describe("property parser lookup", test_property_parser_lookup);
 	LCUI_Destroy();
+	describe("compiled stylesheet", test_compiled_css);
+	describe("load css files in parallel", test_load_css_files);
 }
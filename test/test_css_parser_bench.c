@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/gui/widget.h>
+#include <LCUI/gui/css_parser.h>
+
+#define REPEAT_TIMES 100
+#define PARSE_PASSES 5
+#define THEME_FILES 16
+
+static const char *css_files[] = {
+	"helloworld.css",	   "test_block_layout.css",
+	"test_border.css",	   "test_box_shadow.css",
+	"test_css_parser.css",	   "test_flex_layout.css",
+	"test_scaling_support.css", "test_widget_opacity.css"
+};
+
+/** 读取测试用的 CSS 文件，然后重复拼接成一个大的样式表 */
+static char *LoadStyleSheetText(size_t *out_size)
+{
+	FILE *fp;
+	size_t i, n, size = 0, text_size = 0;
+	char *text, *buf = NULL;
+
+	for (i = 0; i < sizeof(css_files) / sizeof(css_files[0]); ++i) {
+		fp = fopen(css_files[i], "rb");
+		if (!fp) {
+			continue;
+		}
+		fseek(fp, 0, SEEK_END);
+		n = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		buf = realloc(buf, size + n + 1);
+		if (fread(buf + size, 1, n, fp) == n) {
+			size += n;
+			buf[size++] = '\n';
+		}
+		fclose(fp);
+	}
+	if (size < 1) {
+		free(buf);
+		return NULL;
+	}
+	text = malloc(size * REPEAT_TIMES + 1);
+	for (i = 0; i < REPEAT_TIMES; ++i) {
+		memcpy(text + text_size, buf, size);
+		text_size += size;
+	}
+	text[text_size] = 0;
+	free(buf);
+	*out_size = text_size;
+	return text;
+}
+
+/** 把样式表拆分成多个文件，模拟由多个文件组成的主题 */
+static int SaveThemeFiles(const char *text, size_t size,
+			  char names[THEME_FILES][32])
+{
+	int i;
+	FILE *fp;
+	size_t start = 0, end;
+
+	for (i = 0; i < THEME_FILES; ++i) {
+		end = size * (i + 1) / THEME_FILES;
+		/* 在规则的末尾处拆分 */
+		while (end < size && text[end - 1] != '}') {
+			++end;
+		}
+		sprintf(names[i], "test_css_parser_bench_%d.css", i);
+		fp = fopen(names[i], "wb");
+		if (!fp) {
+			return -1;
+		}
+		fwrite(text + start, 1, end - start, fp);
+		fclose(fp);
+		start = end;
+	}
+	return 0;
+}
+
+/** 分别测试依次载入和并行载入主题文件所需的时间 */
+static void TestLoadThemeFiles(const char *text, size_t size)
+{
+	int i;
+	int64_t start, seq_time, par_time;
+	char names[THEME_FILES][32];
+	const char *files[THEME_FILES];
+
+	if (SaveThemeFiles(text, size, names) == 0) {
+		for (i = 0; i < THEME_FILES; ++i) {
+			files[i] = names[i];
+		}
+		LCUI_Init();
+		start = LCUI_GetTime();
+		for (i = 0; i < THEME_FILES; ++i) {
+			LCUI_LoadCSSFile(files[i]);
+		}
+		seq_time = LCUI_GetTimeDelta(start);
+		LCUI_Destroy();
+		LCUI_Init();
+		start = LCUI_GetTime();
+		LCUI_LoadCSSFiles(files, THEME_FILES);
+		par_time = LCUI_GetTimeDelta(start);
+		LCUI_Destroy();
+		Logger_Info("%d files, LCUI_LoadCSSFile: %ldms, "
+			    "LCUI_LoadCSSFiles: %ldms\n",
+			    THEME_FILES, (long)seq_time, (long)par_time);
+	}
+	for (i = 0; i < THEME_FILES; ++i) {
+		remove(names[i]);
+	}
+}
+
+int main(void)
+{
+	int i;
+	char *text;
+	size_t size;
+	int64_t start, time, min_time = 0;
+	char s_size[32], s_time[32];
+
+	LCUI_Init();
+	text = LoadStyleSheetText(&size);
+	if (!text) {
+		Logger_Error("cannot find the css files of the tests\n");
+		LCUI_Destroy();
+		return -1;
+	}
+	for (i = 0; i < PARSE_PASSES; ++i) {
+		start = LCUI_GetTime();
+		LCUI_LoadCSSString(text, NULL);
+		time = LCUI_GetTimeDelta(start);
+		if (i == 0 || time < min_time) {
+			min_time = time;
+		}
+	}
+	sprintf(s_size, "%luKB", (unsigned long)size / 1024);
+	sprintf(s_time, "%ldms", (long)min_time);
+	Logger_Info("%-16s%-16s%s\n", "stylesheet", "parse (min)",
+		    "throughput");
+	Logger_Info("%-16s%-16s%.2fMB/s\n", s_size, s_time,
+		    size / 1024.0 / 1024.0 * 1000.0 / max(min_time, 1));
+	LCUI_Destroy();
+	TestLoadThemeFiles(text, size);
+	free(text);
+	return 0;
+}
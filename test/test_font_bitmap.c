@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/graph.h>
+#include <LCUI/font.h>
+#include "test.h"
+#include "libtest.h"
+
+#define BITMAP_WIDTH 37
+#define BITMAP_ROWS 23
+#define CANVAS_SIZE 64
+
+static unsigned int seed = 1;
+
+static uchar_t NextRandom(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (uchar_t)((seed >> 16) & 0xff);
+}
+
+/** 生成字体位图，其中有一部分像素是完全透明的，模拟真实的字形 */
+static void InitBitmap(LCUI_FontBitmap *bmp)
+{
+	int i;
+
+	FontBitmap_Init(bmp);
+	FontBitmap_Create(bmp, BITMAP_WIDTH, BITMAP_ROWS);
+	for (i = 0; i < BITMAP_WIDTH * BITMAP_ROWS; ++i) {
+		bmp->buffer[i] = NextRandom() % 3 == 0 ? 0 : NextRandom();
+	}
+}
+
+static void InitCanvas(LCUI_Graph *canvas, LCUI_ColorType color_type)
+{
+	size_t i, size;
+
+	Graph_Init(canvas);
+	canvas->color_type = color_type;
+	Graph_Create(canvas, CANVAS_SIZE, CANVAS_SIZE);
+	size = canvas->bytes_per_row * canvas->height;
+	for (i = 0; i < size; ++i) {
+		canvas->bytes[i] = NextRandom();
+	}
+}
+
+static void test_font_bitmap_mix_argb(const char *name)
+{
+	char str[64];
+	int x, y, diff, max_diff = 0;
+	LCUI_Color c, color = ARGB(200, 30, 120, 240);
+	LCUI_Pos pos = { 5, 7 };
+	LCUI_ARGB px, *out;
+	LCUI_Graph canvas, expected;
+	LCUI_FontBitmap bmp;
+
+	InitBitmap(&bmp);
+	InitCanvas(&canvas, LCUI_COLOR_TYPE_ARGB);
+	Graph_Init(&expected);
+	Graph_Copy(&expected, &canvas);
+	for (y = 0; y < BITMAP_ROWS; ++y) {
+		for (x = 0; x < BITMAP_WIDTH; ++x) {
+			c = color;
+			c.alpha = (uchar_t)(bmp.buffer[y * bmp.width + x] *
+					    color.alpha / 255.0);
+			out = expected.argb + (pos.y + y) * expected.width +
+			      pos.x + x;
+			LCUI_OverPixel(out, &c);
+		}
+	}
+	FontBitmap_Mix(&canvas, pos, &bmp, color);
+	for (y = 0; y < CANVAS_SIZE; ++y) {
+		for (x = 0; x < CANVAS_SIZE; ++x) {
+			px = canvas.argb[y * canvas.width + x];
+			c = expected.argb[y * expected.width + x];
+			diff = max(abs(px.r - c.r), abs(px.g - c.g));
+			diff = max(diff, abs(px.b - c.b));
+			diff = max(diff, abs(px.a - c.a));
+			max_diff = max(diff, max_diff);
+		}
+	}
+	snprintf(str, sizeof(str), "check %s ARGB blending matches "
+		 "LCUI_OverPixel()", name);
+	it_b(str, max_diff <= 1, TRUE);
+	Graph_Free(&expected);
+	Graph_Free(&canvas);
+	FontBitmap_Free(&bmp);
+}
+
+static void test_font_bitmap_mix_rgb(const char *name)
+{
+	char str[64];
+	int x, y, i, mismatches = 0;
+	uchar_t alpha, *out;
+	LCUI_Color color = ARGB(180, 220, 40, 90);
+	LCUI_Pos pos = { 9, 3 };
+	LCUI_Graph canvas, expected;
+	LCUI_FontBitmap bmp;
+
+	InitBitmap(&bmp);
+	InitCanvas(&canvas, LCUI_COLOR_TYPE_RGB);
+	Graph_Init(&expected);
+	Graph_Copy(&expected, &canvas);
+	for (y = 0; y < BITMAP_ROWS; ++y) {
+		out = expected.bytes + (pos.y + y) * expected.bytes_per_row +
+		      pos.x * 3;
+		for (x = 0; x < BITMAP_WIDTH; ++x) {
+			alpha = (uchar_t)(bmp.buffer[y * bmp.width + x] *
+					  color.alpha / 255);
+			ALPHA_BLEND(out[0], color.b, alpha);
+			ALPHA_BLEND(out[1], color.g, alpha);
+			ALPHA_BLEND(out[2], color.r, alpha);
+			out += 3;
+		}
+	}
+	FontBitmap_Mix(&canvas, pos, &bmp, color);
+	for (i = 0; i < (int)(canvas.bytes_per_row * canvas.height); ++i) {
+		if (canvas.bytes[i] != expected.bytes[i]) {
+			mismatches += 1;
+		}
+	}
+	snprintf(str, sizeof(str), "check %s RGB blending matches ALPHA_BLEND()",
+		 name);
+	it_i(str, mismatches, 0);
+	Graph_Free(&expected);
+	Graph_Free(&canvas);
+	FontBitmap_Free(&bmp);
+}
+
+/** 分别用各个版本的混合函数混合，并与不使用 SIMD 的参考结果比较 */
+static void test_font_bitmap_mixers(void)
+{
+	size_t i;
+	struct {
+		LCUI_FontBitmapMixerType type;
+		const char *name;
+	} mixers[] = { { FONT_BITMAP_MIXER_SCALAR, "scalar" },
+		       { FONT_BITMAP_MIXER_SSE2, "SSE2" },
+		       { FONT_BITMAP_MIXER_AVX2, "AVX2" } };
+
+	for (i = 0; i < sizeof(mixers) / sizeof(mixers[0]); ++i) {
+		if (FontBitmap_SetMixer(mixers[i].type) != 0) {
+			continue;
+		}
+		test_font_bitmap_mix_argb(mixers[i].name);
+		test_font_bitmap_mix_rgb(mixers[i].name);
+	}
+	FontBitmap_SetMixer(FONT_BITMAP_MIXER_AUTO);
+}
+
+void test_font_bitmap(void)
+{
+	LCUI_InitFontLibrary();
+	describe("test font bitmap mix", test_font_bitmap_mixers);
+	LCUI_FreeFontLibrary();
+}
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/graph.h>
+#include <LCUI/font.h>
+
+#define TEXT_LENGTH 100000
+#define HOT_PASSES 10
+#define GLYPH_CACHE_FILE "test_font_bitmap_bench.cache"
+
+static unsigned int seed = 1;
+
+static unsigned int NextRandom(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+/** 生成中英文混合的文本，中文字符约占三分之一 */
+static void GenerateText(wchar_t *text, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		if (NextRandom() % 3 == 0) {
+			text[i] = 0x4e00 + NextRandom() % 3000;
+		} else {
+			text[i] = ' ' + NextRandom() % ('~' - ' ');
+		}
+	}
+	text[len] = 0;
+}
+
+static int64_t LookupText(const wchar_t *text, int font_id)
+{
+	size_t i;
+	int64_t start;
+	const int sizes[] = { 12, 14, 16, 18 };
+	const LCUI_FontBitmap *bmp;
+
+	start = LCUI_GetTime();
+	for (i = 0; text[i]; ++i) {
+		LCUIFont_GetBitmap(text[i], font_id, sizes[i % 4], &bmp);
+	}
+	return LCUI_GetTimeDelta(start);
+}
+
+static int64_t RenderText(LCUI_Graph *canvas, const wchar_t *text,
+			  int font_id)
+{
+	size_t i;
+	int64_t start;
+	LCUI_Pos pos = { 0, 0 };
+	LCUI_Color color = RGB(0, 0, 0);
+	const int sizes[] = { 12, 14, 16, 18 };
+	const LCUI_FontBitmap *bmp;
+
+	start = LCUI_GetTime();
+	for (i = 0; text[i]; ++i) {
+		LCUIFont_GetBitmap(text[i], font_id, sizes[i % 4], &bmp);
+		if (!bmp) {
+			continue;
+		}
+		FontBitmap_Mix(canvas, pos, bmp, color);
+		pos.x += bmp->advance.x;
+		if (pos.x >= (int)canvas->width) {
+			pos.x = 0;
+			pos.y = (pos.y + 20) % canvas->height;
+		}
+	}
+	return LCUI_GetTimeDelta(start);
+}
+
+/** 初始化字体处理模块，并载入测试用的字体 */
+static int InitFontLibrary(int argc, char **argv)
+{
+	LCUI_InitFontLibrary();
+	/* usage: test_font_bitmap_bench [font file] [font family] */
+	if (argc > 2) {
+		LCUIFont_LoadFile(argv[1]);
+		return LCUIFont_GetId(argv[2], 0, 0);
+	}
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	int i, font_id;
+	int64_t cold, hot_start, hot = 0, lookup = 0;
+	char s_cold[32], s_hot_start[32], s_hot[32], s_lookup[32];
+	wchar_t *text;
+	LCUI_Graph canvas;
+
+	text = malloc(sizeof(wchar_t) * (TEXT_LENGTH + 1));
+	if (!text) {
+		return -1;
+	}
+	GenerateText(text, TEXT_LENGTH);
+	Graph_Init(&canvas);
+	canvas.color_type = LCUI_COLOR_TYPE_ARGB;
+	Graph_Create(&canvas, 800, 600);
+	remove(GLYPH_CACHE_FILE);
+	LCUIFont_SetGlyphCachePath(GLYPH_CACHE_FILE);
+	font_id = InitFontLibrary(argc, argv);
+	/* 只测试获取字体位图的耗时，避免绘制的耗时掩盖渲染字形的耗时 */
+	cold = LookupText(text, font_id);
+	for (i = 0; i < HOT_PASSES; ++i) {
+		hot += RenderText(&canvas, text, font_id);
+		lookup += LookupText(text, font_id);
+	}
+	/* 重新初始化，模拟再次启动时从字形缓存文件中读取字体位图 */
+	LCUI_FreeFontLibrary();
+	font_id = InitFontLibrary(argc, argv);
+	hot_start = LookupText(text, font_id);
+	LCUI_FreeFontLibrary();
+	remove(GLYPH_CACHE_FILE);
+	sprintf(s_cold, "%ldms", (long)cold);
+	sprintf(s_hot_start, "%ldms", (long)hot_start);
+	sprintf(s_hot, "%.2fms", 1.0 * hot / HOT_PASSES);
+	sprintf(s_lookup, "%.2fms", 1.0 * lookup / HOT_PASSES);
+	Logger_Info("%-20s%-20s%-20s%-20s%s\n", "characters", "cold lookup",
+		    "hot start lookup", "hot render (avg)",
+		    "hot lookup (avg)");
+	Logger_Info("%-20d%-20s%-20s%-20s%s\n", TEXT_LENGTH, s_cold,
+		    s_hot_start, s_hot, s_lookup);
+	Graph_Free(&canvas);
+	free(text);
+	return 0;
+}
@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/graph.h>
+#include <LCUI/thread.h>
+#include <LCUI/font.h>
+#include "test.h"
+#include "libtest.h"
+
+#define GLYPH_SIZE 100
+#define GLYPH_COUNT 100
+#define CACHE_LIMIT (128 * 1024)
+
+#define STRESS_THREADS 8
+#define STRESS_CHARS ('~' - ' ')
+#define STRESS_SIZES 20
+#define STRESS_GLYPHS (STRESS_CHARS * STRESS_SIZES)
+
+#define BOUNDED_FRAMES 40
+#define BOUNDED_CHARS 500
+
+#define GLYPH_CACHE_FILE "test_font_glyph.cache"
+
+typedef struct StressTaskRec_ {
+	int offset;
+	int errors;
+	LCUI_Thread tid;
+	LCUI_Graph canvas;
+	const LCUI_FontBitmap *bitmaps[STRESS_GLYPHS];
+} StressTaskRec, *StressTask;
+
+static void test_font_cache_eviction(void)
+{
+	int i, font_id;
+	LCUI_FontBitmap bmp;
+	const LCUI_FontBitmap *first = NULL, *cached;
+	LCUI_FontBitmapCacheStatsRec stats;
+
+	font_id = LCUIFont_GetId("inconsolata", 0, 0);
+	LCUIFont_SetBitmapCacheLimit(CACHE_LIMIT);
+	/* 内置字体会将该尺寸的字符渲染为同样大小的方框 */
+	for (i = 0; i < GLYPH_COUNT; ++i) {
+		FontBitmap_Init(&bmp);
+		FontBitmap_Create(&bmp, GLYPH_SIZE / 2, GLYPH_SIZE);
+		memset(bmp.buffer, 255, bmp.width * bmp.rows);
+		cached = LCUIFont_AddBitmap('A' + i, font_id, GLYPH_SIZE, &bmp);
+		if (i == 0) {
+			first = cached;
+		}
+	}
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_i("check glyphs", (int)stats.glyphs, GLYPH_COUNT);
+	it_b("check cache is allowed to exceed the limit in the current frame",
+	     stats.bytes > CACHE_LIMIT, TRUE);
+	it_b("check bitmaps used in the current frame are pinned",
+	     first->buffer != NULL, TRUE);
+	LCUIFont_EndFrame();
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_b("check bitmaps used in the ended frame are not evicted",
+	     stats.evictions == 0 && first->buffer != NULL, TRUE);
+	/* 只使用最后添加的字符，其余字符在下一帧结束时被回收 */
+	LCUIFont_GetBitmap('A' + GLYPH_COUNT - 1, font_id, GLYPH_SIZE, &cached);
+	LCUIFont_EndFrame();
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_b("check cache is trimmed at the end of the frame",
+	     stats.bytes <= CACHE_LIMIT, TRUE);
+	it_b("check bitmaps used in the ended frame are kept",
+	     cached->buffer != NULL, TRUE);
+	it_b("check evictions", stats.evictions > 0, TRUE);
+	it_b("check records are evicted with their pages",
+	     stats.glyphs < GLYPH_COUNT, TRUE);
+	LCUIFont_GetBitmap('A', font_id, GLYPH_SIZE, &cached);
+	it_b("check evicted bitmap is reloaded",
+	     cached && cached->buffer != NULL, TRUE);
+	LCUIFont_GetBitmap('A', font_id, GLYPH_SIZE, &cached);
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_i("check hits", (int)stats.hits, 2);
+	it_i("check misses", (int)stats.misses, 1);
+	LCUIFont_TrimBitmapCache(0);
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_b("check pinned bitmaps are not trimmed",
+	     stats.glyphs > 0 && cached->buffer != NULL, TRUE);
+	LCUIFont_EndFrame();
+	LCUIFont_TrimBitmapCache(0);
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_i("check cache is empty after trimming", (int)stats.bytes, 0);
+	it_i("check no records are left after trimming", (int)stats.glyphs, 0);
+	FontBitmap_Init(&bmp);
+	it_i("check a bitmap outside the cache is not pinned",
+	     LCUIFont_PinBitmap(&bmp), -1);
+	LCUIFont_GetBitmap('A', font_id, GLYPH_SIZE, &cached);
+	it_i("check a cached bitmap is pinned", LCUIFont_PinBitmap(cached), 0);
+	LCUIFont_SetBitmapCacheLimit(0);
+}
+
+static void test_font_cache_bounded(void)
+{
+	int i, frame, font_id;
+	size_t max_glyphs = 0;
+	const LCUI_FontBitmap *bmp;
+	LCUI_FontBitmapCacheStatsRec stats;
+
+	font_id = LCUIFont_GetId("inconsolata", 0, 0);
+	LCUIFont_SetBitmapCacheLimit(CACHE_LIMIT);
+	/* 每一帧都渲染一批新的字符，字体中没有的字符也会留下一条记录 */
+	for (frame = 0; frame < BOUNDED_FRAMES; ++frame) {
+		for (i = 0; i < BOUNDED_CHARS; ++i) {
+			LCUIFont_GetBitmap(0x4e00 + frame * BOUNDED_CHARS + i,
+					   font_id, 20, &bmp);
+		}
+		LCUIFont_EndFrame();
+		LCUIFont_GetBitmapCacheStats(&stats);
+		if (stats.glyphs > max_glyphs) {
+			max_glyphs = stats.glyphs;
+		}
+	}
+	it_b("check the number of cached glyphs is bounded",
+	     max_glyphs < BOUNDED_FRAMES * BOUNDED_CHARS / 4, TRUE);
+	it_b("check the cache is trimmed to the limit",
+	     stats.bytes <= CACHE_LIMIT * 2, TRUE);
+	LCUIFont_SetBitmapCacheLimit(0);
+}
+
+static LCUI_FontBitmap *AddFilledBitmap(int font_id, int size, int value)
+{
+	LCUI_FontBitmap bmp;
+
+	FontBitmap_Init(&bmp);
+	FontBitmap_Create(&bmp, size, size);
+	memset(bmp.buffer, value, bmp.width * bmp.rows);
+	return LCUIFont_AddBitmap('#', font_id, size, &bmp);
+}
+
+static void test_font_cache_replace(void)
+{
+	int font_id;
+	size_t bytes, epoch;
+	const LCUI_FontBitmap *old_bmp, *new_bmp, *cached;
+	LCUI_FontBitmapCacheStatsRec stats;
+
+	font_id = LCUIFont_GetId("inconsolata", 0, 0);
+	/* 位图数据比图集页大，独占一页，便于检查回收的空间 */
+	AddFilledBitmap(font_id, 300, 1);
+	LCUIFont_GetBitmapCacheStats(&stats);
+	bytes = stats.bytes;
+	epoch = LCUIFont_BeginRead();
+	LCUIFont_GetBitmap('#', font_id, 300, &old_bmp);
+	new_bmp = AddFilledBitmap(font_id, 300, 2);
+	it_b("check the replaced bitmap is a new record", new_bmp != old_bmp,
+	     TRUE);
+	it_b("check the old bitmap is readable until the read ends",
+	     old_bmp->buffer && old_bmp->buffer[0] == 1, TRUE);
+	LCUIFont_GetBitmap('#', font_id, 300, &cached);
+	it_b("check the new bitmap is found",
+	     cached == new_bmp && cached->buffer[0] == 2, TRUE);
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_b("check the old bitmap is retired",
+	     stats.retired > 0 && stats.bytes == bytes, TRUE);
+	LCUIFont_EndRead(epoch);
+	/* 不需要结束当前帧，下一次写入缓存时就会释放不再被读取的数据 */
+	AddFilledBitmap(font_id, 300, 3);
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_i("check retired data is freed after the read ends",
+	     (int)stats.retired, 0);
+	it_b("check the space of the old bitmaps is reclaimed",
+	     stats.bytes == bytes, TRUE);
+}
+
+static void StressThread(void *arg)
+{
+	int i, j;
+	LCUI_Pos pos = { 0, 0 };
+	StressTask task = arg;
+	const LCUI_FontBitmap *bmp;
+
+	size_t epoch;
+
+	/* 每个线程从不同的位置开始，使多个线程有机会同时插入相同的字符 */
+	for (i = 0; i < STRESS_GLYPHS; ++i) {
+		j = (i + task->offset) % STRESS_GLYPHS;
+		epoch = LCUIFont_BeginRead();
+		LCUIFont_GetBitmap(' ' + 1 + j % STRESS_CHARS, -1,
+				   10 + j / STRESS_CHARS, &bmp);
+		task->bitmaps[j] = bmp;
+		if (!bmp || LCUIFont_PinBitmap(bmp) != 0) {
+			task->errors += 1;
+		} else {
+			FontBitmap_Mix(&task->canvas, pos, bmp, RGB(0, 0, 0));
+		}
+		LCUIFont_EndRead(epoch);
+	}
+}
+
+static void test_font_cache_concurrency(void)
+{
+	int i, j, errors = 0, mismatches = 0;
+	StressTaskRec tasks[STRESS_THREADS];
+	LCUI_FontBitmap bmp;
+	const LCUI_FontBitmap *cached;
+
+	for (i = 0; i < STRESS_THREADS; ++i) {
+		tasks[i].errors = 0;
+		tasks[i].offset = i * STRESS_GLYPHS / STRESS_THREADS;
+		Graph_Init(&tasks[i].canvas);
+		tasks[i].canvas.color_type = LCUI_COLOR_TYPE_ARGB;
+		Graph_Create(&tasks[i].canvas, 64, 64);
+		LCUIThread_Create(&tasks[i].tid, StressThread, &tasks[i]);
+	}
+	for (i = 0; i < STRESS_THREADS; ++i) {
+		LCUIThread_Join(tasks[i].tid, NULL);
+		errors += tasks[i].errors;
+	}
+	it_i("check bitmaps are loaded by all threads", errors, 0);
+	/* 同一字符在所有线程中都应该得到同一个字体位图 */
+	for (j = 0; j < STRESS_GLYPHS; ++j) {
+		cached = tasks[0].bitmaps[j];
+		for (i = 1; i < STRESS_THREADS; ++i) {
+			if (tasks[i].bitmaps[j] != cached) {
+				mismatches += 1;
+			}
+		}
+		FontBitmap_Init(&bmp);
+		LCUIFont_RenderBitmap(&bmp, ' ' + 1 + j % STRESS_CHARS, -1,
+				      10 + j / STRESS_CHARS);
+		if (!cached || bmp.width != cached->width ||
+		    bmp.rows != cached->rows ||
+		    (bmp.buffer &&
+		     memcmp(bmp.buffer, cached->buffer, bmp.width * bmp.rows))) {
+			mismatches += 1;
+		}
+		FontBitmap_Free(&bmp);
+	}
+	it_i("check all threads share the same bitmaps", mismatches, 0);
+	for (i = 0; i < STRESS_THREADS; ++i) {
+		Graph_Free(&tasks[i].canvas);
+	}
+	LCUIFont_EndFrame();
+}
+
+/** 反转字形缓存中的字体位图，以便确认字体位图是从缓存中读取的 */
+static LCUI_BOOL InvertCachedGlyph(wchar_t ch, int size)
+{
+	int i;
+	uint64_t key;
+	LCUI_BOOL ok = FALSE;
+	LCUI_FontBitmap bmp;
+	LCUI_GlyphCacheRec cache;
+
+	key = GlyphCache_GetFontKey("test_font_load.ttf", 0);
+	GlyphCache_Init(&cache);
+	GlyphCache_Load(&cache, GLYPH_CACHE_FILE);
+	if (GlyphCache_Read(&cache, key, ch, size, &bmp) == 0) {
+		for (i = 0; i < bmp.width * bmp.rows; ++i) {
+			bmp.buffer[i] = 255 - bmp.buffer[i];
+		}
+		GlyphCache_Add(&cache, key, ch, size, &bmp);
+		ok = bmp.width > 0 &&
+		     GlyphCache_Save(&cache, GLYPH_CACHE_FILE) == 0;
+		FontBitmap_Free(&bmp);
+	}
+	GlyphCache_Destroy(&cache);
+	return ok;
+}
+
+/** 比较字体位图与字体引擎渲染的结果，inverted 为 TRUE 时与反转后的结果比较 */
+static LCUI_BOOL CompareRenderedGlyph(const LCUI_FontBitmap *cached,
+				      wchar_t ch, int font_id,
+				      LCUI_BOOL inverted)
+{
+	int i;
+	LCUI_BOOL ok;
+	LCUI_FontBitmap bmp;
+
+	FontBitmap_Init(&bmp);
+	LCUIFont_RenderBitmap(&bmp, ch, font_id, 16);
+	ok = cached && bmp.width > 0 && bmp.width == cached->width &&
+	     bmp.rows == cached->rows && bmp.top == cached->top &&
+	     bmp.advance.x == cached->advance.x;
+	for (i = 0; ok && i < bmp.width * bmp.rows; ++i) {
+		if (cached->buffer[i] !=
+		    (inverted ? 255 - bmp.buffer[i] : bmp.buffer[i])) {
+			ok = FALSE;
+		}
+	}
+	FontBitmap_Free(&bmp);
+	return ok;
+}
+
+static void test_font_glyph_cache(void)
+{
+	int id;
+	uint64_t key;
+	LCUI_FontBitmap bmp;
+	LCUI_GlyphCacheRec cache;
+	const LCUI_FontBitmap *cached;
+
+	remove(GLYPH_CACHE_FILE);
+	LCUIFont_SetGlyphCachePath(GLYPH_CACHE_FILE);
+	LCUI_InitFontLibrary();
+	LCUIFont_LoadFile("test_font_load.ttf");
+	id = LCUIFont_GetId("icomoon", 0, 0);
+	LCUIFont_GetBitmap('1', id, 16, &cached);
+	LCUIFont_GetBitmap('2', id, 16, &cached);
+	LCUI_FreeFontLibrary();
+	it_b("check rendered glyphs are saved to the glyph cache",
+	     InvertCachedGlyph('1', 16), TRUE);
+
+	LCUI_InitFontLibrary();
+	LCUIFont_LoadFile("test_font_load.ttf");
+	id = LCUIFont_GetId("icomoon", 0, 0);
+	LCUIFont_GetBitmap('1', id, 16, &cached);
+	it_b("check the glyph is read from the glyph cache",
+	     CompareRenderedGlyph(cached, '1', id, TRUE), TRUE);
+	LCUIFont_GetBitmap('2', id, 16, &cached);
+	it_b("check other glyphs in the glyph cache are kept",
+	     CompareRenderedGlyph(cached, '2', id, FALSE), TRUE);
+	LCUIFont_GetBitmap('3', id, 16, &cached);
+	it_b("check glyphs not in the glyph cache are rendered",
+	     CompareRenderedGlyph(cached, '3', id, FALSE), TRUE);
+	LCUI_FreeFontLibrary();
+
+	key = GlyphCache_GetFontKey("test_font_load.ttf", 0);
+	GlyphCache_Init(&cache);
+	GlyphCache_Load(&cache, GLYPH_CACHE_FILE);
+	it_i("check new glyphs are appended to the glyph cache",
+	     GlyphCache_Read(&cache, key, '3', 16, &bmp), 0);
+	FontBitmap_Free(&bmp);
+	it_b("check glyphs of other fonts are not found",
+	     GlyphCache_Read(&cache, key + 1, '3', 16, &bmp) != 0, TRUE);
+	GlyphCache_Destroy(&cache);
+	remove(GLYPH_CACHE_FILE);
+	LCUIFont_SetGlyphCachePath(NULL);
+
+	GlyphCache_Init(&cache);
+	FontBitmap_Init(&bmp);
+	bmp.width = 1024;
+	bmp.rows = 1024;
+	bmp.buffer = calloc(1024, 1024);
+	for (id = 0; id < 64; ++id) {
+		if (GlyphCache_Add(&cache, key, id, 16, &bmp) != 0) {
+			break;
+		}
+	}
+	it_b("check new glyphs are dropped after reaching the limit",
+	     id > 0 && id < 64 && cache.glyphs.length == (size_t)id, TRUE);
+	FontBitmap_Free(&bmp);
+	GlyphCache_Destroy(&cache);
+}
+
+static void test_font_fallback(void)
+{
+	int i, id, *ids, other_ids[3], results[512];
+	size_t count;
+	LCUI_FontBitmapCacheStatsRec stats;
+	const LCUI_FontBitmap *bmp, *fallback;
+
+	LCUI_InitFontLibrary();
+	it_i("check font names are resolved before the font is loaded",
+	     (int)LCUIFont_GetIdByNames(&ids, 0, 0, "icomoon, unknown"), 0);
+	LCUIFont_LoadFile("test_font_load.ttf");
+	id = LCUIFont_GetId("icomoon", 0, 0);
+	count = LCUIFont_GetIdByNames(&ids, 0, 0, "icomoon, unknown");
+	it_b("check font names are resolved again after loading fonts",
+	     count == 1 && ids[0] == id, TRUE);
+	it_i("check the font in the list is used for its own glyphs",
+	     LCUIFont_GetIdByChar(ids, '1'), id);
+	it_b("check other fonts are used for glyphs missing in the list",
+	     LCUIFont_GetIdByChar(ids, 'A') != id &&
+		 LCUIFont_GetBitmap('A', LCUIFont_GetIdByChar(ids, 'A'), 16,
+				    &bmp) == 0,
+	     TRUE);
+	it_i("check the first font is used for glyphs missing in all fonts",
+	     LCUIFont_GetIdByChar(ids, 0xffff), id);
+	other_ids[0] = LCUIFont_GetIdByChar(ids, 'A');
+	other_ids[1] = id;
+	other_ids[2] = 0;
+	it_b("check fallback results are not shared between font lists",
+	     LCUIFont_GetIdByChar(other_ids, '1') == other_ids[0] &&
+		 LCUIFont_GetIdByChar(ids, '1') == id,
+	     TRUE);
+	LCUIFont_GetBitmap(0xffff, id, 16, &fallback);
+	LCUIFont_GetBitmapCacheStats(&stats);
+	count = stats.misses;
+	it_i("check a missing glyph is reported again",
+	     LCUIFont_GetBitmap(0xffff, id, 16, &bmp), -1);
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_b("check a missing glyph is not rendered again",
+	     bmp == fallback && stats.misses == count, TRUE);
+	for (i = 0; i < 512; ++i) {
+		results[i] = LCUIFont_GetIdByChar(ids, 0x20 + i);
+	}
+	for (i = 0; i < 512; ++i) {
+		if (LCUIFont_GetIdByChar(ids, 0x20 + i) != results[i]) {
+			break;
+		}
+	}
+	it_i("check fallback results are kept after the table grows", i, 512);
+	LCUIFont_LoadFile("test_font_load.ttf");
+	for (i = 0; i < 512; ++i) {
+		if (LCUIFont_GetIdByChar(ids, 0x20 + i) != results[i]) {
+			break;
+		}
+	}
+	it_i("check fallback results are looked up again after loading fonts",
+	     i, 512);
+	free(ids);
+	LCUI_FreeFontLibrary();
+}
+
+void test_font_cache(void)
+{
+	LCUI_InitFontLibrary();
+	describe("test font cache eviction", test_font_cache_eviction);
+	describe("test font cache bounded", test_font_cache_bounded);
+	describe("test font cache replace", test_font_cache_replace);
+	describe("test font cache concurrency", test_font_cache_concurrency);
+	LCUI_FreeFontLibrary();
+	describe("test font glyph cache", test_font_glyph_cache);
+	describe("test font fallback", test_font_fallback);
+}
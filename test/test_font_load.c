@@ -1,4 +1,7 @@
-﻿#include <LCUI_Build.h>
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <LCUI_Build.h>
 #include <LCUI/LCUI.h>
 #include <LCUI/font.h>
 #include <LCUI/gui/css_library.h>
@@ -8,6 +11,7 @@
 
 #define GetSegoeUIFont(S, W) LCUIFont_GetId("Segoe UI", S, W)
 #define GetArialFont(S, W) LCUIFont_GetId("Arial", S, W)
+#define CATALOG_CACHE_FILE "test_font_catalog.cache"
 
 void test_segoe_ui_font_load(void)
 {
@@ -121,6 +125,184 @@ void test_arial_font_load(void)
 	}
 }
 
+/** 修改字体目录缓存中的字族名称，以便确认字体信息是从缓存中读取的 */
+static LCUI_BOOL RenameCachedFontFamily(const char *name)
+{
+	LCUI_BOOL ok = FALSE;
+	LCUI_FontCatalogRec catalog;
+	LCUI_FontCatalogFile file;
+
+	FontCatalog_Init(&catalog);
+	FontCatalog_Load(&catalog, CATALOG_CACHE_FILE);
+	file = FontCatalog_Find(&catalog, "test_font_load.ttf");
+	if (file && file->faces_length == 1) {
+		free(file->faces[0].family_name);
+		file->faces[0].family_name = strdup2(name);
+		ok = FontCatalog_Save(&catalog, CATALOG_CACHE_FILE) == 0;
+	}
+	FontCatalog_Destroy(&catalog);
+	return ok;
+}
+
+static void test_font_catalog_cache(void)
+{
+	int id;
+	FILE *fp;
+	LCUI_FontBitmap bmp;
+
+	remove(CATALOG_CACHE_FILE);
+	LCUIFont_SetCatalogCachePath(CATALOG_CACHE_FILE);
+	LCUI_InitFontLibrary();
+	it_i("check loading a font file which is not in the catalog",
+	     LCUIFont_LoadFile("test_font_load.ttf"), 0);
+	LCUI_FreeFontLibrary();
+	it_b("check the font file is recorded in the catalog cache",
+	     RenameCachedFontFamily("icomoon cached"), TRUE);
+
+	LCUI_InitFontLibrary();
+	it_i("check loading a font file which is in the catalog",
+	     LCUIFont_LoadFile("test_font_load.ttf"), 0);
+	id = LCUIFont_GetId("icomoon cached", 0, 0);
+	it_b("check the font info is read from the catalog", id > 0, TRUE);
+	FontBitmap_Init(&bmp);
+	it_b("check the font file is opened when rendering",
+	     LCUIFont_RenderBitmap(&bmp, 'a', id, 16) != -2, TRUE);
+	FontBitmap_Free(&bmp);
+	LCUI_FreeFontLibrary();
+
+	fp = fopen(CATALOG_CACHE_FILE, "w");
+	if (fp) {
+		fputs("LCUI font catalog 1\n1 2 3 test_font_load.ttf\n0\t", fp);
+		fclose(fp);
+	}
+	LCUI_InitFontLibrary();
+	it_i("check loading a font file with a broken catalog cache",
+	     LCUIFont_LoadFile("test_font_load.ttf"), 0);
+	it_b("check the font info is read from the font file",
+	     LCUIFont_GetId("icomoon", 0, 0) > 0, TRUE);
+	LCUI_FreeFontLibrary();
+	remove(CATALOG_CACHE_FILE);
+	LCUIFont_SetCatalogCachePath(NULL);
+}
+
+#ifndef LCUI_BUILD_IN_WIN32
+#define CATALOG_CACHE_HOME "test_font_cache_home"
+#define CATALOG_CACHE_DIR CATALOG_CACHE_HOME "/lcui"
+
+static void test_font_catalog_cache_dir(void)
+{
+	FILE *fp;
+	char *font_cache = NULL;
+	char *xdg_cache_home = NULL;
+
+	if (getenv("LCUI_FONT_CACHE")) {
+		font_cache = strdup(getenv("LCUI_FONT_CACHE"));
+	}
+	if (getenv("XDG_CACHE_HOME")) {
+		xdg_cache_home = strdup(getenv("XDG_CACHE_HOME"));
+	}
+	unsetenv("LCUI_FONT_CACHE");
+	setenv("XDG_CACHE_HOME", CATALOG_CACHE_HOME, 1);
+	LCUI_InitFontLibrary();
+	LCUIFont_LoadFile("test_font_load.ttf");
+	LCUI_FreeFontLibrary();
+	fp = fopen(CATALOG_CACHE_HOME "/lcui-fonts.cache", "r");
+	it_b("check the catalog cache is not saved by default", !fp, TRUE);
+	if (fp) {
+		fclose(fp);
+	}
+
+	setenv("LCUI_FONT_CACHE", CATALOG_CACHE_DIR "/lcui-fonts.cache", 1);
+	LCUI_InitFontLibrary();
+	LCUIFont_LoadFile("test_font_load.ttf");
+	LCUI_FreeFontLibrary();
+	fp = fopen(CATALOG_CACHE_DIR "/lcui-fonts.cache", "r");
+	it_b("check the missing cache directory is created", !!fp, TRUE);
+	if (fp) {
+		fclose(fp);
+	}
+	remove(CATALOG_CACHE_DIR "/lcui-fonts.cache");
+	remove(CATALOG_CACHE_DIR);
+	remove(CATALOG_CACHE_HOME);
+	if (font_cache) {
+		setenv("LCUI_FONT_CACHE", font_cache, 1);
+		free(font_cache);
+	} else {
+		unsetenv("LCUI_FONT_CACHE");
+	}
+	if (xdg_cache_home) {
+		setenv("XDG_CACHE_HOME", xdg_cache_home, 1);
+		free(xdg_cache_home);
+	} else {
+		unsetenv("XDG_CACHE_HOME");
+	}
+}
+#endif
+
+#define MMAP_TEST_GLYPHS 3
+
+/** 载入测试用的字体文件并渲染其中的几个字形 */
+static int RenderTestGlyphs(LCUI_FontBitmap *bmps)
+{
+	int i, id, ret = 0;
+
+	LCUI_InitFontLibrary();
+	LCUIFont_LoadFile("test_font_load.ttf");
+	id = LCUIFont_GetId("icomoon", 0, 0);
+	for (i = 0; i < MMAP_TEST_GLYPHS; ++i) {
+		FontBitmap_Init(&bmps[i]);
+		if (id < 1 ||
+		    LCUIFont_RenderBitmap(&bmps[i], '1' + i, id, 32) != 0 ||
+		    bmps[i].width < 1) {
+			ret = -1;
+		}
+	}
+	LCUI_FreeFontLibrary();
+	return ret;
+}
+
+static LCUI_BOOL CompareFontBitmap(const LCUI_FontBitmap *a,
+				   const LCUI_FontBitmap *b)
+{
+	return a->width == b->width && a->rows == b->rows &&
+	       a->top == b->top && a->left == b->left &&
+	       a->advance.x == b->advance.x && a->advance.y == b->advance.y &&
+	       memcmp(a->buffer, b->buffer, a->width * a->rows) == 0;
+}
+
+static void test_font_mmap(void)
+{
+	int i;
+	LCUI_BOOL ok = TRUE;
+	char *font_mmap = NULL;
+	LCUI_FontBitmap mapped[MMAP_TEST_GLYPHS], loaded[MMAP_TEST_GLYPHS];
+
+	if (getenv("LCUI_FONT_MMAP")) {
+		font_mmap = strdup(getenv("LCUI_FONT_MMAP"));
+	}
+	unsetenv("LCUI_FONT_MMAP");
+	it_i("check glyphs are rendered from the mapped font file",
+	     RenderTestGlyphs(mapped), 0);
+	setenv("LCUI_FONT_MMAP", "0", 1);
+	it_i("check glyphs are rendered from the font file",
+	     RenderTestGlyphs(loaded), 0);
+	for (i = 0; i < MMAP_TEST_GLYPHS; ++i) {
+		if (!CompareFontBitmap(&mapped[i], &loaded[i])) {
+			ok = FALSE;
+		}
+		FontBitmap_Free(&mapped[i]);
+		FontBitmap_Free(&loaded[i]);
+	}
+	it_b("check the mapped font file is rendered the same as the file",
+	     ok, TRUE);
+	if (font_mmap) {
+		setenv("LCUI_FONT_MMAP", font_mmap, 1);
+		free(font_mmap);
+	} else {
+		unsetenv("LCUI_FONT_MMAP");
+	}
+}
+
 void test_font_load(void)
 {
 	LCUI_InitFontLibrary();
@@ -144,4 +326,11 @@ void test_font_load(void)
 	LCUI_FreeCSSParser();
 	LCUI_FreeCSSLibrary();
 	LCUI_FreeFontLibrary();
+
+	describe("test font catalog cache", test_font_catalog_cache);
+#ifndef LCUI_BUILD_IN_WIN32
+	describe("test font catalog cache directory",
+		 test_font_catalog_cache_dir);
+	describe("test font file mapping", test_font_mmap);
+#endif
 }
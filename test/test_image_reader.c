@@ -1,13 +1,50 @@
 ﻿#include <stdio.h>
+#include <string.h>
 #include <LCUI_Build.h>
 #include <LCUI/LCUI.h>
 #include <LCUI/graph.h>
 #include <LCUI/image.h>
+#include <LCUI/gui/widget.h>
 #include <LCUI/util/logger.h>
 #include "test.h"
 #include "libtest.h"
 
-void test_image_reader(void)
+#define IMAGE_HEADER_FILE "test_image_header.png"
+
+/**
+ * 生成一个只有头部信息的 PNG 图像文件
+ * 文件在第一个 IDAT 块的块头之后截断，能读出图像尺寸，但无法解码图像数据。
+ */
+static int CreateImageHeaderFile(void)
+{
+	FILE *fp;
+	size_t i, size;
+	unsigned char data[4096];
+
+	fp = fopen("test_image_reader.png", "rb");
+	if (!fp) {
+		return -1;
+	}
+	size = fread(data, 1, sizeof(data), fp);
+	fclose(fp);
+	for (i = 0; i + 4 <= size; ++i) {
+		if (memcmp(data + i, "IDAT", 4) == 0) {
+			break;
+		}
+	}
+	if (i + 4 > size) {
+		return -1;
+	}
+	fp = fopen(IMAGE_HEADER_FILE, "wb");
+	if (!fp) {
+		return -1;
+	}
+	size = fwrite(data, 1, i + 4, fp);
+	fclose(fp);
+	return size == i + 4 ? 0 : -1;
+}
+
+static void test_image_reader_formats(void)
 {
 	LCUI_Graph img;
 	int i, width, height;
@@ -30,3 +67,81 @@ void test_image_reader(void)
 		Graph_Free(&img);
 	}
 }
+
+static void test_image_reader_header(void)
+{
+	LCUI_Graph img;
+	int width = 0, height = 0;
+
+	Graph_Init(&img);
+	it_b("check LCUI_GetImageSize only reads the image header",
+	     LCUI_GetImageSize(IMAGE_HEADER_FILE, &width, &height) == 0 &&
+		 width == 91 && height == 69,
+	     TRUE);
+	it_b("check LCUI_ReadImageFile cannot decode the image header",
+	     LCUI_ReadImageFile(IMAGE_HEADER_FILE, &img) != 0, TRUE);
+	Graph_Free(&img);
+}
+
+/** 等待背景图像的载入任务完成，直到图像满足条件或超时 */
+static LCUI_BOOL WaitBackgroundImage(LCUI_Widget w, LCUI_BOOL with_data)
+{
+	int i;
+	LCUI_Graph *image = &w->computed_style.background.image;
+
+	for (i = 0; i < 100; ++i) {
+		LCUI_ProcessEvents();
+		if (image->width > 0 && (!with_data || Graph_IsValid(image))) {
+			return TRUE;
+		}
+		LCUI_MSleep(10);
+	}
+	return FALSE;
+}
+
+static void test_background_image_size(void)
+{
+	LCUI_Widget w, other;
+	LCUI_Graph *image;
+
+	LCUI_Init();
+	w = LCUIWidget_New(NULL);
+	other = LCUIWidget_New(NULL);
+	image = &w->computed_style.background.image;
+	Widget_Append(LCUIWidget_GetRoot(), w);
+	Widget_Append(LCUIWidget_GetRoot(), other);
+	Widget_SetStyleString(w, "background-image",
+			      "url(" IMAGE_HEADER_FILE ")");
+	LCUIWidget_Update();
+	it_b("check the image size is available without the image data",
+	     WaitBackgroundImage(w, FALSE) && image->width == 91 &&
+		 image->height == 69,
+	     TRUE);
+	LCUI_MSleep(100);
+	LCUI_ProcessEvents();
+	it_b("check the image size is kept when the image cannot be decoded",
+	     image->width == 91 && image->height == 69 &&
+		 !Graph_IsValid(image),
+	     TRUE);
+
+	image = &other->computed_style.background.image;
+	Widget_SetStyleString(other, "background-image",
+			      "url(test_image_reader.png)");
+	LCUIWidget_Update();
+	it_b("check the image data is applied after it is decoded",
+	     WaitBackgroundImage(other, TRUE) && image->width == 91 &&
+		 image->height == 69,
+	     TRUE);
+	LCUI_Destroy();
+}
+
+void test_image_reader(void)
+{
+	if (CreateImageHeaderFile() != 0) {
+		Logger_Error("cannot create " IMAGE_HEADER_FILE "\n");
+	}
+	describe("test image reader formats", test_image_reader_formats);
+	describe("test image reader header", test_image_reader_header);
+	describe("test background image size", test_background_image_size);
+	remove(IMAGE_HEADER_FILE);
+}
@@ -0,0 +1,98 @@
+#include <wchar.h>
+#include <stdlib.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/util/math.h>
+#include <LCUI/util/rope.h>
+#include "test.h"
+#include "libtest.h"
+
+#define TEXT_BUFFER_SIZE 65536
+#define EDIT_TIMES 2000
+
+static unsigned int seed = 1;
+
+static unsigned int NextRandom(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+/** 生成指定长度的随机文本 */
+static void GenerateText(wchar_t *text, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		text[i] = L'a' + NextRandom() % 26;
+	}
+}
+
+void test_rope(void)
+{
+	int i;
+	size_t pos, len, text_len = 0;
+	LCUI_BOOL ok = TRUE;
+	wchar_t *text, *expected, *buf;
+	Rope rope;
+
+	text = malloc(sizeof(wchar_t) * TEXT_BUFFER_SIZE);
+	expected = malloc(sizeof(wchar_t) * TEXT_BUFFER_SIZE);
+	buf = malloc(sizeof(wchar_t) * (TEXT_BUFFER_SIZE + 1));
+	Rope_Init(&rope);
+	it_i("check the length of an empty rope", (int)Rope_GetLength(&rope),
+	     0);
+	it_i("check insert text", Rope_Insert(&rope, 0, L"hello", 5), 0);
+	it_i("check insert text at the end", Rope_Insert(&rope, 5, L"!", 1), 0);
+	it_i("check insert text in the middle",
+	     Rope_Insert(&rope, 5, L", world", 7), 0);
+	Rope_GetText(&rope, 0, TEXT_BUFFER_SIZE, buf);
+	it_b("check get text", wcscmp(buf, L"hello, world!") == 0, TRUE);
+	it_b("check get char", Rope_GetChar(&rope, 7) == L'w', TRUE);
+	Rope_Delete(&rope, 5, 7);
+	Rope_GetText(&rope, 0, TEXT_BUFFER_SIZE, buf);
+	it_b("check delete text", wcscmp(buf, L"hello!") == 0, TRUE);
+	Rope_Clear(&rope);
+	/* 随机编辑长文本，结果应该与直接编辑字符数组的结果相同 */
+	for (i = 0; i < EDIT_TIMES && ok; ++i) {
+		pos = NextRandom() % (text_len + 1);
+		if (NextRandom() % 3 > 0) {
+			len = 1 + NextRandom() % 3000;
+			if (text_len + len > TEXT_BUFFER_SIZE) {
+				continue;
+			}
+			GenerateText(text, len);
+			Rope_Insert(&rope, pos, text, len);
+			memmove(expected + pos + len, expected + pos,
+				sizeof(wchar_t) * (text_len - pos));
+			memcpy(expected + pos, text, sizeof(wchar_t) * len);
+			text_len += len;
+		} else {
+			len = 1 + NextRandom() % 2000;
+			len = min(len, text_len - pos);
+			Rope_Delete(&rope, pos, len);
+			memmove(expected + pos, expected + pos + len,
+				sizeof(wchar_t) * (text_len - pos - len));
+			text_len -= len;
+		}
+		ok = Rope_GetLength(&rope) == text_len &&
+		     Rope_GetText(&rope, 0, TEXT_BUFFER_SIZE, buf) == text_len &&
+		     memcmp(buf, expected, sizeof(wchar_t) * text_len) == 0;
+		if (ok && text_len > 0) {
+			pos = NextRandom() % text_len;
+			ok = Rope_GetChar(&rope, pos) == expected[pos];
+		}
+	}
+	it_b("check the text after random edits", ok, TRUE);
+	if (text_len > 200) {
+		len = Rope_GetText(&rope, 100, 100, buf);
+		ok = len == 100 && memcmp(buf, expected + 100,
+					  sizeof(wchar_t) * 100) == 0;
+		it_b("check get part of the text", ok, TRUE);
+	}
+	Rope_Clear(&rope);
+	it_i("check the length after clear", (int)Rope_GetLength(&rope), 0);
+	free(text);
+	free(expected);
+	free(buf);
+}
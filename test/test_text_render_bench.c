@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/graph.h>
+#include <LCUI/font.h>
+
+#define CANVAS_WIDTH 1280
+#define CANVAS_HEIGHT 720
+#define RENDER_PASSES 50
+
+static const wchar_t *text_line =
+    L"2019-01-01 12:00:00 [info] GET /api/v1/items?page=2 200 OK 18ms\n"
+    L"| id | name            | price  | stock | updated_at          |\n";
+
+static int64_t RenderText(LCUI_TextLayer layer, LCUI_ColorType color_type)
+{
+	int i;
+	int64_t start;
+	LCUI_Graph canvas;
+	LCUI_Pos pos = { 0, 0 };
+	LCUI_Rect area = { 0, 0, CANVAS_WIDTH, CANVAS_HEIGHT };
+
+	Graph_Init(&canvas);
+	canvas.color_type = color_type;
+	Graph_Create(&canvas, CANVAS_WIDTH, CANVAS_HEIGHT);
+	Graph_FillRect(&canvas, RGB(255, 255, 255), NULL, FALSE);
+	start = LCUI_GetTime();
+	for (i = 0; i < RENDER_PASSES; ++i) {
+		TextLayer_RenderTo(layer, area, pos, &canvas);
+	}
+	start = LCUI_GetTimeDelta(start);
+	Graph_Free(&canvas);
+	return start;
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+	wchar_t *text;
+	size_t len = wcslen(text_line);
+	char s_argb[32], s_rgb[32];
+	LCUI_TextLayer layer;
+	LCUI_TextStyleRec style;
+
+	/* 生成足够填满画布的日志和表格文本 */
+	text = malloc(sizeof(wchar_t) * (len * 30 + 1));
+	for (i = 0; i < 30; ++i) {
+		wcscpy(text + len * i, text_line);
+	}
+	LCUI_InitFontLibrary();
+	TextStyle_Init(&style);
+	style.pixel_size = 14;
+	style.has_pixel_size = TRUE;
+	/* usage: test_text_render_bench [font file] */
+	if (argc > 1) {
+		LCUIFont_LoadFile(argv[1]);
+	}
+	layer = TextLayer_New();
+	TextLayer_SetMultiline(layer, TRUE);
+	TextLayer_SetTextStyle(layer, &style);
+	TextLayer_SetFixedSize(layer, CANVAS_WIDTH, CANVAS_HEIGHT);
+	TextLayer_SetTextW(layer, text, NULL);
+	TextLayer_Update(layer, NULL);
+	TextLayer_ClearInvalidRect(layer);
+	sprintf(s_argb, "%.2fms",
+		1.0 * RenderText(layer, LCUI_COLOR_TYPE_ARGB) / RENDER_PASSES);
+	sprintf(s_rgb, "%.2fms",
+		1.0 * RenderText(layer, LCUI_COLOR_TYPE_RGB) / RENDER_PASSES);
+	Logger_Info("%-20s%-20s%s\n", "characters", "ARGB (avg)", "RGB (avg)");
+	Logger_Info("%-20d%-20s%s\n", (int)(len * 30), s_argb, s_rgb);
+	TextLayer_Destroy(layer);
+	TextStyle_Destroy(&style);
+	LCUI_FreeFontLibrary();
+	free(text);
+	return 0;
+}
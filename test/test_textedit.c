@@ -1,11 +1,86 @@
+#include <stdlib.h>
+#include <wchar.h>
 #include <LCUI_Build.h>
 #include <LCUI/LCUI.h>
 #include <LCUI/font.h>
+#include <LCUI/input.h>
 #include <LCUI/gui/widget.h>
 #include <LCUI/gui/widget/textedit.h>
 #include "test.h"
 #include "libtest.h"
 
+#define LARGE_TEXT_LINES 2000
+
+static void PressKey(LCUI_Widget w, int key_code)
+{
+	LCUI_WidgetEventRec ev;
+
+	LCUI_InitWidgetEvent(&ev, "keydown");
+	ev.key.code = key_code;
+	Widget_TriggerEvent(w, &ev, NULL);
+}
+
+static void test_textedit_large_text(void)
+{
+	int i;
+	size_t len = 0;
+	wchar_t *text, *buf;
+	LCUI_Widget w = LCUIWidget_New("textedit");
+
+	text = malloc(sizeof(wchar_t) * LARGE_TEXT_LINES * 16);
+	buf = malloc(sizeof(wchar_t) * LARGE_TEXT_LINES * 16);
+	for (i = 0; i < LARGE_TEXT_LINES; ++i) {
+		len += swprintf(text + len, 16, i % 2 ? L"line %d\r\n" :
+					       L"line %d\n", i);
+	}
+	TextEdit_SetTextW(w, text);
+	Widget_Update(w);
+	it_b("check TextEdit_GetTextLength after setting large text",
+	     TextEdit_GetTextLength(w) == len, TRUE);
+	it_b("check TextEdit_GetTextW after setting large text",
+	     TextEdit_GetTextW(w, 0, len, buf) == len &&
+		 wcscmp(text, buf) == 0,
+	     TRUE);
+
+	TextEdit_MoveCaret(w, 2, 0);
+	TextEdit_InsertTextW(w, L"abc");
+	Widget_Update(w);
+	TextEdit_GetTextW(w, 0, 32, buf);
+	it_b("check inserting text into large text",
+	     wcsncmp(buf, L"line 0\nline 1\r\nabcline 2\n", 25) == 0, TRUE);
+	PressKey(w, LCUI_KEY_BACKSPACE);
+	PressKey(w, LCUI_KEY_BACKSPACE);
+	PressKey(w, LCUI_KEY_BACKSPACE);
+	Widget_Update(w);
+	it_b("check deleting text from large text",
+	     TextEdit_GetTextW(w, 0, len, buf) == len &&
+		 wcscmp(text, buf) == 0,
+	     TRUE);
+	TextEdit_MoveCaret(w, 2, 0);
+	PressKey(w, LCUI_KEY_BACKSPACE);
+	PressKey(w, LCUI_KEY_DELETE);
+	Widget_Update(w);
+	TextEdit_GetTextW(w, 0, 32, buf);
+	it_b("check deleting line break from large text",
+	     wcsncmp(buf, L"line 0\nline 1ine 2\n", 19) == 0, TRUE);
+	it_b("check the length after deleting text",
+	     TextEdit_GetTextLength(w) == len - 3, TRUE);
+	TextEdit_AppendTextW(w, L"xy");
+	Widget_Update(w);
+	TextEdit_MoveCaret(w, LARGE_TEXT_LINES - 1, 2);
+	PressKey(w, LCUI_KEY_BACKSPACE);
+	PressKey(w, LCUI_KEY_BACKSPACE);
+	Widget_Update(w);
+	it_b("check deleting the whole last line",
+	     TextEdit_GetTextLength(w) == len - 3 &&
+		 TextEdit_GetTextW(w, len - 14, 32, buf) == 11 &&
+		 wcscmp(buf, L"line 1999\r\n") == 0,
+	     TRUE);
+	Widget_Destroy(w);
+	free(text);
+	free(buf);
+}
+
 void test_textedit(void)
 {
 	LCUI_Widget w;
@@ -86,6 +161,8 @@ void test_textedit(void)
 	Widget_Destroy(w);
 	Object_Delete(value);
 
+	test_textedit_large_text();
+
 	LCUI_FreeWidget();
 	LCUI_FreeFontLibrary();
 }
@@ -1,24 +1,511 @@
 #include <wchar.h>
 #include <string.h>
+#include <stdlib.h>
 #include <LCUI_Build.h>
-#include <LCUI/util/logger.h>
-#include <LCUI/font/textlayer.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/graph.h>
+#include <LCUI/font.h>
 #include "test.h"
+#include "libtest.h"
 
-static int test_textlayer_wordbreak(void)
+#define TEXT_BUFFER_SIZE 8192
+#define EDIT_TIMES 300
+
+static unsigned int seed = 1;
+
+static unsigned int NextRandom(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+static LCUI_TextLayer CreateTextLayer(LCUI_WordBreakMode mode)
 {
 	LCUI_TextLayer layer;
+	LCUI_TextStyleRec style;
 
+	TextStyle_Init(&style);
+	style.pixel_size = 14;
+	style.has_pixel_size = TRUE;
 	layer = TextLayer_New();
-	TextLayer_SetTextW(layer,
-			   L"hello, world! "
-			   L"long long long texttexttext, test word break",
-			   NULL);
-	TextLayer_SetFixedSize(layer, )
+	TextLayer_SetTextStyle(layer, &style);
+	TextLayer_SetMultiline(layer, TRUE);
+	TextLayer_SetAutoWrap(layer, TRUE);
+	TextLayer_SetWordBreak(layer, mode);
+	TextLayer_SetFixedSize(layer, 200, 0);
+	TextStyle_Destroy(&style);
+	return layer;
+}
+
+/** 获取文本图层中的全部文本，包括换行符 */
+static void GetLayerText(LCUI_TextLayer layer, wchar_t *wstr)
+{
+	int row, col;
+	size_t i = 0;
+	LCUI_TextRow txtrow;
+
+	for (row = 0; row < layer->text_rows.length; ++row) {
+		txtrow = layer->text_rows.rows[row];
+		for (col = 0; col < txtrow->length && i < TEXT_BUFFER_SIZE - 2;
+		     ++col) {
+			wstr[i++] = txtrow->string[col].code;
+		}
+		if (txtrow->eol != LCUI_EOL_NONE &&
+		    row < layer->text_rows.length - 1) {
+			wstr[i++] = '\n';
+		}
+	}
+	wstr[i] = 0;
+}
+
+/** 检查两个文本图层的断行位置是否相同 */
+static LCUI_BOOL CompareLayout(LCUI_TextLayer a, LCUI_TextLayer b)
+{
+	int row;
+	LCUI_TextRow row_a, row_b;
+
+	if (a->text_rows.length != b->text_rows.length) {
+		return FALSE;
+	}
+	for (row = 0; row < a->text_rows.length; ++row) {
+		row_a = a->text_rows.rows[row];
+		row_b = b->text_rows.rows[row];
+		if (row_a->length != row_b->length ||
+		    row_a->width != row_b->width) {
+			return FALSE;
+		}
+		if (row < a->text_rows.length - 1 && row_a->eol != row_b->eol) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static void test_textlayer_incremental_typeset(LCUI_WordBreakMode mode)
+{
+	int i, row, col;
+	LCUI_BOOL ok = TRUE;
+	LCUI_TextLayer layer, expected;
+	wchar_t *text;
+	const wchar_t *words[] = { L"ab ",        L"hello ", L"x",
+				   L"wonderful ", L"\n",     L"a b c ",
+				   L"iiiiiiiiiiiiiiiiiiiiiiiiiiiiiiii " };
+
+	text = malloc(sizeof(wchar_t) * TEXT_BUFFER_SIZE);
+	layer = CreateTextLayer(mode);
+	for (i = 0; i < EDIT_TIMES && ok; ++i) {
+		row = NextRandom() % layer->text_rows.length;
+		col = NextRandom() % (layer->text_rows.rows[row]->length + 1);
+		TextLayer_SetCaretPos(layer, row, col);
+		switch (NextRandom() % 4) {
+		case 0:
+		case 1:
+			TextLayer_InsertTextW(layer, words[NextRandom() % 7],
+					      NULL);
+			break;
+		case 2:
+			TextLayer_TextDelete(layer, 1 + NextRandom() % 8);
+			break;
+		default:
+			TextLayer_TextBackspace(layer, 1 + NextRandom() % 5);
+			break;
+		}
+		TextLayer_Update(layer, NULL);
+		TextLayer_ClearInvalidRect(layer);
+		/* 重新排版后的结果应该与从头开始排版的结果相同 */
+		GetLayerText(layer, text);
+		expected = CreateTextLayer(mode);
+		TextLayer_SetTextW(expected, text, NULL);
+		TextLayer_Update(expected, NULL);
+		ok = CompareLayout(layer, expected);
+		TextLayer_Destroy(expected);
+	}
+	it_b("check the layout after each edit matches a full typeset", ok,
+	     TRUE);
+	TextLayer_Destroy(layer);
+	free(text);
+}
+
+static void test_textlayer_bounded_typeset(void)
+{
+	int i, n_rows;
+	wchar_t text[1024] = { 0 };
+	LCUI_BOOL unchanged = TRUE;
+	LCUI_TextRow rows[64];
+	LCUI_TextLayer layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+
+	for (i = 0; i < 8; ++i) {
+		wcscat(text, L"lorem ipsum dolor sit amet, consectetur "
+			     L"adipiscing elit, sed do eiusmod tempor "
+			     L"incididunt ut\n");
+	}
+	TextLayer_SetTextW(layer, text, NULL);
+	TextLayer_Update(layer, NULL);
+	n_rows = layer->text_rows.length;
+	it_b("check the text is wrapped into many rows",
+	     n_rows > 16 && n_rows <= 64, TRUE);
+	if (n_rows > 64) {
+		TextLayer_Destroy(layer);
+		return;
+	}
+	memcpy(rows, layer->text_rows.rows, sizeof(LCUI_TextRow) * n_rows);
+	/* 在第一段中输入文字，后面的段落不应该被重新排版 */
+	TextLayer_SetCaretPos(layer, 0, 0);
+	TextLayer_InsertTextW(layer, L"hello, ", NULL);
 	TextLayer_Update(layer, NULL);
+	for (i = 1; i <= n_rows / 2; ++i) {
+		if (layer->text_rows.rows[layer->text_rows.length - i] !=
+		    rows[n_rows - i]) {
+			unchanged = FALSE;
+		}
+	}
+	it_b("check rows after the edited paragraph are kept", unchanged,
+	     TRUE);
+	TextLayer_Destroy(layer);
+}
+
+/** 检查文本行的像素坐标是否与逐行累加行高的结果相同 */
+static LCUI_BOOL CheckRowsPixelPos(LCUI_TextLayer layer)
+{
+	int row, y = 0;
+	LCUI_Pos pos;
+
+	for (row = 0; row < layer->text_rows.length; ++row) {
+		TextLayer_GetCharPixelPos(layer, row, 0, &pos);
+		if (pos.y != y) {
+			return FALSE;
+		}
+		TextLayer_SetCaretPosByPixelPos(layer, 0,
+						layer->offset_y + y + 1);
+		if (layer->insert_y != row) {
+			return FALSE;
+		}
+		y += layer->text_rows.rows[row]->height;
+	}
+	return TextLayer_GetHeight(layer) == y;
+}
+
+static void test_textlayer_lazy_typeset(void)
+{
+	int i, n_pending = 0;
+	LCUI_BOOL ok = TRUE;
+	LCUI_TextLayer layer, expected;
+	wchar_t *text;
+
+	text = malloc(sizeof(wchar_t) * TEXT_BUFFER_SIZE);
+	text[0] = 0;
+	for (i = 0; i < 40; ++i) {
+		wcscat(text, L"lorem ipsum dolor sit amet, consectetur "
+			     L"adipiscing elit, sed do eiusmod tempor "
+			     L"incididunt ut\n");
+	}
+	layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+	TextLayer_SetFixedSize(layer, 200, 100);
+	TextLayer_SetTextW(layer, text, NULL);
+	TextLayer_Update(layer, NULL);
+	TextLayer_ClearInvalidRect(layer);
+	for (i = 0; i < layer->text_rows.length; ++i) {
+		if (layer->text_rows.rows[i]->need_typeset) {
+			++n_pending;
+		}
+	}
+	it_b("check rows far below the viewport are not typeset",
+	     n_pending > 0, TRUE);
+	it_b("check the pixel position of rows", CheckRowsPixelPos(layer),
+	     TRUE);
+	/* 向下滚动，直到全部文本行都排版完 */
+	for (i = 0; i < 100 && layer->task.update_typeset; ++i) {
+		TextLayer_SetOffset(layer, 0, -TextLayer_GetHeight(layer));
+		TextLayer_Update(layer, NULL);
+		TextLayer_ClearInvalidRect(layer);
+	}
+	expected = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+	TextLayer_SetTextW(expected, text, NULL);
+	TextLayer_Update(expected, NULL);
+	ok = !layer->task.update_typeset && CompareLayout(layer, expected);
+	it_b("check the layout after scrolling matches a full typeset", ok,
+	     TRUE);
+	it_b("check the pixel position of rows after scrolling",
+	     CheckRowsPixelPos(layer), TRUE);
+	TextLayer_Destroy(expected);
+	TextLayer_Destroy(layer);
+	free(text);
+}
+
+/** 检查各个文本行的坐标是否都已计算好 */
+static LCUI_BOOL CheckRowsCoords(LCUI_TextLayer layer)
+{
+	int row;
+
+	for (row = 0; row < layer->text_rows.length; ++row) {
+		if (!layer->text_rows.rows[row]->chars_x) {
+			return FALSE;
+		}
+	}
+	return layer->text_rows.valid_y_length == layer->text_rows.length;
+}
+
+static void test_textlayer_render(void)
+{
+	int i;
+	LCUI_Graph graph;
+	LCUI_Pos pos = { 0, 0 };
+	LCUI_Rect rect = { 0, 0, 200, 100 };
+	wchar_t text[1024] = { 0 };
+	LCUI_TextLayer layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+
+	for (i = 0; i < 8; ++i) {
+		wcscat(text, L"lorem ipsum dolor sit amet, consectetur "
+			     L"adipiscing elit, sed do eiusmod tempor\n");
+	}
+	Graph_Init(&graph);
+	graph.color_type = LCUI_COLOR_TYPE_ARGB;
+	Graph_Create(&graph, 200, 100);
+	TextLayer_SetTextW(layer, text, NULL);
+	TextLayer_Update(layer, NULL);
+	it_b("check the coordinates are computed by TextLayer_Update()",
+	     CheckRowsCoords(layer), TRUE);
+	/* 绘制时只读取坐标，修改后还未更新的文本行不应在绘制时计算坐标 */
+	TextLayer_SetCaretPos(layer, 0, 0);
+	TextLayer_InsertTextW(layer, L"hello, ", NULL);
+	TextLayer_RenderTo(layer, rect, pos, &graph);
+	it_b("check TextLayer_RenderTo() does not compute coordinates",
+	     !layer->text_rows.rows[0]->chars_x, TRUE);
+	TextLayer_Update(layer, NULL);
+	it_b("check the coordinates are computed after edited",
+	     CheckRowsCoords(layer), TRUE);
+	Graph_Free(&graph);
+	TextLayer_Destroy(layer);
+}
+
+/** 清空字体位图缓存，使之后用到的字体位图都需要重新渲染 */
+static void ClearFontBitmapCache(void)
+{
+	LCUIFont_EndFrame();
+	LCUIFont_EndFrame();
+	LCUIFont_TrimBitmapCache(0);
+}
+
+/** 字体位图缓存中的字体位图被回收后，文本图层的排版和绘制结果应保持不变 */
+static void test_textlayer_evicted_glyphs(void)
+{
+	int width;
+	LCUI_Graph graph, expected;
+	LCUI_Pos pos = { 0, 0 };
+	LCUI_Rect rect = { 0, 0, 200, 100 };
+	LCUI_FontBitmapCacheStatsRec stats;
+	LCUI_TextLayer layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+
+	Graph_Init(&graph);
+	Graph_Init(&expected);
+	graph.color_type = LCUI_COLOR_TYPE_ARGB;
+	expected.color_type = LCUI_COLOR_TYPE_ARGB;
+	Graph_Create(&graph, 200, 100);
+	Graph_Create(&expected, 200, 100);
+	TextLayer_SetTextW(layer, L"lorem ipsum dolor sit amet", NULL);
+	TextLayer_Update(layer, NULL);
+	TextLayer_RenderTo(layer, rect, pos, &expected);
+	width = layer->text_rows.rows[0]->width;
+	ClearFontBitmapCache();
+	LCUIFont_GetBitmapCacheStats(&stats);
+	it_i("check the font bitmap cache is emptied", (int)stats.glyphs, 0);
+	TextLayer_AddUpdateTypeset(layer, 0);
+	TextLayer_Update(layer, NULL);
+	it_i("check the row width is kept after glyphs are evicted",
+	     layer->text_rows.rows[0]->width, width);
+	TextLayer_RenderTo(layer, rect, pos, &graph);
+	it_b("check the text is rendered the same after glyphs are evicted",
+	     memcmp(graph.bytes, expected.bytes, graph.mem_size) == 0, TRUE);
+	Graph_Free(&graph);
+	Graph_Free(&expected);
+	TextLayer_Destroy(layer);
+}
+
+/** 一次载入大量字符时并行渲染的字体位图，应与逐个渲染的结果相同 */
+static void test_textlayer_parallel_glyphs(void)
+{
+	int i;
+	wchar_t text[128], ch[2] = { 0 };
+	LCUI_Graph graph, expected;
+	LCUI_Pos pos = { 0, 0 };
+	LCUI_Rect rect = { 0, 0, 200, 200 };
+	LCUI_TextLayer layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+	LCUI_TextLayer serial_layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+
+	for (i = 0; i < 94; ++i) {
+		text[i] = '!' + i;
+	}
+	text[i] = 0;
+	Graph_Init(&graph);
+	Graph_Init(&expected);
+	graph.color_type = LCUI_COLOR_TYPE_ARGB;
+	expected.color_type = LCUI_COLOR_TYPE_ARGB;
+	Graph_Create(&graph, 200, 200);
+	Graph_Create(&expected, 200, 200);
+	ClearFontBitmapCache();
+	for (i = 0; text[i]; ++i) {
+		ch[0] = text[i];
+		TextLayer_InsertTextW(serial_layer, ch, NULL);
+	}
+	TextLayer_Update(serial_layer, NULL);
+	TextLayer_RenderTo(serial_layer, rect, pos, &expected);
+	ClearFontBitmapCache();
+	TextLayer_SetTextW(layer, text, NULL);
+	TextLayer_Update(layer, NULL);
+	TextLayer_RenderTo(layer, rect, pos, &graph);
+	it_b("check the layout of glyphs loaded in parallel",
+	     CompareLayout(layer, serial_layer), TRUE);
+	it_b("check glyphs loaded in parallel are rendered the same",
+	     memcmp(graph.bytes, expected.bytes, graph.mem_size) == 0, TRUE);
+	Graph_Free(&graph);
+	Graph_Free(&expected);
+	TextLayer_Destroy(layer);
+	TextLayer_Destroy(serial_layer);
+}
+
+static void SetTextLayerStyle(LCUI_TextLayer layer, int pixel_size,
+			      const char *font)
+{
+	LCUI_TextStyleRec style;
+
+	TextStyle_Init(&style);
+	style.pixel_size = pixel_size;
+	style.has_pixel_size = TRUE;
+	if (font) {
+		TextStyle_SetFont(&style, font);
+	}
+	TextLayer_SetTextStyle(layer, &style);
+	/* 与 TextView 部件一样，改变样式后重新排版 */
+	TextLayer_AddUpdateTypeset(layer, 0);
+	TextStyle_Destroy(&style);
+}
+
+/** 新建一个已排版的文本图层，用于对比排版结果 */
+static LCUI_TextLayer CreateTypesetLayer(const wchar_t *text, int pixel_size,
+					 const char *font)
+{
+	LCUI_TextLayer layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+
+	SetTextLayerStyle(layer, pixel_size, font);
+	TextLayer_SetTextW(layer, text, NULL);
+	TextLayer_Update(layer, NULL);
+	return layer;
+}
+
+/** 文本样式或字体改变后，缓存的词语尺寸应失效，断行结果与新建的图层相同 */
+static void test_textlayer_word_widths(void)
+{
+	int i;
+	wchar_t text[512] = { 0 };
+	LCUI_TextLayer layer, expected, small_layer;
+
+	for (i = 0; i < 4; ++i) {
+		wcscat(text, L"12 lorem 345 ipsum dolor 6789 sit amet ");
+	}
+	LCUIFont_LoadFile("test_font_load.ttf");
+	layer = CreateTypesetLayer(text, 14, NULL);
+	small_layer = CreateTypesetLayer(text, 14, NULL);
+
+	SetTextLayerStyle(layer, 20, NULL);
+	TextLayer_Update(layer, NULL);
+	expected = CreateTypesetLayer(text, 20, NULL);
+	it_b("check the layout changes with the font size",
+	     CompareLayout(expected, small_layer), FALSE);
+	it_b("check word widths are updated after the font size changed",
+	     CompareLayout(layer, expected), TRUE);
+	TextLayer_Destroy(expected);
+
+	SetTextLayerStyle(layer, 20, "icomoon");
+	TextLayer_Update(layer, NULL);
+	expected = CreateTypesetLayer(text, 20, "icomoon");
+	it_b("check word widths are updated after the font changed",
+	     CompareLayout(layer, expected), TRUE);
+	TextLayer_Destroy(expected);
+	TextLayer_Destroy(small_layer);
+	TextLayer_Destroy(layer);
+}
+
+static void test_textlayer_text_offset(void)
+{
+	LCUI_TextLayer layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+
+	TextLayer_SetTextW(layer, L"ab\r\ncd\nef", NULL);
+	TextLayer_Update(layer, NULL);
+	it_b("check text offsets count line breaks",
+	     TextLayer_GetTextOffset(layer, 1, 0) == 4 &&
+		 TextLayer_GetTextOffset(layer, 2, 1) == 8 &&
+		 TextLayer_GetTextOffset(layer, 3, 0) == 9,
+	     TRUE);
+	TextLayer_SetCaretPos(layer, 0, 1);
+	TextLayer_InsertTextW(layer, L"x\ny", NULL);
+	it_b("check text offsets are updated after inserting text",
+	     TextLayer_GetTextOffset(layer, 1, 0) == 3 &&
+		 TextLayer_GetTextOffset(layer, 3, 1) == 11,
+	     TRUE);
+	TextLayer_SetCaretPos(layer, 1, 0);
+	TextLayer_TextBackspace(layer, 1);
+	it_b("check text offsets are updated after deleting text",
+	     TextLayer_GetTextOffset(layer, 1, 0) == 6 &&
+		 TextLayer_GetTextOffset(layer, 2, 1) == 10,
+	     TRUE);
+	TextLayer_Destroy(layer);
+}
+
+/** 获取样式表中仍在使用的样式数量 */
+static unsigned CountTextStyles(LCUI_TextLayer layer)
+{
+	unsigned i, n = 0;
+
+	for (i = 0; i < layer->text_styles_length; ++i) {
+		if (layer->text_styles[i]) {
+			++n;
+		}
+	}
+	return n;
+}
+
+static void test_textlayer_style_table(void)
+{
+	int i;
+	LCUI_TextLayer layer = CreateTextLayer(LCUI_WORD_BREAK_NORMAL);
+
+	TextLayer_EnableStyleTag(layer, TRUE);
+	for (i = 0; i < 100; ++i) {
+		TextLayer_InsertTextW(layer, L"[color=#f00]ab[/color]\n", NULL);
+	}
+	it_i("check the same styles are merged",
+	     (int)layer->text_styles_length, 1);
+	TextLayer_InsertTextW(layer, L"[size=20]cd\nef[/size]", NULL);
+	it_i("check a different style is added", (int)CountTextStyles(layer),
+	     2);
+	TextLayer_TextBackspace(layer, 5);
+	it_i("check the style is freed after its text is deleted",
+	     (int)CountTextStyles(layer), 1);
+	TextLayer_InsertTextW(layer, L"[b]gh[/b]", NULL);
+	it_i("check the freed style index is reused",
+	     (int)layer->text_styles_length, 2);
+	TextLayer_InsertTextW(layer, L"[i][/i]", NULL);
+	it_i("check the style without text is freed",
+	     (int)CountTextStyles(layer), 2);
+	TextLayer_SetCaretPos(layer, 0, 0);
+	TextLayer_TextDelete(layer, 1000);
+	it_i("check all styles are freed after deleting rows",
+	     (int)CountTextStyles(layer), 0);
+	TextLayer_Destroy(layer);
 }
 
-int test_textlayer(void)
+void test_textlayer(void)
 {
-	return test_textlayer_wordbreak();
+	LCUI_InitFontLibrary();
+	test_textlayer_incremental_typeset(LCUI_WORD_BREAK_NORMAL);
+	test_textlayer_incremental_typeset(LCUI_WORD_BREAK_BREAK_ALL);
+	test_textlayer_bounded_typeset();
+	test_textlayer_lazy_typeset();
+	test_textlayer_render();
+	test_textlayer_evicted_glyphs();
+	test_textlayer_parallel_glyphs();
+	test_textlayer_word_widths();
+	test_textlayer_text_offset();
+	test_textlayer_style_table();
+	LCUI_FreeFontLibrary();
 }
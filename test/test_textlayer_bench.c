@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/graph.h>
+#include <LCUI/font.h>
+
+#define TEXT_LENGTH 100000
+#define LAYER_WIDTH 800
+#define VIEW_HEIGHT 600
+#define INSERT_TIMES 100
+#define RENDER_TIMES 100
+#define RESIZE_TIMES 20
+
+static const wchar_t *text_words[] = {
+	L"lorem ", L"ipsum ", L"dolor ", L"sit ",   L"amet, ",
+	L"consectetur ", L"adipiscing ", L"elit, ", L"sed ", L"do "
+};
+
+/** 生成由单词组成的文本，段落长度为 0 时不换行 */
+static void GenerateText(wchar_t *text, size_t len, size_t para_len)
+{
+	size_t i, n, para_end = para_len;
+	const wchar_t *word;
+
+	for (i = 0, n = 0; i < len; ++n) {
+		word = text_words[n % 10];
+		for (; *word && i < len; ++word, ++i) {
+			text[i] = *word;
+		}
+		if (para_len > 0 && i >= para_end && i < len) {
+			text[i++] = '\n';
+			para_end = i + para_len;
+		}
+	}
+	text[len] = 0;
+}
+
+static LCUI_TextLayer CreateTextLayer(int height)
+{
+	LCUI_TextLayer layer;
+	LCUI_TextStyleRec style;
+
+	TextStyle_Init(&style);
+	style.pixel_size = 14;
+	style.has_pixel_size = TRUE;
+	layer = TextLayer_New();
+	TextLayer_SetTextStyle(layer, &style);
+	TextLayer_SetMultiline(layer, TRUE);
+	TextLayer_SetAutoWrap(layer, TRUE);
+	TextLayer_SetFixedSize(layer, LAYER_WIDTH, height);
+	TextStyle_Destroy(&style);
+	return layer;
+}
+
+/** 滚动至文本的中间位置，然后绘制一屏的内容 */
+static int64_t RenderText(LCUI_TextLayer layer, LCUI_Graph *canvas)
+{
+	int i;
+	int64_t start;
+	LCUI_Pos pos = { 0, 0 };
+	LCUI_Rect area = { 0, 0, LAYER_WIDTH, VIEW_HEIGHT };
+
+	TextLayer_SetOffset(layer, 0, -TextLayer_GetHeight(layer) / 2);
+	TextLayer_Update(layer, NULL);
+	TextLayer_ClearInvalidRect(layer);
+	start = LCUI_GetTime();
+	for (i = 0; i < RENDER_TIMES; ++i) {
+		TextLayer_RenderTo(layer, area, pos, canvas);
+	}
+	return LCUI_GetTimeDelta(start);
+}
+
+/** 模拟拖动窗口边框，反复改变文本图层的宽度并重新排版 */
+static int64_t ResizeText(LCUI_TextLayer layer, int height)
+{
+	int i;
+	int64_t start = LCUI_GetTime();
+
+	for (i = 0; i < RESIZE_TIMES; ++i) {
+		TextLayer_SetFixedSize(layer, LAYER_WIDTH - 10 * (i % 10 + 1),
+				       height);
+		TextLayer_Update(layer, NULL);
+		TextLayer_ClearInvalidRect(layer);
+	}
+	return LCUI_GetTimeDelta(start);
+}
+
+/**
+ * 测试文本的设置、输入、绘制和改变宽度的耗时
+ * @param height 文本图层的高度，大于 0 时只需排版可见区域附近的文本
+ */
+static void RunBench(const char *name, const wchar_t *text, int height,
+		     LCUI_Graph *canvas)
+{
+	int i;
+	int64_t start, set_time, insert_time, render_time, resize_time;
+	char s_set[32], s_insert[32], s_render[32], s_resize[32];
+	LCUI_TextLayer layer = CreateTextLayer(height);
+
+	start = LCUI_GetTime();
+	TextLayer_SetTextW(layer, text, NULL);
+	TextLayer_Update(layer, NULL);
+	TextLayer_ClearInvalidRect(layer);
+	set_time = LCUI_GetTimeDelta(start);
+	/* 模拟在文本中间输入文字 */
+	TextLayer_SetCaretPos(layer, TextLayer_GetRowTotal(layer) / 2, 0);
+	start = LCUI_GetTime();
+	for (i = 0; i < INSERT_TIMES; ++i) {
+		TextLayer_InsertTextW(layer, L"a", NULL);
+		TextLayer_Update(layer, NULL);
+		TextLayer_ClearInvalidRect(layer);
+	}
+	insert_time = LCUI_GetTimeDelta(start);
+	render_time = RenderText(layer, canvas);
+	resize_time = ResizeText(layer, height);
+	sprintf(s_set, "%ldms", (long)set_time);
+	sprintf(s_insert, "%.2fms", 1.0 * insert_time / INSERT_TIMES);
+	sprintf(s_render, "%.2fms", 1.0 * render_time / RENDER_TIMES);
+	sprintf(s_resize, "%.2fms", 1.0 * resize_time / RESIZE_TIMES);
+	Logger_Info("%-20s%-12d%-24s%-24s%-16s%s\n", name,
+		    TextLayer_GetRowTotal(layer), s_set, s_insert, s_render,
+		    s_resize);
+	TextLayer_Destroy(layer);
+}
+
+int main(int argc, char **argv)
+{
+	wchar_t *text;
+	LCUI_Graph canvas;
+
+	text = malloc(sizeof(wchar_t) * (TEXT_LENGTH + 1));
+	if (!text) {
+		return -1;
+	}
+	Graph_Init(&canvas);
+	canvas.color_type = LCUI_COLOR_TYPE_ARGB;
+	Graph_Create(&canvas, LAYER_WIDTH, VIEW_HEIGHT);
+	LCUI_InitFontLibrary();
+	/* usage: test_textlayer_bench [font file] */
+	if (argc > 1) {
+		LCUIFont_LoadFile(argv[1]);
+	}
+	Logger_Info("%d characters, %dpx wide\n", TEXT_LENGTH, LAYER_WIDTH);
+	Logger_Info("%-20s%-12s%-24s%-24s%-16s%s\n", "document", "rows",
+		    "set text + typeset", "insert + typeset (avg)",
+		    "render (avg)", "resize (avg)");
+	GenerateText(text, TEXT_LENGTH, 500);
+	RunBench("paragraphs", text, 0, &canvas);
+	RunBench("paragraphs in view", text, VIEW_HEIGHT, &canvas);
+	GenerateText(text, TEXT_LENGTH, 0);
+	RunBench("single paragraph", text, 0, &canvas);
+	LCUI_FreeFontLibrary();
+	Graph_Free(&canvas);
+	free(text);
+	return 0;
+}
@@ -0,0 +1,504 @@
+#include <stdio.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/gui/widget.h>
+#include <LCUI/gui/css_parser.h>
+#include "test.h"
+#include "libtest.h"
+
+static const char *test_css = ".test-panel .test-item { width: 10px; }"
+			      ".test-panel.active .test-item { width: 20px; }"
+			      ".test-panel .test-item:hover { width: 30px; }";
+
+/** 检查选择器是否直接引用了部件及其祖先缓存的结点 */
+static LCUI_BOOL CheckSelectorNodes(LCUI_Widget w, LCUI_Selector s)
+{
+	int i;
+
+	for (i = s->length - 1; w && i >= 0; w = w->parent, --i) {
+		if (s->nodes[i] != Widget_GetCachedSelectorNode(w)) {
+			return FALSE;
+		}
+	}
+	return i < 0;
+}
+
+static void test_widget_selector(void)
+{
+	unsigned hash;
+	LCUI_SelectorRec s;
+	LCUI_Selector copy;
+	LCUI_SelectorNode node;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
+	LCUI_Widget root, panel, item;
+
+	root = LCUIWidget_GetRoot();
+	panel = LCUIWidget_New(NULL);
+	item = LCUIWidget_New(NULL);
+	Widget_AddClass(panel, "test-panel");
+	Widget_AddClass(item, "test-item");
+	Widget_Append(panel, item);
+	Widget_Append(root, panel);
+	LCUI_LoadCSSString(test_css, NULL);
+	LCUIWidget_Update();
+	it_i("check the width of .test-panel .test-item", (int)item->width,
+	     10);
+
+	node = Widget_GetCachedSelectorNode(item);
+	it_b("check the selector node is cached",
+	     node == Widget_GetCachedSelectorNode(item), TRUE);
+	node = Widget_GetSelectorNode(item);
+	it_b("check Widget_GetSelectorNode() returns a new node",
+	     node != Widget_GetCachedSelectorNode(item) &&
+		 node->hash == Widget_GetCachedSelectorNode(item)->hash,
+	     TRUE);
+	SelectorNode_Delete(node);
+	it_b("check the selector references cached nodes",
+	     Widget_InitSelector(item, &s, nodes) == 0 &&
+		 CheckSelectorNodes(item, &s),
+	     TRUE);
+	copy = Widget_GetSelector(item);
+	it_b("check the hash of the selector copy", copy->hash == s.hash,
+	     TRUE);
+	Selector_Delete(copy);
+
+	hash = s.hash;
+	Widget_AddClass(panel, "active");
+	Widget_InitSelector(item, &s, nodes);
+	it_b("check the selector hash is updated after the ancestor "
+	     "classes changed",
+	     s.hash != hash, TRUE);
+	LCUIWidget_Update();
+	it_i("check the width of .test-panel.active .test-item",
+	     (int)item->width, 20);
+
+	Widget_RemoveClass(panel, "active");
+	Widget_InitSelector(item, &s, nodes);
+	it_b("check the selector hash is restored after the class removed",
+	     s.hash == hash, TRUE);
+	Widget_AddStatus(item, "hover");
+	LCUIWidget_Update();
+	it_i("check the width of .test-panel .test-item:hover",
+	     (int)item->width, 30);
+	it_b("check the selector node is rebuilt after the status changed",
+	     !!strstr(Widget_GetCachedSelectorNode(item)->fullname, ":hover"),
+	     TRUE);
+	Widget_Destroy(panel);
+}
+
+static void test_widget_descendant_selector(void)
+{
+	int i;
+	char css[128];
+	LCUI_Widget root, box, panel, item;
+
+	for (i = 0; i < 20; ++i) {
+		sprintf(css, ".test-other-%d .test-item { height: %dpx; }", i,
+			i + 1);
+		LCUI_LoadCSSString(css, NULL);
+	}
+	LCUI_LoadCSSString(".test-box .test-panel .test-item { height: 40px; }"
+			   ".test-box .test-missing .test-item { width: 50px; }",
+			   NULL);
+	root = LCUIWidget_GetRoot();
+	box = LCUIWidget_New(NULL);
+	panel = LCUIWidget_New(NULL);
+	item = LCUIWidget_New(NULL);
+	Widget_AddClass(box, "test-box");
+	Widget_AddClass(panel, "test-panel");
+	Widget_AddClass(item, "test-item");
+	Widget_Append(panel, item);
+	Widget_Append(box, panel);
+	Widget_Append(root, box);
+	LCUIWidget_Update();
+	it_i("check the rule with matched ancestors is applied",
+	     (int)item->height, 40);
+	it_i("check the rule with missing ancestors is not applied",
+	     (int)item->width, 10);
+	Widget_AddClass(box, "test-other-7");
+	LCUIWidget_Update();
+	it_i("check the rule is applied after the ancestor class added",
+	     (int)item->height, 40);
+	Widget_AddClass(panel, "test-other-7");
+	Widget_RemoveClass(box, "test-box");
+	LCUIWidget_Update();
+	it_i("check the rule of the new ancestor class is applied",
+	     (int)item->height, 8);
+	Widget_Destroy(box);
+}
+
+static void test_widget_deep_selector(void)
+{
+	int i;
+	LCUI_Widget root, parent, w;
+
+	root = LCUIWidget_New(NULL);
+	for (i = 0, parent = root; i < MAX_SELECTOR_DEPTH + 8; ++i) {
+		w = LCUIWidget_New(NULL);
+		Widget_AddClass(w, "test-deep");
+		Widget_Append(parent, w);
+		parent = w;
+	}
+	it_b("check the inherited style of a too deep widget is empty",
+	     Widget_GetInheritedStyle(w, key_width)->is_valid, FALSE);
+	Widget_Destroy(root);
+}
+
+static LCUI_BOOL MatchSelectorNode(LCUI_SelectorNode node, const char *str)
+{
+	LCUI_BOOL matched;
+	LCUI_Selector s = Selector(str);
+
+	matched = SelectorNode_Match(node, s->nodes[0]);
+	Selector_Delete(s);
+	return matched;
+}
+
+static void test_selector_node_match(void)
+{
+	int i;
+	char name[32];
+	LCUI_Widget w;
+	LCUI_SelectorNode node;
+
+	w = LCUIWidget_New("textview");
+	Widget_AddClass(w, "test-a");
+	Widget_AddClass(w, "test-c");
+	node = Widget_GetCachedSelectorNode(w);
+	it_b("check matching the second class",
+	     MatchSelectorNode(node, ".test-c"), TRUE);
+	it_b("check matching the type and classes",
+	     MatchSelectorNode(node, "textview.test-c.test-a"), TRUE);
+	it_b("check matching the universal selector",
+	     MatchSelectorNode(node, "*.test-a"), TRUE);
+	it_b("check the id does not match the class of the same name",
+	     MatchSelectorNode(node, "#test-a"), FALSE);
+	it_b("check the missing status does not match",
+	     MatchSelectorNode(node, ".test-a:hover"), FALSE);
+	Widget_Destroy(w);
+
+	w = LCUIWidget_New(NULL);
+	for (i = 0; i < 20; ++i) {
+		sprintf(name, "test-many-%d", i);
+		Widget_AddClass(w, name);
+	}
+	LCUI_LoadCSSString(".test-many-5.test-many-12 { width: 12px; }",
+			   NULL);
+	Widget_Append(LCUIWidget_GetRoot(), w);
+	LCUIWidget_Update();
+	it_i("check the rule of the widget with many classes", (int)w->width,
+	     12);
+	Widget_Destroy(w);
+}
+
+/** 在缓存的样式表中做个标记，用于判断缓存是否被清除 */
+static LCUI_CachedStyleSheet MarkCachedStyleSheet(LCUI_Widget w)
+{
+	LCUI_Style s;
+	LCUI_SelectorRec selector;
+	LCUI_CachedStyleSheet sheet;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
+
+	Widget_InitSelector(w, &selector, nodes);
+	sheet = LCUI_GetCachedStyleSheet(&selector);
+	s = StyleSheet_AddStyle((LCUI_StyleSheet)sheet, key_z_index);
+	s->is_valid = TRUE;
+	s->type = LCUI_STYPE_INT;
+	s->val_int = 1234;
+	return sheet;
+}
+
+static LCUI_BOOL IsCachedStyleSheetMarked(LCUI_Widget w)
+{
+	LCUI_SelectorRec selector;
+	LCUI_CachedStyleSheet sheet;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
+
+	Widget_InitSelector(w, &selector, nodes);
+	sheet = LCUI_GetCachedStyleSheet(&selector);
+	return StyleSheet_CheckStyleType(sheet, key_z_index, LCUI_STYPE_INT) &&
+	       StyleSheet_GetStyle(sheet, key_z_index)->val_int == 1234;
+}
+
+static void test_widget_style_cache(void)
+{
+	LCUI_Widget w = LCUIWidget_New(NULL);
+
+	Widget_AddClass(w, "test-cache");
+	Widget_AddStatus(w, "test-state");
+	LCUI_LoadCSSString(".test-cache { width: 10px; }", NULL);
+
+	MarkCachedStyleSheet(w);
+	LCUI_LoadCSSString(".test-other { width: 20px; }"
+			   ".test-cache .test-other { width: 20px; }",
+			   NULL);
+	it_b("check the cache is kept after unrelated rules are added",
+	     IsCachedStyleSheetMarked(w), TRUE);
+	LCUI_LoadCSSString(".test-cache:test-state { height: 20px; }", NULL);
+	it_b("check the cache is cleared after a related rule is added",
+	     IsCachedStyleSheetMarked(w), FALSE);
+	it_i("check the style of the new rule is applied",
+	     (int)StyleSheet_GetStyle(MarkCachedStyleSheet(w), key_height)->val_px,
+	     20);
+
+	LCUI_BeginPutStyleSheets();
+	LCUI_LoadCSSString(".test-cache { height: 30px; }", NULL);
+	it_b("check the cache is kept before the batch ends",
+	     IsCachedStyleSheetMarked(w), TRUE);
+	LCUI_EndPutStyleSheets();
+	it_b("check the cache is cleared after the batch ends",
+	     IsCachedStyleSheetMarked(w), FALSE);
+
+	MarkCachedStyleSheet(w);
+	LCUI_LoadCSSString(".test-other * { height: 40px; }", NULL);
+	it_b("check the cache is cleared after a universal rule is added",
+	     IsCachedStyleSheetMarked(w), FALSE);
+	Widget_Destroy(w);
+}
+
+static void test_widget_style_cache_index(void)
+{
+	int i;
+	LCUI_BOOL ok = TRUE;
+	LCUI_SelectorRec selector;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
+	LCUI_Widget w = LCUIWidget_New(NULL);
+	const char *names[] = { "#test-index", ".test-index-a", ".test-index-b",
+				":test-index-on" };
+
+	Widget_SetId(w, "test-index");
+	Widget_AddClass(w, "test-index-a");
+	Widget_AddClass(w, "test-index-b");
+	Widget_AddStatus(w, "test-index-on");
+	Widget_InitSelector(w, &selector, nodes);
+	LCUI_GetCachedStyleSheet(&selector);
+	for (i = 0; i < 4; ++i) {
+		if (LCUI_GetStyleSheetCacheIndexSize(names[i]) != 1) {
+			ok = FALSE;
+		}
+	}
+	it_b("check the cache is indexed by every name of the widget", ok,
+	     TRUE);
+	LCUI_LoadCSSString(".test-index-b { width: 10px; }", NULL);
+	for (ok = TRUE, i = 0; i < 4; ++i) {
+		if (LCUI_GetStyleSheetCacheIndexSize(names[i]) != 0) {
+			ok = FALSE;
+		}
+	}
+	it_b("check the cache is removed from every index after it is "
+	     "cleared by one name",
+	     ok, TRUE);
+	Widget_Destroy(w);
+}
+
+static void test_widget_style_sharing(void)
+{
+	int i;
+	LCUI_BOOL ok = TRUE;
+	LCUI_WidgetTasksProfileRec profile = { 0 };
+	LCUI_Widget root, list, items[8];
+
+	LCUI_LoadCSSString(".test-share-list .test-share-item { width: 11px; }"
+			   "#test-share-special { width: 22px; }"
+			   ".test-share-item.active { width: 33px; }",
+			   NULL);
+	root = LCUIWidget_GetRoot();
+	list = LCUIWidget_New(NULL);
+	Widget_AddClass(list, "test-share-list");
+	for (i = 0; i < 8; ++i) {
+		items[i] = LCUIWidget_New(NULL);
+		Widget_AddClass(items[i], "test-share-item");
+		Widget_Append(list, items[i]);
+	}
+	Widget_SetId(items[3], "test-share-special");
+	Widget_AddClass(items[5], "active");
+	Widget_Append(root, list);
+	LCUIWidget_UpdateWithProfile(&profile);
+	for (i = 0; i < 8; ++i) {
+		if (i != 3 && i != 5 && items[i]->width != 11) {
+			ok = FALSE;
+		}
+	}
+	it_b("check the style of the same siblings", ok, TRUE);
+	it_b("check the style is shared between the same siblings",
+	     profile.style_share_count >= 2, TRUE);
+	it_b("check the shared style is the same cached style sheet",
+	     items[1]->inherited_style == items[2]->inherited_style, TRUE);
+	it_i("check the sibling with id does not share the style",
+	     (int)items[3]->width, 22);
+	it_i("check the sibling with other classes does not share the style",
+	     (int)items[5]->width, 33);
+
+	LCUI_LoadCSSString(".test-share-list .test-share-item { height: 44px; }",
+			   NULL);
+	Widget_UpdateStyle(list, TRUE);
+	Widget_UpdateChildrenStyle(list, TRUE);
+	LCUIWidget_Update();
+	for (ok = TRUE, i = 0; i < 8; ++i) {
+		if (items[i]->height != 44) {
+			ok = FALSE;
+		}
+	}
+	it_b("check the shared style is updated after a new rule added", ok,
+	     TRUE);
+	Widget_Destroy(list);
+}
+
+/** 在更新时给父部件添加类，模拟兄弟部件更新期间祖先的选择器发生变化 */
+static void OnToggleParentClass(LCUI_Widget w, int task)
+{
+	if (task == LCUI_WTASK_USER) {
+		Widget_AddClass(w->parent, "test-share-on");
+	}
+}
+
+static void test_widget_style_sharing_ancestors(void)
+{
+	int i;
+	LCUI_Widget root, list, toggler, items[4];
+	LCUI_WidgetPrototype proto;
+
+	LCUI_LoadCSSString(".test-share-item2 { width: 10px; }"
+			   ".test-share-on .test-share-item2 { width: 50px; }",
+			   NULL);
+	proto = LCUIWidget_NewPrototype("test-share-toggler", NULL);
+	proto->runtask = OnToggleParentClass;
+	root = LCUIWidget_GetRoot();
+	list = LCUIWidget_New(NULL);
+	for (i = 0; i < 4; ++i) {
+		items[i] = LCUIWidget_New(NULL);
+		Widget_AddClass(items[i], "test-share-item2");
+	}
+	toggler = LCUIWidget_New("test-share-toggler");
+	/* 首尾的部件带有结构伪类，中间两个部件才会共享样式 */
+	Widget_Append(list, items[0]);
+	Widget_Append(list, items[1]);
+	Widget_Append(list, toggler);
+	Widget_Append(list, items[2]);
+	Widget_Append(list, items[3]);
+	Widget_Append(root, list);
+	Widget_AddTask(toggler, LCUI_WTASK_USER);
+	LCUIWidget_Update();
+	it_i("check the sibling updated after the parent class changed does "
+	     "not share the stale style",
+	     (int)items[2]->width, 50);
+	LCUIWidget_Update();
+	it_i("check the sibling updated before the parent class changed is "
+	     "updated later",
+	     (int)items[1]->width, 50);
+	Widget_Destroy(list);
+}
+
+static void test_widget_style_dependency(void)
+{
+	LCUI_Widget root, parent, child;
+
+	LCUI_LoadCSSString(".test-dep-parent.test-dep-on .test-dep-child "
+			   "{ width: 60px; }"
+			   ".test-dep-parent:test-dep-hover .test-dep-child "
+			   "{ height: 60px; }"
+			   ".test-dep-off { width: 70px; }",
+			   NULL);
+	it_b("check the class in the ancestor position is indexed",
+	     LCUI_IsAncestorSelectorName('.', "test-dep-on"), TRUE);
+	it_b("check the status in the ancestor position is indexed",
+	     LCUI_IsAncestorSelectorName(':', "test-dep-hover"), TRUE);
+	it_b("check the class only in the rightmost position is not indexed",
+	     LCUI_IsAncestorSelectorName('.', "test-dep-off"), FALSE);
+
+	root = LCUIWidget_GetRoot();
+	parent = LCUIWidget_New(NULL);
+	child = LCUIWidget_New(NULL);
+	Widget_AddClass(parent, "test-dep-parent");
+	Widget_AddClass(child, "test-dep-child");
+	Widget_Append(parent, child);
+	Widget_Append(root, parent);
+	LCUIWidget_Update();
+	Widget_AddClass(parent, "test-dep-off");
+	it_b("check toggling an unrelated class does not restyle children",
+	     child->task.states[LCUI_WTASK_REFRESH_STYLE], FALSE);
+	Widget_AddStatus(parent, "test-dep-other");
+	it_b("check toggling an unrelated status does not restyle children",
+	     child->task.states[LCUI_WTASK_REFRESH_STYLE], FALSE);
+	Widget_AddClass(parent, "test-dep-on");
+	it_b("check toggling a related class restyles children",
+	     child->task.states[LCUI_WTASK_REFRESH_STYLE], TRUE);
+	LCUIWidget_Update();
+	it_i("check the width of the child after the class added",
+	     (int)child->width, 60);
+	Widget_AddStatus(parent, "test-dep-hover");
+	LCUIWidget_Update();
+	it_i("check the height of the child after the status added",
+	     (int)child->height, 60);
+	Widget_Destroy(parent);
+}
+
+static void test_stylesheet_merge(void)
+{
+	LCUI_StyleSheet a = StyleSheet();
+	LCUI_StyleSheet b = StyleSheet();
+
+	SetStyle(a, key_width, 10, px);
+	SetStyle(a, key_top, 5, px);
+	SetStyle(b, key_z_index, 7, int);
+	SetStyle(b, key_width, 20, px);
+	SetStyle(b, key_left, 3, px);
+	SetStyle(b, key_background_image, strdup2("a.png"), string);
+	it_i("check the number of styles", a->length, 2);
+	it_b("check the missing style is invalid",
+	     StyleSheet_GetStyle(a, key_height)->is_valid, FALSE);
+	it_b("check the style of an unknown key is invalid",
+	     StyleSheet_GetStyle(a, LCUI_GetStyleTotal() + 64)->is_valid,
+	     FALSE);
+
+	StyleSheet_Merge(a, b);
+	it_i("check the number of styles after merged", a->length, 5);
+	it_b("check the styles are stored in the order of keys",
+	     StyleSheet_GetStyle(a, key_top) <
+		 StyleSheet_GetStyle(a, key_z_index),
+	     TRUE);
+	it_i("check the merged style does not override the existing style",
+	     (int)StyleSheet_GetStyle(a, key_width)->val_px, 10);
+	it_i("check the merged style is added",
+	     StyleSheet_GetStyle(a, key_z_index)->val_int, 7);
+	it_b("check the merged string style is copied",
+	     StyleSheet_GetStyle(a, key_background_image)->val_string !=
+		 StyleSheet_GetStyle(b, key_background_image)->val_string,
+	     TRUE);
+
+	it_i("check the number of replaced styles", StyleSheet_Replace(a, b),
+	     4);
+	it_i("check the replaced style",
+	     (int)StyleSheet_GetStyle(a, key_width)->val_px, 20);
+	it_i("check the style that is not in the source is kept",
+	     (int)StyleSheet_GetStyle(a, key_top)->val_px, 5);
+
+	UnsetStyle(a, key_top);
+	it_b("check the style is removed",
+	     StyleSheet_GetStyle(a, key_top)->is_valid, FALSE);
+	it_i("check the number of styles after removed", a->length, 4);
+	StyleSheet_Clear(a);
+	it_i("check the number of styles after cleared", a->length, 0);
+	StyleSheet_Delete(a);
+	StyleSheet_Delete(b);
+}
+
+void test_widget_style(void)
+{
+	LCUI_Init();
+	describe("test widget selector", test_widget_selector);
+	describe("test widget descendant selector",
+		 test_widget_descendant_selector);
+	describe("test widget deep selector", test_widget_deep_selector);
+	describe("test selector node match", test_selector_node_match);
+	describe("test widget style cache", test_widget_style_cache);
+	describe("test widget style cache index",
+		 test_widget_style_cache_index);
+	describe("test stylesheet merge", test_stylesheet_merge);
+	describe("test widget style sharing", test_widget_style_sharing);
+	describe("test widget style sharing with changed ancestors",
+		 test_widget_style_sharing_ancestors);
+	describe("test widget style dependency", test_widget_style_dependency);
+	LCUI_Destroy();
+}
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <LCUI_Build.h>
+#include <LCUI/LCUI.h>
+#include <LCUI/gui/widget.h>
+#include <LCUI/gui/css_parser.h>
+
+#define PANELS 10
+#define LISTS 100
+#define ITEMS 9
+#define RULES 200
+#define MATCH_PASSES 5
+#define UPDATE_PASSES 5
+#define COMPILED_CSS_FILE "test_widget_style_bench.cssb"
+
+static size_t widgets_count = 0;
+static size_t style_share_count = 0;
+static size_t style_lookup_count = 0;
+
+/** 创建一个 10k 个结点的部件树：面板 > 列表 > 列表项，列表项有三种样式 */
+static LCUI_Widget CreateTree(void)
+{
+	int i, j, k;
+	char name[32];
+	LCUI_Widget app, panel, list, item;
+
+	app = LCUIWidget_New(NULL);
+	Widget_SetId(app, "app");
+	for (i = 0; i < PANELS; ++i) {
+		panel = LCUIWidget_New(NULL);
+		sprintf(name, "panel-%d", i);
+		Widget_AddClass(panel, "panel");
+		Widget_AddClass(panel, name);
+		Widget_Append(app, panel);
+		for (j = 0; j < LISTS; ++j) {
+			list = LCUIWidget_New(NULL);
+			sprintf(name, "list-%d", j);
+			Widget_AddClass(list, "list");
+			Widget_AddClass(list, name);
+			Widget_Append(panel, list);
+			for (k = 0; k < ITEMS; ++k) {
+				item = LCUIWidget_New("textview");
+				sprintf(name, "item-%d", k % 3);
+				Widget_AddClass(item, "item");
+				Widget_AddClass(item, name);
+				Widget_Append(list, item);
+			}
+			widgets_count += ITEMS + 1;
+		}
+		widgets_count += 1;
+	}
+	widgets_count += 1;
+	return app;
+}
+
+/** 加载大量后代选择器规则，大部分规则的祖先部分都不会匹配 */
+static int64_t LoadStyleSheets(void)
+{
+	int i;
+	char css[256];
+	int64_t start = LCUI_GetTime();
+
+	for (i = 0; i < RULES; ++i) {
+		sprintf(css,
+			".sidebar-%d .menu .item { width: %dpx; }"
+			".panel-%d .list-%d .item-%d { height: %dpx; }"
+			"#app .panel .list-%d textview { margin-top: 1px; }",
+			i, i, i % PANELS, i % LISTS, i % 3, i, i);
+		LCUI_LoadCSSString(css, "bench");
+	}
+	return LCUI_GetTimeDelta(start);
+}
+
+/** 在新的样式库中载入由上面的规则生成的预编译样式表 */
+static int64_t LoadCompiledStyleSheets(void)
+{
+	int64_t start;
+
+	LCUI_Init();
+	start = LCUI_GetTime();
+	LCUI_LoadCompiledCSSFile(COMPILED_CSS_FILE);
+	start = LCUI_GetTimeDelta(start);
+	LCUI_Destroy();
+	remove(COMPILED_CSS_FILE);
+	return start;
+}
+
+static void MatchWidget(LCUI_Widget w, void *arg)
+{
+	LinkedList list;
+	LCUI_SelectorRec s;
+	LCUI_SelectorNode nodes[MAX_SELECTOR_DEPTH];
+
+	LinkedList_Init(&list);
+	Widget_InitSelector(w, &s, nodes);
+	LCUI_FindStyleSheet(&s, &list);
+	LinkedList_Clear(&list, NULL);
+}
+
+static void CountStyleMemory(LCUI_Widget w, void *arg)
+{
+	size_t *size = arg;
+
+	*size += sizeof(LCUI_StyleSheetRec);
+	*size += w->style->bits_length * sizeof(unsigned);
+	*size += w->style->capacity * sizeof(LCUI_StyleRec);
+}
+
+/** 为树中的每个部件查找样式表 */
+static int64_t MatchTree(LCUI_Widget root)
+{
+	int i;
+	int64_t start = LCUI_GetTime();
+
+	for (i = 0; i < MATCH_PASSES; ++i) {
+		Widget_Each(root, MatchWidget, NULL);
+	}
+	return LCUI_GetTimeDelta(start);
+}
+
+/** 清空样式表缓存，然后刷新全部部件的样式 */
+static int64_t UpdateTree(LCUI_Widget root)
+{
+	int i;
+	int64_t start, total = 0;
+	LCUI_WidgetTasksProfileRec profile;
+
+	for (i = 0; i < UPDATE_PASSES; ++i) {
+		LCUI_LoadCSSString(".bench-cache-clear * { width: 1px; }",
+				   NULL);
+		Widget_UpdateStyle(root, TRUE);
+		Widget_UpdateChildrenStyle(root, TRUE);
+		memset(&profile, 0, sizeof(profile));
+		start = LCUI_GetTime();
+		LCUIWidget_UpdateWithProfile(&profile);
+		total += LCUI_GetTimeDelta(start);
+		style_share_count += profile.style_share_count;
+		style_lookup_count += profile.style_lookup_count;
+	}
+	return total;
+}
+
+int main(void)
+{
+	LCUI_Widget app;
+	size_t count, memory = 0;
+	int64_t load_time, compiled_time, match_time, update_time;
+	char s_match[32], s_update[32], s_share[32];
+
+	LCUI_Init();
+	load_time = LoadStyleSheets();
+	LCUI_SaveCompiledCSS(COMPILED_CSS_FILE, "bench");
+	app = CreateTree();
+	Widget_Append(LCUIWidget_GetRoot(), app);
+	LCUIWidget_Update();
+	match_time = MatchTree(app);
+	update_time = UpdateTree(app);
+	sprintf(s_match, "%.2fms", 1.0 * match_time / MATCH_PASSES);
+	sprintf(s_update, "%.2fms", 1.0 * update_time / UPDATE_PASSES);
+	count = style_share_count + style_lookup_count;
+	sprintf(s_share, "%.1f%%",
+		count > 0 ? 100.0 * style_share_count / count : 0);
+	Logger_Info("%lu widgets, %d rules\n", (unsigned long)widgets_count,
+		    RULES * 3);
+	Logger_Info("%-24s%-24s%s\n", "match (avg)", "refresh style (avg)",
+		    "style sharing");
+	Logger_Info("%-24s%-24s%s\n", s_match, s_update, s_share);
+	/* 与每个部件都按属性总数分配样式数组的方式对比 */
+	Widget_Each(app, CountStyleMemory, &memory);
+	Logger_Info("computed styles: %luKB, %luKB if dense\n",
+		    (unsigned long)memory / 1024,
+		    (unsigned long)(widgets_count *
+				    (sizeof(LCUI_StyleSheetRec) +
+				     LCUI_GetStyleTotal() * sizeof(LCUI_StyleRec)) /
+				    1024));
+	LCUI_Destroy();
+	compiled_time = LoadCompiledStyleSheets();
+	Logger_Info("load css: %ldms, load compiled css: %ldms\n",
+		    (long)load_time, (long)compiled_time);
+	return 0;
+}